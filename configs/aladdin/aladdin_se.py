@@ -59,6 +59,7 @@ from common import Options
 from common import Simulation
 from common import CacheConfig
 from common import MemConfig
+from common import SweepServer
 
 from common.Caches import *
 from common.cpu2000 import *
@@ -124,6 +125,7 @@ parser = optparse.OptionParser()
 Options.addCommonOptions(parser)
 Options.addSEOptions(parser)
 addAladdinOptions(parser)
+SweepServer.addSweepOptions(parser)
 
 if '--ruby' in sys.argv:
     Ruby.define_options(parser)
@@ -134,6 +136,11 @@ if args:
     print "Error: script doesn't take any positional arguments"
     sys.exit(1)
 
+# In sweep server mode, only the forked children get past this point,
+# each with the accelerator config of its own design point.
+if options.sweep_server:
+    _, options.accel_cfg_file = SweepServer.serve(options)
+
 multiprocesses = []
 numThreads = 1
 
@@ -311,8 +318,8 @@ for i in xrange(np):
         system.cpu[i].fastmem = True
 
     if options.simpoint_profile:
-        system.cpu[i].simpoint_profile = True
-        system.cpu[i].simpoint_interval = options.simpoint_interval
+        system.cpu[i].addSimPointProbe(options.simpoint_interval,
+                                       options.simpoint_accel_weight)
 
     if options.checker:
         system.cpu[i].addCheckerCpu()
@@ -43,16 +43,75 @@
 
 import m5
 from m5.objects import *
+from m5.util import convert, fatal
 from Caches import *
 
 def prefetcher_names():
     return ["tagged", "ghb", "stride"]
 
+def parallel_lookahead(options):
+    """Lookahead of the event queues of --parallel-cores in ticks. It is
+    the delay of the domain bridges in front of the crossbar to the L2,
+    which take over one cycle of the crossbar's latency."""
+    return int(round(convert.anyToLatency(options.sys_clock) *
+                     m5.ticks.tps))
+
+def parallel_quantum(options):
+    """Synchronisation quantum of --parallel-cores in ticks, by default
+    the lookahead."""
+    lookahead = parallel_lookahead(options)
+    if options.parallel_quantum is None:
+        return lookahead
+    if options.parallel_quantum > lookahead:
+        fatal("--parallel-quantum (%d) must not exceed the lookahead of "
+              "one crossbar cycle (%d ticks)" %
+              (options.parallel_quantum, lookahead))
+    return options.parallel_quantum
+
+def connect_partitioned(cpu, eventq_index, cached_bus, uncached_bus, delay):
+    """Move a core and its private caches to their own event queue, and
+    connect them to the buses of the shared part of the system, which
+    stays on queue 0, through domain bridges with the given delay in
+    ticks. The bridges answer the snoops of the crossbar for the caches
+    above them, which therefore write back clean blocks."""
+
+    cpu.eventq_index = eventq_index
+    delay = '%dt' % delay
+
+    for c in ['icache', 'dcache', 'itb_walker_cache', 'dtb_walker_cache']:
+        if hasattr(cpu, c):
+            getattr(cpu, c).writeback_clean = True
+
+    bridges = []
+    for port in cpu._cached_ports:
+        bridge = DomainBridge(delay=delay)
+        exec('cpu.%s = bridge.slave' % port)
+        bridge.master = cached_bus.slave
+        bridges.append(bridge)
+    for port in cpu._uncached_master_ports:
+        bridge = DomainBridge(delay=delay)
+        exec('cpu.%s = bridge.slave' % port)
+        bridge.master = uncached_bus.slave
+        bridges.append(bridge)
+    # Devices in the core, e.g. the interrupt controller, are accessed
+    # from the shared side, so these bridges cross the other way
+    for port in cpu._uncached_slave_ports:
+        bridge = DomainBridge(delay=delay, eventq_index=0,
+                              mem_side_eventq_index=eventq_index)
+        exec('cpu.%s = bridge.master' % port)
+        bridge.slave = uncached_bus.master
+        bridges.append(bridge)
+    cpu.domain_bridges = bridges
+
 def config_cache(options, system):
     if options.external_memory_system and (options.caches or options.l2cache):
         print "External caches and internal caches are exclusive options.\n"
         sys.exit(1)
 
+    if options.parallel_cores and not (options.caches and options.l2cache):
+        print "--parallel-cores requires --caches and --l2cache.\n"
+        sys.exit(1)
+
     if options.external_memory_system:
         ExternalCache = ExternalCacheFactory(options.external_memory_system)
 
@@ -113,6 +172,12 @@ def config_cache(options, system):
                                    response_latency=options.l2_hit_latency)
 
         system.tol2bus = L2XBar(clk_domain = system.clk_domain)
+        if options.parallel_cores:
+            # The domain bridges in front of the crossbar add the cycle
+            # it would otherwise spend on requests and responses
+            system.tol2bus.frontend_latency = 0
+            system.tol2bus.response_latency = 0
+            system.tol2bus.snoop_response_latency = 0
         system.l2.cpu_side = system.tol2bus.master
         system.l2.mem_side = system.membus.slave
 
@@ -186,7 +251,10 @@ def config_cache(options, system):
 
         system.cpu[i].createInterruptController()
 
-        if options.l2cache:
+        if options.parallel_cores:
+            connect_partitioned(system.cpu[i], i + 1, system.tol2bus,
+                                system.membus, parallel_lookahead(options))
+        elif options.l2cache:
             system.cpu[i].connectAllPorts(system.tol2bus, system.membus)
         elif options.external_memory_system:
             system.cpu[i].connectUncachedPorts(system.membus)
@@ -120,6 +120,15 @@ def addNoISAOptions(parser):
     parser.add_option("--l2_hit_latency", type="int", default="20")
     parser.add_option("--cacheline_size", type="int", default=64)
     parser.add_option("--xbar_width", type="int", default=16)
+    parser.add_option("--parallel-cores", action="store_true",
+                      help="""Simulate each core and its private caches on
+                      its own event queue and host thread, behind domain
+                      bridges in front of the crossbar to the L2 (requires
+                      --caches and --l2cache, x86 only)""")
+    parser.add_option("--parallel-quantum", type="int", default=None,
+                      help="""Synchronisation quantum of --parallel-cores in
+                      ticks, at most and by default the lookahead of one
+                      cycle of --sys-clock""")
     parser.add_option("--record-dram-traffic", action="store_true",
         help="Record DRAM memory traffic packets to file (requires protobuf).")
 
@@ -240,7 +249,14 @@ def addCommonOptions(parser):
     parser.add_option("--simpoint-interval", type="int", default=10000000,
                       help="SimPoint interval in num of instructions")
     parser.add_option("--take-simpoint-checkpoints", action="store", type="string",
-        help="<simpoint file,weight file,interval-length,warmup-length>")
+        help="<simpoint file,weight file,interval-length,warmup-length> or "
+             "<bbv file,interval-length,warmup-length> to pick the "
+             "simpoints from a --simpoint-profile BBV file")
+    parser.add_option("--simpoint-max-k", type="int", default=30,
+        help="Maximum number of simpoints picked from a BBV file")
+    parser.add_option("--simpoint-accel-weight", type="float", default=0.1,
+        help="Weight of an accelerator invocation in the BBVs, as a "
+             "fraction of the SimPoint interval (0 to ignore them)")
     parser.add_option("--restore-simpoint-checkpoint", action="store_true",
         help="restore from a simpoint checkpoint taken with " +
              "--take-simpoint-checkpoints")
@@ -258,6 +274,14 @@ def addCommonOptions(parser):
         help="restore from checkpoint <N>")
     parser.add_option("--checkpoint-at-end", action="store_true",
                       help="take a checkpoint at end of run")
+    parser.add_option("--mem-checkpoint-format", type="choice",
+                      default="gzip",
+                      choices=["gzip", "sparse", "sparse_raw"],
+                      help="format used to checkpoint physical memory")
+    parser.add_option("--mem-checkpoint-mmap", action="store_true",
+                      help="map 'sparse_raw' memory checkpoints on restore "
+                      "instead of copying them; the checkpoint must not "
+                      "change during the run")
     parser.add_option("--work-begin-checkpoint-count", action="store", type="int",
                       help="checkpoint at specified work begin count")
     parser.add_option("--work-end-checkpoint-count", action="store", type="int",
@@ -290,6 +314,21 @@ def addCommonOptions(parser):
     parser.add_option("-F", "--fast-forward", action="store", type="string",
         default=None,
         help="Number of instructions to fast forward before switching")
+    parser.add_option("--sampling", action="store", type="string",
+        default=None,
+        help="""<unit,period>: Run the detailed CPU for 'unit' instructions
+                out of every 'period' instructions and the atomic CPU for
+                the rest (SMARTS-style sampling).""")
+    parser.add_option("--sampling-warmup", type="int", default=2000,
+        help="Instructions run on the detailed CPU before each sample")
+    parser.add_option("--sampling-functional-warmup", type="int",
+        default=None,
+        help="""Instructions run through the caches and branch predictor
+                before each detailed warmup. The rest of the period is fast
+                forwarded. Defaults to the whole period.""")
+    parser.add_option("--sampling-confidence", type="float", default=0.997,
+        help="Confidence level of the sampled CPI and accelerator wait "
+             "estimates")
     parser.add_option("-S", "--simpoint", action="store_true", default=False,
         help="""Use workload simpoints as an instruction offset for
                 --checkpoint-restore or --take-checkpoint.""")
@@ -329,6 +368,10 @@ def addSEOptions(parser):
                       help="Redirect stdout to a file.")
     parser.add_option("--errout", default="",
                       help="Redirect stderr to a file.")
+    parser.add_option("--map-executable", action="store_true",
+                      help="""Map the binary copy-on-write instead of
+                              copying it. The binary must not be modified
+                              until the simulation ends.""")
 
 def addFSOptions(parser):
     from FSConfig import os_types
@@ -0,0 +1,240 @@
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# SMARTS-style sampled simulation.
+#
+# The workload runs on the atomic CPU and switches to the detailed CPU
+# for a short measurement unit once every sampling period:
+#
+#   |-- fast forward --|-- functional warming --|-- detailed warmup --|-- unit --|
+#   |<------------------------------- period -------------------------------->|
+#
+# While fast forwarding, the atomic CPU accesses memory directly and
+# leaves the branch predictor alone. While functionally warming, it
+# goes through the caches and trains the branch predictor it shares
+# with the detailed CPU, so that both are warm when the detailed CPU
+# takes over. By default the whole gap between units is functionally
+# warmed, as in SMARTS. The detailed warmup fills the pipeline before
+# the unit is measured.
+#
+# The CPI of each unit, and the fraction of it during which the host
+# was waiting for an accelerator, are sampled. An accelerator is waited
+# for from its invocation until its datapath sets the finish flag, which
+# the system checks every ACCEL_POLL_PERIOD. At the end of the run the
+# means are reported with confidence intervals, along with the number of
+# units needed for a +-3% CPI estimate.
+
+import math
+from os.path import join as joinpath
+
+import m5
+from m5.objects import AtomicSimpleCPU
+from m5.util import fatal
+
+STEP_DONE = "sampling step done"
+ACCEL_POLL_PERIOD = "10ns"
+
+def parseSchedule(options):
+    """Return (unit, detailed warmup, functional warmup, fast forward)"""
+
+    try:
+        unit, period = [int(f) for f in options.sampling.split(",")]
+    except ValueError:
+        fatal("--sampling takes <unit,period> instruction counts")
+    gap = period - unit - options.sampling_warmup
+    if unit <= 0 or options.sampling_warmup < 0 or gap <= 0:
+        fatal("The sampling period must be longer than the unit and its "
+              "detailed warmup")
+    warming = gap
+    if options.sampling_functional_warmup is not None:
+        warming = max(0, min(gap, options.sampling_functional_warmup))
+    return unit, options.sampling_warmup, warming, gap - warming
+
+def setup(options, testsys, switch_cpus):
+    """
+    Check the CPUs and share the branch predictors of the detailed CPUs
+    with the atomic ones. Called before instantiation.
+    """
+
+    parseSchedule(options)
+    if not isinstance(testsys.cpu[0], AtomicSimpleCPU):
+        fatal("Sampling needs the atomic CPU to run between units")
+    if not switch_cpus:
+        fatal("Sampling needs a detailed --cpu-type")
+
+    for atomic, detailed in zip(testsys.cpu, switch_cpus):
+        bpred = getattr(detailed, "branchPred", None)
+        if bpred is None:
+            continue
+        if not bpred.has_parent():
+            detailed.branchPred = bpred
+        atomic.branchPred = bpred
+
+    testsys.accel_poll_period = ACCEL_POLL_PERIOD
+
+def _zScore(confidence):
+    """Two-sided z score of a confidence level"""
+
+    lo, hi = 0.0, 10.0
+    for i in range(100):
+        mid = (lo + hi) / 2
+        if math.erf(mid / math.sqrt(2.0)) < confidence:
+            lo = mid
+        else:
+            hi = mid
+    return hi
+
+def _meanCI(samples, z):
+    """Mean and confidence interval half width of the samples"""
+
+    n = len(samples)
+    mean = sum(samples) / float(n)
+    if n < 2:
+        return mean, float('inf'), 0.0
+    var = sum((x - mean) ** 2 for x in samples) / (n - 1)
+    return mean, z * math.sqrt(var / n), math.sqrt(var)
+
+def _clockPeriod(cpu):
+    domain = cpu.clk_domain
+    divider = 1
+    while not hasattr(domain, "clock"):
+        divider *= domain.clk_divider
+        domain = domain.clk_domain
+    return domain.clock[0].getValue() * divider
+
+class Sampler(object):
+    def __init__(self, options, testsys, switch_cpu_list, maxtick):
+        self.options = options
+        self.testsys = testsys
+        self.atomic_cpus = [old for old, new in switch_cpu_list]
+        self.detailed_cpus = [new for old, new in switch_cpu_list]
+        self.to_detailed = switch_cpu_list
+        self.to_atomic = [(new, old) for old, new in switch_cpu_list]
+        self.maxtick = maxtick
+        self.period = _clockPeriod(self.detailed_cpus[0])
+        self.insts = 0
+        self.units = []
+
+    def step(self, cpu, insts):
+        """
+        Run 'insts' instructions on a CPU. Returns None when done, or the
+        exit event that ended the simulation.
+        """
+
+        if insts <= 0:
+            return None
+        cpu.scheduleInstStop(0, insts, STEP_DONE)
+        while True:
+            exit_event = m5.simulate(self.maxtick - m5.curTick())
+            cause = exit_event.getCause()
+            if cause == STEP_DONE:
+                self.insts += insts
+                return None
+            # Checkpoint and stats requests of the workload are not
+            # meaningful in a sampled run
+            if cause != "checkpoint" and \
+               not cause.startswith("statistics_dump:") and \
+               not cause.startswith("statistics_reset:"):
+                return exit_event
+
+    def fastForward(self, insts):
+        if insts <= 0:
+            return None
+        # Direct memory accesses would miss dirty lines in the caches
+        m5.drain()
+        m5.memWriteback(self.testsys)
+        m5.memInvalidate(self.testsys)
+        for cpu in self.atomic_cpus:
+            cpu.setFastForward(True)
+        exit_event = self.step(self.atomic_cpus[0], insts)
+        for cpu in self.atomic_cpus:
+            cpu.setFastForward(False)
+        return exit_event
+
+    def measure(self, unit):
+        start_tick = m5.curTick()
+        start_wait = self.testsys.acceleratorWaitTicks()
+        exit_event = self.step(self.detailed_cpus[0], unit)
+        if exit_event is None:
+            ticks = m5.curTick() - start_tick
+            wait = self.testsys.acceleratorWaitTicks() - start_wait
+            self.units.append((self.insts - unit,
+                               ticks / float(self.period) / unit,
+                               wait / float(ticks) if ticks else 0.0))
+        return exit_event
+
+    def run(self):
+        unit, warmup, warming, fast_forward = parseSchedule(self.options)
+        print "Sampling: unit %d, detailed warmup %d, functional warming " \
+            "%d, fast forward %d instructions" % \
+            (unit, warmup, warming, fast_forward)
+
+        exit_event = self.fastForward(int(self.options.fast_forward or 0))
+        while exit_event is None:
+            exit_event = self.fastForward(fast_forward) or \
+                self.step(self.atomic_cpus[0], warming)
+            if exit_event is not None:
+                break
+            m5.switchCpus(self.testsys, self.to_detailed, verbose=False)
+            exit_event = self.step(self.detailed_cpus[0], warmup) or \
+                self.measure(unit)
+            if exit_event is not None:
+                break
+            m5.switchCpus(self.testsys, self.to_atomic, verbose=False)
+
+        self.report()
+        return exit_event
+
+    def report(self):
+        lines = ["Sampled %d units over %d instructions" %
+                 (len(self.units), self.insts)]
+        if self.units:
+            confidence = self.options.sampling_confidence
+            z = _zScore(confidence)
+            cpi, cpi_ci, cpi_sd = _meanCI([u[1] for u in self.units], z)
+            lines.append("CPI %.4f +- %.4f (%.2f%%) at %.1f%% confidence" %
+                         (cpi, cpi_ci, 100.0 * cpi_ci / cpi,
+                          100.0 * confidence))
+            if cpi_sd > 0:
+                needed = int(math.ceil((z * cpi_sd / (0.03 * cpi)) ** 2))
+                lines.append("Units needed for +-3%% CPI: %d" % needed)
+            wait, wait_ci, wait_sd = _meanCI([u[2] for u in self.units], z)
+            est_ticks = self.insts * cpi * self.period
+            lines.append("Accelerator wait %.2f%% +- %.2f%% of the time, "
+                         "about %d ticks" % (100.0 * wait, 100.0 * wait_ci,
+                                             wait * est_ticks))
+        for line in lines:
+            print line
+
+        with open(joinpath(m5.options.outdir, "sampling.txt"), "w") as f:
+            for line in lines:
+                f.write("# %s\n" % line)
+            f.write("# start_inst cpi accel_wait\n")
+            for start, cpi, wait in self.units:
+                f.write("%d %.6f %.6f\n" % (start, cpi, wait))
+
+def run(options, testsys, switch_cpu_list, maxtick):
+    return Sampler(options, testsys, switch_cpu_list, maxtick).run()
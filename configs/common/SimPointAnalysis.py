@@ -0,0 +1,227 @@
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Pick simulation points from the basic block vectors (BBVs) written by
+# the SimPoint probe, without going through the SimPoint 3.2 tools.
+#
+# The BBV of each interval is normalized and randomly projected to a
+# few dimensions, then clustered with k-means for every number of
+# clusters up to a maximum. As in SimPoint, the clustering used is the
+# one with the fewest clusters whose Bayesian information criterion
+# (BIC) score reaches 90% of the range of scores seen. Each cluster is
+# represented by the interval closest to its centroid and weighted by
+# its share of the intervals.
+#
+# Accelerator invocations show up as basic blocks of their own in the
+# BBVs, so intervals of the host code that drive different accelerators
+# fall in different clusters.
+#
+# The points are written in the SimPoint 3.2 format, which
+# --take-simpoint-checkpoints reads, and can also be picked offline:
+#
+#   SimPointAnalysis.py <bbv file> <simpoints file> <weights file>
+
+from __future__ import print_function
+
+import gzip
+import math
+import random
+import re
+import sys
+
+def readBBVs(filename):
+    """Read the BBV of each interval as a {block id: count} dict"""
+
+    bbvs = []
+    opener = gzip.open if filename.endswith('.gz') else open
+    entry = re.compile(r':(\d+):(\d+)')
+    with opener(filename, 'rt') as bbv_file:
+        for line in bbv_file:
+            if not line.startswith('T'):
+                continue
+            bbvs.append(dict((int(bb), int(count))
+                             for bb, count in entry.findall(line)))
+    return bbvs
+
+def project(bbvs, dims, seed):
+    """Normalize the BBVs and project them to 'dims' dimensions"""
+
+    rng = random.Random(seed)
+    matrix = {}
+    points = []
+    for bbv in bbvs:
+        total = float(sum(bbv.values())) or 1.0
+        point = [0.0] * dims
+        for bb, count in bbv.items():
+            row = matrix.get(bb)
+            if row is None:
+                row = [rng.uniform(-1.0, 1.0) for d in range(dims)]
+                matrix[bb] = row
+            frac = count / total
+            for d in range(dims):
+                point[d] += frac * row[d]
+        points.append(point)
+    return points
+
+def _distance(a, b):
+    dist = 0.0
+    for x, y in zip(a, b):
+        dist += (x - y) * (x - y)
+    return dist
+
+def _closest(point, centers):
+    best, best_dist = 0, float('inf')
+    for c, center in enumerate(centers):
+        dist = 0.0
+        for x, y in zip(point, center):
+            dist += (x - y) * (x - y)
+            if dist >= best_dist:
+                break
+        else:
+            best, best_dist = c, dist
+    return best, best_dist
+
+def kmeans(points, k, rng, max_iters=100):
+    """Cluster the points, returning (labels, centers, distortion)"""
+
+    # Furthest-first initialization from a random point, as SimPoint
+    # does
+    centers = [list(points[rng.randrange(len(points))])]
+    dists = [_distance(p, centers[0]) for p in points]
+    while len(centers) < k:
+        far = max(range(len(points)), key=lambda i: dists[i])
+        if dists[far] == 0.0:
+            break
+        centers.append(list(points[far]))
+        dists = [min(d, _distance(p, centers[-1]))
+                 for p, d in zip(points, dists)]
+
+    dims = len(points[0])
+    labels = None
+    for iteration in range(max_iters):
+        new_labels = [_closest(p, centers)[0] for p in points]
+        if new_labels == labels:
+            break
+        labels = new_labels
+        sums = [[0.0] * dims for c in centers]
+        sizes = [0] * len(centers)
+        for p, label in zip(points, labels):
+            sizes[label] += 1
+            s = sums[label]
+            for d in range(dims):
+                s[d] += p[d]
+        for c in range(len(centers)):
+            if sizes[c]:
+                centers[c] = [x / sizes[c] for x in sums[c]]
+
+    distortion = sum(_distance(p, centers[l]) for p, l in zip(points, labels))
+    return labels, centers, distortion
+
+def bic(points, labels, centers, distortion):
+    """BIC score of a clustering, as computed by SimPoint"""
+
+    n = len(points)
+    dims = len(points[0])
+    k = len(centers)
+    if n <= k:
+        return float('-inf')
+    variance = distortion / float(dims * (n - k)) or 1e-300
+    sizes = [0] * k
+    for label in labels:
+        sizes[label] += 1
+
+    likelihood = 0.0
+    for size in sizes:
+        if size:
+            likelihood += size * math.log(size) - size * math.log(n) \
+                - size * dims / 2.0 * math.log(2.0 * math.pi * variance) \
+                - (size - 1) * dims / 2.0
+    params = k * (dims + 1)
+    return likelihood - params / 2.0 * math.log(n)
+
+def pickSimPoints(bbvs, max_k=30, dims=15, seed=493575226, inits=3,
+                  max_samples=2000):
+    """
+    Cluster the BBVs and return the representative intervals as a list
+    of (interval, weight) pairs, sorted by interval. Long profiles are
+    clustered on a sample of 'max_samples' intervals, then every
+    interval joins the cluster of the closest centroid.
+    """
+
+    if not bbvs:
+        return []
+    points = project(bbvs, dims, seed)
+    rng = random.Random(seed)
+    if len(points) > max_samples:
+        samples = [points[i] for i in
+                   sorted(rng.sample(range(len(points)), max_samples))]
+    else:
+        samples = points
+
+    clusterings = []
+    for k in range(1, min(max_k, len(samples)) + 1):
+        best = None
+        for i in range(inits if k > 1 else 1):
+            result = kmeans(samples, k, rng)
+            if best is None or result[2] < best[2]:
+                best = result
+        clusterings.append((bic(samples, *best), best))
+
+    scores = [score for score, result in clusterings]
+    threshold = min(scores) + 0.9 * (max(scores) - min(scores))
+    labels, centers, distortion = \
+        next(result for score, result in clusterings if score >= threshold)
+    if samples is not points:
+        labels = [_closest(p, centers)[0] for p in points]
+
+    simpoints = []
+    for c in range(len(centers)):
+        members = [i for i, label in enumerate(labels) if label == c]
+        if not members:
+            continue
+        rep = min(members, key=lambda i: _distance(points[i], centers[c]))
+        simpoints.append((rep, len(members) / float(len(points))))
+    simpoints.sort()
+    return simpoints
+
+def writeSimPoints(simpoints, simpoint_filename, weight_filename):
+    """Write the points in the SimPoint 3.2 format"""
+
+    with open(simpoint_filename, 'w') as simpoint_file:
+        with open(weight_filename, 'w') as weight_file:
+            for cluster, (interval, weight) in enumerate(simpoints):
+                simpoint_file.write("%d %d\n" % (interval, cluster))
+                weight_file.write("%f %d\n" % (weight, cluster))
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (4, 5):
+        print("usage: %s <bbv file> <simpoints file> <weights file> "
+              "[max clusters]" % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+    max_k = int(sys.argv[4]) if len(sys.argv) == 5 else 30
+    simpoints = pickSimPoints(readBBVs(sys.argv[1]), max_k)
+    writeSimPoints(simpoints, sys.argv[2], sys.argv[3])
+    print("%d simulation points" % len(simpoints))
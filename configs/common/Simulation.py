@@ -45,6 +45,7 @@ from os.path import join as joinpath
 
 from common import CpuConfig
 from common import MemConfig
+from common import Sampling
 
 import m5
 from m5.defines import buildEnv
@@ -78,7 +79,7 @@ def setCPUClass(options):
         if options.restore_with_cpu != options.cpu_type:
             CPUClass = TmpClass
             TmpClass, test_mem_mode = getCPUClass(options.restore_with_cpu)
-    elif options.fast_forward:
+    elif options.fast_forward or options.sampling:
         CPUClass = TmpClass
         TmpClass = AtomicSimpleCPU
         test_mem_mode = 'atomic'
@@ -182,6 +183,12 @@ def findCptDir(options, cptdir, testsys):
         print "#%d, start_inst:%d, weight:%f, interval:%d, warmup:%d" % \
             (index, start_inst, weight_inst, interval_length, warmup_length)
 
+        # Record the simpoint next to the stats, for util/simpoint_stats.py
+        with open(joinpath(m5.options.outdir, "simpoint.txt"), "w") as f:
+            f.write("index %d\nstart_inst %d\nweight %f\ninterval %d\n"
+                    "warmup %d\n" % (index, start_inst, weight_inst,
+                                      interval_length, warmup_length))
+
     else:
         dirs = listdir(cptdir)
         expr = re.compile('cpt\.([0-9]+)')
@@ -300,12 +307,30 @@ def benchCheckpoints(options, maxtick, cptdir):
     return exit_event
 
 # Set up environment for taking SimPoint checkpoints
-# Expecting SimPoint files generated by SimPoint 3.2
+# Expecting SimPoint files generated by SimPoint 3.2, or a BBV file from
+# --simpoint-profile that the simpoints are picked from
 def parseSimpointAnalysisFile(options, testsys):
     import re
 
-    simpoint_filename, weight_filename, interval_length, warmup_length = \
-        options.take_simpoint_checkpoints.split(",", 3)
+    fields = options.take_simpoint_checkpoints.split(",", 3)
+    if len(fields) == 3:
+        from common import SimPointAnalysis
+
+        bbv_filename, interval_length, warmup_length = fields
+        print "simpoint BBV file:", bbv_filename
+        simpoint_filename = joinpath(m5.options.outdir, "simpoints")
+        weight_filename = joinpath(m5.options.outdir, "weights")
+        simpoints = SimPointAnalysis.pickSimPoints(
+            SimPointAnalysis.readBBVs(bbv_filename), options.simpoint_max_k)
+        if not simpoints:
+            fatal('no intervals in simpoint BBV file!')
+        SimPointAnalysis.writeSimPoints(simpoints, simpoint_filename,
+                                        weight_filename)
+    elif len(fields) == 4:
+        simpoint_filename, weight_filename, interval_length, warmup_length = \
+            fields
+    else:
+        fatal('--take-simpoint-checkpoints needs 3 or 4 fields!')
     print "simpoint analysis file:", simpoint_filename
     print "simpoint weight file:", weight_filename
     print "interval length:", interval_length
@@ -464,9 +489,29 @@ def run(options, root, testsys, cpu_class):
     if options.repeat_switch and options.take_checkpoints:
         fatal("Can't specify both --repeat-switch and --take-checkpoints")
 
+    if options.sampling and (options.standard_switch or options.repeat_switch
+                             or options.take_checkpoints):
+        fatal("--sampling can't be combined with CPU switching or "
+              "--take-checkpoints")
+
+    # The domain bridges learn which blocks the L1 caches hold from the
+    # timing accesses they see, so the caches must not be filled by
+    # atomic accesses first
+    if options.parallel_cores and (options.fast_forward or
+                                   options.standard_switch or
+                                   options.repeat_switch or
+                                   options.sampling):
+        fatal("--parallel-cores can't be combined with CPU switching")
+
     np = options.num_cpus
     switch_cpus = None
 
+    # Cores and their L1 caches run on event queues 1..np, the L2 and
+    # memory on 0
+    if options.parallel_cores:
+        from common import CacheConfig
+        root.sim_quantum = CacheConfig.parallel_quantum(options)
+
     if options.prog_interval:
         for i in xrange(np):
             testsys.cpu[i].progress_interval = options.prog_interval
@@ -480,7 +525,7 @@ def run(options, root, testsys, cpu_class):
                        for i in xrange(np)]
 
         for i in xrange(np):
-            if options.fast_forward:
+            if options.fast_forward and not options.sampling:
                 testsys.cpu[i].max_insts_any_thread = int(options.fast_forward)
             switch_cpus[i].system = testsys
             switch_cpus[i].workload = testsys.cpu[i].workload
@@ -488,6 +533,8 @@ def run(options, root, testsys, cpu_class):
             switch_cpus[i].progress_interval = \
                 testsys.cpu[i].progress_interval
             switch_cpus[i].isa = testsys.cpu[i].isa
+            if options.parallel_cores:
+                switch_cpus[i].eventq_index = testsys.cpu[i].eventq_index
             # simulation period
             if options.maxinsts:
                 switch_cpus[i].max_insts_any_thread = options.maxinsts
@@ -503,6 +550,10 @@ def run(options, root, testsys, cpu_class):
         testsys.switch_cpus = switch_cpus
         switch_cpu_list = [(testsys.cpu[i], switch_cpus[i]) for i in xrange(np)]
 
+        # The sampler switches back and forth itself
+        if options.sampling:
+            Sampling.setup(options, testsys, switch_cpus)
+
     if options.repeat_switch:
         switch_class = getCPUClass(options.cpu_type)[0]
         if switch_class.require_caches() and \
@@ -521,6 +572,9 @@ def run(options, root, testsys, cpu_class):
             repeat_switch_cpus[i].workload = testsys.cpu[i].workload
             repeat_switch_cpus[i].clk_domain = testsys.cpu[i].clk_domain
             repeat_switch_cpus[i].isa = testsys.cpu[i].isa
+            if options.parallel_cores:
+                repeat_switch_cpus[i].eventq_index = \
+                    testsys.cpu[i].eventq_index
 
             if options.maxinsts:
                 repeat_switch_cpus[i].max_insts_any_thread = options.maxinsts
@@ -552,6 +606,9 @@ def run(options, root, testsys, cpu_class):
             switch_cpus_1[i].clk_domain = testsys.cpu[i].clk_domain
             switch_cpus[i].isa = testsys.cpu[i].isa
             switch_cpus_1[i].isa = testsys.cpu[i].isa
+            if options.parallel_cores:
+                switch_cpus[i].eventq_index = testsys.cpu[i].eventq_index
+                switch_cpus_1[i].eventq_index = testsys.cpu[i].eventq_index
 
             # if restoring, make atomic cpu simulate only a few instructions
             if options.checkpoint_restore != None:
@@ -657,7 +714,7 @@ def run(options, root, testsys, cpu_class):
         fatal("Bad maxtick (%d) specified: " \
               "Checkpoint starts starts from tick: %d", maxtick, cpt_starttick)
 
-    if options.standard_switch or cpu_class:
+    if (options.standard_switch or cpu_class) and not options.sampling:
         if options.standard_switch:
             print "Switch at instruction count:%s" % \
                     str(testsys.cpu[0].max_insts_any_thread)
@@ -721,7 +778,10 @@ def run(options, root, testsys, cpu_class):
 
         # If checkpoints are being taken, then the checkpoint instruction
         # will occur in the benchmark code it self.
-        if options.repeat_switch and maxtick > options.repeat_switch:
+        if options.sampling:
+            exit_event = Sampling.run(options, testsys, switch_cpu_list,
+                                      maxtick)
+        elif options.repeat_switch and maxtick > options.repeat_switch:
             exit_event = repeatSwitch(testsys, repeat_switch_cpu_list,
                                       maxtick, options.repeat_switch)
         elif options.enable_stats_dump_and_resume:
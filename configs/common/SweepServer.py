@@ -0,0 +1,145 @@
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Sweep server: restore a checkpoint once and fork a child simulator
+# per design point.
+#
+# Design sweeps run hundreds of simulations that restore the same
+# checkpoint and only differ in their accelerator configuration. In
+# sweep server mode, the parent process parses the checkpoint and
+# inflates its memory images once, then forks a child per design
+# point. Each child builds the configuration of its design point and
+# instantiates it from the preloaded checkpoint, adopting the memory
+# images as copy-on-write pages, and writes its results to its own
+# output directory.
+
+import os
+import sys
+
+import m5
+from m5.util import fatal
+
+from common import Simulation
+
+def addSweepOptions(parser):
+    parser.add_option("--sweep-server", default=None,
+        help="Restore the checkpoint once and fork a simulation for each "
+             "design point listed in this file. Each line holds a point "
+             "name, its accelerator config file and optionally its output "
+             "directory (default: <outdir>/<name>).")
+    parser.add_option("--sweep-jobs", type="int", default=1,
+        help="Number of design points simulated at the same time by the "
+             "sweep server.")
+
+def readDesignPoints(filename):
+    """Parse a design point list into (name, cfg_file, outdir) tuples"""
+
+    points = []
+    with open(filename, 'r') as f:
+        for lineno, line in enumerate(f, 1):
+            fields = line.split('#', 1)[0].split()
+            if not fields:
+                continue
+            if len(fields) not in (2, 3):
+                fatal("%s:%d: expected 'name cfg_file [outdir]'" %
+                      (filename, lineno))
+            name, cfg_file = fields[:2]
+            if len(fields) == 3:
+                outdir = fields[2]
+            else:
+                outdir = os.path.join(m5.options.outdir, name)
+            points.append((name, cfg_file, outdir))
+
+    if not points:
+        fatal("No design points were listed in %s" % filename)
+    return points
+
+def _reap(running, failed):
+    pid, status = os.wait()
+    name = running.pop(pid, None)
+    if name is None:
+        return
+    if os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0:
+        print "Design point %s done" % name
+    else:
+        print >>sys.stderr, "Design point %s failed (status %d)" % \
+            (name, status)
+        failed.append(name)
+
+def serve(options):
+    """Run the sweep server.
+
+    Returns (name, cfg_file) in each forked child, which goes on to
+    build and simulate that design point. The server itself exits once
+    every design point has completed.
+    """
+
+    if not options.checkpoint_restore:
+        fatal("The sweep server needs a checkpoint to restore from "
+              "(--checkpoint-restore)")
+    if options.simpoint:
+        fatal("The sweep server does not support SimPoint checkpoints")
+    if options.sweep_jobs < 1:
+        fatal("--sweep-jobs must be at least 1")
+
+    points = readDesignPoints(options.sweep_server)
+
+    if options.checkpoint_dir:
+        cptdir = options.checkpoint_dir
+    elif m5.options.outdir:
+        cptdir = m5.options.outdir
+    else:
+        cptdir = os.getcwd()
+    cpt_starttick, checkpoint_dir = \
+        Simulation.findCptDir(options, cptdir, None)
+
+    m5.preloadCheckpoint(checkpoint_dir)
+
+    # Flush before forking so buffered output isn't duplicated
+    sys.stdout.flush()
+    sys.stderr.flush()
+
+    running = {}
+    failed = []
+    for name, cfg_file, outdir in points:
+        while len(running) >= options.sweep_jobs:
+            _reap(running, failed)
+
+        pid = os.fork()
+        if pid == 0:
+            m5.options.outdir = outdir
+            m5.core.setOutputDir(outdir)
+            print "Simulating design point %s (%s)" % (name, cfg_file)
+            return name, cfg_file
+        running[pid] = name
+
+    while running:
+        _reap(running, failed)
+
+    if failed:
+        fatal("%d of %d design points failed: %s" %
+              (len(failed), len(points), " ".join(failed)))
+    sys.exit(0)
@@ -109,6 +109,8 @@ def build_test_system(np):
 
     # Set the cache line size for the entire system
     test_sys.cache_line_size = options.cacheline_size
+    test_sys.memory_checkpoint_format = options.mem_checkpoint_format
+    test_sys.memory_checkpoint_mmap = options.mem_checkpoint_mmap
 
     # Create a top-level voltage domain
     test_sys.voltage_domain = VoltageDomain(voltage = options.sys_voltage)
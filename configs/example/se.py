@@ -94,6 +94,7 @@ def get_processes(options):
         process = Process(pid = 100 + idx)
         process.executable = wrkld
         process.cwd = os.getcwd()
+        process.mapExecutable = bool(options.map_executable)
 
         if options.env:
             with open(options.env, 'r') as f:
@@ -177,7 +178,9 @@ np = options.num_cpus
 system = System(cpu = [CPUClass(cpu_id=i) for i in xrange(np)],
                 mem_mode = test_mem_mode,
                 mem_ranges = [AddrRange(options.mem_size)],
-                cache_line_size = options.cacheline_size)
+                cache_line_size = options.cacheline_size,
+                memory_checkpoint_format = options.mem_checkpoint_format,
+                memory_checkpoint_mmap = options.mem_checkpoint_mmap)
 
 if numThreads > 1:
     system.multi_thread = True
@@ -76,6 +76,14 @@ def define_options(parser):
     parser.add_option("--recycle-latency", type="int", default=10,
                       help="Recycle latency for ruby controller input buffers")
 
+    parser.add_option("--ruby-warmup-mode", type="choice", default="replay",
+                      choices=["replay", "parallel_replay"],
+                      help="How to restore the ruby caches from a checkpoint")
+
+    parser.add_option("--ruby-requests-per-line", type="int", default=1,
+                      help="Max CPU requests the sequencers queue on one "
+                           "cache line before returning them for retry")
+
     protocol = buildEnv['PROTOCOL']
     exec "import %s" % protocol
     eval("%s.define_options(parser)" % protocol)
@@ -137,6 +145,7 @@ def create_system(options, full_system, system, piobus = None, dma_ports = []):
 
     system.ruby = RubySystem()
     ruby = system.ruby
+    ruby.warmup_mode = options.ruby_warmup_mode
 
     # Create the network object
     (network, IntLinkClass, ExtLinkClass, RouterClass, InterfaceClass) = \
@@ -186,6 +195,10 @@ def create_system(options, full_system, system, piobus = None, dma_ports = []):
             if buildEnv['TARGET_ISA'] == "x86":
                 cpu_seq.pio_slave_port = piobus.master
 
+    for cpu_seq in cpu_sequencers:
+        if isinstance(cpu_seq, RubySequencer):
+            cpu_seq.max_requests_per_line = options.ruby_requests_per_line
+
     ruby.number_of_virtual_networks = ruby.network.number_of_virtual_networks
     ruby._cpu_ports = cpu_sequencers
     ruby.num_of_sequencers = len(cpu_sequencers)
@@ -229,9 +229,11 @@ class Decoder
     typedef std::unordered_map<CacheKey, DecodePages *> AddrCacheMap;
     AddrCacheMap addrCacheMap;
 
+    // Decoded instructions are not shared between decoders, as the
+    // cores owning them may be simulated by different threads.
     DecodeCache::InstMap *instMap;
     typedef std::unordered_map<CacheKey, DecodeCache::InstMap *> InstCacheMap;
-    static InstCacheMap instCacheMap;
+    InstCacheMap instCacheMap;
 
   public:
     Decoder(ISA* isa = nullptr) : basePC(0), origPC(0), offset(0),
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/binary_ini.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "base/inifile.hh"
+#include "base/logging.hh"
+
+using namespace std;
+
+namespace {
+
+const char binaryIniMagic[8] = { 'G', 'E', 'M', '5', 'I', 'N', 'I', 'B' };
+const uint32_t binaryIniVersion = 1;
+const uint32_t byteOrderMark = 0x01020304;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numSections;
+    // Section offsets sorted by name
+    uint64_t indexOffset;
+    // Open addressing hash table of section offsets, 0 for an empty
+    // bucket, with a power of two number of buckets
+    uint64_t hashOffset;
+    uint64_t hashBuckets;
+};
+
+inline uint64_t
+align(uint64_t size)
+{
+    return (size + 7) & ~(uint64_t)7;
+}
+
+// FNV-1a, which is cheap for the short names of checkpoints
+uint64_t
+hashName(const char *name, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (uint8_t)name[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int
+compareName(const char *name, uint32_t length, const string &key)
+{
+    int c = memcmp(name, key.data(), min<size_t>(length, key.size()));
+    if (c != 0)
+        return c;
+    if (length == key.size())
+        return 0;
+    return length < key.size() ? -1 : 1;
+}
+
+void
+pad(ostream &out, uint64_t size)
+{
+    static const char zeros[8] = { 0 };
+    out.write(zeros, align(size) - size);
+}
+
+} // anonymous namespace
+
+struct BinaryIni::SectionHeader
+{
+    uint32_t nameLength;
+    uint32_t numEntries;
+
+    const char *name() const { return (const char *)(this + 1); }
+
+    const uint64_t *
+    entries() const
+    {
+        return (const uint64_t *)(name() + align(nameLength));
+    }
+
+    uint64_t
+    size() const
+    {
+        return sizeof(*this) + align(nameLength) +
+            numEntries * sizeof(uint64_t);
+    }
+};
+
+struct BinaryIni::EntryHeader
+{
+    uint32_t nameLength;
+    uint8_t type;
+    uint8_t reserved[3];
+    // Number of bytes of text or of integer words
+    uint64_t count;
+
+    const char *name() const { return (const char *)(this + 1); }
+    const uint8_t *data() const
+    {
+        return (const uint8_t *)(name() + align(nameLength));
+    }
+
+    uint64_t
+    dataSize() const
+    {
+        return type == Text ? count : count * sizeof(uint64_t);
+    }
+
+    uint64_t
+    size() const
+    {
+        return sizeof(*this) + align(nameLength) + align(dataSize());
+    }
+};
+
+BinaryIni::BinaryIni()
+    : base(nullptr), length(0), sectionIndex(nullptr), numSections(0),
+      sectionHash(nullptr), hashMask(0)
+{
+}
+
+BinaryIni::~BinaryIni()
+{
+    unmap();
+}
+
+void
+BinaryIni::unmap()
+{
+    if (base)
+        munmap(const_cast<uint8_t *>(base), length);
+    base = nullptr;
+    length = 0;
+    sectionIndex = nullptr;
+    numSections = 0;
+    sectionHash = nullptr;
+    hashMask = 0;
+}
+
+bool
+BinaryIni::isBinaryIni(const string &file)
+{
+    ifstream in(file.c_str(), ios::binary);
+    char magic[sizeof(binaryIniMagic)];
+    return in.read(magic, sizeof(magic)) &&
+        memcmp(magic, binaryIniMagic, sizeof(magic)) == 0;
+}
+
+bool
+BinaryIni::load(const string &file)
+{
+    unmap();
+
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    base = (const uint8_t *)map;
+    length = st.st_size;
+
+    const FileHeader *header = (const FileHeader *)base;
+    if (memcmp(header->magic, binaryIniMagic, sizeof(header->magic)) != 0 ||
+        header->version != binaryIniVersion) {
+        unmap();
+        return false;
+    }
+
+    if (header->byteOrder != byteOrderMark)
+        fatal("Binary ini file %s was written on a host of different "
+              "endianness\n", file);
+
+    if (header->indexOffset % sizeof(uint64_t) != 0 ||
+        header->indexOffset > length ||
+        header->numSections >
+        (length - header->indexOffset) / sizeof(uint64_t))
+        fatal("Corrupt section index in binary ini file %s\n", file);
+
+    uint64_t buckets = header->hashBuckets;
+    if (header->hashOffset % sizeof(uint64_t) != 0 ||
+        header->hashOffset > length || buckets == 0 ||
+        (buckets & (buckets - 1)) != 0 || buckets <= header->numSections ||
+        buckets > (length - header->hashOffset) / sizeof(uint64_t))
+        fatal("Corrupt section hash table in binary ini file %s\n", file);
+
+    sectionIndex = (const uint64_t *)(base + header->indexOffset);
+    numSections = header->numSections;
+    sectionHash = (const uint64_t *)(base + header->hashOffset);
+    hashMask = buckets - 1;
+
+    // Sections are looked up in file order
+    madvise(map, length, MADV_WILLNEED);
+
+    return true;
+}
+
+template <class T>
+const T *
+BinaryIni::record(uint64_t offset) const
+{
+    if (offset % sizeof(uint64_t) != 0 || offset > length ||
+        length - offset < sizeof(T))
+        fatal("Corrupt record at offset %d of binary ini file\n", offset);
+
+    const T *rec = (const T *)(base + offset);
+    if (length - offset < rec->size())
+        fatal("Truncated record at offset %d of binary ini file\n", offset);
+    return rec;
+}
+
+const BinaryIni::SectionHeader *
+BinaryIni::findSection(const string &section) const
+{
+    if (!base)
+        return nullptr;
+
+    // The table is never full, so probing ends at an empty bucket
+    uint64_t bucket = hashName(section.data(), section.size()) & hashMask;
+    while (sectionHash[bucket] != 0) {
+        const SectionHeader *sec =
+            record<SectionHeader>(sectionHash[bucket]);
+        if (compareName(sec->name(), sec->nameLength, section) == 0)
+            return sec;
+        bucket = (bucket + 1) & hashMask;
+    }
+    return nullptr;
+}
+
+const BinaryIni::EntryHeader *
+BinaryIni::findEntry(const string &section, const string &entry) const
+{
+    const SectionHeader *sec = findSection(section);
+    if (!sec)
+        return nullptr;
+
+    const uint64_t *entries = sec->entries();
+    uint32_t lo = 0, hi = sec->numEntries;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const EntryHeader *ent = record<EntryHeader>(entries[mid]);
+        int c = compareName(ent->name(), ent->nameLength, entry);
+        if (c == 0)
+            return ent;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return nullptr;
+}
+
+bool
+BinaryIni::find(const string &section, const string &entry,
+                string &value) const
+{
+    const EntryHeader *ent = findEntry(section, entry);
+    if (!ent)
+        return false;
+
+    if (ent->type == Text) {
+        value.assign((const char *)ent->data(), ent->count);
+        return true;
+    }
+
+    const uint64_t *words = (const uint64_t *)ent->data();
+    value.clear();
+    for (uint64_t i = 0; i < ent->count; ++i) {
+        if (i)
+            value += ' ';
+        if (ent->type == Int64)
+            value += to_string((int64_t)words[i]);
+        else
+            value += to_string(words[i]);
+    }
+    return true;
+}
+
+bool
+BinaryIni::findInts(const string &section, const string &entry,
+                    Ints &ints) const
+{
+    const EntryHeader *ent = findEntry(section, entry);
+    if (!ent || ent->type == Text)
+        return false;
+
+    ints = Ints((const uint64_t *)ent->data(), ent->count,
+                ent->type == Int64);
+    return true;
+}
+
+bool
+BinaryIni::entryExists(const string &section, const string &entry) const
+{
+    return findEntry(section, entry) != nullptr;
+}
+
+bool
+BinaryIni::sectionExists(const string &section) const
+{
+    return findSection(section) != nullptr;
+}
+
+void
+BinaryIni::getSectionNames(vector<string> &list) const
+{
+    for (uint64_t i = 0; i < numSections; ++i) {
+        const SectionHeader *sec = record<SectionHeader>(sectionIndex[i]);
+        list.emplace_back(sec->name(), sec->nameLength);
+    }
+}
+
+void
+BinaryIniWriter::addSection(const string &section)
+{
+    sections[section];
+}
+
+void
+BinaryIniWriter::add(const string &section, const string &entry,
+                     const string &value)
+{
+    sections[section][entry] = value;
+}
+
+void
+BinaryIniWriter::add(const IniFile &ini)
+{
+    vector<string> names;
+    ini.getSectionNames(names);
+    for (const auto &name : names) {
+        auto &entries = sections[name];
+        ini.visitSection(name, [&entries](const string &entry,
+                                          const string &value) {
+            entries[entry] = value;
+        });
+    }
+}
+
+bool
+BinaryIniWriter::parseInts(const string &value, vector<uint64_t> &words,
+                           bool &is_signed)
+{
+    words.clear();
+    is_signed = false;
+    if (value.empty())
+        return false;
+
+    const uint64_t max_positive = numeric_limits<int64_t>::max();
+    uint64_t max_seen = 0;
+    string::size_type pos = 0;
+    while (true) {
+        string::size_type end = value.find(' ', pos);
+        if (end == string::npos)
+            end = value.size();
+
+        bool negative = value[pos] == '-';
+        string::size_type digits = pos + (negative ? 1 : 0);
+        // Only canonical decimal numbers are stored as integers, so
+        // that they turn back into exactly the same text
+        if (digits == end || (value[digits] == '0' && end - digits > 1) ||
+            (negative && value[digits] == '0'))
+            return false;
+
+        uint64_t magnitude = 0;
+        for (string::size_type i = digits; i < end; ++i) {
+            char c = value[i];
+            if (c < '0' || c > '9')
+                return false;
+            uint64_t digit = c - '0';
+            if (magnitude > (numeric_limits<uint64_t>::max() - digit) / 10)
+                return false;
+            magnitude = magnitude * 10 + digit;
+        }
+
+        if (negative) {
+            if (magnitude > max_positive + 1)
+                return false;
+            is_signed = true;
+            words.push_back(~magnitude + 1);
+        } else {
+            max_seen = max(max_seen, magnitude);
+            words.push_back(magnitude);
+        }
+
+        if (end == value.size())
+            break;
+        pos = end + 1;
+        // A trailing or doubled space can't be reproduced
+        if (pos == value.size())
+            return false;
+    }
+
+    return !is_signed || max_seen <= max_positive;
+}
+
+bool
+BinaryIniWriter::write(const string &file) const
+{
+    ofstream out(file.c_str(), ios::binary | ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    FileHeader header;
+    memcpy(header.magic, binaryIniMagic, sizeof(header.magic));
+    header.version = binaryIniVersion;
+    header.byteOrder = byteOrderMark;
+    header.numSections = sections.size();
+    header.indexOffset = 0;
+    header.hashOffset = 0;
+    header.hashBuckets = 0;
+    out.write((const char *)&header, sizeof(header));
+
+    struct Encoded
+    {
+        const string *name;
+        const string *text;
+        vector<uint64_t> words;
+        uint8_t type;
+    };
+
+    uint64_t pos = sizeof(header);
+    vector<uint64_t> section_index;
+    section_index.reserve(sections.size());
+    vector<Encoded> encoded;
+    vector<uint64_t> entry_offsets;
+
+    // std::map keeps both sections and entries sorted by name
+    for (const auto &section : sections) {
+        section_index.push_back(pos);
+
+        BinaryIni::SectionHeader sec;
+        sec.nameLength = section.first.size();
+        sec.numEntries = section.second.size();
+        uint64_t entry_pos = pos + sec.size();
+
+        encoded.clear();
+        entry_offsets.clear();
+        for (const auto &entry : section.second) {
+            encoded.emplace_back();
+            Encoded &enc = encoded.back();
+            enc.name = &entry.first;
+            enc.text = &entry.second;
+            bool is_signed;
+            if (parseInts(entry.second, enc.words, is_signed))
+                enc.type = is_signed ? BinaryIni::Int64 : BinaryIni::UInt64;
+            else
+                enc.type = BinaryIni::Text;
+
+            BinaryIni::EntryHeader ent;
+            ent.nameLength = entry.first.size();
+            ent.type = enc.type;
+            ent.count = enc.type == BinaryIni::Text ?
+                entry.second.size() : enc.words.size();
+            entry_offsets.push_back(entry_pos);
+            entry_pos += ent.size();
+        }
+
+        out.write((const char *)&sec, sizeof(sec));
+        out.write(section.first.data(), sec.nameLength);
+        pad(out, sec.nameLength);
+        out.write((const char *)entry_offsets.data(),
+                  entry_offsets.size() * sizeof(uint64_t));
+
+        for (const auto &enc : encoded) {
+            BinaryIni::EntryHeader ent;
+            memset(&ent, 0, sizeof(ent));
+            ent.nameLength = enc.name->size();
+            ent.type = enc.type;
+            if (enc.type == BinaryIni::Text) {
+                ent.count = enc.text->size();
+                out.write((const char *)&ent, sizeof(ent));
+                out.write(enc.name->data(), ent.nameLength);
+                pad(out, ent.nameLength);
+                out.write(enc.text->data(), ent.count);
+                pad(out, ent.count);
+            } else {
+                ent.count = enc.words.size();
+                out.write((const char *)&ent, sizeof(ent));
+                out.write(enc.name->data(), ent.nameLength);
+                pad(out, ent.nameLength);
+                out.write((const char *)enc.words.data(),
+                          ent.count * sizeof(uint64_t));
+            }
+        }
+
+        pos = entry_pos;
+    }
+
+    header.indexOffset = pos;
+    out.write((const char *)section_index.data(),
+              section_index.size() * sizeof(uint64_t));
+    pos += section_index.size() * sizeof(uint64_t);
+
+    // At most half full, so that probe sequences stay short
+    uint64_t buckets = 1;
+    while (buckets < 2 * sections.size() + 1)
+        buckets *= 2;
+    vector<uint64_t> hash_table(buckets, 0);
+    auto offset = section_index.begin();
+    for (const auto &section : sections) {
+        uint64_t bucket =
+            hashName(section.first.data(), section.first.size()) &
+            (buckets - 1);
+        while (hash_table[bucket] != 0)
+            bucket = (bucket + 1) & (buckets - 1);
+        hash_table[bucket] = *offset++;
+    }
+    header.hashOffset = pos;
+    header.hashBuckets = buckets;
+    out.write((const char *)hash_table.data(), buckets * sizeof(uint64_t));
+
+    out.seekp(0);
+    out.write((const char *)&header, sizeof(header));
+
+    return out.good();
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * A binary, indexed counterpart to IniFile, used for checkpoints.
+ *
+ * The file holds the same two-level section/entry table as an ini
+ * file, but every name and value is length-prefixed and the file is
+ * indexed, so that it is used in place once memory mapped and loading
+ * involves no parsing at all. Sections are found through a hash
+ * table, entries by a binary search within their section. Values
+ * that are lists of decimal integers, which make up most of a
+ * checkpoint, are stored as arrays of 64-bit words so that they can
+ * be unserialized without going through their text form.
+ *
+ * All fields are in host byte order. Layout, with every record
+ * starting on an 8-byte boundary:
+ *
+ *   FileHeader
+ *   for each section, sorted by name:
+ *     SectionHeader, name, uint64_t offset of each entry sorted by name
+ *     for each entry: EntryHeader, name, text bytes or uint64_t words
+ *   uint64_t offset of each section, sorted by name
+ *   hash table of section offsets
+ */
+
+#ifndef __BASE_BINARY_INI_HH__
+#define __BASE_BINARY_INI_HH__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class IniFile;
+
+class BinaryIni
+{
+  public:
+    /** How an entry's value is stored */
+    enum ValueType : uint8_t {
+        Text = 0,
+        Int64 = 1,
+        UInt64 = 2,
+    };
+
+    /**
+     * An integer list entry, pointing into the mapped file.
+     */
+    class Ints
+    {
+      public:
+        Ints() : words(nullptr), count(0), _signed(false) {}
+        Ints(const uint64_t *_words, uint64_t _count, bool is_signed)
+            : words(_words), count(_count), _signed(is_signed) {}
+
+        uint64_t size() const { return count; }
+
+        /** Elements are two's complement int64_t if set */
+        bool isSigned() const { return _signed; }
+
+        uint64_t operator[](uint64_t i) const { return words[i]; }
+
+      private:
+        const uint64_t *words;
+        uint64_t count;
+        bool _signed;
+    };
+
+    BinaryIni();
+    ~BinaryIni();
+
+    /**
+     * Map a binary ini file.
+     *
+     * @retval True if successful, false if the file can't be opened
+     * or isn't in the binary ini format.
+     */
+    bool load(const std::string &file);
+
+    /** Does the file start with the binary ini magic? */
+    static bool isBinaryIni(const std::string &file);
+
+    /**
+     * Find the value of an entry. Integer lists are turned back into
+     * their text form.
+     */
+    bool find(const std::string &section, const std::string &entry,
+              std::string &value) const;
+
+    /**
+     * Find an entry stored as an integer list. Returns false if the
+     * entry doesn't exist or holds text.
+     */
+    bool findInts(const std::string &section, const std::string &entry,
+                  Ints &ints) const;
+
+    bool entryExists(const std::string &section,
+                     const std::string &entry) const;
+    bool sectionExists(const std::string &section) const;
+    void getSectionNames(std::vector<std::string> &list) const;
+
+  private:
+    friend class BinaryIniWriter;
+
+    struct EntryHeader;
+    struct SectionHeader;
+
+    const SectionHeader *findSection(const std::string &section) const;
+    const EntryHeader *findEntry(const std::string &section,
+                                 const std::string &entry) const;
+
+    /** Bounds checked access to a record of the file */
+    template <class T>
+    const T *record(uint64_t offset) const;
+
+    void unmap();
+
+    const uint8_t *base;
+    uint64_t length;
+    const uint64_t *sectionIndex;
+    uint64_t numSections;
+    const uint64_t *sectionHash;
+    uint64_t hashMask;
+
+    // Prevent copying
+    BinaryIni(const BinaryIni &);
+    BinaryIni &operator=(const BinaryIni &);
+};
+
+/**
+ * Builds a binary ini file in memory and writes it out.
+ */
+class BinaryIniWriter
+{
+  public:
+    /** Add a section, which may stay empty */
+    void addSection(const std::string &section);
+
+    /**
+     * Add an entry, replacing any previous value. Values that are
+     * space separated lists of canonical decimal integers are stored
+     * as integer lists, all others as text.
+     */
+    void add(const std::string &section, const std::string &entry,
+             const std::string &value);
+
+    /** Add every section and entry of an ini file */
+    void add(const IniFile &ini);
+
+    /** @retval True if the file could be written */
+    bool write(const std::string &file) const;
+
+    /**
+     * Parse a value into the words of an integer list, if it is one
+     * that converts back to the very same text.
+     *
+     * @param value Text value
+     * @param words Resulting words
+     * @param is_signed Set if the words are to be read as int64_t
+     * @retval True if the value is such an integer list
+     */
+    static bool parseInts(const std::string &value,
+                          std::vector<uint64_t> &words, bool &is_signed);
+
+  private:
+    std::map<std::string, std::map<std::string, std::string>> sections;
+};
+
+#endif // __BASE_BINARY_INI_HH__
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_CIRCULAR_QUEUE_HH__
+#define __BASE_CIRCULAR_QUEUE_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/**
+ * Double ended queue stored in a ring of slots, for the in-order
+ * structures of a pipeline that are filled at the back and drained at
+ * the front, or truncated from the back on a squash.
+ *
+ * Elements are addressed by a position that keeps growing as elements
+ * are pushed, and the slot of a position is the position modulo the
+ * size of the ring, which is a power of two. An iterator is a
+ * position, so it stays valid while its element is in the queue, no
+ * matter what is pushed or popped around it. Popped slots are reset
+ * to a default constructed element, which releases what they hold.
+ *
+ * The ring is sized up front for the structure it holds. It doubles
+ * if it overflows, which never happens for structures with a hard
+ * limit on their size.
+ */
+template <typename T>
+class CircularQueue
+{
+  public:
+    typedef T value_type;
+
+    class iterator
+        : public std::iterator<std::bidirectional_iterator_tag, T>
+    {
+      private:
+        CircularQueue *queue;
+        uint64_t pos;
+
+        friend class CircularQueue;
+
+      public:
+        iterator() : queue(nullptr), pos(0) {}
+        iterator(CircularQueue *_queue, uint64_t _pos)
+            : queue(_queue), pos(_pos)
+        {}
+
+        T &operator*() const { return queue->slot(pos); }
+        T *operator->() const { return &queue->slot(pos); }
+
+        iterator &operator++() { ++pos; return *this; }
+        iterator operator++(int) { iterator it(*this); ++pos; return it; }
+        iterator &operator--() { --pos; return *this; }
+        iterator operator--(int) { iterator it(*this); --pos; return it; }
+
+        bool
+        operator==(const iterator &other) const
+        {
+            return queue == other.queue && pos == other.pos;
+        }
+
+        bool operator!=(const iterator &other) const
+        { return !(*this == other); }
+    };
+
+  private:
+    std::vector<T> buf;
+    uint64_t mask;
+
+    /** Position of the front element */
+    uint64_t head;
+    /** Position past the back element */
+    uint64_t tail;
+
+    T &slot(uint64_t pos) { return buf[pos & mask]; }
+    const T &slot(uint64_t pos) const { return buf[pos & mask]; }
+
+    void
+    grow()
+    {
+        std::vector<T> old(buf.size() * 2);
+        old.swap(buf);
+        uint64_t old_mask = mask;
+        mask = buf.size() - 1;
+        for (uint64_t pos = head; pos != tail; ++pos)
+            slot(pos) = std::move(old[pos & old_mask]);
+    }
+
+  public:
+    explicit CircularQueue(size_t capacity = 1)
+        : buf(1), mask(0), head(0), tail(0)
+    {
+        reserve(capacity);
+    }
+
+    /**
+     * Make room for at least capacity elements without growing. The
+     * positions of the elements are kept.
+     */
+    void
+    reserve(size_t capacity)
+    {
+        while (buf.size() < capacity)
+            grow();
+    }
+
+    size_t size() const { return tail - head; }
+    bool empty() const { return tail == head; }
+    size_t capacity() const { return buf.size(); }
+
+    T &front() { assert(!empty()); return slot(head); }
+    const T &front() const { assert(!empty()); return slot(head); }
+    T &back() { assert(!empty()); return slot(tail - 1); }
+    const T &back() const { assert(!empty()); return slot(tail - 1); }
+
+    /** Get the element n places from the front. */
+    T &operator[](size_t n) { return slot(head + n); }
+    const T &operator[](size_t n) const { return slot(head + n); }
+
+    iterator begin() { return iterator(this, head); }
+    iterator end() { return iterator(this, tail); }
+
+    void
+    push_back(const T &val)
+    {
+        if (size() == buf.size())
+            grow();
+        slot(tail++) = val;
+    }
+
+    void
+    pop_front()
+    {
+        assert(!empty());
+        slot(head++) = T();
+    }
+
+    void
+    pop_back()
+    {
+        assert(!empty());
+        slot(--tail) = T();
+    }
+
+    /** Remove the elements from it to the back of the queue. */
+    void
+    truncate(iterator it)
+    {
+        assert(it.queue == this && it.pos >= head && it.pos <= tail);
+        while (tail != it.pos)
+            pop_back();
+    }
+
+    void
+    clear()
+    {
+        while (!empty())
+            pop_front();
+    }
+};
+
+#endif // __BASE_CIRCULAR_QUEUE_HH__
@@ -302,6 +302,23 @@ IniFile::getSectionNames(vector<string> &list) const
     }
 }
 
+void
+IniFile::Section::visit(
+    const std::function<void(const string &, const string &)> &cb) const
+{
+    for (const auto &entry : table)
+        cb(entry.first, entry.second->getValue());
+}
+
+void
+IniFile::visitSection(const string &sectionName,
+                      VisitSectionCallback cb) const
+{
+    Section *section = findSection(sectionName);
+    if (section)
+        section->visit(cb);
+}
+
 bool
 IniFile::printUnreferenced()
 {
@@ -33,6 +33,7 @@
 #define __INIFILE_HH__
 
 #include <fstream>
+#include <functional>
 #include <list>
 #include <string>
 #include <unordered_map>
@@ -135,6 +136,11 @@ class IniFile
 
         /// Print the contents of this section to cout (for debugging).
         void dump(const std::string &sectionName);
+
+        /// Call cb(name, value) for every entry of this section.
+        void visit(const std::function<void(const std::string &,
+                                            const std::string &)> &cb)
+            const;
     };
 
     /// SectionTable type.  Map of strings to Section object pointers.
@@ -200,6 +206,14 @@ class IniFile
     /// Push all section names into the given vector
     void getSectionNames(std::vector<std::string> &list) const;
 
+    typedef std::function<void(const std::string &, const std::string &)>
+        VisitSectionCallback;
+
+    /// Call cb(entry, value) for every entry of the named section, in
+    /// no particular order.
+    void visitSection(const std::string &sectionName,
+                      VisitSectionCallback cb) const;
+
     /// Print unreferenced entries in object.  Iteratively calls
     /// printUnreferend() on all the constituent sections.
     bool printUnreferenced();
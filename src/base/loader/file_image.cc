@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/loader/file_image.hh"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace {
+
+bool
+preadAll(int fd, uint8_t *buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t n = ::pread(fd, buf, size, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+ssize_t
+loadFileImage(uint8_t *host, size_t size, int fd, off_t offset)
+{
+    const uintptr_t page_size = ::sysconf(_SC_PAGESIZE);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(host);
+
+    // The pages in the middle can only be mapped if the host memory
+    // and the file are equally misaligned
+    size_t head = size;
+    size_t mapped = 0;
+    if ((start - offset) % page_size == 0) {
+        uintptr_t first = (start + page_size - 1) / page_size * page_size;
+        uintptr_t last = (start + size) / page_size * page_size;
+        if (first < last) {
+            void *m = ::mmap(reinterpret_cast<void *>(first), last - first,
+                             PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                             fd, offset + (first - start));
+            if (m != MAP_FAILED) {
+                head = first - start;
+                mapped = last - first;
+            }
+        }
+    }
+
+    // Read the partial pages at either end, or everything if the
+    // middle couldn't be mapped
+    size_t tail = head + mapped;
+    if (!preadAll(fd, host, head, offset) ||
+        !preadAll(fd, host + tail, size - tail, offset + tail)) {
+        return -1;
+    }
+
+    return mapped;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Helpers for loading parts of an object file into host memory that
+ * backs the simulated memory. Rather than copying a large segment,
+ * whole pages of it are mapped copy-on-write from the file, so the
+ * host only reads them in when the simulation first touches them and
+ * untouched pages never take up memory.
+ */
+
+#ifndef __BASE_LOADER_FILE_IMAGE_HH__
+#define __BASE_LOADER_FILE_IMAGE_HH__
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Load size bytes of a file, starting at offset, into host memory.
+ * Host pages that the bytes cover entirely, and that line up with a
+ * page of the file, are replaced by private mappings of the file. The
+ * rest is read.
+ *
+ * @param host Host memory to load the bytes into, from an anonymous
+ *             private mapping
+ * @param size Number of bytes to load
+ * @param fd Descriptor of the file, which can be closed afterwards
+ * @param offset Offset of the first byte in the file
+ * @return The number of bytes mapped rather than read, or -1 if the
+ *         file couldn't be read
+ */
+ssize_t loadFileImage(uint8_t *host, size_t size, int fd, off_t offset);
+
+#endif // __BASE_LOADER_FILE_IMAGE_HH__
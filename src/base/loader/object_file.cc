@@ -33,11 +33,14 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <list>
 #include <string>
 
@@ -56,9 +59,14 @@ ObjectFile::ObjectFile(const string &_filename,
                        size_t _len, uint8_t *_data,
                        Arch _arch, OpSys _op_sys)
     : filename(_filename), fileData(_data), len(_len),
+      mapImage(false), imageFd(-1), imageFdValid(false),
       arch(_arch), opSys(_op_sys), entry(0), globalPtr(0),
       text{0, nullptr, 0}, data{0, nullptr, 0}, bss{0, nullptr, 0}
 {
+    // Remember which file the image came from, so it can later be
+    // told whether the file on disk still holds it
+    imageStatValid = ::stat(filename.c_str(), &imageStat) == 0 &&
+        imageStat.st_size == (off_t)len;
 }
 
 
@@ -68,6 +76,40 @@ ObjectFile::~ObjectFile()
         ::munmap((char*)fileData, len);
         fileData = NULL;
     }
+    if (imageFd >= 0)
+        ::close(imageFd);
+}
+
+
+int
+ObjectFile::getImageFd()
+{
+    if (imageFdValid)
+        return imageFd;
+    imageFdValid = true;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    // Make sure the file is still the one the image was loaded from,
+    // that it hasn't been written since and that it isn't compressed
+    uint8_t buf[4096];
+    size_t bytes = std::min(len, sizeof(buf));
+    struct stat st;
+    if (!imageStatValid || fstat(fd, &st) != 0 ||
+        st.st_dev != imageStat.st_dev || st.st_ino != imageStat.st_ino ||
+        st.st_size != imageStat.st_size ||
+        st.st_mtime != imageStat.st_mtime ||
+        st.st_ctime != imageStat.st_ctime ||
+        pread(fd, buf, bytes, 0) != (ssize_t)bytes ||
+        memcmp(buf, fileData, bytes) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    imageFd = fd;
+    return imageFd;
 }
 
 
@@ -78,7 +120,13 @@ ObjectFile::loadSection(Section *sec, PortProxy& mem_proxy, Addr addr_mask,
     if (sec->size != 0) {
         Addr addr = (sec->baseAddr & addr_mask) + offset;
         if (sec->fileImage) {
-            mem_proxy.writeBlob(addr, sec->fileImage, sec->size);
+            int fd = mapImage ? getImageFd() : -1;
+            if (fd >= 0) {
+                mem_proxy.writeFileBlob(addr, sec->fileImage, sec->size,
+                                        fd, sec->fileImage - fileData);
+            } else {
+                mem_proxy.writeBlob(addr, sec->fileImage, sec->size);
+            }
         }
         else {
             // no image: must be bss
@@ -32,6 +32,8 @@
 #ifndef __OBJECT_FILE_HH__
 #define __OBJECT_FILE_HH__
 
+#include <sys/stat.h>
+
 #include <limits>
 #include <string>
 
@@ -74,6 +76,20 @@ class ObjectFile
     uint8_t *fileData;
     size_t len;
 
+    /**
+     * Descriptor of the file fileData was mapped from, to map sections
+     * straight into memory when they are loaded if mapImage is set.
+     * It's opened on first use, and is -1 if the file on disk isn't
+     * the one fileData was mapped from any more, e.g. because it was
+     * compressed, replaced or modified since.
+     */
+    bool mapImage;
+    int imageFd;
+    bool imageFdValid;
+    struct stat imageStat;
+    bool imageStatValid;
+    int getImageFd();
+
     Arch arch;
     OpSys opSys;
 
@@ -111,6 +127,14 @@ class ObjectFile
     Arch  getArch()  const { return arch; }
     OpSys getOpSys() const { return opSys; }
 
+    /**
+     * Map the sections copy-on-write from the file when they are
+     * loaded instead of copying them. Pages the simulation hasn't
+     * written keep reading the file, so it must not be modified or
+     * truncated until the simulation ends.
+     */
+    void setMapImage(bool map) { mapImage = map; }
+
   protected:
 
     struct Section {
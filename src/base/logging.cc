@@ -46,6 +46,7 @@
 #include <sstream>
 
 #include "base/hostinfo.hh"
+#include "base/trace.hh"
 
 namespace {
 
@@ -73,6 +74,17 @@ class ExitLogger : public NormalLogger
     }
 };
 
+class PanicLogger : public ExitLogger
+{
+  public:
+    using ExitLogger::ExitLogger;
+
+  protected:
+    // The abort handler can only save the debug messages in full
+    // blocks, so save all of them while it is still safe to
+    void exit() override { Trace::getDebugLogger()->flush(); }
+};
+
 class FatalLogger : public ExitLogger
 {
   public:
@@ -82,7 +94,7 @@ class FatalLogger : public ExitLogger
     void exit() override { ::exit(1); }
 };
 
-ExitLogger panicLogger("panic: ");
+PanicLogger panicLogger("panic: ");
 FatalLogger fatalLogger("fatal: ");
 NormalLogger warnLogger("warn: ");
 NormalLogger infoLogger("info: ");
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_SLAB_POOL_HH__
+#define __BASE_SLAB_POOL_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/**
+ * Free list allocator for objects of one class that are created and
+ * destroyed at a high rate by a single owner, such as the dynamic
+ * instructions of a CPU model.
+ *
+ * Memory is carved out of slabs of a fixed number of objects, and a
+ * destroyed object goes back on the free list of the pool it came
+ * from, to be handed out again by the next allocation. The free list
+ * is last in first out, so squashed instructions are recycled right
+ * away by the instructions fetched after the squash, and the memory
+ * they use stays in the host caches. Slabs are only returned to the
+ * host once the pool is destroyed and all of its objects are gone.
+ *
+ * Each object is preceded by a header naming its pool, which is how
+ * operator delete finds where to return it. Objects that are larger
+ * than the first object allocated from the pool, or that are created
+ * without a pool, come from the heap instead.
+ */
+class SlabPool
+{
+  private:
+    struct alignas(alignof(std::max_align_t)) Header
+    {
+        union {
+            /** Pool of an allocated object, null for heap objects */
+            SlabPool *pool;
+            /** Next object on the free list */
+            Header *next;
+        };
+    };
+
+    /** Number of objects in a slab */
+    const size_t slabObjects;
+    /** Size of an object including its header, set on first use */
+    size_t objectSize;
+
+    std::vector<char *> slabs;
+    /** Objects of the last slab that were never handed out */
+    char *unused;
+    char *slabEnd;
+    /** Objects that were handed out and returned */
+    Header *freeList;
+
+    /** Number of objects handed out and not yet returned */
+    uint64_t _outstanding;
+    /** Number of objects handed out */
+    uint64_t _allocated;
+    /** Number of objects handed out from the free list */
+    uint64_t _reused;
+    /** Owner is gone, delete the pool with its last object */
+    bool detached;
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    ~SlabPool()
+    {
+        for (auto slab : slabs)
+            delete [] slab;
+    }
+
+    void
+    grow()
+    {
+        unused = new char[slabObjects * objectSize];
+        slabEnd = unused + slabObjects * objectSize;
+        slabs.push_back(unused);
+    }
+
+    void
+    put(Header *h)
+    {
+        assert(_outstanding > 0);
+        h->next = freeList;
+        freeList = h;
+        if (--_outstanding == 0 && detached)
+            delete this;
+    }
+
+  public:
+    /**
+     * @param slab_objects Number of objects in a slab, which should
+     * cover the number of objects the owner usually has alive.
+     */
+    explicit SlabPool(size_t slab_objects)
+        : slabObjects(slab_objects ? slab_objects : 1), objectSize(0),
+          unused(nullptr), slabEnd(nullptr), freeList(nullptr),
+          _outstanding(0), _allocated(0), _reused(0),
+          detached(false)
+    {}
+
+    /**
+     * Destroy the pool once all of its objects are gone. Used by the
+     * owner instead of delete, as objects may outlive their owner.
+     */
+    void
+    detach()
+    {
+        detached = true;
+        if (_outstanding == 0)
+            delete this;
+    }
+
+    /** Allocate memory for an object of the given size. */
+    void *
+    allocate(size_t size)
+    {
+        if (objectSize == 0) {
+            const size_t align = sizeof(Header);
+            objectSize = sizeof(Header) + (size + align - 1) / align * align;
+        }
+        if (sizeof(Header) + size > objectSize)
+            return allocateUnpooled(size);
+
+        Header *h;
+        if (freeList) {
+            h = freeList;
+            freeList = h->next;
+            ++_reused;
+        } else {
+            if (unused == slabEnd)
+                grow();
+            h = reinterpret_cast<Header *>(unused);
+            unused += objectSize;
+        }
+        h->pool = this;
+        ++_outstanding;
+        ++_allocated;
+        return h + 1;
+    }
+
+    /** Allocate memory for an object that does not belong to a pool. */
+    static void *
+    allocateUnpooled(size_t size)
+    {
+        Header *h =
+            static_cast<Header *>(::operator new(sizeof(Header) + size));
+        h->pool = nullptr;
+        return h + 1;
+    }
+
+    /** Return the memory of an object to where it came from. */
+    static void
+    release(void *p)
+    {
+        if (!p)
+            return;
+        Header *h = static_cast<Header *>(p) - 1;
+        if (h->pool)
+            h->pool->put(h);
+        else
+            ::operator delete(h);
+    }
+
+    /** Number of objects allocated from the pool */
+    uint64_t allocated() const { return _allocated; }
+    /** Number of allocations served from the free list */
+    uint64_t reused() const { return _reused; }
+    /** Number of objects alive */
+    uint64_t outstanding() const { return _outstanding; }
+    /** Number of slabs taken from the heap */
+    uint64_t numSlabs() const { return slabs.size(); }
+
+    /** Restart the allocated and reused counts, for a stats reset */
+    void resetCounts() { _allocated = 0; _reused = 0; }
+};
+
+/**
+ * Base class of objects that may be allocated from a SlabPool, with
+ * new (pool) T(...). Objects created with a plain new come from the
+ * heap as usual, and delete does the right thing for both.
+ */
+class SlabAllocated
+{
+  public:
+    static void *
+    operator new(size_t size, SlabPool &pool)
+    {
+        return pool.allocate(size);
+    }
+
+    static void *
+    operator new(size_t size)
+    {
+        return SlabPool::allocateUnpooled(size);
+    }
+
+    static void operator delete(void *p) { SlabPool::release(p); }
+    static void operator delete(void *p, SlabPool &) { SlabPool::release(p); }
+};
+
+#endif // __BASE_SLAB_POOL_HH__
@@ -490,6 +490,26 @@ processDumpQueue()
     dumpQueue.process();
 }
 
+void
+dumpDirty(Output &output, const string &desc)
+{
+    output.begin(desc);
+    for (auto *info : statsList()) {
+        if (info->dirty()) {
+            info->prepare();
+            info->visit(output);
+        }
+    }
+    output.end();
+}
+
+void
+clearDirty()
+{
+    for (auto *info : statsList())
+        info->clearDirty();
+}
+
 void
 registerResetCallback(Callback *cb)
 {
@@ -98,6 +98,8 @@ class InfoProxy : public Base
         visitor.visit(*static_cast<Base *>(this));
     }
     bool zero() const { return s.zero(); }
+    bool dirty() const { return s.dirty(); }
+    void clearDirty() { s.clearDirty(); }
 };
 
 template <class Stat>
@@ -172,6 +174,10 @@ struct StorageParams
 
 class InfoAccess
 {
+  private:
+    /** Set when the stat is updated, cleared once it has been dumped */
+    bool _dirty;
+
   protected:
     /** Set up an info class for this statistic */
     void setInfo(Info *info);
@@ -186,6 +192,23 @@ class InfoAccess
     const Info *info() const;
 
   public:
+    InfoAccess() : _dirty(true) {}
+
+    /** Note that the value of this stat changed */
+    void setDirty() { _dirty = true; }
+
+    /**
+     * @return true if the stat may have changed since it was last
+     * dumped. Stats whose value changes without being updated hide
+     * this to always return true: Average, AverageVector and
+     * AverageDeviation, whose values change with time, and Value and
+     * Formula, which are computed when dumped.
+     */
+    bool dirty() const { return _dirty; }
+
+    /** Note that the stat has been dumped */
+    void clearDirty() { _dirty = false; }
+
     /**
      * Reset the stat to the default state.
      */
@@ -411,6 +434,7 @@ class DataWrapVec : public DataWrap<Derived, InfoProxyType>
         size_t size = self.size();
         for (off_type i = 0; i < size; ++i)
             self.data(i)->reset(info);
+        this->setDirty();
     }
 };
 
@@ -688,12 +712,12 @@ class ScalarBase : public DataWrap<Derived, ScalarInfoProxy>
      * Increment the stat by 1. This calls the associated storage object inc
      * function.
      */
-    void operator++() { data()->inc(1); }
+    void operator++() { data()->inc(1); this->setDirty(); }
     /**
      * Decrement the stat by 1. This calls the associated storage object dec
      * function.
      */
-    void operator--() { data()->dec(1); }
+    void operator--() { data()->dec(1); this->setDirty(); }
 
     /** Increment the stat by 1. */
     void operator++(int) { ++*this; }
@@ -706,7 +730,7 @@ class ScalarBase : public DataWrap<Derived, ScalarInfoProxy>
      * @param v The new value.
      */
     template <typename U>
-    void operator=(const U &v) { data()->set(v); }
+    void operator=(const U &v) { data()->set(v); this->setDirty(); }
 
     /**
      * Increment the stat by the given value. This calls the associated
@@ -714,7 +738,7 @@ class ScalarBase : public DataWrap<Derived, ScalarInfoProxy>
      * @param v The value to add.
      */
     template <typename U>
-    void operator+=(const U &v) { data()->inc(v); }
+    void operator+=(const U &v) { data()->inc(v); this->setDirty(); }
 
     /**
      * Decrement the stat by the given value. This calls the associated
@@ -722,7 +746,7 @@ class ScalarBase : public DataWrap<Derived, ScalarInfoProxy>
      * @param v The value to substract.
      */
     template <typename U>
-    void operator-=(const U &v) { data()->dec(v); }
+    void operator-=(const U &v) { data()->dec(v); this->setDirty(); }
 
     /**
      * Return the number of elements, always 1 for a scalar.
@@ -738,7 +762,13 @@ class ScalarBase : public DataWrap<Derived, ScalarInfoProxy>
 
     bool zero() { return result() == 0.0; }
 
-    void reset() { data()->reset(this->info()); }
+    void
+    reset()
+    {
+        data()->reset(this->info());
+        this->setDirty();
+    }
+
     void prepare() { data()->prepare(this->info()); }
 };
 
@@ -852,6 +882,7 @@ class ValueBase : public DataWrap<Derived, ScalarInfoProxy>
     std::string str() const { return proxy->str(); }
     bool zero() const { return proxy->zero(); }
     bool check() const { return proxy != NULL; }
+    bool dirty() const { return true; }
     void prepare() { }
     void reset() { }
 };
@@ -926,12 +957,12 @@ class ScalarProxy
      * Increment the stat by 1. This calls the associated storage object inc
      * function.
      */
-    void operator++() { stat.data(index)->inc(1); }
+    void operator++() { stat.data(index)->inc(1); stat.setDirty(); }
     /**
      * Decrement the stat by 1. This calls the associated storage object dec
      * function.
      */
-    void operator--() { stat.data(index)->dec(1); }
+    void operator--() { stat.data(index)->dec(1); stat.setDirty(); }
 
     /** Increment the stat by 1. */
     void operator++(int) { ++*this; }
@@ -948,6 +979,7 @@ class ScalarProxy
     operator=(const U &v)
     {
         stat.data(index)->set(v);
+        stat.setDirty();
     }
 
     /**
@@ -960,6 +992,7 @@ class ScalarProxy
     operator+=(const U &v)
     {
         stat.data(index)->inc(v);
+        stat.setDirty();
     }
 
     /**
@@ -972,6 +1005,7 @@ class ScalarProxy
     operator-=(const U &v)
     {
         stat.data(index)->dec(v);
+        stat.setDirty();
     }
 
     /**
@@ -1339,6 +1373,7 @@ class Vector2dBase : public DataWrapVec2d<Derived, Vector2dInfoProxy>
         size_type size = this->size();
         for (off_type i = 0; i < size; ++i)
             data(i)->reset(info);
+        this->setDirty();
     }
 
     bool
@@ -1866,7 +1901,12 @@ class DistBase : public DataWrap<Derived, DistInfoProxy>
      * @param n The number of times to add it, defaults to 1.
      */
     template <typename U>
-    void sample(const U &v, int n = 1) { data()->sample(v, n); }
+    void
+    sample(const U &v, int n = 1)
+    {
+        data()->sample(v, n);
+        this->setDirty();
+    }
 
     /**
      * Return the number of entries in this stat.
@@ -1893,12 +1933,18 @@ class DistBase : public DataWrap<Derived, DistInfoProxy>
     reset()
     {
         data()->reset(this->info());
+        this->setDirty();
     }
 
     /**
      *  Add the argument distribution to the this distribution.
      */
-    void add(DistBase &d) { data()->add(d.data()); }
+    void
+    add(DistBase &d)
+    {
+        data()->add(d.data());
+        this->setDirty();
+    }
 
 };
 
@@ -2037,6 +2083,7 @@ class DistProxy
     sample(const U &v, int n = 1)
     {
         data()->sample(v, n);
+        stat.setDirty();
     }
 
     size_type
@@ -2486,6 +2533,9 @@ class Average : public ScalarBase<Average, AvgStor>
 {
   public:
     using ScalarBase<Average, AvgStor>::operator=;
+
+    /** The average changes with time even without updates. */
+    bool dirty() const { return true; }
 };
 
 class Value : public ValueBase<Value>
@@ -2506,6 +2556,9 @@ class Vector : public VectorBase<Vector, StatStor>
  */
 class AverageVector : public VectorBase<AverageVector, AvgStor>
 {
+  public:
+    /** The averages change with time even without updates. */
+    bool dirty() const { return true; }
 };
 
 /**
@@ -2601,6 +2654,9 @@ class AverageDeviation : public DistBase<AverageDeviation, AvgSampleStor>
         this->doInit();
         this->setParams(params);
     }
+
+    /** The statistics change with time even without samples. */
+    bool dirty() const { return true; }
 };
 
 /**
@@ -2676,6 +2732,9 @@ class VectorAverageDeviation
         this->setParams(params);
         return this->self();
     }
+
+    /** The statistics change with time even without samples. */
+    bool dirty() const { return true; }
 };
 
 template <class Stat>
@@ -2763,7 +2822,12 @@ class SparseHistBase : public DataWrap<Derived, SparseHistInfoProxy>
      * @param n The number of times to add it, defaults to 1.
      */
     template <typename U>
-    void sample(const U &v, int n = 1) { data()->sample(v, n); }
+    void
+    sample(const U &v, int n = 1)
+    {
+        data()->sample(v, n);
+        this->setDirty();
+    }
 
     /**
      * Return the number of entries in this stat.
@@ -2790,6 +2854,7 @@ class SparseHistBase : public DataWrap<Derived, SparseHistInfoProxy>
     reset()
     {
         data()->reset(this->info());
+        this->setDirty();
     }
 };
 
@@ -2971,6 +3036,12 @@ class Formula : public DataWrapVec<Formula, FormulaInfoProxy>
      */
     bool zero() const;
 
+    /**
+     * Formulas are computed from other stats, so they are always
+     * dumped.
+     */
+    bool dirty() const { return true; }
+
     std::string str() const;
 };
 
@@ -3263,6 +3334,18 @@ void processResetQueue();
  */
 void processDumpQueue();
 
+/**
+ * Dump the stats that may have changed since the last dump to an
+ * output that only stores changes. Only those stats are prepared.
+ */
+void dumpDirty(Output &output, const std::string &desc);
+
+/**
+ * Mark all stats as dumped, once every output has seen the current
+ * dump.
+ */
+void clearDirty();
+
 std::list<Info *> &statsList();
 
 typedef std::map<const void *, Info *> MapType;
@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/stats/columnar.hh"
+
+#include <sys/stat.h>
+
+#include <cassert>
+#include <cstring>
+
+#include "base/logging.hh"
+#include "base/output.hh"
+#include "base/stats/info.hh"
+#include "base/types.hh"
+
+/** The current simulated tick. */
+extern Tick curTick();
+
+using namespace std;
+
+namespace Stats {
+
+const char Columnar::magic[8] = { 'G', 'E', 'M', '5', 'S', 'T', 'C', '1' };
+
+const vector<string> Columnar::distFields = {
+    "samples", "min_value", "max_value", "underflows", "overflows",
+    "sum", "squares", "logs", "bucket_size", "min_bucket", "max_bucket",
+};
+
+namespace {
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+};
+
+template <class T>
+void
+put(string &buf, T value)
+{
+    buf.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void
+putString(string &buf, const string &str)
+{
+    put<uint32_t>(buf, str.size());
+    buf.append(str);
+}
+
+void
+pad(string &buf)
+{
+    buf.append((8 - buf.size() % 8) % 8, '\0');
+}
+
+string
+subname(const vector<string> &names, off_type i)
+{
+    if (i < names.size() && !names[i].empty())
+        return names[i];
+    return to_string(i);
+}
+
+void
+distNames(vector<string> &names, const string &prefix, const DistData &data)
+{
+    for (const auto &field : Columnar::distFields)
+        names.push_back(prefix + field);
+    for (off_type i = 0; i < data.cvec.size(); ++i)
+        names.push_back(prefix + "bucket" + to_string(i));
+}
+
+} // anonymous namespace
+
+Columnar::Columnar()
+    : stream(nullptr), output(nullptr), deltas(false), partial(false),
+      sparseStats(0), dumps(0)
+{
+}
+
+Columnar::Columnar(const string &file, bool deltas)
+    : stream(nullptr), output(nullptr), deltas(false), partial(false),
+      sparseStats(0), dumps(0)
+{
+    open(file, deltas);
+}
+
+Columnar::~Columnar()
+{
+}
+
+void
+Columnar::open(const string &file, bool _deltas)
+{
+    if (stream)
+        panic("stream already set!");
+
+    path = file;
+    deltas = _deltas;
+
+    fileStream.open(file.c_str(), ios::binary | ios::app);
+    stream = &fileStream;
+    if (!valid())
+        fatal("Unable to open statistics file for writing\n");
+
+    startFile();
+}
+
+void
+Columnar::open(OutputStream *file, bool _deltas)
+{
+    if (stream)
+        panic("stream already set!");
+
+    output = file;
+    path = simout.resolve(file->name());
+    deltas = _deltas;
+
+    stream = file->stream();
+    if (!valid())
+        fatal("Unable to open statistics file for writing\n");
+
+    startFile();
+}
+
+void
+Columnar::startFile()
+{
+    // The file is opened in append mode, so an existing one is only
+    // read here
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && st.st_size > 0) {
+        FileHeader header;
+        ifstream is(path.c_str(), ios::binary);
+        if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+            header.version != version ||
+            header.byteOrder != byteOrderMark) {
+            fatal("Can't append stats to %s, it isn't a columnar stats "
+                  "file written by this version on this host\n", path);
+        }
+    } else {
+        FileHeader header;
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.byteOrder = byteOrderMark;
+        stream->write(reinterpret_cast<const char *>(&header),
+                      sizeof(header));
+        stream->flush();
+    }
+
+    // Every file starts with a schema
+    schema.clear();
+    schemaIndex.clear();
+}
+
+bool
+Columnar::relocated() const
+{
+    return output && simout.resolve(output->name()) != path;
+}
+
+bool
+Columnar::valid() const
+{
+    return stream && stream->good();
+}
+
+bool
+Columnar::incremental() const
+{
+    // The first dump of a run, or of a file in a new output directory,
+    // has every stat so that it can write the schema.
+    return deltas && !schema.empty() && !relocated();
+}
+
+void
+Columnar::begin(string _desc)
+{
+    // simout was moved, e.g., in a child forked to run a sweep point,
+    // and the file reopened in the new directory
+    if (relocated()) {
+        path = simout.resolve(output->name());
+        startFile();
+    }
+
+    desc = _desc;
+    partial = incremental();
+    layout.clear();
+    row.clear();
+    sparse.clear();
+    sparseStats = 0;
+}
+
+void
+Columnar::end()
+{
+    if (partial) {
+        writeDelta();
+    } else {
+        if (!(layout == schema)) {
+            schema = layout;
+            writeSchema();
+        }
+        writeDump();
+    }
+
+    if (sparseStats) {
+        string header;
+        put<uint64_t>(header, sparseStats);
+        writeChunk(Sparse, header + sparse);
+    }
+
+    stream->flush();
+    dumps++;
+}
+
+bool
+Columnar::noOutput(const Info &info)
+{
+    // Unlike the text output, stats with a zero prerequisite are kept
+    // so that the row layout stays the same from dump to dump.
+    return !info.flags.isSet(display);
+}
+
+void
+Columnar::addColumn(const Info &info, StatKind kind, size_type first)
+{
+    layout.push_back(Column{&info, kind, uint32_t(row.size() - first)});
+}
+
+uint32_t
+Columnar::statIndex(const Info &info)
+{
+    // In a full dump the schema is the layout of the dump, which ends
+    // with the stat being visited.
+    if (!partial)
+        return layout.size() - 1;
+
+    auto it = schemaIndex.find(&info);
+    panic_if(it == schemaIndex.end(),
+             "Stat %s was added after the first dump to %s\n", info.name,
+             path);
+    return it->second;
+}
+
+void
+Columnar::addDist(const DistData &data)
+{
+    bool deviation = data.type == Deviation;
+
+    // Only the fields that prepare() fills in for this type of
+    // distribution hold meaningful values.
+    row.push_back(data.samples);
+    row.push_back(deviation ? 0 : data.min_val);
+    row.push_back(deviation ? 0 : data.max_val);
+    row.push_back(deviation ? 0 : data.underflow);
+    row.push_back(deviation ? 0 : data.overflow);
+    row.push_back(data.sum);
+    row.push_back(data.squares);
+    row.push_back(data.type == Hist ? data.logs : 0);
+    row.push_back(deviation ? 0 : data.bucket_size);
+    row.push_back(deviation ? 0 : data.min);
+    row.push_back(deviation ? 0 : data.max);
+    if (!deviation)
+        row.insert(row.end(), data.cvec.begin(), data.cvec.end());
+}
+
+void
+Columnar::visit(const ScalarInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    row.push_back(info.result());
+    layout.push_back(Column{&info, ScalarKind, 1});
+}
+
+void
+Columnar::visit(const VectorInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type first = row.size();
+    const VResult &vec = info.result();
+    row.insert(row.end(), vec.begin(), vec.end());
+    addColumn(info, VectorKind, first);
+}
+
+void
+Columnar::visit(const DistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type first = row.size();
+    addDist(info.data);
+    addColumn(info, DistKind, first);
+}
+
+void
+Columnar::visit(const VectorDistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type first = row.size();
+    for (off_type i = 0; i < info.size(); ++i)
+        addDist(info.data[i]);
+    addColumn(info, VectorDistKind, first);
+}
+
+void
+Columnar::visit(const Vector2dInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type first = row.size();
+    row.insert(row.end(), info.cvec.begin(), info.cvec.end());
+    addColumn(info, Vector2dKind, first);
+}
+
+void
+Columnar::visit(const FormulaInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    size_type first = row.size();
+    const VResult &vec = info.result();
+    row.insert(row.end(), vec.begin(), vec.end());
+    addColumn(info, FormulaKind, first);
+}
+
+void
+Columnar::visit(const SparseHistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    row.push_back(info.data.samples);
+    layout.push_back(Column{&info, SparseHistKind, 1});
+
+    put<uint32_t>(sparse, statIndex(info));
+    put<uint32_t>(sparse, 0);
+    put<uint64_t>(sparse, info.data.cmap.size());
+    for (const auto &bucket : info.data.cmap) {
+        put<double>(sparse, bucket.first);
+        put<double>(sparse, bucket.second);
+    }
+    sparseStats++;
+}
+
+void
+Columnar::writeChunk(ChunkType type, const string &payload)
+{
+    assert(payload.size() % 8 == 0);
+
+    ChunkHeader header;
+    header.type = type;
+    header.reserved = 0;
+    header.size = payload.size();
+    stream->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream->write(payload.data(), payload.size());
+}
+
+void
+Columnar::writeSchema()
+{
+    schemaIndex.clear();
+    for (uint32_t i = 0; i < schema.size(); i++)
+        schemaIndex[schema[i].info] = i;
+
+    string payload;
+    put<uint64_t>(payload, schema.size());
+    put<uint64_t>(payload, row.size());
+
+    vector<string> names;
+    for (const auto &column : schema) {
+        const Info &info = *column.info;
+
+        names.clear();
+        switch (column.kind) {
+          case ScalarKind:
+          case SparseHistKind:
+            names.push_back("");
+            break;
+
+          case VectorKind:
+          case FormulaKind: {
+              auto &vinfo = static_cast<const VectorInfo &>(info);
+              for (off_type i = 0; i < column.count; ++i)
+                  names.push_back(subname(vinfo.subnames, i));
+              break;
+          }
+
+          case DistKind:
+            distNames(names, "", static_cast<const DistInfo &>(info).data);
+            break;
+
+          case VectorDistKind: {
+              auto &vinfo = static_cast<const VectorDistInfo &>(info);
+              for (off_type i = 0; i < vinfo.size(); ++i) {
+                  distNames(names, subname(vinfo.subnames, i) + "::",
+                            vinfo.data[i]);
+              }
+              break;
+          }
+
+          case Vector2dKind: {
+              auto &vinfo = static_cast<const Vector2dInfo &>(info);
+              for (off_type x = 0; x < vinfo.x; ++x) {
+                  for (off_type y = 0; y < vinfo.y; ++y) {
+                      names.push_back(subname(vinfo.subnames, x) + "::" +
+                                      subname(vinfo.y_subnames, y));
+                  }
+              }
+              break;
+          }
+        }
+        assert(names.size() == column.count);
+
+        put<int32_t>(payload, info.id);
+        put<uint32_t>(payload, column.kind);
+        put<uint32_t>(payload, column.count);
+        putString(payload, info.name);
+        putString(payload, info.desc);
+        for (const auto &name : names)
+            putString(payload, name);
+    }
+    pad(payload);
+
+    writeChunk(Schema, payload);
+}
+
+void
+Columnar::writeDump()
+{
+    string payload;
+    payload.reserve(24 + desc.size() + row.size() * sizeof(Result));
+    put<uint64_t>(payload, curTick());
+    put<uint64_t>(payload, row.size());
+    putString(payload, desc);
+    pad(payload);
+    payload.append(reinterpret_cast<const char *>(row.data()),
+                   row.size() * sizeof(Result));
+    writeChunk(Dump, payload);
+}
+
+void
+Columnar::writeDelta()
+{
+    string payload;
+    payload.reserve(32 + desc.size() + layout.size() * sizeof(uint32_t) +
+                    row.size() * sizeof(Result));
+    put<uint64_t>(payload, curTick());
+    put<uint64_t>(payload, layout.size());
+    put<uint64_t>(payload, row.size());
+    putString(payload, desc);
+    pad(payload);
+
+    for (const auto &column : layout) {
+        uint32_t index = statIndex(*column.info);
+        panic_if(!(schema[index] == column),
+                 "Stat %s changed its size since the first dump to %s\n",
+                 column.info->name, path);
+        put<uint32_t>(payload, index);
+    }
+    pad(payload);
+
+    payload.append(reinterpret_cast<const char *>(row.data()),
+                   row.size() * sizeof(Result));
+    writeChunk(Delta, payload);
+}
+
+Output *
+initColumnar(const string &filename, bool deltas)
+{
+    static Columnar columnar;
+    static bool connected = false;
+
+    if (!connected) {
+        // Opened through simout so that the file follows the output
+        // directory into forked children, as the text stats file does
+        columnar.open(simout.open(filename, ios::binary | ios::app, true,
+                                  true), deltas);
+        connected = true;
+    }
+
+    return &columnar;
+}
+
+} // namespace Stats
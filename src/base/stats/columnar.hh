@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_STATS_COLUMNAR_HH__
+#define __BASE_STATS_COLUMNAR_HH__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/stats/output.hh"
+#include "base/stats/types.hh"
+
+class OutputStream;
+
+namespace Stats {
+
+struct DistData;
+
+/**
+ * Binary stats output that stores the layout of the stats once and
+ * then one row of doubles per dump, so that a run's dumps can be
+ * loaded as columns without parsing text.
+ *
+ * The file is a 16 byte header followed by chunks. Every chunk starts
+ * with a ChunkHeader and its payload is padded to a multiple of 8
+ * bytes. All fields are in the byte order of the host that wrote
+ * them, which the reader recovers from the header's byteOrder field.
+ *
+ * A Schema chunk describes the row of the dumps that follow it: the
+ * number of stats and values, then for every stat its id, kind,
+ * number of values, name, description and one name per value.
+ * Strings are a 32 bit length followed by the characters.
+ *
+ * A Dump chunk holds the tick, the dump description and the row. The
+ * row starts at an 8 byte aligned offset within the payload so that
+ * it can be mapped as an array of doubles.
+ *
+ * Sparse histograms don't have a fixed number of values. Their
+ * samples are part of the row and their buckets are written as
+ * (key, count) pairs in a Sparse chunk following the dump.
+ *
+ * Dumps are appended to an existing file, and a new schema is written
+ * whenever the row layout differs from the last one written, e.g.,
+ * at the start of every run appending to the file.
+ *
+ * With deltas enabled, every dump but the first of a schema is a Delta
+ * chunk holding only the stats that changed since the previous dump,
+ * see dumpDirty(). It has the tick, the number of stats and values and
+ * the description, followed by the 32 bit schema index of every stat
+ * and then their values. Both arrays start at 8 byte aligned offsets.
+ * Stats that aren't in a delta keep their values from the dump before.
+ */
+class Columnar : public Output
+{
+  public:
+    static const char magic[8];
+    static const uint32_t version = 1;
+    static const uint32_t byteOrderMark = 0x01020304;
+
+    enum ChunkType : uint32_t {
+        Schema = 1,
+        Dump = 2,
+        Sparse = 3,
+        Delta = 4,
+    };
+
+    enum StatKind : uint32_t {
+        ScalarKind,
+        VectorKind,
+        DistKind,
+        VectorDistKind,
+        Vector2dKind,
+        FormulaKind,
+        SparseHistKind,
+    };
+
+    struct ChunkHeader
+    {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t size;
+    };
+
+    /** Values stored for every distribution, ahead of its buckets */
+    static const std::vector<std::string> distFields;
+
+  protected:
+    struct Column
+    {
+        const Info *info;
+        StatKind kind;
+        uint32_t count;
+
+        bool
+        operator==(const Column &rhs) const
+        {
+            return info == rhs.info && kind == rhs.kind &&
+                count == rhs.count;
+        }
+    };
+
+    /** File opened by path, unused when writing to an OutputStream */
+    std::ofstream fileStream;
+    std::ostream *stream;
+    /**
+     * File in the output directory, which is reopened in the new
+     * directory when simout moves, e.g., in a forked child
+     */
+    OutputStream *output;
+    std::string path;
+
+    /** Write Delta chunks after the first dump of a schema */
+    bool deltas;
+    /** The dump in progress only has the stats that changed */
+    bool partial;
+
+    /** Layout of the last schema written */
+    std::vector<Column> schema;
+    /** Index of every stat in the schema */
+    std::unordered_map<const Info *, uint32_t> schemaIndex;
+    /** Layout and values of the dump in progress */
+    std::vector<Column> layout;
+    VResult row;
+    std::string desc;
+
+    /** Sparse histogram entries of the dump in progress */
+    std::string sparse;
+    uint64_t sparseStats;
+
+    uint64_t dumps;
+
+    bool noOutput(const Info &info);
+    void addColumn(const Info &info, StatKind kind, size_type first);
+    void addDist(const DistData &data);
+    /** Index of a stat in the schema the dump in progress uses */
+    uint32_t statIndex(const Info &info);
+
+    /** Check the header of the file, or write it if the file is new */
+    void startFile();
+    /** Has the output directory moved since the file was started? */
+    bool relocated() const;
+
+    void writeChunk(ChunkType type, const std::string &payload);
+    void writeSchema();
+    void writeDump();
+    void writeDelta();
+
+  public:
+    Columnar();
+    Columnar(const std::string &file, bool deltas=false);
+    ~Columnar();
+
+    void open(const std::string &file, bool deltas=false);
+    /** Write to a binary file opened in append mode in simout */
+    void open(OutputStream *file, bool deltas=false);
+
+    /** Number of dumps written by this output */
+    uint64_t numDumps() const { return dumps; }
+
+    // Implement Visit
+    void visit(const ScalarInfo &info) override;
+    void visit(const VectorInfo &info) override;
+    void visit(const DistInfo &info) override;
+    void visit(const VectorDistInfo &info) override;
+    void visit(const Vector2dInfo &info) override;
+    void visit(const FormulaInfo &info) override;
+    void visit(const SparseHistInfo &info) override;
+
+    // Implement Output
+    bool valid() const override;
+    bool incremental() const override;
+    void begin(std::string desc="") override;
+    void end() override;
+};
+
+Output *initColumnar(const std::string &filename, bool deltas);
+
+} // namespace Stats
+
+#endif // __BASE_STATS_COLUMNAR_HH__
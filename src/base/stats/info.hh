@@ -128,6 +128,18 @@ class Info
      */
     virtual bool zero() const = 0;
 
+    /**
+     * @return true if the stat may have changed since it was last
+     * dumped, i.e., since clearDirty() was last called. Averages,
+     * AverageDeviation, Value and Formula stats always report dirty.
+     */
+    virtual bool dirty() const { return true; }
+
+    /**
+     * Note that the stat has been dumped in its current state.
+     */
+    virtual void clearDirty() { }
+
     /**
      * Visitor entry for outputing statistics data
      */
@@ -52,6 +52,13 @@ struct Output
     virtual void end() = 0;
     virtual bool valid() const = 0;
 
+    /**
+     * Outputs that can store a dump as the stats that changed since
+     * the previous one return true. They are then only visited with
+     * those stats, see dumpDirty().
+     */
+    virtual bool incremental() const { return false; }
+
     virtual void visit(const ScalarInfo &info) = 0;
     virtual void visit(const VectorInfo &info) = 0;
     virtual void visit(const DistInfo &info) = 0;
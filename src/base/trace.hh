@@ -41,6 +41,7 @@
 #include "base/cprintf.hh"
 #include "base/debug.hh"
 #include "base/match.hh"
+#include "base/trace_args.hh"
 #include "base/types.hh"
 #include "sim/core.hh"
 
@@ -54,7 +55,15 @@ class Logger
     /** Name match for objects to ignore */
     ObjectMatch ignore;
 
+    /**
+     * Set by loggers that store the arguments of messages instead of
+     * formatting them, see reserveMessage().
+     */
+    bool unformatted;
+
   public:
+    Logger() : unformatted(false) { }
+
     /** Log a single message */
     template <typename ...Args>
     void dprintf(Tick when, const std::string &name, const char *fmt,
@@ -63,6 +72,15 @@ class Logger
         if (!name.empty() && ignore.match(name))
             return;
 
+        if (unformatted && PackableArgs<Args...>::value) {
+            char *data = reserveMessage(when, name, fmt, sizeof...(Args),
+                                        packedSize(args...));
+            if (data) {
+                packArgs(data, args...);
+                return;
+            }
+        }
+
         std::ostringstream line;
         ccprintf(line, fmt, args...);
         logMessage(when, name, line.str());
@@ -76,6 +94,28 @@ class Logger
     virtual void logMessage(Tick when, const std::string &name,
                             const std::string &message) = 0;
 
+    /**
+     * Reserve space for the packed arguments of an unformatted
+     * message, see trace_args.hh. Returns nullptr if the message
+     * should be formatted and passed to logMessage() instead.
+     */
+    virtual char *
+    reserveMessage(Tick when, const std::string &name, const char *fmt,
+                   unsigned nargs, size_t size)
+    {
+        return nullptr;
+    }
+
+    /** Write out any buffered messages */
+    virtual void flush() { }
+
+    /**
+     * Write out buffered messages from a fatal signal handler. This
+     * must not lock, allocate or wait, so it may leave out messages
+     * flush() would write.
+     */
+    virtual void signalFlush() { }
+
     /** Return an ostream that can be used to send messages to
      *  the 'same place' as formatted logMessage messages.  This
      *  can be implemented to use a logger's underlying ostream,
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Packing of the arguments of debug messages for loggers that store
+ * them without formatting them, see Trace::BinaryLogger. Each argument
+ * is stored as a type tag followed by its value, so that it can later
+ * be formatted by cprintf exactly as if it had been printed directly.
+ * Messages with arguments of any other type are formatted as usual.
+ */
+
+#ifndef __BASE_TRACE_ARGS_HH__
+#define __BASE_TRACE_ARGS_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace Trace {
+
+/** The C++ type an argument had when it was logged */
+enum class ArgType : uint8_t
+{
+    Invalid,
+    Bool,
+    Char,
+    SignedChar,
+    UnsignedChar,
+    Short,
+    UnsignedShort,
+    Int,
+    UnsignedInt,
+    Long,
+    UnsignedLong,
+    LongLong,
+    UnsignedLongLong,
+    Float,
+    Double,
+    String,
+    Pointer,
+};
+
+/** Arguments of this type can't be packed */
+template <typename T, typename Enable = void>
+struct ArgTraits
+{
+    static const bool packable = false;
+    static size_t size(const T &) { return 0; }
+    static char *pack(char *p, const T &) { return p; }
+};
+
+template <typename T, ArgType Type>
+struct ScalarArgTraits
+{
+    static const bool packable = true;
+
+    static size_t size(const T &) { return 1 + sizeof(T); }
+
+    static char *
+    pack(char *p, const T &value)
+    {
+        *p = char(Type);
+        memcpy(p + 1, &value, sizeof(T));
+        return p + 1 + sizeof(T);
+    }
+};
+
+template <> struct ArgTraits<bool>
+    : ScalarArgTraits<bool, ArgType::Bool> {};
+template <> struct ArgTraits<char>
+    : ScalarArgTraits<char, ArgType::Char> {};
+template <> struct ArgTraits<signed char>
+    : ScalarArgTraits<signed char, ArgType::SignedChar> {};
+template <> struct ArgTraits<unsigned char>
+    : ScalarArgTraits<unsigned char, ArgType::UnsignedChar> {};
+template <> struct ArgTraits<short>
+    : ScalarArgTraits<short, ArgType::Short> {};
+template <> struct ArgTraits<unsigned short>
+    : ScalarArgTraits<unsigned short, ArgType::UnsignedShort> {};
+template <> struct ArgTraits<int>
+    : ScalarArgTraits<int, ArgType::Int> {};
+template <> struct ArgTraits<unsigned int>
+    : ScalarArgTraits<unsigned int, ArgType::UnsignedInt> {};
+template <> struct ArgTraits<long>
+    : ScalarArgTraits<long, ArgType::Long> {};
+template <> struct ArgTraits<unsigned long>
+    : ScalarArgTraits<unsigned long, ArgType::UnsignedLong> {};
+template <> struct ArgTraits<long long>
+    : ScalarArgTraits<long long, ArgType::LongLong> {};
+template <> struct ArgTraits<unsigned long long>
+    : ScalarArgTraits<unsigned long long, ArgType::UnsignedLongLong> {};
+template <> struct ArgTraits<float>
+    : ScalarArgTraits<float, ArgType::Float> {};
+template <> struct ArgTraits<double>
+    : ScalarArgTraits<double, ArgType::Double> {};
+
+/**
+ * Strings are stored as a 32 bit length and their characters. A null
+ * C string is stored as an empty string.
+ */
+struct StringArgTraits
+{
+    static const bool packable = true;
+
+    static size_t length(const char *str) { return str ? strlen(str) : 0; }
+    static size_t size(const char *str) { return 5 + length(str); }
+    static size_t size(const std::string &str) { return 5 + str.size(); }
+
+    static char *
+    pack(char *p, const char *str, uint32_t len)
+    {
+        *p = char(ArgType::String);
+        memcpy(p + 1, &len, sizeof(len));
+        memcpy(p + 5, str, len);
+        return p + 5 + len;
+    }
+
+    static char *
+    pack(char *p, const char *str)
+    {
+        return pack(p, str, length(str));
+    }
+
+    static char *
+    pack(char *p, const std::string &str)
+    {
+        return pack(p, str.data(), str.size());
+    }
+};
+
+template <> struct ArgTraits<char *> : StringArgTraits {};
+template <> struct ArgTraits<const char *> : StringArgTraits {};
+template <size_t N> struct ArgTraits<char[N]> : StringArgTraits {};
+template <size_t N> struct ArgTraits<const char[N]> : StringArgTraits {};
+template <> struct ArgTraits<std::string> : StringArgTraits {};
+
+/**
+ * Pointers to objects print their address. Pointers to characters
+ * print the string they point to, so the ones that aren't strings
+ * above are formatted as usual.
+ */
+template <typename T>
+struct ArgTraits<T *, typename std::enable_if<
+    std::is_object<T>::value &&
+    !std::is_same<typename std::remove_cv<T>::type, char>::value &&
+    !std::is_same<typename std::remove_cv<T>::type, signed char>::value &&
+    !std::is_same<typename std::remove_cv<T>::type, unsigned char>::value
+    >::type>
+    : ScalarArgTraits<const void *, ArgType::Pointer> {};
+
+/** True if all arguments can be packed */
+template <typename ...Args>
+struct PackableArgs;
+
+template <>
+struct PackableArgs<>
+{
+    static const bool value = true;
+};
+
+template <typename T, typename ...Args>
+struct PackableArgs<T, Args...>
+{
+    static const bool value =
+        ArgTraits<T>::packable && PackableArgs<Args...>::value;
+};
+
+inline size_t packedSize() { return 0; }
+
+/** Number of bytes the packed arguments take */
+template <typename T, typename ...Args>
+size_t
+packedSize(const T &arg, const Args &...args)
+{
+    return ArgTraits<T>::size(arg) + packedSize(args...);
+}
+
+inline char *packArgs(char *p) { return p; }
+
+/** Pack the arguments at p, returning the end of the packed data */
+template <typename T, typename ...Args>
+char *
+packArgs(char *p, const T &arg, const Args &...args)
+{
+    return packArgs(ArgTraits<T>::pack(p, arg), args...);
+}
+
+} // namespace Trace
+
+#endif // __BASE_TRACE_ARGS_HH__
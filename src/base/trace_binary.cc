@@ -0,0 +1,768 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/trace_binary.hh"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "base/atomicio.hh"
+#include "base/logging.hh"
+
+namespace Trace {
+
+const char BinaryLogger::magic[8] = { 'G', 'E', 'M', '5', 'T', 'R', 'C', '1' };
+const uint32_t BinaryLogger::version;
+const uint32_t BinaryLogger::byteOrderMark;
+const size_t BinaryLogger::headerSize;
+const size_t BinaryLogger::maxBlocks;
+
+namespace {
+
+std::atomic<uint64_t> nextSerial(1);
+
+/** Serial of the logger threadStatePtr belongs to */
+__thread uint64_t threadSerial = 0;
+__thread void *threadStatePtr = nullptr;
+
+const std::string noName;
+
+size_t
+roundUp8(size_t n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+bool
+pwriteAll(int fd, const void *data, size_t len, off_t offset)
+{
+    const char *p = static_cast<const char *>(data);
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+uint64_t
+blockSeq(const char *block)
+{
+    BinaryLogger::BlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    return header.seq;
+}
+
+void
+flushDebugLogger()
+{
+    getDebugLogger()->flush();
+}
+
+} // anonymous namespace
+
+BinaryLogger::BinaryLogger(const std::string &_filename, size_t ring_size,
+                           size_t block_size)
+    : filename(_filename), blockSize(block_size),
+      ringBlocks(ring_size ? std::max<size_t>(ring_size / block_size, 2) : 0),
+      serial(nextSerial++), fd(-1),
+      rawBuf(*this), rawStream(&rawBuf),
+      nextSeq(1), writing(false), stopping(false), submitted(maxBlocks)
+{
+    fatal_if(blockSize < 1024 || blockSize > (1 << 30) || blockSize % 8,
+             "Bad debug trace block size %d\n", blockSize);
+
+    unformatted = true;
+
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (fd < 0)
+        fatal("Can't open debug trace %s: %s\n", filename, strerror(errno));
+
+    dict.open(filename + ".dict",
+              std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!dict)
+        fatal("Can't open debug trace dictionary %s.dict\n", filename);
+
+    FileHeader header;
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.byteOrderMark = byteOrderMark;
+    header.blockSize = blockSize;
+    header.ringBlocks = ringBlocks;
+
+    char buf[headerSize] = {};
+    memcpy(buf, &header, sizeof(header));
+    if (atomic_write(fd, buf, headerSize) != headerSize)
+        fatal("Can't write debug trace %s: %s\n", filename, strerror(errno));
+
+    nameIds[""] = 0;
+
+    writer = std::thread(&BinaryLogger::writeLoop, this);
+
+    // Messages still in memory when gem5 exits would be lost
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        std::atexit(flushDebugLogger);
+    }
+}
+
+BinaryLogger::~BinaryLogger()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    fullCond.notify_all();
+    writer.join();
+
+    for (auto ts : threads)
+        delete ts;
+    for (auto block : blocks)
+        delete [] block;
+
+    close(fd);
+}
+
+BinaryLogger::ThreadState &
+BinaryLogger::threadState()
+{
+    if (threadSerial != serial) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto ts = new ThreadState(threads.size());
+        threads.push_back(ts);
+        threadStatePtr = ts;
+        threadSerial = serial;
+    }
+    return *static_cast<ThreadState *>(threadStatePtr);
+}
+
+uint32_t
+BinaryLogger::define(std::unordered_map<std::string, uint32_t> &ids,
+                     DictKind kind, const std::string &str)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = ids.find(str);
+    if (it != ids.end())
+        return it->second;
+
+    // Names start at 1 since 0 is the empty name, so do formats
+    uint32_t id = ids.size() + (kind == FormatDef ? 1 : 0);
+    ids.emplace(str, id);
+
+    // The definition has to be on disk before any block using it
+    uint8_t k = kind;
+    uint32_t len = str.size();
+    dict.write(reinterpret_cast<const char *>(&k), sizeof(k));
+    dict.write(reinterpret_cast<const char *>(&id), sizeof(id));
+    dict.write(reinterpret_cast<const char *>(&len), sizeof(len));
+    dict.write(str.data(), len);
+    dict.flush();
+
+    return id;
+}
+
+uint32_t
+BinaryLogger::formatId(ThreadState &ts, const char *fmt)
+{
+    uintptr_t key = reinterpret_cast<uintptr_t>(fmt);
+    auto &entry = ts.formats[(key ^ (key >> 8)) % ThreadState::cacheSize];
+
+    // Format strings are almost always literals, but check the string
+    // in case the pointer was reused for a different one
+    if (entry.ptr != fmt || strcmp(entry.str.c_str(), fmt) != 0) {
+        entry.str = fmt;
+        entry.id = define(formatIds, FormatDef, entry.str);
+        entry.ptr = fmt;
+    }
+    return entry.id;
+}
+
+uint32_t
+BinaryLogger::nameId(ThreadState &ts, const std::string &name)
+{
+    if (name.empty())
+        return 0;
+
+    uintptr_t key = reinterpret_cast<uintptr_t>(name.data());
+    auto &entry = ts.names[(key ^ (key >> 8)) % ThreadState::cacheSize];
+
+    if (entry.ptr != name.data() || entry.str != name) {
+        entry.str = name;
+        entry.id = define(nameIds, NameDef, entry.str);
+        entry.ptr = name.data();
+    }
+    return entry.id;
+}
+
+char *
+BinaryLogger::reserve(ThreadState &ts, size_t size)
+{
+    if (!ts.block || ts.used + size > blockSize) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (ts.block)
+            submit(ts);
+
+        // Wait for the writer to catch up rather than using an
+        // unbounded amount of memory
+        freeCond.wait(lock, [this]() {
+            return !freeBlocks.empty() || blocks.size() < maxBlocks;
+        });
+
+        if (freeBlocks.empty()) {
+            blocks.push_back(new char[blockSize]);
+            ts.block = blocks.back();
+        } else {
+            ts.block = freeBlocks.back();
+            freeBlocks.pop_back();
+        }
+        ts.used = sizeof(BlockHeader);
+    }
+
+    char *p = ts.block + ts.used;
+    ts.used += size;
+    return p;
+}
+
+void
+BinaryLogger::submit(ThreadState &ts)
+{
+    BlockHeader header;
+    header.seq = nextSeq++;
+    header.thread = ts.thread;
+    header.used = ts.used;
+    memcpy(ts.block, &header, sizeof(header));
+
+    // At most maxBlocks blocks exist, so there is always a free slot
+    for (auto &slot : submitted) {
+        if (!slot.load()) {
+            slot.store(ts.block);
+            break;
+        }
+    }
+
+    fullBlocks.push_back(ts.block);
+    ts.block = nullptr;
+    fullCond.notify_one();
+}
+
+char *
+BinaryLogger::reserveMessage(Tick when, const std::string &name,
+                             const char *fmt, unsigned nargs, size_t size)
+{
+    size_t record = roundUp8(sizeof(RecordHeader) + size);
+    if (nargs > 255 || record > blockSize - sizeof(BlockHeader))
+        return nullptr;
+
+    ThreadState &ts = threadState();
+
+    RecordHeader header;
+    header.size = record;
+    header.kind = Message;
+    header.nargs = nargs;
+    header.pad = 0;
+    header.fmt = formatId(ts, fmt);
+    header.name = nameId(ts, name);
+    header.when = when;
+
+    char *p = reserve(ts, record);
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memset(p + size, 0, record - sizeof(header) - size);
+
+    return p;
+}
+
+void
+BinaryLogger::logBytes(RecordKind kind, Tick when, const std::string &name,
+                       const char *data, size_t len)
+{
+    ThreadState &ts = threadState();
+    uint32_t name_id = nameId(ts, name);
+
+    // Text longer than a block is continued in Raw records
+    const size_t max_len =
+        blockSize - sizeof(BlockHeader) - sizeof(RecordHeader) - 4;
+
+    do {
+        uint32_t n = std::min(len, max_len);
+        size_t record = roundUp8(sizeof(RecordHeader) + 4 + n);
+
+        RecordHeader header;
+        header.size = record;
+        header.kind = kind;
+        header.nargs = 0;
+        header.pad = 0;
+        header.fmt = 0;
+        header.name = name_id;
+        header.when = when;
+
+        char *p = reserve(ts, record);
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        memcpy(p, &n, sizeof(n));
+        p += sizeof(n);
+        memcpy(p, data, n);
+        memset(p + n, 0, record - sizeof(header) - sizeof(n) - n);
+
+        data += n;
+        len -= n;
+        kind = Raw;
+    } while (len > 0);
+}
+
+void
+BinaryLogger::logMessage(Tick when, const std::string &name,
+                         const std::string &message)
+{
+    if (!name.empty() && ignore.match(name))
+        return;
+
+    logBytes(Text, when, name, message.data(), message.size());
+}
+
+void
+BinaryLogger::dump(Tick when, const std::string &name,
+                   const void *d, int len)
+{
+    if (!name.empty() && ignore.match(name))
+        return;
+
+    if (len <= 0)
+        return;
+
+    if (sizeof(RecordHeader) + 4 + len > blockSize - sizeof(BlockHeader)) {
+        Logger::dump(when, name, d, len);
+        return;
+    }
+
+    logBytes(Dump, when, name, static_cast<const char *>(d), len);
+}
+
+bool
+BinaryLogger::claim(const char *block)
+{
+    for (auto &slot : submitted) {
+        char *expected = const_cast<char *>(block);
+        if (slot.compare_exchange_strong(expected, nullptr))
+            return true;
+    }
+    return false;
+}
+
+void
+BinaryLogger::flush()
+{
+    rawStream.flush();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto ts : threads) {
+        if (ts->block && ts->used > sizeof(BlockHeader))
+            submit(*ts);
+    }
+
+    idleCond.wait_for(lock, std::chrono::seconds(10), [this]() {
+        return fullBlocks.empty() && !writing;
+    });
+}
+
+void
+BinaryLogger::signalFlush()
+{
+    // Claim the blocks first, so the writer thread skips them, then
+    // write them in the order they were filled. Errors are ignored,
+    // as in the rest of the signal handler.
+    char *blocks[maxBlocks];
+    size_t count = 0;
+    for (auto &slot : submitted) {
+        char *block = slot.exchange(nullptr);
+        if (!block)
+            continue;
+
+        size_t i = count++;
+        for (; i > 0 && blockSeq(blocks[i - 1]) > blockSeq(block); --i)
+            blocks[i] = blocks[i - 1];
+        blocks[i] = block;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        writeBlock(blocks[i]);
+}
+
+bool
+BinaryLogger::writeBlock(const char *block)
+{
+    BlockHeader header;
+    memcpy(&header, block, sizeof(header));
+
+    if (!ringBlocks)
+        return atomic_write(fd, block, header.used) == header.used;
+
+    // Invalidate the slot while it is rewritten, so a crash never
+    // leaves an old header in front of new data
+    off_t offset = headerSize + (header.seq % ringBlocks) * blockSize;
+    const BlockHeader invalid = { 0, 0, 0 };
+    return pwriteAll(fd, &invalid, sizeof(invalid), offset) &&
+        pwriteAll(fd, block + sizeof(header), header.used - sizeof(header),
+                  offset + sizeof(header)) &&
+        pwriteAll(fd, &header, sizeof(header), offset);
+}
+
+void
+BinaryLogger::writeLoop()
+{
+    // Leave the asynchronous signals to the simulation threads
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        fullCond.wait(lock, [this]() {
+            return stopping || !fullBlocks.empty();
+        });
+        if (fullBlocks.empty())
+            break;
+
+        char *block = fullBlocks.front();
+        fullBlocks.pop_front();
+        writing = true;
+
+        lock.unlock();
+        bool claimed = claim(block);
+        if (claimed && !writeBlock(block)) {
+            warn_once("Failed to write debug trace %s: %s\n",
+                      filename, strerror(errno));
+        }
+        lock.lock();
+
+        // signalFlush() may still be writing a block it claimed, so
+        // that block is never reused
+        writing = false;
+        if (claimed) {
+            freeBlocks.push_back(block);
+            freeCond.notify_one();
+        }
+        if (fullBlocks.empty())
+            idleCond.notify_all();
+    }
+}
+
+int
+BinaryLogger::RawBuf::overflow(int c)
+{
+    if (c == traits_type::eof())
+        return traits_type::not_eof(c);
+
+    line += char(c);
+    if (c == '\n')
+        sync();
+    return c;
+}
+
+std::streamsize
+BinaryLogger::RawBuf::xsputn(const char *s, std::streamsize n)
+{
+    line.append(s, n);
+    if (memchr(s, '\n', n))
+        sync();
+    return n;
+}
+
+int
+BinaryLogger::RawBuf::sync()
+{
+    if (!line.empty()) {
+        logger.logBytes(Raw, MaxTick, noName, line.data(), line.size());
+        line.clear();
+    }
+    return 0;
+}
+
+namespace {
+
+template <typename T>
+T
+readValue(const char *&p)
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return value;
+}
+
+void
+readDict(const std::string &filename, std::vector<std::string> &formats,
+         std::vector<std::string> &names)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        fatal("Can't open debug trace dictionary %s\n", filename);
+
+    names.assign(1, std::string());
+
+    uint8_t kind;
+    uint32_t id, len;
+    while (in.read(reinterpret_cast<char *>(&kind), sizeof(kind)) &&
+           in.read(reinterpret_cast<char *>(&id), sizeof(id)) &&
+           in.read(reinterpret_cast<char *>(&len), sizeof(len))) {
+        std::string str(len, '\0');
+        if (!in.read(&str[0], len))
+            break;
+
+        auto &table = kind == BinaryLogger::FormatDef ? formats : names;
+        if (table.size() <= id)
+            table.resize(id + 1);
+        table[id] = std::move(str);
+    }
+}
+
+/** Format a Message record the way Logger::dprintf() would have */
+std::string
+formatMessage(const std::string &fmt, const char *p, const char *end,
+              unsigned nargs)
+{
+    std::ostringstream line;
+    cp::Print print(line, fmt);
+
+    for (unsigned i = 0; i < nargs && p < end; ++i) {
+        switch (ArgType(*p++)) {
+          case ArgType::Bool:
+            print.add_arg(readValue<bool>(p));
+            break;
+          case ArgType::Char:
+            print.add_arg(readValue<char>(p));
+            break;
+          case ArgType::SignedChar:
+            print.add_arg(readValue<signed char>(p));
+            break;
+          case ArgType::UnsignedChar:
+            print.add_arg(readValue<unsigned char>(p));
+            break;
+          case ArgType::Short:
+            print.add_arg(readValue<short>(p));
+            break;
+          case ArgType::UnsignedShort:
+            print.add_arg(readValue<unsigned short>(p));
+            break;
+          case ArgType::Int:
+            print.add_arg(readValue<int>(p));
+            break;
+          case ArgType::UnsignedInt:
+            print.add_arg(readValue<unsigned int>(p));
+            break;
+          case ArgType::Long:
+            print.add_arg(readValue<long>(p));
+            break;
+          case ArgType::UnsignedLong:
+            print.add_arg(readValue<unsigned long>(p));
+            break;
+          case ArgType::LongLong:
+            print.add_arg(readValue<long long>(p));
+            break;
+          case ArgType::UnsignedLongLong:
+            print.add_arg(readValue<unsigned long long>(p));
+            break;
+          case ArgType::Float:
+            print.add_arg(readValue<float>(p));
+            break;
+          case ArgType::Double:
+            print.add_arg(readValue<double>(p));
+            break;
+          case ArgType::Pointer:
+            print.add_arg(readValue<const void *>(p));
+            break;
+          case ArgType::String: {
+            uint32_t len = readValue<uint32_t>(p);
+            len = std::min<size_t>(len, end - p);
+            print.add_arg(std::string(p, len));
+            p += len;
+            break;
+          }
+          default:
+            panic("Bad argument type %d in debug trace\n", p[-1]);
+        }
+    }
+
+    print.end_args();
+    return line.str();
+}
+
+void
+decodeBlock(const char *block, const std::vector<std::string> &formats,
+            const std::vector<std::string> &names, Logger &logger,
+            std::ostream &out)
+{
+    BinaryLogger::BlockHeader block_header;
+    memcpy(&block_header, block, sizeof(block_header));
+
+    const char *p = block + sizeof(block_header);
+    const char *end = block + block_header.used;
+
+    BinaryLogger::RecordHeader header;
+    while (p + sizeof(header) <= end) {
+        memcpy(&header, p, sizeof(header));
+        if (header.size < sizeof(header) || header.size > end - p)
+            fatal("Corrupt record in debug trace block %d\n",
+                  block_header.seq);
+
+        const char *data = p + sizeof(header);
+        const char *data_end = p + header.size;
+        p = data_end;
+
+        if (header.name >= names.size())
+            fatal("Undefined name %d in debug trace\n", header.name);
+        const std::string &name = names[header.name];
+
+        if (header.kind == BinaryLogger::Message) {
+            if (header.fmt >= formats.size())
+                fatal("Undefined format %d in debug trace\n", header.fmt);
+            logger.logMessage(header.when, name,
+                              formatMessage(formats[header.fmt], data,
+                                            data_end, header.nargs));
+            continue;
+        }
+
+        uint32_t len = readValue<uint32_t>(data);
+        len = std::min<size_t>(len, data_end - data);
+
+        switch (header.kind) {
+          case BinaryLogger::Text:
+            logger.logMessage(header.when, name, std::string(data, len));
+            break;
+          case BinaryLogger::Dump:
+            logger.dump(header.when, name, data, len);
+            break;
+          case BinaryLogger::Raw:
+            out.write(data, len);
+            break;
+          default:
+            fatal("Bad record kind %d in debug trace\n", header.kind);
+        }
+    }
+}
+
+} // anonymous namespace
+
+void
+decodeBinaryTrace(const std::string &filename, std::ostream &out)
+{
+    std::vector<std::string> formats, names;
+    readDict(filename + ".dict", formats, names);
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        fatal("Can't open debug trace %s\n", filename);
+
+    char buf[BinaryLogger::headerSize];
+    BinaryLogger::FileHeader header;
+    if (!in.read(buf, sizeof(buf)))
+        fatal("%s is too short to be a debug trace\n", filename);
+    memcpy(&header, buf, sizeof(header));
+
+    if (memcmp(header.magic, BinaryLogger::magic, sizeof(header.magic)))
+        fatal("%s is not a binary debug trace\n", filename);
+    if (header.byteOrderMark != BinaryLogger::byteOrderMark)
+        fatal("Debug trace %s has the wrong byte order\n", filename);
+    if (header.version != BinaryLogger::version)
+        fatal("Debug trace %s has unsupported version %d\n",
+              filename, header.version);
+
+    const size_t block_size = header.blockSize;
+    std::vector<char> block(block_size);
+    BinaryLogger::BlockHeader block_header;
+
+    auto read_block = [&]() {
+        if (!in.read(block.data(), sizeof(block_header)))
+            return false;
+        memcpy(&block_header, block.data(), sizeof(block_header));
+        if (block_header.used < sizeof(block_header) ||
+            block_header.used > block_size) {
+            return false;
+        }
+        return bool(in.read(block.data() + sizeof(block_header),
+                            block_header.used - sizeof(block_header)));
+    };
+
+    OstreamLogger logger(out);
+
+    if (!header.ringBlocks) {
+        // A trace cut short by a crash ends with a partial block
+        while (read_block())
+            decodeBlock(block.data(), formats, names, logger, out);
+    } else {
+        // Slots that were never filled, or were being rewritten, have
+        // a zero sequence number. Messages from several threads are
+        // ordered by block, not by message.
+        std::vector<std::pair<uint64_t, uint32_t>> slots;
+        for (uint32_t slot = 0; slot < header.ringBlocks; ++slot) {
+            in.seekg(BinaryLogger::headerSize + uint64_t(slot) * block_size);
+            if (!in.read(reinterpret_cast<char *>(&block_header),
+                         sizeof(block_header))) {
+                break;
+            }
+            if (block_header.seq &&
+                block_header.seq % header.ringBlocks == slot) {
+                slots.emplace_back(block_header.seq, slot);
+            }
+        }
+        in.clear();
+        std::sort(slots.begin(), slots.end());
+
+        for (const auto &slot : slots) {
+            in.seekg(BinaryLogger::headerSize +
+                     uint64_t(slot.second) * block_size);
+            if (read_block())
+                decodeBlock(block.data(), formats, names, logger, out);
+        }
+    }
+
+    out.flush();
+}
+
+} // namespace Trace
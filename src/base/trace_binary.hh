@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * A debug logger that stores messages in a compact binary format
+ * instead of formatting them. Messages are decoded into the same text
+ * OstreamLogger would have written by decodeBinaryTrace().
+ *
+ * A message whose arguments can be packed (see trace_args.hh) is
+ * stored as its tick, the ids of its object name and format string,
+ * and its raw arguments. Everything else is stored as text. Records
+ * are appended to blocks owned by the thread that logs them, and full
+ * blocks are written out by a separate writer thread. The names and
+ * format strings are written to <file>.dict as they are first seen.
+ *
+ * The logger can keep only the last ringSize bytes of messages, in
+ * which case the file is a ring of fixed size block slots that is
+ * overwritten as the simulation proceeds. This is useful to find out
+ * what happened just before a crash in a long simulation.
+ */
+
+#ifndef __BASE_TRACE_BINARY_HH__
+#define __BASE_TRACE_BINARY_HH__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base/trace.hh"
+
+namespace Trace {
+
+class BinaryLogger : public Logger
+{
+  public:
+    static const char magic[8];
+    static const uint32_t version = 1;
+    static const uint32_t byteOrderMark = 0x01020304;
+
+    /** Offset of the first block in the file */
+    static const size_t headerSize = 64;
+
+    /** Blocks allocated at most, bounding memory use */
+    static const size_t maxBlocks = 64;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint32_t blockSize;
+        /** Number of block slots in ring mode, 0 when streaming */
+        uint32_t ringBlocks;
+    };
+
+    struct BlockHeader
+    {
+        /** Order in which the block was filled, starting at 1 */
+        uint64_t seq;
+        /** Thread that filled the block */
+        uint32_t thread;
+        /** Bytes used, including this header */
+        uint32_t used;
+    };
+
+    enum RecordKind : uint8_t
+    {
+        /** Format string id and packed arguments */
+        Message = 1,
+        /** Formatted message */
+        Text,
+        /** Data for Logger::dump() */
+        Dump,
+        /** Text written verbatim, without tick and name */
+        Raw,
+    };
+
+    /**
+     * Header of each record in a block. Text, Dump and Raw records
+     * are followed by a 32 bit length and that many bytes. Records
+     * are padded to 8 bytes.
+     */
+    struct RecordHeader
+    {
+        uint32_t size;
+        uint8_t kind;
+        uint8_t nargs;
+        uint16_t pad;
+        uint32_t fmt;
+        uint32_t name;
+        uint64_t when;
+    };
+
+    enum DictKind : uint8_t
+    {
+        FormatDef = 1,
+        NameDef,
+    };
+
+  protected:
+    /** Per thread block being filled and id caches */
+    struct ThreadState
+    {
+        static const unsigned cacheSize = 256;
+
+        struct CacheEntry
+        {
+            const char *ptr;
+            uint32_t id;
+            std::string str;
+
+            CacheEntry() : ptr(nullptr), id(0) { }
+        };
+
+        uint32_t thread;
+        char *block;
+        size_t used;
+
+        CacheEntry formats[cacheSize];
+        CacheEntry names[cacheSize];
+
+        ThreadState(uint32_t _thread)
+            : thread(_thread), block(nullptr), used(0)
+        { }
+    };
+
+    /** Buffers lines written to getOstream() into Raw records */
+    class RawBuf : public std::streambuf
+    {
+      protected:
+        BinaryLogger &logger;
+        std::string line;
+
+        int overflow(int c) override;
+        std::streamsize xsputn(const char *s, std::streamsize n) override;
+        int sync() override;
+
+      public:
+        RawBuf(BinaryLogger &_logger) : logger(_logger) { }
+    };
+
+    const std::string filename;
+    const size_t blockSize;
+    const uint32_t ringBlocks;
+    /** Distinguishes loggers in the thread local state */
+    const uint64_t serial;
+
+    int fd;
+    std::ofstream dict;
+
+    RawBuf rawBuf;
+    std::ostream rawStream;
+
+    /** Protects everything below */
+    std::mutex mutex;
+    std::condition_variable fullCond;
+    std::condition_variable freeCond;
+    std::condition_variable idleCond;
+
+    std::vector<ThreadState *> threads;
+    std::vector<char *> blocks;
+    std::vector<char *> freeBlocks;
+    std::deque<char *> fullBlocks;
+    uint64_t nextSeq;
+    bool writing;
+    bool stopping;
+
+    std::unordered_map<std::string, uint32_t> formatIds;
+    std::unordered_map<std::string, uint32_t> nameIds;
+
+    /**
+     * Submitted blocks that nobody started writing yet. These are
+     * claimed without the mutex, so signalFlush() can write them
+     * while another thread holds it.
+     */
+    std::vector<std::atomic<char *>> submitted;
+
+    std::thread writer;
+
+    ThreadState &threadState();
+    uint32_t define(std::unordered_map<std::string, uint32_t> &ids,
+                    DictKind kind, const std::string &str);
+    uint32_t formatId(ThreadState &ts, const char *fmt);
+    uint32_t nameId(ThreadState &ts, const std::string &name);
+
+    /** Reserve size bytes for a record in the thread's block */
+    char *reserve(ThreadState &ts, size_t size);
+    /** Hand the thread's block to the writer, mutex must be held */
+    void submit(ThreadState &ts);
+    /** Take a submitted block, false if signalFlush() already did */
+    bool claim(const char *block);
+
+    /** Log a record of the given kind holding the given bytes */
+    void logBytes(RecordKind kind, Tick when, const std::string &name,
+                  const char *data, size_t len);
+
+    /** Write a full block, without locking or allocating */
+    bool writeBlock(const char *block);
+    void writeLoop();
+
+  public:
+    /**
+     * @param filename File to write, definitions go to <filename>.dict
+     * @param ring_size Keep only about this many bytes of the most
+     *                  recent messages, 0 to keep everything
+     * @param block_size Size of the blocks messages are logged into
+     */
+    BinaryLogger(const std::string &filename, size_t ring_size = 0,
+                 size_t block_size = 64 * 1024);
+    ~BinaryLogger();
+
+    char *reserveMessage(Tick when, const std::string &name,
+                         const char *fmt, unsigned nargs,
+                         size_t size) override;
+
+    void logMessage(Tick when, const std::string &name,
+                    const std::string &message) override;
+
+    void dump(Tick when, const std::string &name,
+              const void *d, int len) override;
+
+    std::ostream &getOstream() override { return rawStream; }
+
+    /**
+     * Write out all logged messages, including the ones in partially
+     * filled blocks. Other threads must not log messages meanwhile.
+     * This is called at exit, so it gives up waiting for the writer
+     * rather than blocking forever.
+     */
+    void flush() override;
+
+    /**
+     * Write out the blocks that were submitted but not yet picked up
+     * by the writer thread. Partially filled blocks are left out, as
+     * their owners may be in the middle of logging a message, and so
+     * is the block the writer thread is writing. The blocks written
+     * are never reused, so the logger should only be flushed or
+     * destroyed afterwards.
+     */
+    void signalFlush() override;
+};
+
+/**
+ * Decode a trace written by BinaryLogger, writing the messages to out
+ * in the format of OstreamLogger.
+ */
+void decodeBinaryTrace(const std::string &filename, std::ostream &out);
+
+} // namespace Trace
+
+#endif // __BASE_TRACE_BINARY_HH__
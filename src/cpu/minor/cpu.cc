@@ -77,6 +77,15 @@ MinorCPU::MinorCPU(MinorCPUParams *params) :
 
     Minor::MinorDynInst::init();
 
+    /* Enough instructions to fill the buffers and latches between Fetch2
+     *  and the end of Execute */
+    dynInstPool = new SlabPool(params->decodeInputWidth *
+        (params->decodeInputBufferSize + params->executeInputBufferSize +
+        params->fetch2ToDecodeForwardDelay +
+        params->decodeToExecuteForwardDelay) +
+        params->executeLSQStoreBufferSize +
+        params->executeMaxAccessesInMemory);
+
     pipeline = new Minor::Pipeline(*this, *params);
     activityRecorder = pipeline->getActivityRecorder();
 }
@@ -84,6 +93,7 @@ MinorCPU::MinorCPU(MinorCPUParams *params) :
 MinorCPU::~MinorCPU()
 {
     delete pipeline;
+    dynInstPool->detach();
 
     for (ThreadID thread_id = 0; thread_id < threads.size(); thread_id++) {
         delete threads[thread_id];
@@ -126,10 +136,17 @@ void
 MinorCPU::regStats()
 {
     BaseCPU::regStats();
-    stats.regStats(name(), *this);
+    stats.regStats(name(), *this, *dynInstPool);
     pipeline->regStats();
 }
 
+void
+MinorCPU::resetStats()
+{
+    BaseCPU::resetStats();
+    dynInstPool->resetCounts();
+}
+
 void
 MinorCPU::serializeThread(CheckpointOut &cp, ThreadID thread_id) const
 {
@@ -46,6 +46,7 @@
 #ifndef __CPU_MINOR_CPU_HH__
 #define __CPU_MINOR_CPU_HH__
 
+#include "base/slab_pool.hh"
 #include "cpu/minor/activity.hh"
 #include "cpu/minor/stats.hh"
 #include "cpu/base.hh"
@@ -94,6 +95,9 @@ class MinorCPU : public BaseCPU
      *  threads[threadId]->getTC() */
     std::vector<Minor::MinorThread *> threads;
 
+    /** Pool the dynamic instructions of this CPU are allocated from */
+    SlabPool *dynInstPool;
+
   public:
     /** Provide a non-protected base class for Minor's Ports as derived
      *  classes are created by Fetch1 and Execute */
@@ -137,6 +141,7 @@ class MinorCPU : public BaseCPU
 
     /** Stats interface from SimObject (by way of BaseCPU) */
     void regStats() override;
+    void resetStats() override;
 
     /** Simple inst count interface from BaseCPU */
     Counter totalInsts() const override;
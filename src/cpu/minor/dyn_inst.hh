@@ -51,6 +51,7 @@
 #include <iostream>
 
 #include "base/refcnt.hh"
+#include "base/slab_pool.hh"
 #include "cpu/minor/buffers.hh"
 #include "cpu/inst_seq.hh"
 #include "cpu/static_inst.hh"
@@ -154,7 +155,7 @@ std::ostream &operator <<(std::ostream &os, const MinorDynInst &inst);
  *  MinorDynInst implements the BubbleIF interface
  *  Has two separate notions of sequence number for pre/post-micro-op
  *  decomposition: fetchSeqNum and execSeqNum */
-class MinorDynInst : public RefCounted
+class MinorDynInst : public RefCounted, public SlabAllocated
 {
   private:
     /** A prototypical bubble instruction.  You must call MinorDynInst::init
@@ -46,7 +46,8 @@ MinorStats::MinorStats()
 { }
 
 void
-MinorStats::regStats(const std::string &name, BaseCPU &baseCpu)
+MinorStats::regStats(const std::string &name, BaseCPU &baseCpu,
+    SlabPool &dynInstPool)
 {
     numInsts
         .name(name + ".committedInsts")
@@ -89,6 +90,17 @@ MinorStats::regStats(const std::string &name, BaseCPU &baseCpu)
         .desc("Class of committed instruction")
         .flags(Stats::total | Stats::pdf | Stats::dist);
     committedInstType.ysubnames(Enums::OpClassStrings);
+
+    dynInstsAllocated
+        .method(&dynInstPool, &SlabPool::allocated)
+        .name(name + ".dynInstsAllocated")
+        .desc("Number of dynamic instructions allocated");
+
+    dynInstsReused
+        .method(&dynInstPool, &SlabPool::reused)
+        .name(name + ".dynInstsReused")
+        .desc("Number of dynamic instructions allocated from the free "
+            "list of the pool");
 }
 
 };
@@ -46,6 +46,7 @@
 #ifndef __CPU_MINOR_STATS_HH__
 #define __CPU_MINOR_STATS_HH__
 
+#include "base/slab_pool.hh"
 #include "base/statistics.hh"
 #include "cpu/base.hh"
 #include "sim/ticked_object.hh"
@@ -79,11 +80,17 @@ class MinorStats
     /** Number of instructions by type (OpClass) */
     Stats::Vector2d committedInstType;
 
+    /** Number of dynamic instructions allocated, and reused from the
+     *  free list of the CPU's pool */
+    Stats::Value dynInstsAllocated;
+    Stats::Value dynInstsReused;
+
   public:
     MinorStats();
 
   public:
-    void regStats(const std::string &name, BaseCPU &baseCpu);
+    void regStats(const std::string &name, BaseCPU &baseCpu,
+        SlabPool &dynInstPool);
 };
 
 }
@@ -46,6 +46,8 @@ from FUPool import *
 from O3Checker import O3Checker
 from BranchPredictor import *
 
+class IQScheduler(Enum): vals = ['Lists', 'Matrix']
+
 class DerivO3CPU(BaseCPU):
     type = 'DerivO3CPU'
     cxx_header = 'cpu/o3/deriv.hh'
@@ -142,6 +144,11 @@ class DerivO3CPU(BaseCPU):
     numPhysCCRegs = Param.Unsigned(_defaultNumPhysCCRegs,
                                    "Number of physical cc registers")
     numIQEntries = Param.Unsigned(64, "Number of instruction queue entries")
+    # The matrix takes more host time than the lists for IQ sizes in
+    # use (see wakeupmatrixtime), so it is only used when asked for
+    iqScheduler = Param.IQScheduler('Lists', "IQ scheduling engine: "
+        "dependency lists and per op class ready queues (Lists), or "
+        "dependency and age bit matrices (Matrix)")
     numROBEntries = Param.Unsigned(192, "Number of reorder buffer entries")
 
     smtNumFetchingThreads = Param.Unsigned(1, "SMT Number of Fetching Threads")
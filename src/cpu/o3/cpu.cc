@@ -184,6 +184,12 @@ FullO3CPU<Impl>::FullO3CPU(DerivO3CPUParams *params)
                   params->activity),
 
       globalSeqNum(1),
+      // Enough instructions for the ROB and the queues in front of it
+      dynInstPool(new SlabPool(params->numROBEntries + params->fetchQueueSize +
+                               params->decodeWidth *
+                               (params->fetchToDecodeDelay +
+                                params->decodeToRenameDelay +
+                                params->renameToIEWDelay))),
       system(params->system),
       lastRunningCycle(curCycle())
 {
@@ -419,6 +425,7 @@ FullO3CPU<Impl>::FullO3CPU(DerivO3CPUParams *params)
 template <class Impl>
 FullO3CPU<Impl>::~FullO3CPU()
 {
+    dynInstPool->detach();
 }
 
 template <class Impl>
@@ -557,6 +564,26 @@ FullO3CPU<Impl>::regStats()
         .name(name() + ".misc_regfile_writes")
         .desc("number of misc regfile writes")
         .prereq(miscRegfileWrites);
+
+    dynInstsAllocated
+        .method(dynInstPool, &SlabPool::allocated)
+        .name(name() + ".dyn_insts_allocated")
+        .desc("number of dynamic instructions allocated");
+
+    dynInstsReused
+        .method(dynInstPool, &SlabPool::reused)
+        .name(name() + ".dyn_insts_reused")
+        .desc("number of dynamic instructions allocated from the free "
+              "list of the pool");
+}
+
+template <class Impl>
+void
+FullO3CPU<Impl>::resetStats()
+{
+    BaseCPU::resetStats();
+
+    dynInstPool->resetCounts();
 }
 
 template <class Impl>
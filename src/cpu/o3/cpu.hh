@@ -55,6 +55,7 @@
 
 #include "arch/generic/types.hh"
 #include "arch/types.hh"
+#include "base/slab_pool.hh"
 #include "base/statistics.hh"
 #include "config/the_isa.hh"
 #include "cpu/o3/comm.hh"
@@ -254,6 +255,9 @@ class FullO3CPU : public BaseO3CPU
     /** Registers statistics. */
     void regStats() override;
 
+    /** Resets the statistics that aren't reset by the stats package. */
+    void resetStats() override;
+
     ProbePointArg<PacketPtr> *ppInstAccessComplete;
     ProbePointArg<std::pair<DynInstPtr, PacketPtr> > *ppDataAccessComplete;
 
@@ -716,6 +720,9 @@ class FullO3CPU : public BaseO3CPU
     /** The global sequence number counter. */
     InstSeqNum globalSeqNum;//[Impl::MaxThreads];
 
+    /** Pool the dynamic instructions of this CPU are allocated from. */
+    SlabPool *dynInstPool;
+
     /** Pointer to the checker, which can dynamically verify
      * instruction results at run time.  This can be set to NULL if it
      * is not being used.
@@ -799,6 +806,9 @@ class FullO3CPU : public BaseO3CPU
     //number of misc
     Stats::Scalar miscRegfileReads;
     Stats::Scalar miscRegfileWrites;
+    //number of dynamic instructions allocated, and reused from the free list
+    Stats::Value dynInstsAllocated;
+    Stats::Value dynInstsReused;
 };
 
 #endif // __CPU_O3_CPU_HH__
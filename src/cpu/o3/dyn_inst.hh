@@ -47,6 +47,7 @@
 #include <array>
 
 #include "arch/isa_traits.hh"
+#include "base/slab_pool.hh"
 #include "config/the_isa.hh"
 #include "cpu/o3/cpu.hh"
 #include "cpu/o3/isa_specific.hh"
@@ -57,7 +58,7 @@
 class Packet;
 
 template <class Impl>
-class BaseO3DynInst : public BaseDynInst<Impl>
+class BaseO3DynInst : public BaseDynInst<Impl>, public SlabAllocated
 {
   public:
     /** Typedef for the CPU. */
@@ -141,6 +142,9 @@ class BaseO3DynInst : public BaseDynInst<Impl>
     int32_t storeTick;
 #endif
 
+    /** Slot of the IQ wakeup matrix the instruction holds, -1 if none. */
+    int iqSlot;
+
     /** Reads a misc. register, including any side-effects the read
      * might have as defined by the architecture.
      */
@@ -109,6 +109,7 @@ BaseO3DynInst<Impl>::initVars()
     this->_readySrcRegIdx.reset();
 
     _numDestMiscRegs = 0;
+    iqSlot = -1;
 
 #if TRACING_ON
     // Value -1 indicates that particular phase
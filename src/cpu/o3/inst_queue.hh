@@ -49,9 +49,11 @@
 #include <queue>
 #include <vector>
 
+#include "base/circular_queue.hh"
 #include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/o3/dep_graph.hh"
+#include "cpu/o3/wakeup_matrix.hh"
 #include "cpu/inst_seq.hh"
 #include "cpu/op_class.hh"
 #include "cpu/timebuf.hh"
@@ -76,6 +78,12 @@ class MemInterface;
  * requiring IEW to be able to peek into the IQ. At the end of the execution
  * latency, the instruction is put into the queue to execute, where it will
  * have the execute() function called on it.
+ *
+ * Instead of the dependency graph and ready queues, the IQ can track
+ * dependencies and instruction age in a WakeupMatrix, like a hardware
+ * matrix scheduler, which is selected with the iqScheduler parameter.
+ * Both issue the same instructions in the same cycles, but the matrix
+ * takes more host time, so the lists are the default.
  * @todo: Make IQ able to handle multiple FU pools.
  */
 template <class Impl>
@@ -93,6 +101,7 @@ class InstructionQueue
 
     // Typedef of iterator through the list of instructions.
     typedef typename std::list<DynInstPtr>::iterator ListIt;
+    typedef typename CircularQueue<DynInstPtr>::iterator QueueIt;
 
     /** FU completion event class. */
     class FUCompletion : public Event {
@@ -275,6 +284,15 @@ class InstructionQueue
     /** Does the actual squashing. */
     void doSquash(ThreadID tid);
 
+    /**
+     * Issues an instruction to a FU if one is free.
+     * @return true if the instruction was issued.
+     */
+    bool issueInst(DynInstPtr &issuing_inst, IssueStruct *i2e_info);
+
+    /** Selects and issues the ready instructions from the matrix. */
+    int scheduleFromMatrix(IssueStruct *i2e_info);
+
     /////////////////////////
     // Various pointers
     /////////////////////////
@@ -312,10 +330,10 @@ class InstructionQueue
     //////////////////////////////////////
 
     /** List of all the instructions in the IQ (some of which may be issued). */
-    std::list<DynInstPtr> instList[Impl::MaxThreads];
+    CircularQueue<DynInstPtr> instList[Impl::MaxThreads];
 
     /** List of instructions that are ready to be executed. */
-    std::list<DynInstPtr> instsToExecute;
+    CircularQueue<DynInstPtr> instsToExecute;
 
     /** List of instructions waiting for their DTB translation to
      *  complete (hw page table walk in progress).
@@ -399,6 +417,22 @@ class InstructionQueue
 
     DependencyGraph<DynInstPtr> dependGraph;
 
+    /** Matrix scheduler, used instead of the dependency graph and the
+     *  ready queues if not NULL. */
+    WakeupMatrix *wakeupMatrix;
+
+    /** Instruction in each slot of the matrix. */
+    std::vector<DynInstPtr> matrixInsts;
+
+    /** Takes a slot of the matrix for an instruction entering the IQ. */
+    void allocateSlot(DynInstPtr &inst);
+
+    /** Releases the slot of an instruction leaving the IQ. */
+    void freeSlot(DynInstPtr &inst);
+
+    /** Wakes the instructions waiting on a register in the matrix. */
+    int wakeupMatrixDependents(PhysRegIndex reg);
+
     //////////////////////////////////////
     // Various parameters
     //////////////////////////////////////
@@ -45,12 +45,14 @@
 #ifndef __CPU_O3_INST_QUEUE_IMPL_HH__
 #define __CPU_O3_INST_QUEUE_IMPL_HH__
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 
 #include "cpu/o3/fu_pool.hh"
 #include "cpu/o3/inst_queue.hh"
 #include "debug/IQ.hh"
+#include "enums/IQScheduler.hh"
 #include "enums/OpClass.hh"
 #include "params/DerivO3CPU.hh"
 #include "sim/core.hh"
@@ -111,12 +113,29 @@ InstructionQueue<Impl>::InstructionQueue(O3CPU *cpu_ptr, IEW *iew_ptr,
     // Resize the register scoreboard.
     regScoreboard.resize(numPhysRegs);
 
+    // The matrix scheduler replaces the dependency graph and the ready
+    // queues, with a slot for every IQ entry.
+    if (params->iqScheduler == Enums::Matrix) {
+        wakeupMatrix = new WakeupMatrix(numEntries, numPhysRegs,
+                                        Num_OpClasses);
+        matrixInsts.resize(numEntries);
+    } else {
+        wakeupMatrix = NULL;
+    }
+
     //Initialize Mem Dependence Units
     for (ThreadID tid = 0; tid < numThreads; tid++) {
         memDepUnit[tid].init(params, tid);
         memDepUnit[tid].setIQ(this);
     }
 
+    // Instructions stay on the lists until they commit, so the lists
+    // can hold as many as the ROB
+    for (ThreadID tid = 0; tid < numThreads; tid++) {
+        instList[tid].reserve(params->numROBEntries);
+    }
+    instsToExecute.reserve(totalWidth * 2);
+
     resetState();
 
     std::string policy = params->smtIQPolicy;
@@ -171,6 +190,7 @@ template <class Impl>
 InstructionQueue<Impl>::~InstructionQueue()
 {
     dependGraph.reset();
+    delete wakeupMatrix;
 #ifdef DEBUG
     cprintf("Nodes traversed: %i, removed: %i\n",
             dependGraph.nodesTraversed, dependGraph.nodesRemoved);
@@ -433,6 +453,10 @@ InstructionQueue<Impl>::resetState()
         queueOnList[i] = false;
         readyIt[i] = listOrder.end();
     }
+    if (wakeupMatrix) {
+        wakeupMatrix->reset();
+        std::fill(matrixInsts.begin(), matrixInsts.end(), DynInstPtr());
+    }
     nonSpecInsts.clear();
     listOrder.clear();
     deferredMemInsts.clear();
@@ -469,6 +493,7 @@ bool
 InstructionQueue<Impl>::isDrained() const
 {
     bool drained = dependGraph.empty() &&
+                   (!wakeupMatrix || wakeupMatrix->empty()) &&
                    instsToExecute.empty() &&
                    wbOutstanding == 0;
     for (ThreadID tid = 0; tid < numThreads; ++tid)
@@ -482,6 +507,7 @@ void
 InstructionQueue<Impl>::drainSanityCheck() const
 {
     assert(dependGraph.empty());
+    assert(!wakeupMatrix || wakeupMatrix->empty());
     assert(instsToExecute.empty());
     for (ThreadID tid = 0; tid < numThreads; ++tid)
         memDepUnit[tid].drainSanityCheck();
@@ -570,6 +596,9 @@ template <class Impl>
 bool
 InstructionQueue<Impl>::hasReadyInsts()
 {
+    if (wakeupMatrix)
+        return wakeupMatrix->anyReady();
+
     if (!listOrder.empty()) {
         return true;
     }
@@ -605,6 +634,7 @@ InstructionQueue<Impl>::insert(DynInstPtr &new_inst)
     instList[new_inst->threadNumber].push_back(new_inst);
 
     --freeEntries;
+    allocateSlot(new_inst);
 
     new_inst->setInIQ();
 
@@ -656,6 +686,7 @@ InstructionQueue<Impl>::insertNonSpec(DynInstPtr &new_inst)
     instList[new_inst->threadNumber].push_back(new_inst);
 
     --freeEntries;
+    allocateSlot(new_inst);
 
     new_inst->setInIQ();
 
@@ -807,6 +838,11 @@ InstructionQueue<Impl>::scheduleReadyInsts()
     // This will avoid trying to schedule a certain op class if there are no
     // FUs that handle it.
     int total_issued = 0;
+
+    // The ready queues are empty when the matrix is used
+    if (wakeupMatrix)
+        total_issued = scheduleFromMatrix(i2e_info);
+
     ListOrderIt order_it = listOrder.begin();
     ListOrderIt order_end_it = listOrder.end();
 
@@ -844,60 +880,7 @@ InstructionQueue<Impl>::scheduleReadyInsts()
             continue;
         }
 
-        int idx = FUPool::NoCapableFU;
-        Cycles op_latency = Cycles(1);
-        ThreadID tid = issuing_inst->threadNumber;
-
-        if (op_class != No_OpClass) {
-            idx = fuPool->getUnit(op_class);
-            if (issuing_inst->isFloating()) {
-                fpAluAccesses++;
-            } else if (issuing_inst->isVector()) {
-                vecAluAccesses++;
-            } else {
-                intAluAccesses++;
-            }
-            if (idx > FUPool::NoFreeFU) {
-                op_latency = fuPool->getOpLatency(op_class);
-            }
-        }
-
-        // If we have an instruction that doesn't require a FU, or a
-        // valid FU, then schedule for execution.
-        if (idx != FUPool::NoFreeFU) {
-            if (op_latency == Cycles(1)) {
-                i2e_info->size++;
-                instsToExecute.push_back(issuing_inst);
-
-                // Add the FU onto the list of FU's to be freed next
-                // cycle if we used one.
-                if (idx >= 0)
-                    fuPool->freeUnitNextCycle(idx);
-            } else {
-                bool pipelined = fuPool->isPipelined(op_class);
-                // Generate completion event for the FU
-                ++wbOutstanding;
-                FUCompletion *execution = new FUCompletion(issuing_inst,
-                                                           idx, this);
-
-                cpu->schedule(execution,
-                              cpu->clockEdge(Cycles(op_latency - 1)));
-
-                if (!pipelined) {
-                    // If FU isn't pipelined, then it must be freed
-                    // upon the execution completing.
-                    execution->setFreeFU();
-                } else {
-                    // Add the FU onto the list of FU's to be freed next cycle.
-                    fuPool->freeUnitNextCycle(idx);
-                }
-            }
-
-            DPRINTF(IQ, "Thread %i: Issuing instruction PC %s "
-                    "[sn:%lli]\n",
-                    tid, issuing_inst->pcState(),
-                    issuing_inst->seqNum);
-
+        if (issueInst(issuing_inst, i2e_info)) {
             readyInsts[op_class].pop();
 
             if (!readyInsts[op_class].empty()) {
@@ -907,28 +890,9 @@ InstructionQueue<Impl>::scheduleReadyInsts()
                 queueOnList[op_class] = false;
             }
 
-            issuing_inst->setIssued();
             ++total_issued;
-
-#if TRACING_ON
-            issuing_inst->issueTick = curTick() - issuing_inst->fetchTick;
-#endif
-
-            if (!issuing_inst->isMemRef()) {
-                // Memory instructions can not be freed from the IQ until they
-                // complete.
-                ++freeEntries;
-                count[tid]--;
-                issuing_inst->clearInIQ();
-            } else {
-                memDepUnit[tid].issue(issuing_inst);
-            }
-
             listOrder.erase(order_it++);
-            statIssuedInstType[tid][op_class]++;
         } else {
-            statFuBusy[op_class]++;
-            fuBusy[tid]++;
             ++order_it;
         }
     }
@@ -947,6 +911,161 @@ InstructionQueue<Impl>::scheduleReadyInsts()
     }
 }
 
+template <class Impl>
+bool
+InstructionQueue<Impl>::issueInst(DynInstPtr &issuing_inst,
+                                  IssueStruct *i2e_info)
+{
+    OpClass op_class = issuing_inst->opClass();
+    int idx = FUPool::NoCapableFU;
+    Cycles op_latency = Cycles(1);
+    ThreadID tid = issuing_inst->threadNumber;
+
+    if (op_class != No_OpClass) {
+        idx = fuPool->getUnit(op_class);
+        if (issuing_inst->isFloating()) {
+            fpAluAccesses++;
+        } else if (issuing_inst->isVector()) {
+            vecAluAccesses++;
+        } else {
+            intAluAccesses++;
+        }
+        if (idx > FUPool::NoFreeFU) {
+            op_latency = fuPool->getOpLatency(op_class);
+        }
+    }
+
+    // If we have an instruction that doesn't require a FU, or a
+    // valid FU, then schedule for execution.
+    if (idx == FUPool::NoFreeFU) {
+        statFuBusy[op_class]++;
+        fuBusy[tid]++;
+        return false;
+    }
+
+    if (op_latency == Cycles(1)) {
+        i2e_info->size++;
+        instsToExecute.push_back(issuing_inst);
+
+        // Add the FU onto the list of FU's to be freed next
+        // cycle if we used one.
+        if (idx >= 0)
+            fuPool->freeUnitNextCycle(idx);
+    } else {
+        bool pipelined = fuPool->isPipelined(op_class);
+        // Generate completion event for the FU
+        ++wbOutstanding;
+        FUCompletion *execution = new FUCompletion(issuing_inst,
+                                                   idx, this);
+
+        cpu->schedule(execution,
+                      cpu->clockEdge(Cycles(op_latency - 1)));
+
+        if (!pipelined) {
+            // If FU isn't pipelined, then it must be freed
+            // upon the execution completing.
+            execution->setFreeFU();
+        } else {
+            // Add the FU onto the list of FU's to be freed next cycle.
+            fuPool->freeUnitNextCycle(idx);
+        }
+    }
+
+    DPRINTF(IQ, "Thread %i: Issuing instruction PC %s "
+            "[sn:%lli]\n",
+            tid, issuing_inst->pcState(),
+            issuing_inst->seqNum);
+
+    issuing_inst->setIssued();
+
+#if TRACING_ON
+    issuing_inst->issueTick = curTick() - issuing_inst->fetchTick;
+#endif
+
+    if (!issuing_inst->isMemRef()) {
+        // Memory instructions can not be freed from the IQ until they
+        // complete.
+        ++freeEntries;
+        freeSlot(issuing_inst);
+        count[tid]--;
+        issuing_inst->clearInIQ();
+    } else {
+        memDepUnit[tid].issue(issuing_inst);
+    }
+
+    statIssuedInstType[tid][op_class]++;
+    return true;
+}
+
+template <class Impl>
+int
+InstructionQueue<Impl>::scheduleFromMatrix(IssueStruct *i2e_info)
+{
+    // Issue the oldest ready instruction until the issue width is used
+    // up. An op class whose FUs are all busy is skipped for the rest of
+    // the cycle, as it is when walking the ready queues in age order.
+    int total_issued = 0;
+    wakeupMatrix->unblockAll();
+
+    while (total_issued < totalWidth) {
+        int slot = wakeupMatrix->selectOldest();
+        if (slot < 0)
+            break;
+
+        DynInstPtr issuing_inst = matrixInsts[slot];
+
+        if (issuing_inst->isFloating()) {
+            fpInstQueueReads++;
+        } else if (issuing_inst->isVector()) {
+            vecInstQueueReads++;
+        } else {
+            intInstQueueReads++;
+        }
+
+        // Squashed instructions keep their slot until the IQ squashes
+        if (issuing_inst->isSquashed()) {
+            wakeupMatrix->clearReady(slot);
+            ++iqSquashedInstsIssued;
+            continue;
+        }
+
+        if (issueInst(issuing_inst, i2e_info)) {
+            // Memory instructions stay in the IQ until they complete
+            if (issuing_inst->iqSlot >= 0)
+                wakeupMatrix->clearReady(slot);
+            ++total_issued;
+        } else {
+            wakeupMatrix->block(issuing_inst->opClass());
+        }
+    }
+
+    return total_issued;
+}
+
+template <class Impl>
+void
+InstructionQueue<Impl>::allocateSlot(DynInstPtr &inst)
+{
+    if (!wakeupMatrix)
+        return;
+
+    int slot = wakeupMatrix->allocate(inst->seqNum);
+    matrixInsts[slot] = inst;
+    inst->iqSlot = slot;
+}
+
+template <class Impl>
+void
+InstructionQueue<Impl>::freeSlot(DynInstPtr &inst)
+{
+    if (!wakeupMatrix || inst->iqSlot < 0)
+        return;
+
+    wakeupMatrix->free(inst->iqSlot);
+    matrixInsts[inst->iqSlot] = NULL;
+    inst->iqSlot = -1;
+}
+
 template <class Impl>
 void
 InstructionQueue<Impl>::scheduleNonSpec(const InstSeqNum &inst)
@@ -982,11 +1101,8 @@ InstructionQueue<Impl>::commit(const InstSeqNum &inst, ThreadID tid)
     DPRINTF(IQ, "[tid:%i]: Committing instructions older than [sn:%i]\n",
             tid,inst);
 
-    ListIt iq_it = instList[tid].begin();
-
-    while (iq_it != instList[tid].end() &&
-           (*iq_it)->seqNum <= inst) {
-        ++iq_it;
+    while (!instList[tid].empty() &&
+           instList[tid].front()->seqNum <= inst) {
         instList[tid].pop_front();
     }
 
@@ -1045,6 +1161,12 @@ InstructionQueue<Impl>::wakeDependents(DynInstPtr &completed_inst)
                 dest_reg->index(),
                 dest_reg->className());
 
+        if (wakeupMatrix) {
+            dependents += wakeupMatrixDependents(dest_reg->flatIndex());
+            regScoreboard[dest_reg->flatIndex()] = true;
+            continue;
+        }
+
         //Go through the dependency chain, marking the registers as
         //ready within the waiting instructions.
         DynInstPtr dep_inst = dependGraph.pop(dest_reg->flatIndex());
@@ -1077,12 +1199,59 @@ InstructionQueue<Impl>::wakeDependents(DynInstPtr &completed_inst)
     return dependents;
 }
 
+template <class Impl>
+int
+InstructionQueue<Impl>::wakeupMatrixDependents(PhysRegIndex reg)
+{
+    int dependents = 0;
+
+    wakeupMatrix->wakeDependents(reg, [&](int slot) {
+        DynInstPtr dep_inst = matrixInsts[slot];
+
+        DPRINTF(IQ, "Waking up a dependent instruction, [sn:%lli] "
+                "PC %s.\n", dep_inst->seqNum, dep_inst->pcState());
+
+        // The graph holds an entry for every source operand waiting on
+        // the register, the matrix a single bit for the instruction.
+        for (int src_reg_idx = 0; src_reg_idx < dep_inst->numSrcRegs();
+             src_reg_idx++) {
+            PhysRegIdPtr src_reg = dep_inst->renamedSrcRegIdx(src_reg_idx);
+            if (!dep_inst->isReadySrcRegIdx(src_reg_idx) &&
+                !src_reg->isFixedMapping() &&
+                src_reg->flatIndex() == reg) {
+                dep_inst->markSrcRegReady();
+                ++dependents;
+            }
+        }
+
+        addIfReady(dep_inst);
+    });
+
+    return dependents;
+}
+
 template <class Impl>
 void
 InstructionQueue<Impl>::addReadyMemInst(DynInstPtr &ready_inst)
 {
     OpClass op_class = ready_inst->opClass();
 
+    if (wakeupMatrix) {
+        // Deferred and blocked instructions may have been squashed out
+        // of the IQ in the meantime
+        if (ready_inst->iqSlot < 0) {
+            assert(ready_inst->isSquashed());
+            ++iqSquashedInstsIssued;
+            return;
+        }
+        wakeupMatrix->setReady(ready_inst->iqSlot, op_class);
+
+        DPRINTF(IQ, "Instruction is ready to issue, putting it onto "
+                "the ready list, PC %s opclass:%i [sn:%lli].\n",
+                ready_inst->pcState(), op_class, ready_inst->seqNum);
+        return;
+    }
+
     readyInsts[op_class].push(ready_inst);
 
     // Will need to reorder the list if either a queue is not on the list,
@@ -1131,6 +1300,7 @@ InstructionQueue<Impl>::completeMemInst(DynInstPtr &completed_inst)
             completed_inst->pcState(), completed_inst->seqNum);
 
     ++freeEntries;
+    freeSlot(completed_inst);
 
     completed_inst->memOpDone(true);
 
@@ -1224,19 +1394,15 @@ template <class Impl>
 void
 InstructionQueue<Impl>::doSquash(ThreadID tid)
 {
-    // Start at the tail.
-    ListIt squash_it = instList[tid].end();
-    --squash_it;
-
     DPRINTF(IQ, "[tid:%i]: Squashing until sequence number %i!\n",
             tid, squashedSeqNum[tid]);
 
     // Squash any instructions younger than the squashed sequence number
-    // given.
-    while (squash_it != instList[tid].end() &&
-           (*squash_it)->seqNum > squashedSeqNum[tid]) {
+    // given, starting at the tail.
+    while (!instList[tid].empty() &&
+           instList[tid].back()->seqNum > squashedSeqNum[tid]) {
 
-        DynInstPtr squashed_inst = (*squash_it);
+        DynInstPtr squashed_inst = instList[tid].back();
         if (squashed_inst->isFloating()) {
             fpInstQueueWrites++;
         } else if (squashed_inst->isVector()) {
@@ -1245,13 +1411,10 @@ InstructionQueue<Impl>::doSquash(ThreadID tid)
             intInstQueueWrites++;
         }
 
-        // Only handle the instruction if it actually is in the IQ and
-        // hasn't already been squashed in the IQ.
-        if (squashed_inst->threadNumber != tid ||
-            squashed_inst->isSquashedInIQ()) {
-            --squash_it;
-            continue;
-        }
+        // Instructions are removed from the list as soon as they are
+        // squashed in the IQ, so the list can be truncated
+        assert(squashed_inst->threadNumber == tid &&
+               !squashed_inst->isSquashedInIQ());
 
         if (!squashed_inst->isIssued() ||
             (squashed_inst->isMemRef() &&
@@ -1290,8 +1453,13 @@ InstructionQueue<Impl>::doSquash(ThreadID tid)
 
                     if (!squashed_inst->isReadySrcRegIdx(src_reg_idx) &&
                         !src_reg->isFixedMapping()) {
-                        dependGraph.remove(src_reg->flatIndex(),
-                                           squashed_inst);
+                        if (wakeupMatrix) {
+                            wakeupMatrix->removeDependent(
+                                src_reg->flatIndex(), squashed_inst->iqSlot);
+                        } else {
+                            dependGraph.remove(src_reg->flatIndex(),
+                                               squashed_inst);
+                        }
                     }
 
 
@@ -1336,9 +1504,10 @@ InstructionQueue<Impl>::doSquash(ThreadID tid)
             count[squashed_inst->threadNumber]--;
 
             ++freeEntries;
+            freeSlot(squashed_inst);
         }
 
-        instList[tid].erase(squash_it--);
+        instList[tid].pop_back();
         ++iqSquashedInstsExamined;
     }
 }
@@ -1372,7 +1541,12 @@ InstructionQueue<Impl>::addToDependents(DynInstPtr &new_inst)
                         new_inst->pcState(), src_reg->index(),
                         src_reg->className());
 
-                dependGraph.insert(src_reg->flatIndex(), new_inst);
+                if (wakeupMatrix) {
+                    wakeupMatrix->addDependent(src_reg->flatIndex(),
+                                               new_inst->iqSlot);
+                } else {
+                    dependGraph.insert(src_reg->flatIndex(), new_inst);
+                }
 
                 // Change the return value to indicate that something
                 // was added to the dependency graph.
@@ -1413,14 +1587,22 @@ InstructionQueue<Impl>::addToProducers(DynInstPtr &new_inst)
             continue;
         }
 
-        if (!dependGraph.empty(dest_reg->flatIndex())) {
-            dependGraph.dump();
-            panic("Dependency graph %i (%s) (flat: %i) not empty!",
-                  dest_reg->index(), dest_reg->className(),
-                  dest_reg->flatIndex());
-        }
+        if (wakeupMatrix) {
+            if (wakeupMatrix->hasDependents(dest_reg->flatIndex())) {
+                panic("Wakeup matrix row %i (%s) (flat: %i) not empty!",
+                      dest_reg->index(), dest_reg->className(),
+                      dest_reg->flatIndex());
+            }
+        } else {
+            if (!dependGraph.empty(dest_reg->flatIndex())) {
+                dependGraph.dump();
+                panic("Dependency graph %i (%s) (flat: %i) not empty!",
+                      dest_reg->index(), dest_reg->className(),
+                      dest_reg->flatIndex());
+            }
 
-        dependGraph.setInst(dest_reg->flatIndex(), new_inst);
+            dependGraph.setInst(dest_reg->flatIndex(), new_inst);
+        }
 
         // Mark the scoreboard to say it's not yet ready.
         regScoreboard[dest_reg->flatIndex()] = false;
@@ -1453,6 +1635,11 @@ InstructionQueue<Impl>::addIfReady(DynInstPtr &inst)
                 "the ready list, PC %s opclass:%i [sn:%lli].\n",
                 inst->pcState(), op_class, inst->seqNum);
 
+        if (wakeupMatrix) {
+            wakeupMatrix->setReady(inst->iqSlot, op_class);
+            return;
+        }
+
         readyInsts[op_class].push(inst);
 
         // Will need to reorder the list if either a queue is not on the list,
@@ -1479,7 +1666,7 @@ InstructionQueue<Impl>::countInsts()
     int total_insts = 0;
 
     for (ThreadID tid = 0; tid < numThreads; ++tid) {
-        ListIt count_it = instList[tid].begin();
+        QueueIt count_it = instList[tid].begin();
 
         while (count_it != instList[tid].end()) {
             if (!(*count_it)->isSquashed() && !(*count_it)->isSquashedInIQ()) {
@@ -1553,7 +1740,7 @@ InstructionQueue<Impl>::dumpInsts()
     for (ThreadID tid = 0; tid < numThreads; ++tid) {
         int num = 0;
         int valid_num = 0;
-        ListIt inst_list_it = instList[tid].begin();
+        QueueIt inst_list_it = instList[tid].begin();
 
         while (inst_list_it != instList[tid].end()) {
             cprintf("Instruction:%i\n", num);
@@ -1593,7 +1780,7 @@ InstructionQueue<Impl>::dumpInsts()
 
     int num = 0;
     int valid_num = 0;
-    ListIt inst_list_it = instsToExecute.begin();
+    QueueIt inst_list_it = instsToExecute.begin();
 
     while (inst_list_it != instsToExecute.end())
     {
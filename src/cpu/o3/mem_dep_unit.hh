@@ -48,6 +48,7 @@
 #include <set>
 #include <unordered_map>
 
+#include "base/circular_queue.hh"
 #include "base/statistics.hh"
 #include "cpu/inst_seq.hh"
 #include "debug/MemDepUnit.hh"
@@ -164,6 +165,7 @@ class MemDepUnit
 
   private:
     typedef typename std::list<DynInstPtr>::iterator ListIt;
+    typedef typename CircularQueue<DynInstPtr>::iterator QueueIt;
 
     class MemDepEntry;
 
@@ -209,7 +211,7 @@ class MemDepUnit
         DynInstPtr inst;
 
         /** The iterator to the instruction's location inside the list. */
-        ListIt listIt;
+        QueueIt listIt;
 
         /** A vector of any dependent instructions. */
         std::vector<MemDepEntryPtr> dependInsts;
@@ -244,8 +246,12 @@ class MemDepUnit
     /** A hash map of all memory dependence entries. */
     MemDepHash memDepHash;
 
-    /** A list of all instructions in the memory dependence unit. */
-    std::list<DynInstPtr> instList[Impl::MaxThreads];
+    /**
+     * A list of all instructions in the memory dependence unit, in
+     * program order. Instructions that complete out of order leave a
+     * null entry behind until the ones before them have completed too.
+     */
+    CircularQueue<DynInstPtr> instList[Impl::MaxThreads];
 
     /** A list of all instructions that are going to be replayed. */
     std::list<DynInstPtr> instsToReplay;
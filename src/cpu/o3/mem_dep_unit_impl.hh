@@ -73,18 +73,18 @@ MemDepUnit<MemDepPred, Impl>::~MemDepUnit()
 {
     for (ThreadID tid = 0; tid < Impl::MaxThreads; tid++) {
 
-        ListIt inst_list_it = instList[tid].begin();
-
         MemDepHashIt hash_it;
 
         while (!instList[tid].empty()) {
-            hash_it = memDepHash.find((*inst_list_it)->seqNum);
+            if (instList[tid].front()) {
+                hash_it = memDepHash.find(instList[tid].front()->seqNum);
 
-            assert(hash_it != memDepHash.end());
+                assert(hash_it != memDepHash.end());
 
-            memDepHash.erase(hash_it);
+                memDepHash.erase(hash_it);
+            }
 
-            instList[tid].erase(inst_list_it++);
+            instList[tid].pop_front();
         }
     }
 
@@ -102,6 +102,10 @@ MemDepUnit<MemDepPred, Impl>::init(DerivO3CPUParams *params, ThreadID tid)
     _name = csprintf("%s.memDep%d", params->name, tid);
     id = tid;
 
+    // Completed instructions can only be removed once all those before
+    // them have completed, which happens before they commit
+    instList[tid].reserve(params->numROBEntries);
+
     depPred.init(params->store_set_clear_period, params->SSITSize,
             params->LFSTSize);
 }
@@ -416,7 +420,10 @@ MemDepUnit<MemDepPred, Impl>::completed(DynInstPtr &inst)
 
     assert(hash_it != memDepHash.end());
 
-    instList[tid].erase((*hash_it).second->listIt);
+    // Leave a hole in the list, and drop any holes at its front
+    *(*hash_it).second->listIt = NULL;
+    while (!instList[tid].empty() && !instList[tid].front())
+        instList[tid].pop_front();
 
     (*hash_it).second = NULL;
 
@@ -497,13 +504,19 @@ MemDepUnit<MemDepPred, Impl>::squash(const InstSeqNum &squashed_num,
         }
     }
 
-    ListIt squash_it = instList[tid].end();
-    --squash_it;
-
     MemDepHashIt hash_it;
 
-    while (!instList[tid].empty() &&
-           (*squash_it)->seqNum > squashed_num) {
+    while (!instList[tid].empty()) {
+        QueueIt squash_it = --instList[tid].end();
+
+        // Drop the holes left by completed instructions
+        if (!*squash_it) {
+            instList[tid].pop_back();
+            continue;
+        }
+
+        if ((*squash_it)->seqNum <= squashed_num)
+            break;
 
         DPRINTF(MemDepUnit, "Squashing inst [sn:%lli]\n",
                 (*squash_it)->seqNum);
@@ -527,7 +540,7 @@ MemDepUnit<MemDepPred, Impl>::squash(const InstSeqNum &squashed_num,
         MemDepEntry::memdep_erase++;
 #endif
 
-        instList[tid].erase(squash_it--);
+        instList[tid].pop_back();
     }
 
     // Tell the dependency predictor to squash as well.
@@ -585,13 +598,19 @@ void
 MemDepUnit<MemDepPred, Impl>::dumpLists()
 {
     for (ThreadID tid = 0; tid < Impl::MaxThreads; tid++) {
-        cprintf("Instruction list %i size: %i\n",
-                tid, instList[tid].size());
+        int size = 0;
+        for (auto it = instList[tid].begin(); it != instList[tid].end(); ++it)
+            size += *it ? 1 : 0;
+        cprintf("Instruction list %i size: %i\n", tid, size);
 
-        ListIt inst_list_it = instList[tid].begin();
+        QueueIt inst_list_it = instList[tid].begin();
         int num = 0;
 
         while (inst_list_it != instList[tid].end()) {
+            if (!*inst_list_it) {
+                inst_list_it++;
+                continue;
+            }
             cprintf("Instruction:%i\nPC: %s\n[sn:%i]\n[tid:%i]\nIssued:%i\n"
                     "Squashed:%i\n\n",
                     num, (*inst_list_it)->pcState(),
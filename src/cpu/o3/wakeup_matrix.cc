@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "cpu/o3/wakeup_matrix.hh"
+
+#include <algorithm>
+
+#include "base/logging.hh"
+
+WakeupMatrix::WakeupMatrix(unsigned num_slots, unsigned num_regs,
+                           unsigned num_classes)
+    : numSlots(num_slots), rowWords((num_slots + 63) / 64),
+      numClasses(num_classes),
+      occupied(rowWords), ready(rowWords), blocked(rowWords),
+      readyByClass(num_classes * rowWords),
+      dependents(num_regs * rowWords),
+      older(num_slots * rowWords),
+      slotSeqNum(num_slots), slotClass(num_slots),
+      candidates(rowWords)
+{
+    reset();
+}
+
+void
+WakeupMatrix::reset()
+{
+    std::fill(occupied.begin(), occupied.end(), 0);
+    std::fill(ready.begin(), ready.end(), 0);
+    std::fill(blocked.begin(), blocked.end(), 0);
+    std::fill(readyByClass.begin(), readyByClass.end(), 0);
+    std::fill(dependents.begin(), dependents.end(), 0);
+
+    // Hand out the low slots first
+    freeSlots.clear();
+    for (int slot = numSlots; slot-- > 0; )
+        freeSlots.push_back(slot);
+}
+
+int
+WakeupMatrix::allocate(InstSeqNum seq_num)
+{
+    assert(!freeSlots.empty());
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    // Instructions usually arrive in order, so everything in the
+    // matrix is older. Only look at the sequence numbers when some
+    // thread is behind another.
+    uint64_t *new_older = row(older, slot);
+    for (unsigned w = 0; w < rowWords; w++) {
+        uint64_t word = occupied[w];
+        new_older[w] = word;
+        while (word) {
+            int other = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            if (slotSeqNum[other] < seq_num) {
+                clear(row(older, other), slot);
+            } else {
+                clear(new_older, other);
+                set(row(older, other), slot);
+            }
+        }
+    }
+
+    set(occupied.data(), slot);
+    slotSeqNum[slot] = seq_num;
+    return slot;
+}
+
+void
+WakeupMatrix::free(int slot)
+{
+    assert(test(occupied.data(), slot));
+    clearReady(slot);
+    clear(occupied.data(), slot);
+    freeSlots.push_back(slot);
+}
+
+bool
+WakeupMatrix::hasDependents(int reg) const
+{
+    const uint64_t *deps = row(dependents, reg);
+    for (unsigned w = 0; w < rowWords; w++) {
+        if (deps[w])
+            return true;
+    }
+    return false;
+}
+
+bool
+WakeupMatrix::empty() const
+{
+    return std::find_if(dependents.begin(), dependents.end(),
+                        [](uint64_t word) { return word != 0; }) ==
+        dependents.end();
+}
+
+void
+WakeupMatrix::setReady(int slot, int op_class)
+{
+    assert(test(occupied.data(), slot));
+    assert((unsigned)op_class < numClasses);
+    set(ready.data(), slot);
+    set(row(readyByClass, op_class), slot);
+    slotClass[slot] = op_class;
+}
+
+void
+WakeupMatrix::clearReady(int slot)
+{
+    if (!test(ready.data(), slot))
+        return;
+    clear(ready.data(), slot);
+    clear(row(readyByClass, slotClass[slot]), slot);
+}
+
+bool
+WakeupMatrix::anyReady() const
+{
+    for (unsigned w = 0; w < rowWords; w++) {
+        if (ready[w])
+            return true;
+    }
+    return false;
+}
+
+void
+WakeupMatrix::unblockAll()
+{
+    std::fill(blocked.begin(), blocked.end(), 0);
+}
+
+void
+WakeupMatrix::block(int op_class)
+{
+    const uint64_t *class_ready = row(readyByClass, op_class);
+    for (unsigned w = 0; w < rowWords; w++)
+        blocked[w] |= class_ready[w];
+}
+
+int
+WakeupMatrix::selectOldest()
+{
+    bool any = false;
+    for (unsigned w = 0; w < rowWords; w++) {
+        candidates[w] = ready[w] & ~blocked[w];
+        any = any || candidates[w];
+    }
+    if (!any)
+        return -1;
+
+    // Narrow the candidates down to the ones older than any one of
+    // them until none is older than the one picked
+    for (unsigned w = 0; w < rowWords; w++) {
+        while (candidates[w]) {
+            int slot = w * 64 + __builtin_ctzll(candidates[w]);
+            const uint64_t *slot_older = row(older, slot);
+            bool oldest = true;
+            for (unsigned v = w; v < rowWords; v++) {
+                candidates[v] &= slot_older[v];
+                oldest = oldest && !candidates[v];
+            }
+            if (oldest)
+                return slot;
+        }
+    }
+
+    panic("No oldest instruction in the IQ age matrix");
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CPU_O3_WAKEUP_MATRIX_HH__
+#define __CPU_O3_WAKEUP_MATRIX_HH__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "cpu/inst_seq.hh"
+
+/**
+ * Bit matrix scheduler state for the instruction queue, modelled on
+ * the dependency and age matrices of hardware schedulers.
+ *
+ * Each instruction waiting in the IQ holds a slot. The dependency
+ * matrix has a row per physical register, with a bit set for every
+ * slot whose instruction waits on that register, so waking up the
+ * consumers of a register is a scan of one row. The age matrix has a
+ * row per slot, with a bit set for every slot that holds an older
+ * instruction, so the oldest of a set of ready slots is the one whose
+ * row has no bit in common with the set. Rows are arrays of 64 bit
+ * words and are combined a word at a time.
+ *
+ * Rows of the dependency matrix are indexed by register rather than
+ * by the slot of the producer, as the IQ releases a slot when its
+ * instruction issues, before the instruction writes back.
+ */
+class WakeupMatrix
+{
+  private:
+    /** Number of slots */
+    const unsigned numSlots;
+    /** Number of 64 bit words in a row of slots */
+    const unsigned rowWords;
+    /** Number of op classes */
+    const unsigned numClasses;
+
+    /** Slots holding an instruction */
+    std::vector<uint64_t> occupied;
+    /** Slots holding an instruction ready to issue */
+    std::vector<uint64_t> ready;
+    /** Ready slots of the op classes that can't issue this cycle */
+    std::vector<uint64_t> blocked;
+    /** Ready slots of each op class */
+    std::vector<uint64_t> readyByClass;
+    /** Slots waiting on each register */
+    std::vector<uint64_t> dependents;
+    /** Slots holding an older instruction than each slot */
+    std::vector<uint64_t> older;
+
+    /** Sequence number and op class of the instruction in each slot */
+    std::vector<InstSeqNum> slotSeqNum;
+    std::vector<int> slotClass;
+
+    std::vector<int> freeSlots;
+
+    /** Candidates of the current select */
+    std::vector<uint64_t> candidates;
+
+    uint64_t *row(std::vector<uint64_t> &m, unsigned i)
+    { return &m[i * rowWords]; }
+    const uint64_t *row(const std::vector<uint64_t> &m, unsigned i) const
+    { return &m[i * rowWords]; }
+
+    static void set(uint64_t *r, int slot)
+    { r[slot / 64] |= 1ULL << (slot % 64); }
+    static void clear(uint64_t *r, int slot)
+    { r[slot / 64] &= ~(1ULL << (slot % 64)); }
+    static bool test(const uint64_t *r, int slot)
+    { return r[slot / 64] & (1ULL << (slot % 64)); }
+
+  public:
+    /**
+     * @param num_slots Number of instructions in the IQ.
+     * @param num_regs Number of physical registers.
+     * @param num_classes Number of op classes.
+     */
+    WakeupMatrix(unsigned num_slots, unsigned num_regs,
+                 unsigned num_classes);
+
+    /** Empty the matrices. */
+    void reset();
+
+    /** Number of free slots. */
+    unsigned numFree() const { return freeSlots.size(); }
+
+    /**
+     * Take a slot for an instruction, ordering it by sequence number
+     * against the instructions already in the matrix.
+     */
+    int allocate(InstSeqNum seq_num);
+
+    /** Release a slot. It must no longer be waiting on a register. */
+    void free(int slot);
+
+    /** Make a slot wait on a register. */
+    void addDependent(int reg, int slot)
+    { set(row(dependents, reg), slot); }
+
+    /** Stop a slot waiting on a register. */
+    void removeDependent(int reg, int slot)
+    { clear(row(dependents, reg), slot); }
+
+    /** Is any slot waiting on a register. */
+    bool hasDependents(int reg) const;
+
+    /** Is no slot waiting on any register. */
+    bool empty() const;
+
+    /**
+     * Wake up the slots waiting on a register, calling wake(slot) for
+     * each of them in slot order.
+     * @return the number of slots woken up.
+     */
+    template <class F>
+    unsigned
+    wakeDependents(int reg, F wake)
+    {
+        unsigned woken = 0;
+        uint64_t *deps = row(dependents, reg);
+        for (unsigned w = 0; w < rowWords; w++) {
+            uint64_t word = deps[w];
+            deps[w] = 0;
+            while (word) {
+                wake(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+                ++woken;
+            }
+        }
+        return woken;
+    }
+
+    /** Mark a slot as ready to issue on an op class. */
+    void setReady(int slot, int op_class);
+
+    /** Mark a slot as not ready to issue. */
+    void clearReady(int slot);
+
+    /** Is any slot ready to issue. */
+    bool anyReady() const;
+
+    /** Is a slot ready to issue. */
+    bool isReady(int slot) const { return test(ready.data(), slot); }
+
+    /** Start a new select, where every op class may issue. */
+    void unblockAll();
+
+    /** Skip the ready slots of an op class for the rest of the select. */
+    void block(int op_class);
+
+    /**
+     * Find the oldest slot that is ready and not blocked.
+     * @return the slot, -1 if there is none.
+     */
+    int selectOldest();
+};
+
+#endif // __CPU_O3_WAKEUP_MATRIX_HH__
@@ -47,8 +47,7 @@
 #ifndef __CPU_PRED_BPRED_UNIT_HH__
 #define __CPU_PRED_BPRED_UNIT_HH__
 
-#include <deque>
-
+#include "base/circular_queue.hh"
 #include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/pred/btb.hh"
@@ -206,6 +205,10 @@ class BPredUnit : public SimObject
               wasCall(0), wasReturn(0), wasIndirect(0)
         {}
 
+        PredictorHistory()
+            : PredictorHistory(0, 0, false, nullptr, 0)
+        {}
+
         bool operator==(const PredictorHistory &entry) const {
             return this->seqNum == entry.seqNum;
         }
@@ -250,7 +253,13 @@ class BPredUnit : public SimObject
         bool wasIndirect;
     };
 
-    typedef std::deque<PredictorHistory> History;
+    /**
+     * Branches in flight, oldest at the front. The ring grows if more
+     * than historyCapacity branches are in flight at once, which is
+     * more than the ROB of any of the CPU models holds by default.
+     */
+    typedef CircularQueue<PredictorHistory> History;
+    static const size_t historyCapacity = 256;
 
     /** Number of the threads for which the branch history is maintained. */
     const unsigned numThreads;
@@ -40,6 +40,8 @@
 
 #include "cpu/pred/ltage.hh"
 
+#include <algorithm>
+
 #include "base/intmath.hh"
 #include "base/logging.hh"
 #include "base/random.hh"
@@ -65,11 +67,15 @@ LTAGE::LTAGE(const LTAGEParams *params)
     logTick = 19;
     tCounter = ULL(1) << (logTick - 1);
 
+    // The history is a ring of 64 bit words
+    unsigned hist_buffer_size = std::max(64U, histBufferSize);
+    if (!isPowerOf2(hist_buffer_size))
+        hist_buffer_size = 1 << ceilLog2(hist_buffer_size);
+    histBufferMask = hist_buffer_size - 1;
+
     for (auto& history : threadHistory) {
         history.pathHist = 0;
-        history.globalHistory = new uint8_t[histBufferSize];
-        history.gHist = history.globalHistory;
-        memset(history.gHist, 0, histBufferSize);
+        history.globalHistory.assign(hist_buffer_size / 64, 0);
         history.ptGhist = 0;
     }
 
@@ -106,32 +112,34 @@ LTAGE::LTAGE(const LTAGEParams *params)
     for (int i = 11; i <= 12; i++)
         tagTableSizes[i] = logSizeTagTables - 2;
 
-    for (auto& history : threadHistory) {
-        history.computeIndices = new FoldedHistory[nHistoryTables+1];
-        history.computeTags[0] = new FoldedHistory[nHistoryTables+1];
-        history.computeTags[1] = new FoldedHistory[nHistoryTables+1];
-
-        for (int i = 1; i <= nHistoryTables; i++) {
-            history.computeIndices[i].init(histLengths[i], (tagTableSizes[i]));
-            history.computeTags[0][i].init(
-                history.computeIndices[i].origLength, tagWidths[i]);
-            history.computeTags[1][i].init(
-                history.computeIndices[i].origLength, tagWidths[i] - 1);
-            DPRINTF(LTage, "HistLength:%d, TTSize:%d, TTTWidth:%d\n",
-                    histLengths[i], tagTableSizes[i], tagWidths[i]);
+    foldOrigLength.resize(3 * nHistoryTables);
+    foldCompLength.resize(3 * nHistoryTables);
+    foldOutpoint.resize(3 * nHistoryTables);
+    foldMask.resize(3 * nHistoryTables);
+    for (int i = 1; i <= nHistoryTables; i++) {
+        const int comp_lengths[3] =
+            { tagTableSizes[i], tagWidths[i], tagWidths[i] - 1 };
+        for (int j = 0; j < 3; j++) {
+            int k = j * nHistoryTables + i - 1;
+            foldOrigLength[k] = histLengths[i];
+            foldCompLength[k] = comp_lengths[j];
+            foldOutpoint[k] = histLengths[i] % comp_lengths[j];
+            foldMask[k] = (ULL(1) << comp_lengths[j]) - 1;
         }
+        DPRINTF(LTage, "HistLength:%d, TTSize:%d, TTTWidth:%d\n",
+                histLengths[i], tagTableSizes[i], tagWidths[i]);
     }
 
+    for (auto& history : threadHistory)
+        history.folded.assign(3 * nHistoryTables, 0);
+
     btable = new BimodalEntry[ULL(1) << logSizeBiMP];
     ltable = new LoopEntry[ULL(1) << logSizeLoopPred];
-    gtable = new TageEntry*[nHistoryTables + 1];
+    gtable.resize(nHistoryTables + 1);
     for (int i = 1; i <= nHistoryTables; i++) {
-        gtable[i] = new TageEntry[1<<(tagTableSizes[i])];
+        gtable[i].init(1 << tagTableSizes[i]);
     }
 
-    tableIndices = new int [nHistoryTables+1];
-    tableTags = new int [nHistoryTables+1];
-
     loopUseCounter = 0;
 }
 
@@ -172,7 +180,7 @@ LTAGE::gindex(ThreadID tid, Addr pc, int bank) const
     int hlen = (histLengths[bank] > 16) ? 16 : histLengths[bank];
     index =
         (pc) ^ ((pc) >> ((int) abs(tagTableSizes[bank] - bank) + 1)) ^
-        threadHistory[tid].computeIndices[bank].comp ^
+        threadHistory[tid].folded[bank - 1] ^
         F(threadHistory[tid].pathHist, hlen, bank);
 
     return (index & ((ULL(1) << (tagTableSizes[bank])) - 1));
@@ -183,8 +191,9 @@ LTAGE::gindex(ThreadID tid, Addr pc, int bank) const
 uint16_t
 LTAGE::gtag(ThreadID tid, Addr pc, int bank) const
 {
-    int tag = (pc) ^ threadHistory[tid].computeTags[0][bank].comp
-                   ^ (threadHistory[tid].computeTags[1][bank].comp << 1);
+    const unsigned *folded = &threadHistory[tid].folded[bank - 1];
+    int tag = (pc) ^ folded[nHistoryTables]
+                   ^ (folded[2 * nHistoryTables] << 1);
 
     return (tag & ((ULL(1) << tagWidths[bank]) - 1));
 }
@@ -359,24 +368,42 @@ LTAGE::loopUpdate(Addr pc, bool taken, BranchInfo* bi)
 
 }
 
-// shifting the global history:  we manage the history in a big table in order
-// to reduce simulation time
+// shifting the global history: the history is a circular buffer of bits,
+// so this only moves the pointer back and sets a bit
+void
+LTAGE::updateGHist(ThreadHistory &t_hist, bool dir)
+{
+    t_hist.ptGhist = (t_hist.ptGhist - 1) & histBufferMask;
+    uint64_t &word = t_hist.globalHistory[t_hist.ptGhist >> 6];
+    uint64_t bit = ULL(1) << (t_hist.ptGhist & 63);
+    word = dir ? (word | bit) : (word & ~bit);
+}
+
+// Shift the most recent outcome into every folded history, and the
+// outcome that falls out of each one's window out of it
 void
-LTAGE::updateGHist(uint8_t * &h, bool dir, uint8_t * tab, int &pt)
+LTAGE::updateFoldedHistories(ThreadHistory &t_hist)
 {
-    if (pt == 0) {
-        DPRINTF(LTage, "Rolling over the histories\n");
-         // Copy beginning of globalHistoryBuffer to end, such that
-         // the last maxHist outcomes are still reachable
-         // through pt[0 .. maxHist - 1].
-         for (int i = 0; i < maxHist; i++)
-             tab[histBufferSize - maxHist + i] = tab[i];
-         pt =  histBufferSize - maxHist;
-         h = &tab[pt];
+    const unsigned n = foldOrigLength.size();
+    const unsigned newest = ghistBit(t_hist, t_hist.ptGhist);
+    unsigned outgoing[3 * 15];
+    assert(n <= sizeof(outgoing) / sizeof(outgoing[0]));
+
+    // The three folded histories of a table share their window
+    for (unsigned k = 0; k < nHistoryTables; k++) {
+        outgoing[k] = ghistBit(t_hist, t_hist.ptGhist + foldOrigLength[k]);
+        outgoing[k + nHistoryTables] = outgoing[k];
+        outgoing[k + 2 * nHistoryTables] = outgoing[k];
+    }
+
+    // Independent for every folded history, so this vectorizes
+    unsigned *comp = t_hist.folded.data();
+    for (unsigned k = 0; k < n; k++) {
+        unsigned c = (comp[k] << 1) | newest;
+        c ^= outgoing[k] << foldOutpoint[k];
+        c ^= (c >> foldCompLength[k]);
+        comp[k] = c & foldMask[k];
     }
-    pt--;
-    h--;
-    h[0] = (dir) ? 1 : 0;
 }
 
 // Get GHR for hashing indirect predictor
@@ -386,14 +413,12 @@ unsigned
 LTAGE::getGHR(ThreadID tid, void *bp_history) const
 {
     BranchInfo* bi = static_cast<BranchInfo*>(bp_history);
-    unsigned val = 0;
-    for (unsigned i = 0; i < 32; i++) {
-        // Make sure we don't go out of bounds
-        int gh_offset = bi->ptGhist + i;
-        assert(&(threadHistory[tid].globalHistory[gh_offset]) <
-               threadHistory[tid].globalHistory + histBufferSize);
-        val |= ((threadHistory[tid].globalHistory[gh_offset] & 0x1) << i);
-    }
+    const std::vector<uint64_t> &ghist = threadHistory[tid].globalHistory;
+    unsigned pos = bi->ptGhist;
+    unsigned shift = pos & 63;
+    uint64_t val = ghist[pos >> 6] >> shift;
+    if (shift)
+        val |= ghist[((pos >> 6) + 1) % ghist.size()] << (64 - shift);
 
     return val;
 }
@@ -412,11 +437,11 @@ LTAGE::predict(ThreadID tid, Addr branch_pc, bool cond_branch, void* &b)
         // TAGE prediction
 
         // computes the table addresses and the partial tags
+        int *tableIndices = bi->tableIndices;
+        int *tableTags = bi->tableTags;
         for (int i = 1; i <= nHistoryTables; i++) {
             tableIndices[i] = gindex(tid, pc, i);
-            bi->tableIndices[i] = tableIndices[i];
             tableTags[i] = gtag(tid, pc, i);
-            bi->tableTags[i] = tableTags[i];
         }
 
         bi->bimodalIndex = bindex(pc);
@@ -425,7 +450,7 @@ LTAGE::predict(ThreadID tid, Addr branch_pc, bool cond_branch, void* &b)
         bi->altBank = 0;
         //Look for the bank with longest matching history
         for (int i = nHistoryTables; i > 0; i--) {
-            if (gtable[i][tableIndices[i]].tag == tableTags[i]) {
+            if (gtable[i].tag[tableIndices[i]] == tableTags[i]) {
                 bi->hitBank = i;
                 bi->hitBankIndex = tableIndices[bi->hitBank];
                 break;
@@ -433,7 +458,7 @@ LTAGE::predict(ThreadID tid, Addr branch_pc, bool cond_branch, void* &b)
         }
         //Look for the alternate bank
         for (int i = bi->hitBank - 1; i > 0; i--) {
-            if (gtable[i][tableIndices[i]].tag == tableTags[i]) {
+            if (gtable[i].tag[tableIndices[i]] == tableTags[i]) {
                 bi->altBank = i;
                 bi->altBankIndex = tableIndices[bi->altBank];
                 break;
@@ -443,22 +468,22 @@ LTAGE::predict(ThreadID tid, Addr branch_pc, bool cond_branch, void* &b)
         if (bi->hitBank > 0) {
             if (bi->altBank > 0) {
                 bi->altTaken =
-                    gtable[bi->altBank][tableIndices[bi->altBank]].ctr >= 0;
+                    gtable[bi->altBank].ctr[tableIndices[bi->altBank]] >= 0;
             }else {
                 bi->altTaken = getBimodePred(pc, bi);
             }
 
             bi->longestMatchPred =
-                gtable[bi->hitBank][tableIndices[bi->hitBank]].ctr >= 0;
+                gtable[bi->hitBank].ctr[tableIndices[bi->hitBank]] >= 0;
             bi->pseudoNewAlloc =
-                abs(2 * gtable[bi->hitBank][bi->hitBankIndex].ctr + 1) <= 1;
+                abs(2 * gtable[bi->hitBank].ctr[bi->hitBankIndex] + 1) <= 1;
 
             //if the entry is recognized as a newly allocated entry and
             //useAltPredForNewlyAllocated is positive use the alternate
             //prediction
             if ((useAltPredForNewlyAllocated < 0)
                    || abs(2 *
-                   gtable[bi->hitBank][tableIndices[bi->hitBank]].ctr + 1) > 1)
+                   gtable[bi->hitBank].ctr[tableIndices[bi->hitBank]] + 1) > 1)
                 bi->tagePred = bi->longestMatchPred;
             else
                 bi->tagePred = bi->altTaken;
@@ -542,8 +567,8 @@ LTAGE::update(ThreadID tid, Addr branch_pc, bool taken, void* bp_history,
             // is there some "unuseful" entry to allocate
             int8_t min = 1;
             for (int i = nHistoryTables; i > bi->hitBank; i--) {
-                if (gtable[i][bi->tableIndices[i]].u < min) {
-                    min = gtable[i][bi->tableIndices[i]].u;
+                if (gtable[i].u[bi->tableIndices[i]] < min) {
+                    min = gtable[i].u[bi->tableIndices[i]];
                 }
             }
 
@@ -560,16 +585,16 @@ LTAGE::update(ThreadID tid, Addr branch_pc, bool taken, void* bp_history,
             }
             // No entry available, forces one to be available
             if (min > 0) {
-                gtable[X][bi->tableIndices[X]].u = 0;
+                gtable[X].u[bi->tableIndices[X]] = 0;
             }
 
 
             //Allocate only  one entry
             for (int i = X; i <= nHistoryTables; i++) {
-                if ((gtable[i][bi->tableIndices[i]].u == 0)) {
-                    gtable[i][bi->tableIndices[i]].tag = bi->tableTags[i];
-                    gtable[i][bi->tableIndices[i]].ctr = (taken) ? 0 : -1;
-                    gtable[i][bi->tableIndices[i]].u = 0; //?
+                if ((gtable[i].u[bi->tableIndices[i]] == 0)) {
+                    gtable[i].tag[bi->tableIndices[i]] = bi->tableTags[i];
+                    gtable[i].ctr[bi->tableIndices[i]] = (taken) ? 0 : -1;
+                    gtable[i].u[bi->tableIndices[i]] = 0; //?
                 }
             }
         }
@@ -579,8 +604,8 @@ LTAGE::update(ThreadID tid, Addr branch_pc, bool taken, void* bp_history,
             // reset least significant bit
             // most significant bit becomes least significant bit
             for (int i = 1; i <= nHistoryTables; i++) {
-                for (int j = 0; j < (ULL(1) << tagTableSizes[i]); j++) {
-                    gtable[i][j].u = gtable[i][j].u >> 1;
+                for (auto &u : gtable[i].u) {
+                    u = u >> 1;
                 }
             }
         }
@@ -588,13 +613,13 @@ LTAGE::update(ThreadID tid, Addr branch_pc, bool taken, void* bp_history,
         if (bi->hitBank > 0) {
             DPRINTF(LTage, "Updating tag table entry (%d,%d) for branch %lx\n",
                     bi->hitBank, bi->hitBankIndex, branch_pc);
-            ctrUpdate(gtable[bi->hitBank][bi->hitBankIndex].ctr, taken,
+            ctrUpdate(gtable[bi->hitBank].ctr[bi->hitBankIndex], taken,
                       tagTableCounterBits);
             // if the provider entry is not certified to be useful also update
             // the alternate prediction
-            if (gtable[bi->hitBank][bi->hitBankIndex].u == 0) {
+            if (gtable[bi->hitBank].u[bi->hitBankIndex] == 0) {
                 if (bi->altBank > 0) {
-                    ctrUpdate(gtable[bi->altBank][bi->altBankIndex].ctr, taken,
+                    ctrUpdate(gtable[bi->altBank].ctr[bi->altBankIndex], taken,
                               tagTableCounterBits);
                     DPRINTF(LTage, "Updating tag table entry (%d,%d) for"
                             " branch %lx\n", bi->hitBank, bi->hitBankIndex,
@@ -608,8 +633,8 @@ LTAGE::update(ThreadID tid, Addr branch_pc, bool taken, void* bp_history,
             // update the u counter
             if (longest_match_pred != bi->altTaken) {
                 if (longest_match_pred == taken) {
-                    if (gtable[bi->hitBank][bi->hitBankIndex].u < 1) {
-                        gtable[bi->hitBank][bi->hitBankIndex].u++;
+                    if (gtable[bi->hitBank].u[bi->hitBankIndex] < 1) {
+                        gtable[bi->hitBank].u[bi->hitBankIndex]++;
                     }
                 }
             }
@@ -633,22 +658,15 @@ LTAGE::updateHistories(ThreadID tid, Addr branch_pc, bool taken, void* b)
     bool pathbit = ((branch_pc) & 1);
     //on a squash, return pointers to this and recompute indices.
     //update user history
-    updateGHist(tHist.gHist, taken, tHist.globalHistory, tHist.ptGhist);
+    updateGHist(tHist, taken);
     tHist.pathHist = (tHist.pathHist << 1) + pathbit;
     tHist.pathHist = (tHist.pathHist & ((ULL(1) << 16) - 1));
 
     bi->ptGhist = tHist.ptGhist;
     bi->pathHist = tHist.pathHist;
     //prepare next index and tag computations for user branchs
-    for (int i = 1; i <= nHistoryTables; i++)
-    {
-        bi->ci[i]  = tHist.computeIndices[i].comp;
-        bi->ct0[i] = tHist.computeTags[0][i].comp;
-        bi->ct1[i] = tHist.computeTags[1][i].comp;
-        tHist.computeIndices[i].update(tHist.gHist);
-        tHist.computeTags[0][i].update(tHist.gHist);
-        tHist.computeTags[1][i].update(tHist.gHist);
-    }
+    std::copy(tHist.folded.begin(), tHist.folded.end(), bi->folded);
+    updateFoldedHistories(tHist);
     DPRINTF(LTage, "Updating global histories with branch:%lx; taken?:%d, "
             "path Hist: %x; pointer:%d\n", branch_pc, taken, tHist.pathHist,
             tHist.ptGhist);
@@ -662,17 +680,12 @@ LTAGE::squash(ThreadID tid, bool taken, void *bp_history)
     DPRINTF(LTage, "Restoring branch info: %lx; taken? %d; PathHistory:%x, "
             "pointer:%d\n", bi->branchPC,taken, bi->pathHist, bi->ptGhist);
     tHist.pathHist = bi->pathHist;
-    tHist.ptGhist = bi->ptGhist;
-    tHist.gHist = &(tHist.globalHistory[tHist.ptGhist]);
-    tHist.gHist[0] = (taken ? 1 : 0);
-    for (int i = 1; i <= nHistoryTables; i++) {
-        tHist.computeIndices[i].comp = bi->ci[i];
-        tHist.computeTags[0][i].comp = bi->ct0[i];
-        tHist.computeTags[1][i].comp = bi->ct1[i];
-        tHist.computeIndices[i].update(tHist.gHist);
-        tHist.computeTags[0][i].update(tHist.gHist);
-        tHist.computeTags[1][i].update(tHist.gHist);
-    }
+    // Rewrite the outcome of the branch
+    tHist.ptGhist = (bi->ptGhist + 1) & histBufferMask;
+    updateGHist(tHist, taken);
+    std::copy(bi->folded, bi->folded + tHist.folded.size(),
+              tHist.folded.begin());
+    updateFoldedHistories(tHist);
 
     if (bi->condBranch) {
         if (bi->loopHit >= 0) {
@@ -705,8 +718,6 @@ LTAGE::lookup(ThreadID tid, Addr branch_pc, void* &bp_history)
 
     DPRINTF(LTage, "Lookup branch: %lx; predict:%d\n", branch_pc, retval);
     updateHistories(tid, branch_pc, retval, bp_history);
-    assert(threadHistory[tid].gHist ==
-           &threadHistory[tid].globalHistory[threadHistory[tid].ptGhist]);
 
     return retval;
 }
@@ -717,16 +728,12 @@ LTAGE::btbUpdate(ThreadID tid, Addr branch_pc, void* &bp_history)
     BranchInfo* bi = (BranchInfo*) bp_history;
     ThreadHistory& tHist = threadHistory[tid];
     DPRINTF(LTage, "BTB miss resets prediction: %lx\n", branch_pc);
-    assert(tHist.gHist == &tHist.globalHistory[tHist.ptGhist]);
-    tHist.gHist[0] = 0;
-    for (int i = 1; i <= nHistoryTables; i++) {
-        tHist.computeIndices[i].comp = bi->ci[i];
-        tHist.computeTags[0][i].comp = bi->ct0[i];
-        tHist.computeTags[1][i].comp = bi->ct1[i];
-        tHist.computeIndices[i].update(tHist.gHist);
-        tHist.computeTags[0][i].update(tHist.gHist);
-        tHist.computeTags[1][i].update(tHist.gHist);
-    }
+    // Rewrite the outcome of the branch as not taken
+    tHist.ptGhist = (tHist.ptGhist + 1) & histBufferMask;
+    updateGHist(tHist, false);
+    std::copy(bi->folded, bi->folded + tHist.folded.size(),
+              tHist.folded.begin());
+    updateFoldedHistories(tHist);
 }
 
 void
@@ -735,8 +742,6 @@ LTAGE::uncondBranch(ThreadID tid, Addr br_pc, void* &bp_history)
     DPRINTF(LTage, "UnConditionalBranch: %lx\n", br_pc);
     predict(tid, br_pc, false, bp_history);
     updateHistories(tid, br_pc, true, bp_history);
-    assert(threadHistory[tid].gHist ==
-           &threadHistory[tid].globalHistory[threadHistory[tid].ptGhist]);
 }
 
 LTAGE*
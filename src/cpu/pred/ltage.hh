@@ -73,6 +73,8 @@ class LTAGE: public BPredUnit
     unsigned getGHR(ThreadID tid, void *bp_history) const override;
 
   private:
+    struct ThreadHistory;
+
     // Prediction Structures
     // Loop Predictor Entry
     struct LoopEntry
@@ -98,39 +100,19 @@ class LTAGE: public BPredUnit
         BimodalEntry() : pred(0), hyst(1) { }
     };
 
-    // Tage Entry
-    struct TageEntry
-    {
-        int8_t ctr;
-        uint16_t tag;
-        int8_t u;
-        TageEntry() : ctr(0), tag(0), u(0) { }
-    };
-
-    // Folded History Table - compressed history
-    // to mix with instruction PC to index partially
-    // tagged tables.
-    struct FoldedHistory
+    // Tage Table, with the fields of the entries kept in separate
+    // arrays so that looking for a matching tag only touches the tags
+    struct TageTable
     {
-        unsigned comp;
-        int compLength;
-        int origLength;
-        int outpoint;
+        std::vector<uint16_t> tag;
+        std::vector<int8_t> ctr;
+        std::vector<int8_t> u;
 
-        void init(int original_length, int compressed_length)
+        void init(int size)
         {
-            comp = 0;
-            origLength = original_length;
-            compLength = compressed_length;
-            outpoint = original_length % compressed_length;
-        }
-
-        void update(uint8_t * h)
-        {
-            comp = (comp << 1) | h[0];
-            comp ^= h[origLength] << outpoint;
-            comp ^= (comp >> compLength);
-            comp &= (ULL(1) << compLength) - 1;
+            tag.assign(size, 0);
+            ctr.assign(size, 0);
+            u.assign(size, 0);
         }
     };
 
@@ -160,16 +142,16 @@ class LTAGE: public BPredUnit
 
         // Pointer to dynamically allocated storage
         // to save table indices and folded histories.
-        // To do one call to new instead of five.
+        // To do one call to new instead of three.
         int *storage;
 
         // Pointers to actual saved array within the dynamically
         // allocated storage.
         int *tableIndices;
         int *tableTags;
-        int *ci;
-        int *ct0;
-        int *ct1;
+        // Folded histories before this branch, laid out as in
+        // ThreadHistory::folded
+        unsigned *folded;
 
         BranchInfo(int sz)
             : pathHist(0), ptGhist(0),
@@ -184,9 +166,7 @@ class LTAGE: public BPredUnit
             storage = new int [sz * 5];
             tableIndices = storage;
             tableTags = storage + sz;
-            ci = tableTags + sz;
-            ct0 = ci + sz;
-            ct1 = ct0 + sz;
+            folded = reinterpret_cast<unsigned *>(tableTags + sz);
         }
 
         ~BranchInfo()
@@ -284,13 +264,30 @@ class LTAGE: public BPredUnit
 
    /**
     * (Speculatively) updates the global branch history.
-    * @param h Reference to pointer to global branch history.
+    * @param t_hist Histories of the thread.
     * @param dir (Predicted) outcome to update the histories
     * with.
-    * @param tab
-    * @param PT Reference to path history.
     */
-    void updateGHist(uint8_t * &h, bool dir, uint8_t * tab, int &PT);
+    void updateGHist(ThreadHistory &t_hist, bool dir);
+
+    /**
+     * Reads an outcome from the global branch history.
+     * @param t_hist Histories of the thread.
+     * @param pos Position of the outcome in the circular buffer.
+     */
+    bool
+    ghistBit(const ThreadHistory &t_hist, unsigned pos) const
+    {
+        pos &= histBufferMask;
+        return (t_hist.globalHistory[pos >> 6] >> (pos & 63)) & 1;
+    }
+
+    /**
+     * Shifts the most recent outcome into all the folded histories of a
+     * thread at once.
+     * @param t_hist Histories of the thread.
+     */
+    void updateFoldedHistories(ThreadHistory &t_hist);
 
     /**
      * Get a branch prediction from L-TAGE. *NOT* an override of
@@ -365,9 +362,24 @@ class LTAGE: public BPredUnit
     const unsigned minTagWidth;
 
     BimodalEntry *btable;
-    TageEntry **gtable;
+    std::vector<TageTable> gtable;
     LoopEntry *ltable;
 
+    // Size of the global history buffer, in outcomes, minus one
+    unsigned histBufferMask;
+
+    // Folded histories compress the global history to mix it with the
+    // PC when indexing and tagging the partially tagged tables. Each
+    // table has one for its index and two for its tag, kept in that
+    // order, so there are 3 * nHistoryTables of them. These are the
+    // lengths of the history they fold, the lengths they fold it to,
+    // the positions at which the outgoing outcome leaves them and the
+    // masks of their folded lengths.
+    std::vector<unsigned> foldOrigLength;
+    std::vector<unsigned> foldCompLength;
+    std::vector<unsigned> foldOutpoint;
+    std::vector<unsigned> foldMask;
+
     // Keep per-thread histories to
     // support SMT.
     struct ThreadHistory {
@@ -375,20 +387,16 @@ class LTAGE: public BPredUnit
         // (LSB of branch address)
         int pathHist;
 
-        // Speculative branch direction
-        // history (circular buffer)
-        // @TODO Convert to std::vector<bool>
-        uint8_t *globalHistory;
-
-        // Pointer to most recent branch outcome
-        uint8_t* gHist;
+        // Speculative branch direction history, a circular bit
+        // vector filled towards lower positions, so that the outcome
+        // n branches ago is at ptGhist + n
+        std::vector<uint64_t> globalHistory;
 
         // Index to most recent branch outcome
-        int ptGhist;
+        unsigned ptGhist;
 
-        // Speculative folded histories.
-        FoldedHistory *computeIndices;
-        FoldedHistory *computeTags[2];
+        // Speculative folded histories
+        std::vector<unsigned> folded;
     };
 
     std::vector<ThreadHistory> threadHistory;
@@ -396,8 +404,6 @@ class LTAGE: public BPredUnit
     int tagWidths[15];
     int tagTableSizes[15];
     int *histLengths;
-    int *tableIndices;
-    int *tableTags;
 
     int8_t loopUseCounter;
     int8_t useAltPredForNewlyAllocated;
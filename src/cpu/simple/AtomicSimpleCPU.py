@@ -38,6 +38,7 @@
 #
 # Authors: Nathan Binkert
 
+from m5.SimObject import *
 from m5.params import *
 from BaseSimpleCPU import BaseSimpleCPU
 from SimPoint import SimPoint
@@ -50,6 +51,10 @@ class AtomicSimpleCPU(BaseSimpleCPU):
     type = 'AtomicSimpleCPU'
     cxx_header = "cpu/simple/atomic.hh"
 
+    cxx_exports = [
+        PyBindMethod("setFastForward"),
+    ]
+
     @classmethod
     def memory_mode(cls):
         return 'atomic'
@@ -62,8 +67,12 @@ class AtomicSimpleCPU(BaseSimpleCPU):
     simulate_data_stalls = Param.Bool(False, "Simulate dcache stall cycles")
     simulate_inst_stalls = Param.Bool(False, "Simulate icache stall cycles")
     fastmem = Param.Bool(False, "Access memory directly")
+    decode_blocks = Param.Bool(True, "Cache decoded basic blocks and skip "
+        "instruction fetch when accessing memory directly (SE mode only)")
 
-    def addSimPointProbe(self, interval):
+    def addSimPointProbe(self, interval, accel_weight=None):
         simpoint = SimPoint()
         simpoint.interval = interval
+        if accel_weight is not None:
+            simpoint.accel_weight = accel_weight
         self.probeListener = simpoint
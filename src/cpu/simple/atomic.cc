@@ -74,6 +74,15 @@ AtomicSimpleCPU::init()
     data_write_req.setContext(cid);
 }
 
+void
+AtomicSimpleCPU::startup()
+{
+    BaseSimpleCPU::startup();
+
+    // Every CPU has registered its thread contexts by now
+    updateBlockCache();
+}
+
 AtomicSimpleCPU::AtomicSimpleCPU(AtomicSimpleCPUParams *p)
     : BaseSimpleCPU(p),
       tickEvent([this]{ tick(); }, "AtomicSimpleCPU tick",
@@ -87,6 +96,7 @@ AtomicSimpleCPU::AtomicSimpleCPU(AtomicSimpleCPUParams *p)
       ppCommit(nullptr)
 {
     _status = Idle;
+    updateBlockCache();
 }
 
 
@@ -147,6 +157,9 @@ AtomicSimpleCPU::drainResume()
     DPRINTF(SimpleCPU, "Resume\n");
     verifyMemoryMode();
 
+    // Memory may have changed while we were drained
+    blockCache.flush();
+
     assert(!threadContexts.empty());
 
     _status = BaseSimpleCPU::Idle;
@@ -205,6 +218,8 @@ AtomicSimpleCPU::takeOverFrom(BaseCPU *oldCPU)
 
     // The tick event should have been descheduled by drain()
     assert(!tickEvent.scheduled());
+
+    blockCache.flush();
 }
 
 void
@@ -216,6 +231,29 @@ AtomicSimpleCPU::verifyMemoryMode() const
     }
 }
 
+void
+AtomicSimpleCPU::setFastForward(bool fast_forward)
+{
+    auto p = static_cast<const AtomicSimpleCPUParams *>(params());
+    fastmem = fast_forward || p->fastmem;
+    useBranchPred = !fast_forward;
+    updateBlockCache();
+}
+
+void
+AtomicSimpleCPU::updateBlockCache()
+{
+    auto p = static_cast<const AtomicSimpleCPUParams *>(params());
+    // Fetches only bypass the memory system with fastmem, and the block
+    // cache relies on the fixed code mappings of SE mode. It only sees
+    // the stores of its own thread, so no other thread may run.
+    bool use = fastmem && p->decode_blocks && !FullSystem &&
+        system->numContexts() == 1;
+    if (use != useBlockCache)
+        blockCache.flush();
+    useBlockCache = use;
+}
+
 void
 AtomicSimpleCPU::activateContext(ThreadID thread_num)
 {
@@ -434,6 +472,10 @@ AtomicSimpleCPU::writeMem(uint8_t *data, unsigned size, Addr addr,
         data = zero_array;
     }
 
+    // Self-modifying code
+    if (useBlockCache)
+        blockCache.invalidate(addr, size);
+
     // use the CPU's statically allocated write request and packet objects
     Request *req = &data_write_req;
 
@@ -576,6 +618,10 @@ AtomicSimpleCPU::tick()
 
         bool needToFetch = !isRomMicroPC(pcState.microPC()) &&
                            !curMacroStaticInst;
+        if (needToFetch && useBlockCache) {
+            cachedInst = blockCache.lookup(pcState);
+            needToFetch = !cachedInst;
+        }
         if (needToFetch) {
             ifetch_req.taskId(taskId());
             setupFetchRequest(&ifetch_req);
@@ -660,6 +706,12 @@ AtomicSimpleCPU::tick()
         }
         if (fault != NoFault || !t_info.stayAtPC)
             advancePC(fault);
+
+        // Syscalls write memory through the thread's port proxy, which
+        // the block cache doesn't see, and may change the mappings of
+        // code. On some ISAs they only run in advancePC().
+        if (useBlockCache && curStaticInst && curStaticInst->isSyscall())
+            blockCache.flush();
     }
 
     if (tryCompleteDrain())
@@ -673,6 +725,14 @@ AtomicSimpleCPU::tick()
         reschedule(tickEvent, curTick() + latency, true);
 }
 
+void
+AtomicSimpleCPU::regStats()
+{
+    BaseSimpleCPU::regStats();
+
+    blockCache.regStats(name() + ".blockCache");
+}
+
 void
 AtomicSimpleCPU::regProbePoints()
 {
@@ -57,6 +57,7 @@ class AtomicSimpleCPU : public BaseSimpleCPU
     virtual ~AtomicSimpleCPU();
 
     void init() override;
+    void startup() override;
 
   private:
 
@@ -190,6 +191,22 @@ class AtomicSimpleCPU : public BaseSimpleCPU
 
     void verifyMemoryMode() const override;
 
+    /**
+     * Switch between functional warming, which goes through the caches
+     * and trains the branch predictor, and fast forwarding, which
+     * accesses memory directly and leaves the predictor alone. The
+     * caches have to be written back and invalidated before fast
+     * forwarding. Used by sampled simulation.
+     */
+    void setFastForward(bool fast_forward);
+
+    /**
+     * Use the decoded block cache whenever fetches bypass the memory
+     * system of a single CPU SE system. Flushes it when it is turned on
+     * or off.
+     */
+    void updateBlockCache();
+
     void activateContext(ThreadID thread_num) override;
     void suspendContext(ThreadID thread_num) override;
 
@@ -202,6 +219,7 @@ class AtomicSimpleCPU : public BaseSimpleCPU
     Fault writeMem(uint8_t *data, unsigned size,
                    Addr addr, Request::Flags flags, uint64_t *res) override;
 
+    void regStats() override;
     void regProbePoints() override;
 
     /**
@@ -90,6 +90,9 @@ BaseSimpleCPU::BaseSimpleCPU(BaseSimpleCPUParams *p)
     : BaseCPU(p),
       curThread(0),
       branchPred(p->branchPred),
+      useBranchPred(true),
+      useBlockCache(false),
+      cachedInst(nullptr),
       traceData(NULL),
       inst(),
       _status(Idle)
@@ -509,6 +512,20 @@ BaseSimpleCPU::preExecute()
         t_info.stayAtPC = false;
         curStaticInst = microcodeRom.fetchMicroop(pcState.microPC(),
                                                   curMacroStaticInst);
+    } else if (cachedInst) {
+        //The instruction was decoded before, so nothing was fetched
+        StaticInstPtr instPtr = cachedInst->inst;
+        t_info.stayAtPC = false;
+        thread->pcState(cachedInst->pc);
+        cachedInst = nullptr;
+
+        if (instPtr->isMacroop()) {
+            curMacroStaticInst = instPtr;
+            curStaticInst =
+                curMacroStaticInst->fetchMicroop(thread->pcState().microPC());
+        } else {
+            curStaticInst = instPtr;
+        }
     } else if (!curMacroStaticInst) {
         //We're not in the middle of a macro instruction
         StaticInstPtr instPtr = NULL;
@@ -528,6 +545,8 @@ BaseSimpleCPU::preExecute()
         instPtr = decoder->decode(pcState);
         if (instPtr) {
             t_info.stayAtPC = false;
+            if (useBlockCache)
+                blockCache.record(thread->pcState(), pcState, instPtr);
             thread->pcState(pcState);
         } else {
             t_info.stayAtPC = true;
@@ -559,7 +578,7 @@ BaseSimpleCPU::preExecute()
 #endif // TRACING_ON
     }
 
-    if (branchPred && curStaticInst &&
+    if (branchPred && useBranchPred && curStaticInst &&
         curStaticInst->isControl()) {
         // Use a fake sequence number since we only have one
         // instruction in flight at the same time.
@@ -688,7 +707,8 @@ BaseSimpleCPU::advancePC(const Fault &fault)
         }
     }
 
-    if (branchPred && curStaticInst && curStaticInst->isControl()) {
+    if (branchPred && useBranchPred && curStaticInst &&
+        curStaticInst->isControl()) {
         // Use a fake sequence number since we only have one
         // instruction in flight at the same time.
         const InstSeqNum cur_sn(0);
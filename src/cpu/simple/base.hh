@@ -52,6 +52,7 @@
 #include "cpu/checker/cpu.hh"
 #include "cpu/exec_context.hh"
 #include "cpu/pc_event.hh"
+#include "cpu/simple/block_cache.hh"
 #include "cpu/simple_thread.hh"
 #include "cpu/static_inst.hh"
 #include "mem/packet.hh"
@@ -86,6 +87,14 @@ class BaseSimpleCPU : public BaseCPU
   protected:
     ThreadID curThread;
     BPredUnit *branchPred;
+    /** Whether the branch predictor is used, cleared when fast forwarding */
+    bool useBranchPred;
+
+    /** Decoded basic blocks, used by CPU models that skip fetch */
+    DecodedBlockCache blockCache;
+    bool useBlockCache;
+    /** Instruction taken from the block cache instead of being fetched */
+    const DecodedBlockCache::Inst *cachedInst;
 
     void checkPcEventQueue();
     void swapActiveThread();
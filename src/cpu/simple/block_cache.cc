@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "cpu/simple/block_cache.hh"
+
+#include "arch/isa_traits.hh"
+
+const Addr DecodedBlockCache::pageMask = ~(TheISA::PageBytes - 1);
+
+DecodedBlockCache::DecodedBlockCache()
+    : current(nullptr), pos(0), nextAddr(0), buildFrom(nullptr)
+{
+}
+
+const DecodedBlockCache::Inst *
+DecodedBlockCache::lookup(const TheISA::PCState &pc)
+{
+    Block *from = nullptr;
+
+    if (current) {
+        if (pos < current->insts.size()) {
+            const Inst &inst = current->insts[pos];
+            if (inst.key == pc) {
+                ++pos;
+                ++hits;
+                return &inst;
+            }
+        } else {
+            for (Block *succ : current->succ) {
+                if (succ && succ->insts.front().key == pc) {
+                    current = succ;
+                    pos = 1;
+                    ++hits;
+                    ++chained;
+                    return &succ->insts.front();
+                }
+            }
+            from = current;
+        }
+        current = nullptr;
+    }
+
+    if (building) {
+        // Keep recording while execution falls through. This is also
+        // the case when the decoder needed more bytes for the first
+        // instruction.
+        if (pc.instAddr() == nextAddr)
+            return nullptr;
+        from = finishBlock();
+    }
+
+    auto it = blocks.find(pc.instAddr());
+    if (it != blocks.end()) {
+        Block *block = it->second.get();
+        // The same address decoded in another mode stays uncached
+        if (!(block->insts.front().key == pc))
+            return nullptr;
+        if (from)
+            link(from, block);
+        current = block;
+        pos = 1;
+        ++hits;
+        return &block->insts.front();
+    }
+
+    building.reset(new Block());
+    building->succ[0] = building->succ[1] = nullptr;
+    building->nextSucc = 0;
+    nextAddr = pc.instAddr();
+    buildFrom = from;
+    return nullptr;
+}
+
+void
+DecodedBlockCache::record(const TheISA::PCState &key,
+                          const TheISA::PCState &pc,
+                          const StaticInstPtr &inst)
+{
+    if (!building)
+        return;
+
+    ++misses;
+    building->insts.push_back(Inst{key, pc, inst});
+    nextAddr = pc.nextInstAddr();
+
+    codePages.insert(key.instAddr() & pageMask);
+    if (nextAddr > key.instAddr())
+        codePages.insert((nextAddr - 1) & pageMask);
+
+    // Anything after these may run in a different mode, or not at all
+    if (inst->isControl() || inst->isSerializing() ||
+        inst->isNonSpeculative() || inst->isSyscall() || inst->isQuiesce() ||
+        building->insts.size() == maxBlockInsts) {
+        current = finishBlock();
+        pos = current ? current->insts.size() : 0;
+    }
+}
+
+DecodedBlockCache::Block *
+DecodedBlockCache::finishBlock()
+{
+    std::unique_ptr<Block> block(std::move(building));
+    Block *from = buildFrom;
+    buildFrom = nullptr;
+    if (block->insts.empty())
+        return nullptr;
+
+    if (blocks.size() >= maxBlocks) {
+        flush();
+        from = nullptr;
+    }
+
+    // Another path may have recorded a block at the same address
+    Addr start = block->insts.front().key.instAddr();
+    auto ins = blocks.emplace(start, std::move(block));
+    if (!ins.second)
+        return nullptr;
+
+    Block *finished = ins.first->second.get();
+    if (from)
+        link(from, finished);
+    return finished;
+}
+
+void
+DecodedBlockCache::link(Block *from, Block *to)
+{
+    if (from->succ[0] == to || from->succ[1] == to)
+        return;
+    from->succ[from->nextSucc] = to;
+    from->nextSucc ^= 1;
+}
+
+void
+DecodedBlockCache::flush()
+{
+    if (blocks.empty() && !building)
+        return;
+
+    ++flushes;
+    blocks.clear();
+    codePages.clear();
+    building.reset();
+    current = nullptr;
+    pos = 0;
+    buildFrom = nullptr;
+}
+
+void
+DecodedBlockCache::regStats(const std::string &name)
+{
+    hits
+        .name(name + ".hits")
+        .desc("Instructions found in the decoded block cache")
+        ;
+
+    chained
+        .name(name + ".chained")
+        .desc("Blocks entered through a successor link")
+        ;
+
+    misses
+        .name(name + ".misses")
+        .desc("Instructions fetched and decoded into the block cache")
+        ;
+
+    flushes
+        .name(name + ".flushes")
+        .desc("Decoded block cache flushes")
+        ;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CPU_SIMPLE_BLOCK_CACHE_HH__
+#define __CPU_SIMPLE_BLOCK_CACHE_HH__
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "arch/types.hh"
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/static_inst.hh"
+
+/**
+ * Cache of decoded basic blocks for the simple CPUs.
+ *
+ * A block is a run of instructions that were decoded back to back,
+ * ending at a control instruction, at anything that may change how the
+ * following code is decoded (serializing and non-speculative
+ * instructions) or wherever decoding was interrupted. Each instruction
+ * is stored with the PC state it was decoded at, and is only reused
+ * when the thread's PC state matches exactly, so mode bits (e.g. Thumb
+ * or IT state on ARM) are respected. Blocks link directly to the blocks
+ * that followed them, so a loop runs without any hash lookups.
+ *
+ * Instructions are cached by virtual address and the cache does not
+ * observe address translation, so it should only be used where the
+ * mapping of code is fixed, i.e. in SE mode. Writes by the owning CPU
+ * to a page holding cached code flush the cache. Writes from other
+ * agents are not observed, so the atomic CPU only uses the cache when
+ * it runs the only thread of the system, and flushes it after every
+ * syscall, since syscall emulation writes memory through a port proxy.
+ */
+class DecodedBlockCache
+{
+  public:
+    struct Inst
+    {
+        /** PC state the instruction was fetched at */
+        TheISA::PCState key;
+        /** PC state after decoding */
+        TheISA::PCState pc;
+        StaticInstPtr inst;
+    };
+
+    DecodedBlockCache();
+
+    /**
+     * Look up the instruction at a PC at the start of a new instruction.
+     * Returns nullptr on a miss, in which case the instruction decoded
+     * at that PC is expected to be passed to record().
+     */
+    const Inst *lookup(const TheISA::PCState &pc);
+
+    /** Add an instruction decoded after a lookup miss. */
+    void record(const TheISA::PCState &key, const TheISA::PCState &pc,
+                const StaticInstPtr &inst);
+
+    /** Flush the cache if a write overlaps a page holding cached code. */
+    void
+    invalidate(Addr addr, unsigned size)
+    {
+        if (!codePages.empty() &&
+            (codePages.count(addr & pageMask) ||
+             codePages.count((addr + size - 1) & pageMask)))
+            flush();
+    }
+
+    /** Drop all blocks. */
+    void flush();
+
+    void regStats(const std::string &name);
+
+  private:
+    struct Block
+    {
+        std::vector<Inst> insts;
+        /** The last blocks that followed this one */
+        Block *succ[2];
+        unsigned nextSucc;
+    };
+
+    /** Longest block recorded */
+    static const unsigned maxBlockInsts = 64;
+    /** Number of blocks after which the cache is flushed */
+    static const size_t maxBlocks = 1 << 16;
+    static const Addr pageMask;
+
+    /** Blocks by the address of their first instruction */
+    std::unordered_map<Addr, std::unique_ptr<Block>> blocks;
+    /** Pages holding cached instructions */
+    std::unordered_set<Addr> codePages;
+
+    /** Block being executed and the index of its next instruction */
+    Block *current;
+    unsigned pos;
+
+    /** Block being recorded, the address of the instruction that falls
+     * through to it next and the block that ran before it */
+    std::unique_ptr<Block> building;
+    Addr nextAddr;
+    Block *buildFrom;
+
+    void link(Block *from, Block *to);
+    Block *finishBlock();
+
+    Stats::Scalar hits;
+    Stats::Scalar chained;
+    Stats::Scalar misses;
+    Stats::Scalar flushes;
+};
+
+#endif // __CPU_SIMPLE_BLOCK_CACHE_HH__
@@ -36,6 +36,7 @@
 # Authors: Curtis Dunham
 
 from m5.params import *
+from m5.proxy import *
 from Probe import ProbeListenerObject
 
 class SimPoint(ProbeListenerObject):
@@ -46,3 +47,7 @@ class SimPoint(ProbeListenerObject):
 
     interval = Param.UInt64(100000000, "Interval Size (insts)")
     profile_file = Param.String("simpoint.bb.gz", "BBV (output) file")
+    system = Param.System(Parent.any,
+        "System whose accelerator invocations are profiled")
+    accel_weight = Param.Float(0.1, "Weight of an accelerator invocation "
+        "in the BBV, as a fraction of the interval (0 to ignore them)")
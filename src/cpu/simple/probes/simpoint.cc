@@ -40,14 +40,38 @@
 
 #include "cpu/simple/probes/simpoint.hh"
 
+#include <algorithm>
+
 #include "base/output.hh"
+#include "sim/system.hh"
+
+/** Listens to the accelerator invocations of a system */
+class AccelInvokeListener : public ProbeListenerArgBase<int>
+{
+  private:
+    SimPoint &simpoint;
+
+  public:
+    AccelInvokeListener(SimPoint &_simpoint, ProbeManager *pm)
+        : ProbeListenerArgBase<int>(pm, "AccelInvoke"), simpoint(_simpoint)
+    {}
+
+    void notify(const int &accel_id) override
+    {
+        simpoint.accelInvoked(accel_id);
+    }
+};
 
 SimPoint::SimPoint(const SimPointParams *p)
     : ProbeListenerObject(p),
+      // A zero weight leaves accelerator invocations out of the BBVs
+      system(p->accel_weight > 0 ? p->system : nullptr),
+      accelWeight(std::max<uint64_t>(1, p->accel_weight * p->interval)),
       intervalSize(p->interval),
       intervalCount(0),
       intervalDrift(0),
       simpointStream(NULL),
+      lastId(0),
       currentBBV(0, 0),
       currentBBVInstCount(0)
 {
@@ -72,6 +96,24 @@ SimPoint::regProbeListeners()
         SimPointListener;
     listeners.push_back(new SimPointListener(this, "Commit",
                                              &SimPoint::profile));
+    if (system) {
+        listeners.push_back(new AccelInvokeListener(
+                                *this, system->getProbeManager()));
+    }
+}
+
+void
+SimPoint::accelInvoked(const int &accel_id)
+{
+    auto map_itr = accelMap.find(accel_id);
+    if (map_itr == accelMap.end()) {
+        BBInfo info;
+        info.id = ++lastId;
+        info.insts = 0;
+        info.count = 0;
+        map_itr = accelMap.insert(std::make_pair(accel_id, info)).first;
+    }
+    map_itr->second.count += accelWeight;
 }
 
 void
@@ -98,7 +140,7 @@ SimPoint::profile(const std::pair<SimpleThread*, StaticInstPtr>& p)
             // If a new (previously unseen) basic block is found,
             // add a new unique id, record num of insts and insert into bbMap.
             BBInfo info;
-            info.id = bbMap.size() + 1;
+            info.id = ++lastId;
             info.insts = currentBBVInstCount;
             info.count = currentBBVInstCount;
             bbMap.insert(std::make_pair(currentBBV, info));
@@ -124,6 +166,13 @@ SimPoint::profile(const std::pair<SimpleThread*, StaticInstPtr>& p)
                     info.count = 0;
                 }
             }
+            for (auto &accel : accelMap) {
+                BBInfo& info = accel.second;
+                if (info.count != 0) {
+                    counts.push_back(std::make_pair(info.id, info.count));
+                    info.count = 0;
+                }
+            }
             std::sort(counts.begin(), counts.end());
 
             // Print output BBV info
@@ -48,6 +48,8 @@
 #include "params/SimPoint.hh"
 #include "sim/probe/probe.hh"
 
+class System;
+
 /**
  * Probe for SimPoints BBV generation
  */
@@ -89,7 +91,21 @@ class SimPoint : public ProbeListenerObject
      */
     void profile(const std::pair<SimpleThread*, StaticInstPtr>&);
 
+    /**
+     * Count an accelerator invocation in the current interval. Each
+     * accelerator shows up in the BBV as a basic block of its own, so
+     * that intervals that invoke different accelerators end up in
+     * different clusters.
+     */
+    void accelInvoked(const int &accel_id);
+
   private:
+    /** System whose accelerator invocations are profiled, if any */
+    System *system;
+
+    /** Weight of an accelerator invocation in the BBV, in instructions */
+    const uint64_t accelWeight;
+
     /** SimPoint profiling interval size in instructions */
     const uint64_t intervalSize;
 
@@ -112,6 +128,10 @@ class SimPoint : public ProbeListenerObject
 
     /** Hash table containing all previously seen basic blocks */
     std::unordered_map<BasicBlockRange, BBInfo> bbMap;
+    /** Invocations of each accelerator, indexed by accelerator id */
+    std::unordered_map<int, BBInfo> accelMap;
+    /** Last unique ID given to a basic block or an accelerator */
+    uint64_t lastId;
     /** Currently executing basic block */
     BasicBlockRange currentBBV;
     /** inst count in current basic block */
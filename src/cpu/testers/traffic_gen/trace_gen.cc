@@ -50,17 +50,30 @@
 #include "proto/packet.pb.h"
 
 TraceGen::InputStream::InputStream(const std::string& filename)
-    : trace(filename)
 {
+    if (PackedTrace::isPackedTrace(filename))
+        packed.reset(new PackedTraceReader(filename));
+    else
+        trace.reset(new ProtoInputStream(filename));
     init();
 }
 
 void
 TraceGen::InputStream::init()
 {
+    if (packed) {
+        const auto &header = packed->header();
+        if (header.kind != PackedTrace::PacketTrace)
+            panic("Trace is not a packet trace\n");
+        else if (header.tickFreq != SimClock::Frequency)
+            panic("Trace was recorded with a different tick frequency %d\n",
+                  header.tickFreq);
+        return;
+    }
+
     // Create a protobuf message for the header and read it from the stream
     ProtoMessage::PacketHeader header_msg;
-    if (!trace.read(header_msg)) {
+    if (!trace->read(header_msg)) {
         panic("Failed to read packet header from trace\n");
     } else if (header_msg.tick_freq() != SimClock::Frequency) {
         panic("Trace was recorded with a different tick frequency %d\n",
@@ -71,15 +84,30 @@ TraceGen::InputStream::init()
 void
 TraceGen::InputStream::reset()
 {
-    trace.reset();
+    if (packed)
+        packed->reset();
+    else
+        trace->reset();
     init();
 }
 
 bool
 TraceGen::InputStream::read(TraceElement& element)
 {
+    if (packed) {
+        PackedTrace::Packet pkt;
+        if (!packed->read(pkt))
+            return false;
+        element.cmd = pkt.cmd;
+        element.addr = pkt.addr;
+        element.blocksize = pkt.size;
+        element.tick = pkt.tick;
+        element.flags = pkt.flags;
+        return true;
+    }
+
     ProtoMessage::Packet pkt_msg;
-    if (trace.read(pkt_msg)) {
+    if (trace->read(pkt_msg)) {
         element.cmd = pkt_msg.cmd();
         element.addr = pkt_msg.addr();
         element.blocksize = pkt_msg.size();
@@ -49,10 +49,13 @@
 #ifndef __CPU_TRAFFIC_GEN_TRACE_GEN_HH__
 #define __CPU_TRAFFIC_GEN_TRACE_GEN_HH__
 
+#include <memory>
+
 #include "base/bitfield.hh"
 #include "base/intmath.hh"
 #include "base_gen.hh"
 #include "mem/packet.hh"
+#include "proto/packed_trace.hh"
 #include "proto/protoio.hh"
 
 /**
@@ -113,7 +116,10 @@ class TraceGen : public BaseGen
       private:
 
         /// Input file stream for the protobuf trace
-        ProtoInputStream trace;
+        std::unique_ptr<ProtoInputStream> trace;
+
+        /// Reader used instead if the trace is a packed trace
+        std::unique_ptr<PackedTraceReader> packed;
 
       public:
 
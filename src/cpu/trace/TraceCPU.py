@@ -87,3 +87,9 @@ class TraceCPU(BaseCPU):
     progressMsgInterval = Param.Unsigned(0, "Interval of committed "\
                                          "instructions at which to print a"\
                                          " progress msg")
+
+    # The elastic data trace is parsed on a host thread, filling one buffer
+    # of records while the replay takes them from the other one. Turning it
+    # off parses each record when the replay needs it.
+    decodeThread = Param.Bool(True, "Parse the data trace on a separate "\
+                              "host thread")
@@ -41,10 +41,12 @@
 
 #include "cpu/trace/trace_cpu.hh"
 
+#include <algorithm>
+
 #include "sim/sim_exit.hh"
 
 // Declare and initialize the static counter for number of trace CPUs.
-int TraceCPU::numTraceCPUs = 0;
+std::atomic<int> TraceCPU::numTraceCPUs(0);
 
 TraceCPU::TraceCPU(TraceCPUParams *params)
     :   BaseCPU(params),
@@ -61,7 +63,8 @@ TraceCPU::TraceCPU(TraceCPUParams *params)
         dcacheNextEvent([this]{ schedDcacheNext(); }, name()),
         oneTraceComplete(false),
         traceOffset(0),
-        execCompleteEvent(nullptr),
+        execCompleteEvent([this]{ countDownExit(); }, name(), false,
+                          Event::Sim_Exit_Pri),
         enableEarlyExit(params->enableEarlyExit),
         progressMsgInterval(params->progressMsgInterval),
         progressMsgThreshold(params->progressMsgInterval)
@@ -149,17 +152,13 @@ TraceCPU::init()
     // send its first request at the first event and schedule subsequent
     // events using a relative tick delta
     dcacheGen.adjustInitTraceOffset(traceOffset);
+}
 
-    // If the Trace CPU simulation is configured to exit on any one trace
-    // completion then we don't need a counted event to count down all Trace
-    // CPUs in the system. If not then instantiate a counted event.
-    if (!enableEarlyExit) {
-        // The static counter for number of Trace CPUs is correctly set at
-        // this point so create an event and pass it.
-        execCompleteEvent = new CountedExitEvent("end of all traces reached.",
-                                                 numTraceCPUs);
-    }
-
+void
+TraceCPU::countDownExit()
+{
+    if (--numTraceCPUs == 0)
+        exitSimLoop("end of all traces reached.", 0);
 }
 
 void
@@ -217,7 +216,7 @@ TraceCPU::checkAndSchedExitEvent()
         if (enableEarlyExit) {
             exitSimLoop("End of trace reached");
         } else {
-            schedule(*execCompleteEvent, curTick());
+            schedule(execCompleteEvent, curTick());
         }
     }
 }
@@ -308,6 +307,12 @@ TraceCPU::ElasticDataGen::regStats()
     .name(name() + ".dataLastTick")
     .desc("Last tick simulated from the elastic data trace")
     ;
+
+    numDecodeWaits
+    .method(&trace, &InputStream::getDecodeWaits)
+    .name(name() + ".numDecodeWaits")
+    .desc("Number of times the replay waited for the trace decoder")
+    ;
 }
 
 Tick
@@ -316,6 +321,11 @@ TraceCPU::ElasticDataGen::init()
     DPRINTF(TraceCPUData, "Initializing data memory request generator "
             "DcacheGen: elastic issue with retry.\n");
 
+    // The graph holds two windows of nodes after the first reads
+    depGraph.reserve(2 * windowSize);
+    freeNodes.reserve(2 * windowSize);
+    readyList.reserve(2 * windowSize);
+
     if (!readNextWindow())
         panic("Trace has %d elements. It must have at least %d elements.\n",
               depGraph.size(), 2 * windowSize);
@@ -332,16 +342,17 @@ TraceCPU::ElasticDataGen::init()
     if (DTRACE(TraceCPUData)) {
         printReadyList();
     }
-    auto free_itr = readyList.begin();
+    const ReadyNode &first_node = nextReadyNode();
     DPRINTF(TraceCPUData, "Execute tick of the first dependency free node %lli"
-            " is %d.\n", free_itr->seqNum, free_itr->execTick);
+            " is %d.\n", first_node.seqNum, first_node.execTick);
     // Return the execute tick of the earliest ready node so that an event
     // can be scheduled to call execute()
-    return (free_itr->execTick);
+    return first_node.execTick;
 }
 
 void
 TraceCPU::ElasticDataGen::adjustInitTraceOffset(Tick& offset) {
+    // Moving all nodes by the same offset keeps the heap ordered
     for (auto& free_node : readyList) {
         free_node.execTick -= offset;
     }
@@ -372,14 +383,15 @@ TraceCPU::ElasticDataGen::readNextWindow()
     uint32_t num_read = 0;
     while (num_read != windowSize) {
 
-        // Create a new graph node
-        GraphNode* new_node = new GraphNode;
+        // Take a new graph node from the pool
+        GraphNode* new_node = allocNode();
 
         // Read the next line to get the next record. If that fails then end of
         // trace has been reached and traceComplete needs to be set in addition
         // to returning false.
         if (!trace.read(new_node)) {
             DPRINTF(TraceCPUData, "\tTrace complete!\n");
+            freeNode(new_node);
             traceComplete = true;
             return false;
         }
@@ -441,7 +453,7 @@ TraceCPU::ElasticDataGen::execute()
 {
     DPRINTF(TraceCPUData, "Execute start occupancy:\n");
     DPRINTFR(TraceCPUData, "\tdepGraph = %d, readyList = %d, "
-            "depFreeQueue = %d ,", depGraph.size(), readyList.size(),
+            "depFreeQueue = %d ,", depGraph.size(), readyListSize(),
             depFreeQueue.size());
     hwResource.printOccupancy();
 
@@ -465,14 +477,20 @@ TraceCPU::ElasticDataGen::execute()
         }
     }
     // Proceed to execute from readyList
-    auto graph_itr = depGraph.begin();
-    auto free_itr = readyList.begin();
     // Iterate through readyList until the next free node has its execute
     // tick later than curTick or the end of readyList is reached
-    while (free_itr->execTick <= curTick() && free_itr != readyList.end()) {
+    while (!readyListEmpty() && nextReadyNode().execTick <= curTick()) {
+
+        // Take the node off the readyList, unless it is the one waiting
+        // for a retry which is not in it
+        ReadyNode free_node = nextReadyNode();
+        if (!retryPkt) {
+            std::pop_heap(readyList.begin(), readyList.end());
+            readyList.pop_back();
+        }
 
         // Get pointer to the node to be executed
-        graph_itr = depGraph.find(free_itr->seqNum);
+        auto graph_itr = depGraph.find(free_node.seqNum);
         assert(graph_itr != depGraph.end());
         GraphNode* node_ptr = graph_itr->second;
 
@@ -498,8 +516,9 @@ TraceCPU::ElasticDataGen::execute()
         }
         // If the retryPkt or a new load/store node failed, we exit from here
         // as a retry from cache will bring the control to execute(). The
-        // first node in readyList then, will be the failed node.
+        // failed node is kept aside as the first node of the readyList.
         if (retryPkt) {
+            retryNode = free_node;
             break;
         }
 
@@ -556,8 +575,7 @@ TraceCPU::ElasticDataGen::execute()
             }
         }
 
-        // After executing the node, remove from readyList and delete node.
-        readyList.erase(free_itr);
+        // After executing the node, it is off the readyList, delete node.
         // If it is a cacheable load which was sent, don't delete
         // just yet.  Delete it in completeMemAccess() after the
         // response is received. If it is an strictly ordered
@@ -572,13 +590,11 @@ TraceCPU::ElasticDataGen::execute()
             (node_ptr->dependents).clear();
             // Update the stat for numOps simulated
             owner.updateNumOps(node_ptr->robNum);
-            // delete node
-            delete node_ptr;
+            // return node to the pool
+            freeNode(node_ptr);
             // remove from graph
             depGraph.erase(graph_itr);
         }
-        // Point to first node to continue to next iteration of while loop
-        free_itr = readyList.begin();
     } // end of while loop
 
     // Print readyList, sizes of queues and resource status after updating
@@ -586,7 +602,7 @@ TraceCPU::ElasticDataGen::execute()
         printReadyList();
         DPRINTF(TraceCPUData, "Execute end occupancy:\n");
         DPRINTFR(TraceCPUData, "\tdepGraph = %d, readyList = %d, "
-                "depFreeQueue = %d ,", depGraph.size(), readyList.size(),
+                "depFreeQueue = %d ,", depGraph.size(), readyListSize(),
                 depFreeQueue.size());
         hwResource.printOccupancy();
     }
@@ -607,13 +623,13 @@ TraceCPU::ElasticDataGen::execute()
     // readyList else retry from cache will schedule the event. If the ready
     // list is empty then check if the next pending node has resources
     // available to issue. If yes, then schedule an event for the next cycle.
-    if (!readyList.empty()) {
-        Tick next_event_tick = std::max(readyList.begin()->execTick,
+    if (!readyListEmpty()) {
+        Tick next_event_tick = std::max(nextReadyNode().execTick,
                                         curTick());
         DPRINTF(TraceCPUData, "Attempting to schedule @%lli.\n",
                 next_event_tick);
         owner.schedDcacheNextEvent(next_event_tick);
-    } else if (readyList.empty() && !depFreeQueue.empty() &&
+    } else if (readyListEmpty() && !depFreeQueue.empty() &&
                 hwResource.isAvailable(depFreeQueue.front())) {
         DPRINTF(TraceCPUData, "Attempting to schedule @%lli.\n",
                 owner.clockEdge(Cycles(1)));
@@ -622,7 +638,7 @@ TraceCPU::ElasticDataGen::execute()
 
     // If trace is completely read, readyList is empty and depGraph is empty,
     // set execComplete to true
-    if (depGraph.empty() && readyList.empty() && traceComplete &&
+    if (depGraph.empty() && readyListEmpty() && traceComplete &&
         !hwResource.awaitingResponse()) {
         DPRINTF(TraceCPUData, "\tExecution Complete!\n");
         execComplete = true;
@@ -776,8 +792,8 @@ TraceCPU::ElasticDataGen::completeMemAccess(PacketPtr pkt)
         (node_ptr->dependents).clear();
         // Update the stat for numOps completed
         owner.updateNumOps(node_ptr->robNum);
-        // delete node
-        delete node_ptr;
+        // return node to the pool
+        freeNode(node_ptr);
         // remove from graph
         depGraph.erase(graph_itr);
     }
@@ -801,8 +817,8 @@ TraceCPU::ElasticDataGen::completeMemAccess(PacketPtr pkt)
         // last remaining response. So, either the trace is complete or there
         // are pending nodes in the depFreeQueue. The checking is done in the
         // execute() control flow, so schedule an event to go via that flow.
-        Tick next_event_tick = readyList.empty() ? owner.clockEdge(Cycles(1)) :
-            std::max(readyList.begin()->execTick, owner.clockEdge(Cycles(1)));
+        Tick next_event_tick = readyListEmpty() ? owner.clockEdge(Cycles(1)) :
+            std::max(nextReadyNode().execTick, owner.clockEdge(Cycles(1)));
         DPRINTF(TraceCPUData, "Attempting to schedule @%lli.\n",
                 next_event_tick);
         owner.schedDcacheNextEvent(next_event_tick);
@@ -817,73 +833,58 @@ TraceCPU::ElasticDataGen::addToSortedReadyList(NodeSeqNum seq_num,
     ready_node.seqNum = seq_num;
     ready_node.execTick = exec_tick;
 
-    // Iterator to readyList
-    auto itr = readyList.begin();
+    // The heap keeps the nodes ordered by execution tick and then by
+    // sequence number. A node that failed to execute is held out of the
+    // heap in retryNode, so its position as the first is maintained.
+    readyList.push_back(ready_node);
+    std::push_heap(readyList.begin(), readyList.end());
 
-    // If the readyList is empty, simply insert the new node at the beginning
-    // and return
-    if (itr == readyList.end()) {
-        readyList.insert(itr, ready_node);
-        maxReadyListSize = std::max<double>(readyList.size(),
-                                              maxReadyListSize.value());
-        return;
-    }
-
-    // If the new node has its execution tick equal to the first node in the
-    // list then go to the next node. If the first node in the list failed
-    // to execute, its position as the first is thus maintained.
-    if (retryPkt)
-        if (retryPkt->req->getReqInstSeqNum() == itr->seqNum)
-            itr++;
-
-    // Increment the iterator and compare the node pointed to by it to the new
-    // node till the position to insert the new node is found.
-    bool found = false;
-    while (!found && itr != readyList.end()) {
-        // If the execution tick of the new node is less than the node then
-        // this is the position to insert
-        if (exec_tick < itr->execTick)
-            found = true;
-        // If the execution tick of the new node is equal to the node then
-        // sort in ascending order of sequence numbers
-        else if (exec_tick == itr->execTick) {
-            // If the sequence number of the new node is less than the node
-            // then this is the position to insert
-            if (seq_num < itr->seqNum)
-                found = true;
-            // Else go to next node
-            else
-                itr++;
-        }
-        // If the execution tick of the new node is greater than the node then
-        // go to the next node
-        else
-            itr++;
-    }
-    readyList.insert(itr, ready_node);
     // Update the stat for max size reached of the readyList
-    maxReadyListSize = std::max<double>(readyList.size(),
+    maxReadyListSize = std::max<double>(readyListSize(),
                                           maxReadyListSize.value());
 }
 
 void
 TraceCPU::ElasticDataGen::printReadyList() {
 
-    auto itr = readyList.begin();
-    if (itr == readyList.end()) {
+    if (readyListEmpty()) {
         DPRINTF(TraceCPUData, "readyList is empty.\n");
         return;
     }
     DPRINTF(TraceCPUData, "Printing readyList:\n");
-    while (itr != readyList.end()) {
-        auto graph_itr = depGraph.find(itr->seqNum);
+    std::vector<ReadyNode> sorted(readyList);
+    // The earliest node is the greatest in the order of the heap
+    std::sort(sorted.rbegin(), sorted.rend());
+    if (retryPkt)
+        sorted.insert(sorted.begin(), retryNode);
+    for (const auto &ready_node : sorted) {
+        auto graph_itr = depGraph.find(ready_node.seqNum);
         GraphNode* node_ptr M5_VAR_USED = graph_itr->second;
-        DPRINTFR(TraceCPUData, "\t%lld(%s), %lld\n", itr->seqNum,
-            node_ptr->typeToStr(), itr->execTick);
-        itr++;
+        DPRINTFR(TraceCPUData, "\t%lld(%s), %lld\n", ready_node.seqNum,
+            node_ptr->typeToStr(), ready_node.execTick);
     }
 }
 
+TraceCPU::ElasticDataGen::GraphNode *
+TraceCPU::ElasticDataGen::allocNode()
+{
+    if (freeNodes.empty()) {
+        nodePool.emplace_back();
+        return &nodePool.back();
+    }
+    GraphNode *node = freeNodes.back();
+    freeNodes.pop_back();
+    return node;
+}
+
+void
+TraceCPU::ElasticDataGen::freeNode(GraphNode *node)
+{
+    // The dependents keep their storage for the next node
+    assert(node->dependents.empty());
+    freeNodes.push_back(node);
+}
+
 TraceCPU::ElasticDataGen::HardwareResource::HardwareResource(
     uint16_t max_rob, uint16_t max_stores, uint16_t max_loads)
   : sizeROB(max_rob),
@@ -1266,14 +1267,36 @@ TraceCPU::DcachePort::recvReqRetry()
 
 TraceCPU::ElasticDataGen::InputStream::InputStream(
     const std::string& filename,
-    const double time_multiplier)
-    : trace(filename),
-      timeMultiplier(time_multiplier),
-      microOpCount(0)
+    const double time_multiplier,
+    bool decode_thread)
+    : timeMultiplier(time_multiplier),
+      microOpCount(0),
+      decodeThread(decode_thread),
+      batchSize{{0, 0}},
+      batchFull{{false, false}},
+      stopDecode(false),
+      readBatch(0),
+      readPos(0),
+      haveBatch(false),
+      decodeWaits(0)
 {
+    if (PackedTrace::isPackedTrace(filename)) {
+        packed.reset(new PackedTraceReader(filename));
+        const auto &header = packed->header();
+        if (header.kind != PackedTrace::InstDepTrace)
+            fatal("%s is not an elastic instruction trace\n", filename);
+        if (header.tickFreq != SimClock::Frequency)
+            panic("Trace %s was recorded with a different tick frequency "
+                  "%d\n", filename, header.tickFreq);
+        windowSize = header.windowSize;
+        return;
+    }
+
+    trace.reset(new ProtoInputStream(filename));
+
     // Create a protobuf message for the header and read it from the stream
     ProtoMessage::InstDepRecordHeader header_msg;
-    if (!trace.read(header_msg)) {
+    if (!trace->read(header_msg)) {
         panic("Failed to read packet header from %s\n", filename);
 
         if (header_msg.tick_freq() != SimClock::Frequency) {
@@ -1287,17 +1310,127 @@ TraceCPU::ElasticDataGen::InputStream::InputStream(
     }
 }
 
+TraceCPU::ElasticDataGen::InputStream::~InputStream()
+{
+    stopDecoder();
+}
+
 void
 TraceCPU::ElasticDataGen::InputStream::reset()
 {
-    trace.reset();
+    if (packed) {
+        packed->reset();
+        return;
+    }
+    stopDecoder();
+    trace->reset();
+}
+
+void
+TraceCPU::ElasticDataGen::InputStream::stopDecoder()
+{
+    if (decoder.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopDecode = true;
+        }
+        cond.notify_all();
+        decoder.join();
+    }
+
+    stopDecode = false;
+    batchFull = {{false, false}};
+    readBatch = 0;
+    readPos = 0;
+    haveBatch = false;
+}
+
+void
+TraceCPU::ElasticDataGen::InputStream::decodeLoop()
+{
+    unsigned batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]{ return !batchFull[batch] || stopDecode; });
+            if (stopDecode)
+                return;
+        }
+
+        // The replay does not touch a buffer that is not full
+        auto &records = batches[batch];
+        size_t num_read = 0;
+        while (num_read < records.size() && trace->read(records[num_read]))
+            ++num_read;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batchSize[batch] = num_read;
+            batchFull[batch] = true;
+        }
+        cond.notify_all();
+
+        // A buffer that is not filled up holds the end of the trace
+        if (num_read < records.size())
+            return;
+        batch ^= 1;
+    }
+}
+
+const TraceCPU::ElasticDataGen::Record *
+TraceCPU::ElasticDataGen::InputStream::nextRecord()
+{
+    if (!decodeThread)
+        return trace->read(record) ? &record : nullptr;
+
+    if (!decoder.joinable()) {
+        for (auto &records : batches)
+            records.resize(batchRecords);
+        decoder = std::thread(&InputStream::decodeLoop, this);
+    }
+
+    if (haveBatch && readPos < batchSize[readBatch])
+        return &batches[readBatch][readPos++];
+
+    if (haveBatch) {
+        // After the last buffer there is nothing left to wait for
+        if (batchSize[readBatch] < batchRecords)
+            return nullptr;
+
+        // Hand the buffer back to the decoder and move to the other one
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batchFull[readBatch] = false;
+        }
+        cond.notify_all();
+        readBatch ^= 1;
+        haveBatch = false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!batchFull[readBatch]) {
+            ++decodeWaits;
+            cond.wait(lock, [&]{ return batchFull[readBatch]; });
+        }
+    }
+    haveBatch = true;
+    readPos = 0;
+
+    if (readPos < batchSize[readBatch])
+        return &batches[readBatch][readPos++];
+    return nullptr;
 }
 
 bool
 TraceCPU::ElasticDataGen::InputStream::read(GraphNode* element)
 {
-    ProtoMessage::InstDepRecord pkt_msg;
-    if (trace.read(pkt_msg)) {
+    if (packed)
+        return readPacked(element);
+
+    const Record *rec = nextRecord();
+    if (rec) {
+        const Record &pkt_msg = *rec;
         // Required fields
         element->seqNum = pkt_msg.seq_num();
         element->type = pkt_msg.type();
@@ -1373,6 +1506,55 @@ TraceCPU::ElasticDataGen::InputStream::read(GraphNode* element)
     return false;
 }
 
+bool
+TraceCPU::ElasticDataGen::InputStream::readPacked(GraphNode* element)
+{
+    PackedTrace::InstDep rec;
+    if (!packed->read(rec))
+        return false;
+
+    element->seqNum = rec.seqNum;
+    element->type = RecordType(rec.type);
+    // Scale the compute delay to effectively scale the Trace CPU frequency
+    element->compDelay = rec.compDelay * timeMultiplier;
+
+    element->clearRobDep();
+    assert(rec.numRobDep <= element->maxRobDep);
+    for (int i = 0; i < rec.numRobDep; i++) {
+        element->robDep[element->numRobDep] = rec.deps[i];
+        element->numRobDep += 1;
+    }
+
+    // Register dependencies that are also order dependencies are omitted,
+    // as when reading the protobuf trace
+    element->clearRegDep();
+    assert(rec.numRegDep <= TheISA::MaxInstSrcRegs);
+    const uint64_t *reg_deps = rec.deps + rec.numRobDep;
+    for (int i = 0; i < rec.numRegDep; i++) {
+        bool duplicate = false;
+        for (int j = 0; j < element->numRobDep; j++) {
+            duplicate |= (reg_deps[i] == element->robDep[j]);
+        }
+        if (!duplicate) {
+            element->regDep[element->numRegDep] = reg_deps[i];
+            element->numRegDep += 1;
+        }
+    }
+
+    // Optional fields that are not set are stored as zero
+    element->physAddr = rec.pAddr;
+    element->virtAddr = rec.vAddr;
+    element->asid = rec.asid;
+    element->size = rec.size;
+    element->flags = rec.flags;
+    element->pc = rec.pc;
+
+    // ROB occupancy number
+    microOpCount += 1 + rec.weight;
+    element->robNum = microOpCount;
+    return true;
+}
+
 bool
 TraceCPU::ElasticDataGen::GraphNode::removeRegDep(NodeSeqNum reg_dep)
 {
@@ -1480,11 +1662,23 @@ TraceCPU::ElasticDataGen::GraphNode::typeToStr() const
 }
 
 TraceCPU::FixedRetryGen::InputStream::InputStream(const std::string& filename)
-    : trace(filename)
 {
+    if (PackedTrace::isPackedTrace(filename)) {
+        packed.reset(new PackedTraceReader(filename));
+        const auto &header = packed->header();
+        if (header.kind != PackedTrace::PacketTrace)
+            fatal("%s is not a packet trace\n", filename);
+        if (header.tickFreq != SimClock::Frequency)
+            panic("Trace %s was recorded with a different tick frequency "
+                  "%d\n", filename, header.tickFreq);
+        return;
+    }
+
+    trace.reset(new ProtoInputStream(filename));
+
     // Create a protobuf message for the header and read it from the stream
     ProtoMessage::PacketHeader header_msg;
-    if (!trace.read(header_msg)) {
+    if (!trace->read(header_msg)) {
         panic("Failed to read packet header from %s\n", filename);
 
         if (header_msg.tick_freq() != SimClock::Frequency) {
@@ -1497,14 +1691,30 @@ TraceCPU::FixedRetryGen::InputStream::InputStream(const std::string& filename)
 void
 TraceCPU::FixedRetryGen::InputStream::reset()
 {
-    trace.reset();
+    if (packed)
+        packed->reset();
+    else
+        trace->reset();
 }
 
 bool
 TraceCPU::FixedRetryGen::InputStream::read(TraceElement* element)
 {
+    if (packed) {
+        PackedTrace::Packet pkt;
+        if (!packed->read(pkt))
+            return false;
+        element->cmd = pkt.cmd;
+        element->addr = pkt.addr;
+        element->blocksize = pkt.size;
+        element->tick = pkt.tick;
+        element->flags = pkt.flags;
+        element->pc = pkt.pc;
+        return true;
+    }
+
     ProtoMessage::Packet pkt_msg;
-    if (trace.read(pkt_msg)) {
+    if (trace->read(pkt_msg)) {
         element->cmd = pkt_msg.cmd();
         element->addr = pkt_msg.addr();
         element->blocksize = pkt_msg.size();
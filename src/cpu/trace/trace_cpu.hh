@@ -43,9 +43,15 @@
 #define __CPU_TRACE_TRACE_CPU_HH__
 
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
+#include <thread>
 #include <unordered_map>
 
 #include "arch/registers.hh"
@@ -55,6 +61,7 @@
 #include "debug/TraceCPUInst.hh"
 #include "params/TraceCPU.hh"
 #include "proto/inst_dep_record.pb.h"
+#include "proto/packed_trace.hh"
 #include "proto/packet.pb.h"
 #include "proto/protoio.hh"
 #include "sim/sim_events.hh"
@@ -74,7 +81,7 @@
  * timing from the trace and without performing real execution of micro-ops. As
  * soon as the last dependency for an instruction is complete, its
  * computational delay, also provided in the input trace is added. The
- * dependency-free nodes are maintained in a list, called 'ReadyList', ordered
+ * dependency-free nodes are maintained in a heap, called 'ReadyList', ordered
  * by ready time. Instructions which depend on load stall until the responses
  * for read requests are received thus achieving elastic replay. If the
  * dependency is not found when adding a new node, it is assumed complete.
@@ -136,9 +143,15 @@
  * Strictly-ordered requests are skipped and the dependencies on such requests
  * are handled by simply marking them complete immediately.
  *
- * A CountedExitEvent that contains a static int belonging to the Trace CPU
- * class as a down counter is used to implement multi Trace CPU simulation
- * exit.
+ * The graph nodes are recycled through a pool sized by the trace window, so
+ * that replaying long traces does not allocate a node per instruction. The
+ * protobuf records are parsed ahead on a host thread into two buffers, one
+ * being replayed while the other is filled.
+ *
+ * A static atomic counter belonging to the Trace CPU class is counted down
+ * by each Trace CPU completing its execution to implement multi Trace CPU
+ * simulation exit. Trace CPUs may therefore be placed on separate event
+ * queues and replay in parallel.
  */
 
 class TraceCPU : public BaseCPU
@@ -396,7 +409,10 @@ class TraceCPU : public BaseCPU
           private:
 
             // Input file stream for the protobuf trace
-            ProtoInputStream trace;
+            std::unique_ptr<ProtoInputStream> trace;
+
+            // Reader used instead if the trace is a packed trace
+            std::unique_ptr<PackedTraceReader> packed;
 
           public:
 
@@ -689,6 +705,17 @@ class TraceCPU : public BaseCPU
 
             /** The tick at which the ready node must be executed */
             Tick execTick;
+
+            /**
+             * Order of the readyList heap, which has the node with the
+             * earliest execute tick on top, the oldest one among equals.
+             */
+            bool
+            operator<(const ReadyNode &other) const
+            {
+                return execTick > other.execTick ||
+                    (execTick == other.execTick && seqNum > other.seqNum);
+            }
         };
 
         /**
@@ -798,7 +825,14 @@ class TraceCPU : public BaseCPU
           private:
 
             /** Input file stream for the protobuf trace */
-            ProtoInputStream trace;
+            std::unique_ptr<ProtoInputStream> trace;
+
+            /**
+             * Reader used instead if the trace is a packed trace. Its
+             * records are decoded a batch at a time, so the decoder
+             * thread is not used.
+             */
+            std::unique_ptr<PackedTraceReader> packed;
 
             /**
              * A multiplier for the compute delays in the trace to modulate
@@ -816,6 +850,58 @@ class TraceCPU : public BaseCPU
              * trace and used to process the dependency trace
              */
             uint32_t windowSize;
+
+            /** Parse the trace on a separate host thread */
+            const bool decodeThread;
+
+            /** Records parsed ahead by the decoder in each buffer */
+            static const size_t batchRecords = 4096;
+
+            /** Thread parsing the trace into the buffers */
+            std::thread decoder;
+
+            /** Protects the buffer states shared with the decoder */
+            std::mutex mutex;
+            std::condition_variable cond;
+
+            /**
+             * Two buffers of parsed records. The decoder fills a buffer and
+             * marks it full, the replay takes the records from it and hands
+             * it back once it is done with all of them.
+             */
+            std::array<std::vector<Record>, 2> batches;
+            std::array<size_t, 2> batchSize;
+            std::array<bool, 2> batchFull;
+
+            /** Set to make the decoder return */
+            bool stopDecode;
+
+            /** Buffer being replayed and position of the next record in it */
+            unsigned readBatch;
+            size_t readPos;
+            bool haveBatch;
+
+            /** Number of times the replay waited for the decoder */
+            uint64_t decodeWaits;
+
+            /** Record read when the trace is parsed in the replay thread */
+            Record record;
+
+            /** Main loop of the decoder thread */
+            void decodeLoop();
+
+            /** Read the next element of a packed trace */
+            bool readPacked(GraphNode* element);
+
+            /** Stop the decoder and drop the records it parsed ahead */
+            void stopDecoder();
+
+            /**
+             * Get the next record of the trace, starting the decoder if
+             * needed. Returns nullptr at the end of the trace.
+             */
+            const Record *nextRecord();
+
           public:
 
             /**
@@ -825,7 +911,10 @@ class TraceCPU : public BaseCPU
              * @param time_multiplier used to scale the compute delays
              */
             InputStream(const std::string& filename,
-                        const double time_multiplier);
+                        const double time_multiplier,
+                        bool decode_thread);
+
+            ~InputStream();
 
             /**
              * Reset the stream such that it can be played once
@@ -849,6 +938,9 @@ class TraceCPU : public BaseCPU
 
             /** Get number of micro-ops modelled in the TraceCPU replay */
             uint64_t getMicroOpCount() const { return microOpCount; }
+
+            /** Get number of times the replay waited for the decoder */
+            uint64_t getDecodeWaits() const { return decodeWaits; }
         };
 
         public:
@@ -859,7 +951,8 @@ class TraceCPU : public BaseCPU
             : owner(_owner),
               port(_port),
               masterID(master_id),
-              trace(trace_file, 1.0 / params->freqMultiplier),
+              trace(trace_file, 1.0 / params->freqMultiplier,
+                    params->decodeThread),
               genName(owner.name() + ".elastic" + _name),
               retryPkt(nullptr),
               traceComplete(false),
@@ -942,8 +1035,8 @@ class TraceCPU : public BaseCPU
         PacketPtr executeMemReq(GraphNode* node_ptr);
 
         /**
-         * Add a ready node to the readyList. When inserting, ensure the nodes
-         * are sorted in ascending order of their execute ticks.
+         * Add a ready node to the readyList. The readyList is a heap that
+         * keeps the node with the earliest execute tick on top.
          *
          * @param seq_num seq. num of ready node
          * @param exec_tick the execute tick of the ready node
@@ -953,6 +1046,26 @@ class TraceCPU : public BaseCPU
         /** Print readyList for debugging using debug flag TraceCPUData. */
         void printReadyList();
 
+        /**
+         * The next node to execute, which is the node waiting for a retry
+         * if there is one, and the top of the readyList otherwise.
+         */
+        const ReadyNode &nextReadyNode() const
+        { return retryPkt ? retryNode : readyList.front(); }
+
+        /** True if no node is ready to execute */
+        bool readyListEmpty() const { return !retryPkt && readyList.empty(); }
+
+        /** Number of nodes ready to execute */
+        size_t readyListSize() const
+        { return readyList.size() + (retryPkt ? 1 : 0); }
+
+        /** Take a node from the pool, allocating more if it is empty */
+        GraphNode *allocNode();
+
+        /** Return a node that has completed to the pool */
+        void freeNode(GraphNode *node);
+
         /**
          * When a load writeback is received, that is when the load completes,
          * release the dependents on it. This is called from the dcache port
@@ -1034,6 +1147,15 @@ class TraceCPU : public BaseCPU
         /** Store the depGraph of GraphNodes */
         std::unordered_map<NodeSeqNum, GraphNode*> depGraph;
 
+        /**
+         * Storage for the GraphNodes. It only grows when more nodes are in
+         * flight than ever before, which the trace window bounds.
+         */
+        std::deque<GraphNode> nodePool;
+
+        /** Nodes of the pool not in the depGraph */
+        std::vector<GraphNode *> freeNodes;
+
         /**
          * Queue of dependency-free nodes that are pending issue because
          * resources are not available. This is chosen to be FIFO so that
@@ -1043,8 +1165,14 @@ class TraceCPU : public BaseCPU
          */
         std::queue<const GraphNode*> depFreeQueue;
 
-        /** List of nodes that are ready to execute */
-        std::list<ReadyNode> readyList;
+        /** Heap of nodes that are ready to execute */
+        std::vector<ReadyNode> readyList;
+
+        /**
+         * The node whose request is waiting for a retry, taken off the
+         * readyList so that it stays first. Valid if retryPkt is set.
+         */
+        ReadyNode retryNode;
 
         /** Stats for data memory accesses replayed. */
         Stats::Scalar maxDependents;
@@ -1058,6 +1186,8 @@ class TraceCPU : public BaseCPU
         Stats::Scalar numSOStores;
         /** Tick when ElasticDataGen completes execution */
         Stats::Scalar dataLastTick;
+        /** Times the replay waited for the trace decoder */
+        Stats::Value numDecodeWaits;
     };
 
     /** Instance of FixedRetryGen to replay instruction read requests. */
@@ -1102,19 +1232,22 @@ class TraceCPU : public BaseCPU
     Tick traceOffset;
 
     /**
-     * Number of Trace CPUs in the system used as a shared variable and passed
-     * to the CountedExitEvent event used for counting down exit events.  It is
-     * incremented in the constructor call so that the total is arrived at
-     * automatically.
+     * Number of Trace CPUs in the system that have not completed their
+     * execution, shared between Trace CPUs that may run on different event
+     * queues. It is incremented in the constructor call so that the total is
+     * arrived at automatically.
      */
-    static int numTraceCPUs;
-
-   /**
-    * A CountedExitEvent which when serviced decrements the counter. A sim
-    * exit event is scheduled when the counter equals zero, that is all
-    * instances of Trace CPU have had their execCompleteEvent serviced.
-    */
-    CountedExitEvent *execCompleteEvent;
+    static std::atomic<int> numTraceCPUs;
+
+    /**
+     * Decrements the counter when serviced. A sim exit event is scheduled
+     * when the counter equals zero, that is all instances of Trace CPU have
+     * had their execCompleteEvent serviced.
+     */
+    void countDownExit();
+
+    /** Event for countDownExit() */
+    EventFunctionWrapper execCompleteEvent;
 
     /**
      * Exit when any one Trace CPU completes its execution. If this is
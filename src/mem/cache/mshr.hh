@@ -289,6 +289,13 @@ class MSHR : public QueueEntry, public Printable
 
     void clearDownstreamPending();
 
+    /**
+     * Mark the request of this MSHR as not yet ordered below, e.g. by
+     * a bridge to another event queue, so that snoops are treated as
+     * preceding it until clearDownstreamPending() is called.
+     */
+    void setDownstreamPending() { downstreamPending = true; }
+
     /**
      * Mark this MSHR as free.
      */
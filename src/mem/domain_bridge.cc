@@ -0,0 +1,978 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Implementation of a bridge that connects two parts of the memory
+ * system serviced by different event queues.
+ */
+
+#include "mem/domain_bridge.hh"
+
+#include <algorithm>
+
+#include "base/trace.hh"
+#include "config/the_isa.hh"
+#include "debug/DomainBridge.hh"
+#include "mem/cache/mshr.hh"
+#include "params/DomainBridge.hh"
+#include "sim/global_event.hh"
+#include "sim/system.hh"
+
+void
+DomainBridge::Mailbox::push(const DeferredPacket &p)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    buffer[GlobalSyncEvent::quantumCount() & 1].push_back(p);
+}
+
+void
+DomainBridge::Mailbox::collect(std::vector<DeferredPacket> &list)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    list.clear();
+    std::swap(list, buffer[(GlobalSyncEvent::quantumCount() - 1) & 1]);
+}
+
+bool
+DomainBridge::Mailbox::checkFunctional(PacketPtr pkt)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto &packets : buffer) {
+        for (const auto &p : packets) {
+            if (p.pkt && pkt->checkFunctional(p.pkt)) {
+                pkt->makeResponse();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+DomainBridge::DomainSlavePort::DomainSlavePort(const std::string& _name,
+                                               DomainBridge& _bridge,
+                                               DomainMasterPort& _masterPort,
+                                               int _req_limit,
+                                               int _resp_limit)
+    : SlavePort(_name, &_bridge), bridge(_bridge), masterPort(_masterPort),
+      reqCredits(_req_limit), outstandingResponses(0), retryReq(false),
+      respQueueLimit(_resp_limit),
+      sendEvent([this]{ trySendTiming(); }, _name),
+      // the crossbar sent snoops and took requests before any response
+      // due at the same time, so they go first on this side as well
+      snoopEvent([this]{ sendSnoops(); }, _name + ".snoop", false,
+                 Event::Default_Pri - 1)
+{
+}
+
+DomainBridge::DomainMasterPort::DomainMasterPort(const std::string& _name,
+                                                 DomainBridge& _bridge,
+                                                 DomainSlavePort& _slavePort,
+                                                 unsigned _blk_size)
+    : MasterPort(_name, &_bridge), bridge(_bridge), slavePort(_slavePort),
+      blkSize(_blk_size),
+      sendEvent([this]{ trySendTiming(); }, _name),
+      snoopRespEvent([this]{ trySendSnoopResp(); }, _name + ".snoopResp")
+{
+}
+
+DomainBridge::DomainBridge(Params *p)
+    : MemObject(p),
+      slavePort(p->name + ".slave", *this, masterPort, p->req_size,
+                p->resp_size),
+      masterPort(p->name + ".master", *this, slavePort,
+                 p->system->cacheLineSize()),
+      delay(p->delay),
+      memSide(getEventQueue(p->mem_side_eventq_index)),
+      crossing(p->eventq_index != p->mem_side_eventq_index),
+      toMemCallback(this), toCpuCallback(this), inFlight(0)
+{
+    if (crossing) {
+        GlobalSyncEvent::registerQuantumCallback(memSide.eventQueue(),
+                                                 &toMemCallback);
+        GlobalSyncEvent::registerQuantumCallback(eventQueue(),
+                                                 &toCpuCallback);
+    }
+}
+
+BaseMasterPort&
+DomainBridge::getMasterPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "master")
+        return masterPort;
+    else
+        // pass it along to our super class
+        return MemObject::getMasterPort(if_name, idx);
+}
+
+BaseSlavePort&
+DomainBridge::getSlavePort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "slave")
+        return slavePort;
+    else
+        // pass it along to our super class
+        return MemObject::getSlavePort(if_name, idx);
+}
+
+void
+DomainBridge::init()
+{
+    if (!slavePort.isConnected() || !masterPort.isConnected())
+        fatal("Both ports of a domain bridge must be connected.\n");
+
+    // a packet sent during a quantum must not be due before the
+    // barrier that hands it over
+    if (crossing && delay < simQuantum)
+        fatal("%s: delay (%d) must be at least the simulation quantum "
+              "(%d).\n", name(), delay, simQuantum);
+
+#if THE_ISA != X86_ISA
+    // the decoders of the other ISAs share a decode cache between all
+    // cores, which the threads of the cores would race on
+    fatal_if(crossing, "%s: cores on their own event queues are only "
+             "supported on x86.\n", name());
+#endif
+}
+
+void
+DomainBridge::regStats()
+{
+    MemObject::regStats();
+
+    deferredSnoops
+        .name(name() + ".deferredSnoops")
+        .desc("Snoops copied across to the slave side")
+        ;
+
+    promisedSnoops
+        .name(name() + ".promisedSnoops")
+        .desc("Snoops responded to on behalf of the caches above")
+        ;
+
+    droppedEvictions
+        .name(name() + ".droppedEvictions")
+        .desc("Evictions of blocks a snoop took away before they were "
+              "sent")
+        ;
+
+    creditStalls
+        .name(name() + ".creditStalls")
+        .desc("Requests refused for lack of request credits")
+        ;
+
+    lateDeliveries
+        .name(name() + ".lateDeliveries")
+        .desc("Packets that crossed the bridge after they were due")
+        ;
+}
+
+DrainState
+DomainBridge::drain()
+{
+    return inFlight == 0 ? DrainState::Drained : DrainState::Draining;
+}
+
+void
+DomainBridge::packetLeft()
+{
+    assert(inFlight != 0);
+    if (--inFlight == 0 && drainState() == DrainState::Draining) {
+        std::lock_guard<std::mutex> guard(drainLock);
+        signalDrainDone();
+    }
+}
+
+void
+DomainBridge::sendToMem(const DeferredPacket &p)
+{
+    if (crossing)
+        toMem.push(p);
+    else
+        masterPort.receive(p);
+}
+
+void
+DomainBridge::sendToCpu(const DeferredPacket &p)
+{
+    if (crossing)
+        toCpu.push(p);
+    else
+        slavePort.receive(p);
+}
+
+void
+DomainBridge::collectToMem()
+{
+    std::vector<DeferredPacket> list;
+    toMem.collect(list);
+    for (const auto &p : list)
+        masterPort.receive(p);
+}
+
+void
+DomainBridge::collectToCpu()
+{
+    std::vector<DeferredPacket> list;
+    toCpu.collect(list);
+    for (const auto &p : list)
+        slavePort.receive(p);
+}
+
+bool
+DomainBridge::DomainSlavePort::recvTimingReq(PacketPtr pkt)
+{
+    DPRINTF(DomainBridge, "recvTimingReq: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    panic_if(pkt->cacheResponding(), "Should not see packets where cache "
+             "is responding");
+
+    // we should not get a new request after committing to retry the
+    // current one, but unfortunately the CPU violates this rule, so
+    // simply ignore it for now
+    if (retryReq)
+        return false;
+
+    if (reqCredits == 0) {
+        DPRINTF(DomainBridge, "Out of request credits\n");
+        ++bridge.creditStalls;
+        retryReq = true;
+    } else if (pkt->needsResponse()) {
+        if (outstandingResponses == respQueueLimit) {
+            DPRINTF(DomainBridge, "Response queue full\n");
+            retryReq = true;
+        } else {
+            ++outstandingResponses;
+        }
+    }
+
+    if (!retryReq) {
+        --reqCredits;
+        ++bridge.inFlight;
+
+        if (bridge.crossing && pkt->needsResponse()) {
+            // snoops the crossbar sends before it sees the request
+            // logically come first, so tell the cache above until the
+            // credit of the request returns
+            MSHR *mshr = pkt->findNextSenderState<MSHR>();
+            if (mshr)
+                mshr->setDownstreamPending();
+            pkt->senderState = new CrossingState(pkt->senderState, mshr);
+        }
+
+        // the packet only reaches us after the header delay, and we
+        // also need to deserialise any payload
+        Tick receive_delay = pkt->headerDelay + pkt->payloadDelay;
+        pkt->headerDelay = pkt->payloadDelay = 0;
+
+        bridge.sendToMem(DeferredPacket(pkt, curTick() + bridge.delay +
+                                        receive_delay));
+    }
+
+    return !retryReq;
+}
+
+bool
+DomainBridge::DomainSlavePort::recvTimingSnoopResp(PacketPtr pkt)
+{
+    DPRINTF(DomainBridge, "recvTimingSnoopResp: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    // snoop responses are bounded by the snoops we forwarded, so they
+    // do not need credits
+    ++bridge.inFlight;
+
+    Tick receive_delay = pkt->headerDelay + pkt->payloadDelay;
+    pkt->headerDelay = pkt->payloadDelay = 0;
+
+    // when crossing, the master side has responded already and only
+    // takes the data
+    bridge.sendToMem(DeferredPacket(pkt, curTick() + bridge.delay +
+                                    receive_delay, nullptr,
+                                    bridge.crossing));
+
+    return true;
+}
+
+bool
+DomainBridge::DomainMasterPort::recvTimingResp(PacketPtr pkt)
+{
+    // space was reserved when the request was accepted on the slave
+    // side
+    DPRINTF(DomainBridge, "recvTimingResp: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    if (bridge.crossing) {
+        auto *state = dynamic_cast<CrossingState *>(pkt->senderState);
+        assert(state);
+        pkt->senderState = state->aboveState;
+        delete state;
+
+        if (!pkt->req->isUncacheable()) {
+            auto it = blocks.find(pkt->getBlockAddr(blkSize));
+            if (it != blocks.end() && it->second.filling) {
+                // a cache waiting for a block downgrades it when
+                // snooped, but the caches above never saw the snoop
+                if (it->second.snooped)
+                    pkt->setHasSharers();
+                else if (!pkt->hasSharers())
+                    it->second.state = BlockState::Writable;
+                it->second.filling = it->second.snooped = false;
+            }
+        }
+    }
+
+    ++bridge.inFlight;
+
+    Tick receive_delay = pkt->headerDelay + pkt->payloadDelay;
+    pkt->headerDelay = pkt->payloadDelay = 0;
+
+    bridge.sendToCpu(DeferredPacket(pkt, curTick() + bridge.delay +
+                                    receive_delay));
+
+    return true;
+}
+
+void
+DomainBridge::DomainSlavePort::receive(const DeferredPacket &p)
+{
+    if (!p.pkt && !bridge.crossing) {
+        returnCredit(p.mshr);
+        bridge.packetLeft();
+        return;
+    }
+
+    DeferredPacket deferred = p;
+    if (deferred.tick < curTick()) {
+        ++bridge.lateDeliveries;
+        deferred.tick = curTick();
+    }
+
+    if (!deferred.pkt || deferred.pkt->isRequest()) {
+        if (snoopList.empty())
+            bridge.schedule(snoopEvent, deferred.tick);
+        snoopList.push_back(deferred);
+        return;
+    }
+
+    if (transmitList.empty())
+        bridge.schedule(sendEvent, deferred.tick);
+
+    transmitList.push_back(deferred);
+}
+
+void
+DomainBridge::DomainMasterPort::receive(const DeferredPacket &p)
+{
+    Tick when = p.tick;
+    if (when < curTick()) {
+        ++bridge.lateDeliveries;
+        when = curTick();
+    }
+
+    if (p.promised) {
+        completeFromAbove(p.pkt, when);
+        return;
+    }
+
+    if (p.pkt->isResponse()) {
+        queueSnoopResp(p.pkt, when);
+        return;
+    }
+
+    if (bridge.crossing && p.pkt->isEviction())
+        completeFromEviction(p.pkt, when);
+
+    if (transmitList.empty())
+        bridge.memSide.schedule(sendEvent, when);
+
+    transmitList.emplace_back(p.pkt, when);
+}
+
+void
+DomainBridge::DomainMasterPort::queueSnoopResp(PacketPtr pkt, Tick when)
+{
+    if (snoopRespList.empty())
+        bridge.memSide.schedule(snoopRespEvent, when);
+
+    snoopRespList.emplace_back(pkt, when);
+}
+
+void
+DomainBridge::DomainMasterPort::trySendTiming()
+{
+    assert(!transmitList.empty());
+
+    DeferredPacket req = transmitList.front();
+
+    assert(req.tick <= curTick());
+
+    // an eviction dropped by a snoop leaves nothing to send
+    bool sent = !req.pkt;
+    MSHR *mshr = nullptr;
+
+    if (req.pkt) {
+        PacketPtr pkt = req.pkt;
+        Addr blk_addr = pkt->getBlockAddr(blkSize);
+
+        DPRINTF(DomainBridge, "trySend request addr 0x%x, queue size %d\n",
+                pkt->getAddr(), transmitList.size());
+
+        if (bridge.crossing) {
+            if (pkt->needsResponse()) {
+                auto *state = dynamic_cast<CrossingState *>(
+                    pkt->senderState);
+                assert(state);
+                mshr = state->mshr;
+            }
+
+            if (!pkt->req->isUncacheable() && !blocks.count(blk_addr)) {
+                if (pkt->isEviction()) {
+                    // an invalidation took the block after it was
+                    // evicted above, and the crossbar no longer
+                    // expects it from us
+                    DPRINTF(DomainBridge, "Dropping %s addr 0x%x\n",
+                            pkt->cmdString(), pkt->getAddr());
+                    ++bridge.droppedEvictions;
+                    delete pkt;
+                    sent = true;
+                } else if (pkt->isUpgrade()) {
+                    // the block was invalidated after the upgrade was
+                    // sent above, so the data is needed as well, as
+                    // MSHR::replaceUpgrade does in a cache below
+                    pkt->cmd = pkt->cmd == MemCmd::SCUpgradeReq ?
+                        MemCmd::SCUpgradeFailReq : MemCmd::ReadExReq;
+                }
+            }
+        }
+
+        if (!sent) {
+            // the crossbar may sink the request before returning
+            MemCmd cmd = pkt->cmd;
+            bool uncacheable = pkt->req->isUncacheable();
+
+            sent = sendTimingReq(pkt);
+            if (sent && bridge.crossing)
+                requestSent(cmd, blk_addr, uncacheable);
+        }
+    }
+
+    if (sent) {
+        transmitList.pop_front();
+
+        if (!transmitList.empty()) {
+            bridge.memSide.schedule(sendEvent,
+                std::max(transmitList.front().tick, curTick()));
+        }
+
+        // return the credit before accounting for the request, so a
+        // drain does not complete with the credit still crossing
+        ++bridge.inFlight;
+        bridge.sendToCpu(DeferredPacket(nullptr, bridge.crossing ?
+                                        curTick() + bridge.delay :
+                                        curTick(), mshr));
+        bridge.packetLeft();
+    }
+
+    // if the send failed, then we try again once we receive a retry,
+    // and therefore there is no need to take any action
+}
+
+void
+DomainBridge::DomainMasterPort::requestSent(MemCmd cmd, Addr blk_addr,
+                                            bool uncacheable)
+{
+    // only caches keep copies of the blocks they ask for
+    if (uncacheable || !cmd.fromCache())
+        return;
+
+    if (cmd.isEviction()) {
+        blocks.erase(blk_addr);
+    } else if (cmd.needsWritable()) {
+        blocks[blk_addr] = { BlockState::Writable, true, false };
+    } else if (cmd.isRead() && cmd.needsResponse()) {
+        auto it = blocks.find(blk_addr);
+        if (it == blocks.end())
+            blocks[blk_addr] = { BlockState::Shared, true, false };
+        else
+            it->second.filling = true;
+    }
+}
+
+void
+DomainBridge::DomainMasterPort::trySendSnoopResp()
+{
+    assert(!snoopRespList.empty());
+
+    DeferredPacket resp = snoopRespList.front();
+
+    assert(resp.tick <= curTick());
+
+    if (sendTimingSnoopResp(resp.pkt)) {
+        snoopRespList.pop_front();
+        bridge.packetLeft();
+
+        if (!snoopRespList.empty()) {
+            bridge.memSide.schedule(snoopRespEvent,
+                std::max(snoopRespList.front().tick, curTick()));
+        }
+    }
+}
+
+void
+DomainBridge::DomainSlavePort::trySendTiming()
+{
+    assert(!transmitList.empty());
+
+    DeferredPacket resp = transmitList.front();
+
+    assert(resp.tick <= curTick());
+
+    DPRINTF(DomainBridge, "trySend response addr 0x%x, outstanding %d\n",
+            resp.pkt->getAddr(), outstandingResponses);
+
+    if (sendTimingResp(resp.pkt)) {
+        transmitList.pop_front();
+
+        assert(outstandingResponses != 0);
+        --outstandingResponses;
+        bridge.packetLeft();
+
+        if (!transmitList.empty()) {
+            bridge.schedule(sendEvent,
+                            std::max(transmitList.front().tick, curTick()));
+        }
+
+        // if we have credits and were stalling a request, it will
+        // definitely be possible to accept it now since there is
+        // guaranteed space in the response queue
+        if (reqCredits != 0 && retryReq) {
+            DPRINTF(DomainBridge, "Request waiting for retry, now "
+                    "retrying\n");
+            retryReq = false;
+            sendRetryReq();
+        }
+    }
+}
+
+void
+DomainBridge::DomainSlavePort::returnCredit(MSHR *mshr)
+{
+    // the request has reached the crossbar, so snoops from now on
+    // follow it
+    if (mshr)
+        mshr->clearDownstreamPending();
+
+    // and there is room for another one
+    ++reqCredits;
+
+    if (retryReq && (outstandingResponses != respQueueLimit)) {
+        DPRINTF(DomainBridge, "Request waiting for retry, now "
+                "retrying\n");
+        retryReq = false;
+        sendRetryReq();
+    }
+}
+
+void
+DomainBridge::DomainSlavePort::sendSnoops()
+{
+    while (!snoopList.empty() && snoopList.front().tick <= curTick()) {
+        DeferredPacket p = snoopList.front();
+        snoopList.pop_front();
+
+        if (p.pkt)
+            sendSnoop(p);
+        else
+            returnCredit(p.mshr);
+
+        bridge.packetLeft();
+    }
+
+    if (!snoopList.empty())
+        bridge.schedule(snoopEvent, snoopList.front().tick);
+}
+
+void
+DomainBridge::DomainSlavePort::sendSnoop(const DeferredPacket &snoop)
+{
+    PacketPtr pkt = snoop.pkt;
+
+    DPRINTF(DomainBridge, "sendSnoop: %s addr 0x%x%s\n",
+            pkt->cmdString(), pkt->getAddr(),
+            snoop.promised ? " (promised)" : "");
+
+    // a cache above only responds to a snoop if it holds the block
+    // dirty, so read the block first in case it is clean by now
+    PacketPtr data = nullptr;
+    if (snoop.promised && pkt->isRead()) {
+        data = new Packet(pkt->req, MemCmd::ReadReq);
+        data->allocate();
+        sendFunctionalSnoop(data);
+    }
+
+    sendTimingSnoopReq(pkt);
+
+    if (pkt->cacheResponding()) {
+        // the response of the cache carries the data across
+        panic_if(!snoop.promised, "%s: a cache above responded to a "
+                 "snoop the bridge did not respond to\n", name());
+        delete data;
+        delete pkt;
+        return;
+    }
+
+    if (!snoop.promised) {
+        delete data;
+        delete pkt->req;
+        delete pkt;
+        return;
+    }
+
+    // answer with the block read above, or with the snoop itself if
+    // the snoop needs no data or the block is on its way down
+    PacketPtr answer = pkt;
+    if (data && data->isResponse()) {
+        answer = data;
+        delete pkt;
+    } else {
+        delete data;
+    }
+
+    ++bridge.inFlight;
+    bridge.sendToMem(DeferredPacket(answer, curTick() + bridge.delay,
+                                    nullptr, true));
+}
+
+void
+DomainBridge::DomainMasterPort::recvReqRetry()
+{
+    trySendTiming();
+}
+
+void
+DomainBridge::DomainMasterPort::recvRetrySnoopResp()
+{
+    trySendSnoopResp();
+}
+
+void
+DomainBridge::DomainSlavePort::recvRespRetry()
+{
+    trySendTiming();
+}
+
+void
+DomainBridge::DomainMasterPort::recvTimingSnoopReq(PacketPtr pkt)
+{
+    DPRINTF(DomainBridge, "recvTimingSnoopReq: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    if (!bridge.crossing) {
+        slavePort.sendTimingSnoopReq(pkt);
+        return;
+    }
+
+    snoopCrossing(pkt);
+}
+
+std::deque<DomainBridge::DeferredPacket>::iterator
+DomainBridge::DomainMasterPort::findEviction(Addr blk_addr)
+{
+    return std::find_if(transmitList.begin(), transmitList.end(),
+                        [this, blk_addr](const DeferredPacket &p) {
+                            return p.pkt && p.pkt->isEviction() &&
+                                p.pkt->getBlockAddr(blkSize) == blk_addr;
+                        });
+}
+
+void
+DomainBridge::DomainMasterPort::snoopCrossing(PacketPtr pkt)
+{
+    panic_if(pkt->isClean() || pkt->req->isCacheMaintenance(),
+             "%s: cache maintenance cannot cross event queues\n", name());
+
+    Addr blk_addr = pkt->getBlockAddr(blkSize);
+    auto blk = blocks.find(blk_addr);
+    bool held = blk != blocks.end();
+
+    // requests from below checking whether a block is cached above
+    if (pkt->mustCheckAbove()) {
+        if (held)
+            pkt->setBlockCached();
+        return;
+    }
+
+    bool invalidate = pkt->isInvalidate();
+    bool needs_response = pkt->needsResponse();
+    PacketPtr promise = nullptr;
+
+    auto wb = findEviction(blk_addr);
+    if (held && wb != transmitList.end()) {
+        // the block has left the caches above, and its eviction waits
+        // here, as in the write buffer of a cache
+        PacketPtr wb_pkt = wb->pkt;
+
+        if (!pkt->req->isUncacheable() && pkt->isRead() && !invalidate) {
+            pkt->setHasSharers();
+            wb_pkt->setHasSharers();
+        }
+
+        if (wb_pkt->cmd == MemCmd::WritebackDirty && needs_response) {
+            pkt->setCacheResponding();
+            if (!wb_pkt->hasSharers())
+                pkt->setResponderHadWritable();
+
+            PacketPtr resp = new Packet(pkt, false, true);
+            resp->makeTimingResponse();
+            if (resp->isRead())
+                resp->setDataFromBlock(wb_pkt->getConstPtr<uint8_t>(),
+                                       blkSize);
+            ++bridge.inFlight;
+            queueSnoopResp(resp, curTick());
+        }
+
+        if (invalidate) {
+            // the crossbar no longer expects the eviction
+            ++bridge.droppedEvictions;
+            delete wb_pkt;
+            wb->pkt = nullptr;
+            blocks.erase(blk);
+        }
+    } else if (held) {
+        bool writable = blk->second.state == BlockState::Writable;
+        bool dirty = blk->second.state != BlockState::Shared;
+
+        if (pkt->isRead() && !invalidate)
+            pkt->setHasSharers();
+
+        if (dirty && needs_response) {
+            // the caches above may hold the only valid copy, so we
+            // respond, and send the data when they have answered
+            pkt->setCacheResponding();
+            if (writable)
+                pkt->setResponderHadWritable();
+
+            promise = new Packet(pkt, false, true);
+            promise->makeTimingResponse();
+            ++bridge.promisedSnoops;
+            ++bridge.inFlight;
+        }
+
+        // the state changes as the crossbar orders the snoop
+        if (invalidate) {
+            blocks.erase(blk);
+        } else if (!pkt->req->isUncacheable() && pkt->isRead()) {
+            if (writable) {
+                blk->second.state = BlockState::Owned;
+                blk->second.filling = false;
+            } else if (blk->second.filling) {
+                blk->second.snooped = true;
+            }
+        }
+    }
+
+    // a core also checks its load/store queue against invalidations,
+    // so those cross even if nothing above holds the block
+    if (!invalidate && !promise)
+        return;
+
+    ++bridge.deferredSnoops;
+    ++bridge.inFlight;
+
+    Request *req = new Request(pkt->getAddr(), pkt->getSize(),
+                               pkt->req->getFlags(), pkt->req->masterId());
+    if (pkt->req->hasContextId())
+        req->setContext(pkt->req->contextId());
+    PacketPtr snoop = new Packet(req, pkt->cmd);
+    snoop->setExpressSnoop();
+
+    if (promise)
+        pendingSnoops.push_back({ promise, req, invalidate, false });
+
+    bridge.sendToCpu(DeferredPacket(snoop, curTick() + bridge.delay,
+                                    nullptr, promise != nullptr));
+}
+
+void
+DomainBridge::DomainMasterPort::completeFromEviction(PacketPtr pkt,
+                                                     Tick when)
+{
+    // a clean eviction carries no data, and the answer to the snoop
+    // will say so
+    if (!pkt->hasData())
+        return;
+
+    Addr blk_addr = pkt->getBlockAddr(blkSize);
+    for (auto &snoop : pendingSnoops) {
+        if (snoop.done || snoop.resp->getBlockAddr(blkSize) != blk_addr)
+            continue;
+
+        DPRINTF(DomainBridge, "Completing %s addr 0x%x from %s\n",
+                snoop.resp->cmdString(), snoop.resp->getAddr(),
+                pkt->cmdString());
+
+        if (snoop.resp->isRead())
+            snoop.resp->setDataFromBlock(pkt->getConstPtr<uint8_t>(),
+                                         blkSize);
+        snoop.done = true;
+        queueSnoopResp(snoop.resp, when);
+
+        // the eviction of a block a snoop took away is dropped when
+        // it is due, and a reader got a copy
+        if (!snoop.invalidate)
+            pkt->setHasSharers();
+    }
+}
+
+void
+DomainBridge::DomainMasterPort::completeFromAbove(PacketPtr pkt, Tick when)
+{
+    auto snoop = std::find_if(pendingSnoops.begin(), pendingSnoops.end(),
+                              [pkt](const PendingSnoop &s) {
+                                  return s.req == pkt->req;
+                              });
+    panic_if(snoop == pendingSnoops.end(), "%s: unexpected answer %s\n",
+             name(), pkt->print());
+
+    if (!snoop->done) {
+        if (snoop->resp->isRead()) {
+            panic_if(!pkt->isResponse(), "%s: no data for %s, the caches "
+                     "above must write back clean blocks\n", name(),
+                     snoop->resp->print());
+            snoop->resp->setData(pkt->getConstPtr<uint8_t>());
+        }
+        queueSnoopResp(snoop->resp, when);
+    }
+
+    pendingSnoops.erase(snoop);
+
+    // the answer was made from our copy of the snoop
+    delete pkt->req;
+    delete pkt;
+    bridge.packetLeft();
+}
+
+Tick
+DomainBridge::DomainMasterPort::recvAtomicSnoop(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migration(bridge.eventQueue(),
+                                          bridge.migrate());
+    return bridge.delay + slavePort.sendAtomicSnoop(pkt);
+}
+
+void
+DomainBridge::DomainMasterPort::recvFunctionalSnoop(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migration(bridge.eventQueue(),
+                                          bridge.migrate());
+    slavePort.sendFunctionalSnoop(pkt);
+}
+
+void
+DomainBridge::DomainMasterPort::recvRangeChange()
+{
+    slavePort.sendRangeChange();
+}
+
+Tick
+DomainBridge::DomainSlavePort::recvAtomic(PacketPtr pkt)
+{
+    panic_if(pkt->cacheResponding(), "Should not see packets where cache "
+             "is responding");
+
+    EventQueue::ScopedMigration migration(bridge.memSide.eventQueue(),
+                                          bridge.migrate());
+    return bridge.delay + masterPort.sendAtomic(pkt);
+}
+
+void
+DomainBridge::DomainSlavePort::recvFunctional(PacketPtr pkt)
+{
+    pkt->pushLabel(name());
+
+    // check the responses on our side and everything crossing
+    if (checkFunctional(pkt) || bridge.toCpu.checkFunctional(pkt) ||
+        bridge.toMem.checkFunctional(pkt)) {
+        pkt->popLabel();
+        return;
+    }
+
+    EventQueue::ScopedMigration migration(bridge.memSide.eventQueue(),
+                                          bridge.migrate());
+
+    // also check the requests waiting on the master side
+    if (masterPort.checkFunctional(pkt)) {
+        pkt->popLabel();
+        return;
+    }
+
+    pkt->popLabel();
+
+    // fall through if pkt still not satisfied
+    masterPort.sendFunctional(pkt);
+}
+
+bool
+DomainBridge::DomainSlavePort::checkFunctional(PacketPtr pkt)
+{
+    for (const auto &p : transmitList) {
+        if (pkt->checkFunctional(p.pkt)) {
+            pkt->makeResponse();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+DomainBridge::DomainMasterPort::checkFunctional(PacketPtr pkt)
+{
+    for (const auto *list : { &transmitList, &snoopRespList }) {
+        for (const auto &p : *list) {
+            if (p.pkt && pkt->checkFunctional(p.pkt)) {
+                pkt->makeResponse();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+AddrRangeList
+DomainBridge::DomainSlavePort::getAddrRanges() const
+{
+    return masterPort.getAddrRanges();
+}
+
+DomainBridge *
+DomainBridgeParams::create()
+{
+    return new DomainBridge(this);
+}
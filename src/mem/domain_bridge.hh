@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a bridge that connects two parts of the memory
+ * system serviced by different event queues.
+ */
+
+#ifndef __MEM_DOMAIN_BRIDGE_HH__
+#define __MEM_DOMAIN_BRIDGE_HH__
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "base/callback.hh"
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "mem/mem_object.hh"
+#include "params/DomainBridge.hh"
+
+class MSHR;
+
+/**
+ * A domain bridge connects a master and a slave that run on different
+ * event queues, and thus possibly on different host threads, e.g. the
+ * private L1 caches of a core and the crossbar in front of a shared
+ * L2. The slave side is serviced by the event queue of the bridge
+ * itself, the master side by the queue selected with
+ * mem_side_eventq_index.
+ *
+ * Timing requests, responses and snoops cross the bridge with a fixed
+ * delay that must be at least the simulation quantum. A packet sent
+ * during one quantum is therefore never due before the next one
+ * starts, so the bridge can hand packets over at the quantum barrier,
+ * when the receiving side's thread picks up everything sent to it in
+ * the previous quantum (see GlobalSyncEvent::registerQuantumCallback).
+ * This keeps the crossing deterministic: neither the order nor the
+ * time at which packets arrive depends on how the host threads
+ * interleave. The delay is the lookahead of the two sides, so it
+ * should take over latency the crossbar would otherwise add.
+ *
+ * Request buffer space is managed with credits. The slave side
+ * accepts as many requests as the request queue holds, and the master
+ * side returns a credit across the bridge for every request it sends
+ * on. Response space is reserved when a request is accepted, as in
+ * the Bridge.
+ *
+ * The crossbar on the master side expects snooped caches to say right
+ * away whether they hold a block and whether they will respond, while
+ * the caches above a crossing bridge only see the snoop a delay later.
+ * The master side therefore tracks the state of every block held
+ * above, from the requests it sends on, the responses it passes up
+ * and the snoops it sees, i.e. in the order the crossbar sees them,
+ * and answers snoops from that state. If the caches above may hold a
+ * block dirty, the bridge commits to responding and completes the
+ * response when the caches above have answered the snoop, or when a
+ * writeback of the block crosses. Requests that have crossed but not
+ * reached the crossbar logically follow any snoop it sends meanwhile.
+ * The bridge marks the MSHRs of such requests as downstream pending
+ * until they are sent on, so the caches above treat the snoop as
+ * coming first, as they do for requests buffered in a cache below,
+ * and evictions waiting in the bridge are handled like the write
+ * buffer of a cache. The caches above must write back clean blocks,
+ * so that a writeback always carries the data of a block whose
+ * response the bridge committed to.
+ *
+ * Atomic and functional accesses are serviced synchronously by
+ * temporarily migrating to the other side's event queue (see
+ * EventQueue::ScopedMigration), which holds the service lock of that
+ * queue.
+ *
+ * Both sides must not share mutable state other than through the
+ * bridge, so the bridge is not clocked and adds its delay in ticks.
+ * When both sides are serviced by the same event queue, packets are
+ * handed over directly and the bridge behaves like a plain Bridge.
+ */
+class DomainBridge : public MemObject
+{
+  protected:
+
+    /**
+     * A deferred packet stores a packet along with the time it is due
+     * on the other side. Credits crossing from the master side to the
+     * slave side have no packet.
+     */
+    class DeferredPacket
+    {
+      public:
+
+        Tick tick;
+        PacketPtr pkt;
+
+        /**
+         * MSHR above that sent the request a credit is returned for,
+         * to be told the request has reached the crossbar.
+         */
+        MSHR *mshr;
+
+        /** Is the bridge responding to this snoop? */
+        bool promised;
+
+        DeferredPacket(PacketPtr _pkt, Tick _tick, MSHR *_mshr = nullptr,
+                       bool _promised = false)
+            : tick(_tick), pkt(_pkt), mshr(_mshr), promised(_promised)
+        { }
+    };
+
+    /**
+     * Sender state of a request that crosses the bridge. It hides the
+     * sender state of the masters above from the ones below, which
+     * run on another thread, and remembers the MSHR that sent it.
+     */
+    class CrossingState : public Packet::SenderState
+    {
+      public:
+
+        Packet::SenderState *const aboveState;
+        MSHR *const mshr;
+
+        CrossingState(Packet::SenderState *_above_state, MSHR *_mshr)
+            : aboveState(_above_state), mshr(_mshr)
+        { }
+    };
+
+    /**
+     * One direction of the crossing. The sending side adds packets to
+     * the buffer of the current quantum, and the receiving side takes
+     * the buffer of the previous quantum when it leaves the quantum
+     * barrier. The lock only serialises functional accesses looking
+     * at a buffer against the threads filling and emptying it.
+     */
+    class Mailbox
+    {
+      public:
+
+        /** Add a packet sent during the current quantum. */
+        void push(const DeferredPacket &p);
+
+        /**
+         * Move the packets sent during the previous quantum to the
+         * end of a list, in the order they were sent.
+         */
+        void collect(std::vector<DeferredPacket> &list);
+
+        /**
+         * Check a functional request against the packets crossing.
+         *
+         * @return true if we find a match
+         */
+        bool checkFunctional(PacketPtr pkt);
+
+      private:
+
+        std::mutex lock;
+
+        std::vector<DeferredPacket> buffer[2];
+    };
+
+    // Forward declaration to allow the slave port to have a pointer
+    class DomainMasterPort;
+
+    /**
+     * The port on the side that receives requests and sends
+     * responses. It holds the request credits and the responses that
+     * have crossed but not been sent yet.
+     */
+    class DomainSlavePort : public SlavePort
+    {
+
+      private:
+
+        /** The bridge to which this port belongs. */
+        DomainBridge& bridge;
+
+        /** Master port on the other side of the bridge. */
+        DomainMasterPort& masterPort;
+
+        /**
+         * Responses that have crossed the bridge. We use a deque as we
+         * need to iterate over the items for functional accesses.
+         */
+        std::deque<DeferredPacket> transmitList;
+
+        /** Requests that may be accepted before credits return. */
+        unsigned int reqCredits;
+
+        /** Counter to track the outstanding responses. */
+        unsigned int outstandingResponses;
+
+        /** If we should send a retry when space becomes available. */
+        bool retryReq;
+
+        /** Max queue size for reserved responses. */
+        const unsigned int respQueueLimit;
+
+        /**
+         * Snoops and returned credits that have crossed the bridge,
+         * in the order the master side sent them.
+         */
+        std::deque<DeferredPacket> snoopList;
+
+        /**
+         * Handle send event, scheduled when the packet at the head of
+         * the response queue is due.
+         */
+        void trySendTiming();
+
+        /**
+         * Send the snoops that are due to the master above us, and
+         * take the credits that are due.
+         */
+        void sendSnoops();
+
+        /** Send a snoop to the master above us and answer it. */
+        void sendSnoop(const DeferredPacket &snoop);
+
+        /** Take a credit, and retry a request waiting for it. */
+        void returnCredit(MSHR *mshr);
+
+        /** Send events for the response and snoop queues. */
+        EventFunctionWrapper sendEvent;
+        EventFunctionWrapper snoopEvent;
+
+      public:
+
+        DomainSlavePort(const std::string& _name, DomainBridge& _bridge,
+                        DomainMasterPort& _masterPort, int _req_limit,
+                        int _resp_limit);
+
+        /**
+         * Take a packet or a credit that has crossed the bridge.
+         *
+         * @param p a response, a snoop or a credit with its due time
+         */
+        void receive(const DeferredPacket &p);
+
+        /**
+         * Check a functional request against the responses waiting to
+         * be sent.
+         *
+         * @return true if we find a match
+         */
+        bool checkFunctional(PacketPtr pkt);
+
+        /** Are there packets in our queue? */
+        bool empty() const { return transmitList.empty(); }
+
+      protected:
+
+        bool recvTimingReq(PacketPtr pkt);
+
+        bool recvTimingSnoopResp(PacketPtr pkt);
+
+        void recvRespRetry();
+
+        Tick recvAtomic(PacketPtr pkt);
+
+        void recvFunctional(PacketPtr pkt);
+
+        AddrRangeList getAddrRanges() const;
+    };
+
+
+    /**
+     * Port on the side that forwards requests and receives responses
+     * and snoops. It holds the requests and snoop responses that have
+     * crossed but not been sent yet, and the state of the blocks held
+     * above the bridge.
+     */
+    class DomainMasterPort : public MasterPort
+    {
+
+      private:
+
+        /** The bridge to which this port belongs. */
+        DomainBridge& bridge;
+
+        /** The slave port on the other side of the bridge. */
+        DomainSlavePort& slavePort;
+
+        /**
+         * Requests that have crossed the bridge. Evictions dropped
+         * because a snoop took the block away are left as entries
+         * without a packet.
+         */
+        std::deque<DeferredPacket> transmitList;
+
+        /** Snoop responses ready to be sent. */
+        std::deque<DeferredPacket> snoopRespList;
+
+        /** State of a block held above the bridge. */
+        enum class BlockState
+        {
+            /** Clean and read-only */
+            Shared,
+            /** Read-only, possibly dirty */
+            Owned,
+            /** Writable, possibly dirty */
+            Writable
+        };
+
+        struct BlockEntry
+        {
+            BlockState state;
+            /**
+             * The response to a request for the block has not passed
+             * yet, and no snoop has changed the state since the
+             * request was sent.
+             */
+            bool filling;
+            /**
+             * A snoop reading the block passed while it was filling,
+             * so the response must not make it writable.
+             */
+            bool snooped;
+        };
+
+        /** Blocks held above the bridge, by block address. */
+        std::unordered_map<Addr, BlockEntry> blocks;
+
+        /** A snoop response the bridge has committed to. */
+        struct PendingSnoop
+        {
+            /** Response to send, without data yet */
+            PacketPtr resp;
+            /** Request of the copy of the snoop sent above */
+            Request *req;
+            /** Does the snoop invalidate the block? */
+            bool invalidate;
+            /** Has the response been sent already? */
+            bool done;
+        };
+
+        /** Snoop responses waiting for the caches above. */
+        std::list<PendingSnoop> pendingSnoops;
+
+        /** Size of the blocks of the caches above. */
+        const unsigned blkSize;
+
+        /**
+         * Handle send events, scheduled when the packet at the head of
+         * either queue is due.
+         */
+        void trySendTiming();
+        void trySendSnoopResp();
+
+        EventFunctionWrapper sendEvent;
+        EventFunctionWrapper snoopRespEvent;
+
+        /** Queue a snoop response to be sent at a given time. */
+        void queueSnoopResp(PacketPtr pkt, Tick when);
+
+        /**
+         * Look for an eviction of a block waiting in the request
+         * queue.
+         */
+        std::deque<DeferredPacket>::iterator findEviction(Addr blk_addr);
+
+        /**
+         * Complete the responses committed to for a block with the
+         * data of an eviction that crossed after the snoop.
+         */
+        void completeFromEviction(PacketPtr pkt, Tick when);
+
+        /**
+         * Complete a committed response with the answer of the caches
+         * above.
+         */
+        void completeFromAbove(PacketPtr pkt, Tick when);
+
+        /**
+         * Update the block state for a request the crossbar accepted.
+         * The request itself may be gone already.
+         */
+        void requestSent(MemCmd cmd, Addr blk_addr, bool uncacheable);
+
+        /** Timing snoops of a bridge crossing event queues. */
+        void snoopCrossing(PacketPtr pkt);
+
+      public:
+
+        DomainMasterPort(const std::string& _name, DomainBridge& _bridge,
+                         DomainSlavePort& _slavePort, unsigned _blk_size);
+
+        /**
+         * Take a request, an eviction or a snoop response that has
+         * crossed the bridge.
+         *
+         * @param p the packet with its due time
+         */
+        void receive(const DeferredPacket &p);
+
+        /**
+         * Check a functional request against the packets in our
+         * queues.
+         *
+         * @return true if we find a match
+         */
+        bool checkFunctional(PacketPtr pkt);
+
+        bool isSnooping() const { return slavePort.isSnooping(); }
+
+      protected:
+
+        bool recvTimingResp(PacketPtr pkt);
+
+        void recvReqRetry();
+
+        void recvRetrySnoopResp();
+
+        void recvTimingSnoopReq(PacketPtr pkt);
+
+        Tick recvAtomicSnoop(PacketPtr pkt);
+
+        void recvFunctionalSnoop(PacketPtr pkt);
+
+        void recvRangeChange();
+    };
+
+    /**
+     * Hand a packet to the other side, at the next quantum barrier
+     * if the sides are serviced by different queues.
+     */
+    void sendToMem(const DeferredPacket &p);
+    void sendToCpu(const DeferredPacket &p);
+
+    /**
+     * Quantum callbacks taking the packets of the previous quantum,
+     * run on the master and the slave side respectively.
+     */
+    void collectToMem();
+    void collectToCpu();
+
+    /** Slave port of the bridge. */
+    DomainSlavePort slavePort;
+
+    /** Master port of the bridge. */
+    DomainMasterPort masterPort;
+
+    /** Delay of packets crossing the bridge. */
+    const Tick delay;
+
+    /** Event queue servicing the master side. */
+    EventManager memSide;
+
+    /** True if the two sides are serviced by different queues. */
+    const bool crossing;
+
+    /** Packets crossing towards the master and the slave side. */
+    Mailbox toMem;
+    Mailbox toCpu;
+
+    MakeCallback<DomainBridge, &DomainBridge::collectToMem> toMemCallback;
+    MakeCallback<DomainBridge, &DomainBridge::collectToCpu> toCpuCallback;
+
+    /** Packets accepted by either side and not yet sent on. */
+    std::atomic<unsigned int> inFlight;
+
+    /** Serialises signalling the end of a drain from both sides. */
+    std::mutex drainLock;
+
+    /**
+     * Account for a packet leaving the bridge, and finish draining
+     * when it was the last one.
+     */
+    void packetLeft();
+
+    /**
+     * Should calls crossing synchronously migrate to the other
+     * side's event queue?
+     */
+    bool migrate() const { return crossing && inParallelMode; }
+
+    Stats::Scalar deferredSnoops;
+    Stats::Scalar promisedSnoops;
+    Stats::Scalar droppedEvictions;
+    Stats::Scalar creditStalls;
+    Stats::Scalar lateDeliveries;
+
+  public:
+
+    virtual BaseMasterPort& getMasterPort(const std::string& if_name,
+                                          PortID idx = InvalidPortID);
+    virtual BaseSlavePort& getSlavePort(const std::string& if_name,
+                                        PortID idx = InvalidPortID);
+
+    void init() override;
+
+    void regStats() override;
+
+    DrainState drain() override;
+
+    typedef DomainBridgeParams Params;
+
+    DomainBridge(Params *p);
+};
+
+#endif //__MEM_DOMAIN_BRIDGE_HH__
@@ -37,8 +37,10 @@
  */
 #include "mem/page_table.hh"
 
+#include <atomic>
 #include <string>
 
+#include "base/compiler.hh"
 #include "base/trace.hh"
 #include "debug/MMU.hh"
 #include "sim/faults.hh"
@@ -46,6 +48,138 @@
 
 using namespace std;
 
+namespace {
+
+/** Source of page table generations, unique across all tables */
+atomic<uint64_t> nextGeneration(1);
+
+/**
+ * Recently used mappings of any page table, per thread so that
+ * lookups stay free of data races. An entry is valid while the table
+ * it came from still has the generation it was cached at.
+ */
+struct CachedMapping
+{
+    const EmulationPageTable *table;
+    uint64_t generation;
+    Addr start;
+    Addr size;
+    Addr paddr;
+    uint64_t flags;
+};
+
+const unsigned translationCacheSize = 16;
+__thread CachedMapping translationCache[translationCacheSize];
+
+/** The entry lookup() returns a pointer to */
+__thread EmulationPageTable::Entry lookupEntry;
+
+} // anonymous namespace
+
+void
+EmulationPageTable::changed()
+{
+    generation = nextGeneration++;
+}
+
+bool
+EmulationPageTable::find(Addr vaddr, Addr &start, Mapping &mapping) const
+{
+    // Index by 2 MB region, so that accesses streaming through a large
+    // mapping keep hitting the same entry
+    CachedMapping &cached = translationCache[
+        (vaddr >> 21) % translationCacheSize];
+
+    if (cached.table == this && cached.generation == generation &&
+        vaddr - cached.start < cached.size) {
+        start = cached.start;
+        mapping = Mapping(cached.size, cached.paddr, cached.flags);
+        return true;
+    }
+
+    auto it = mappings.upper_bound(vaddr);
+    if (it == mappings.begin())
+        return false;
+    --it;
+    if (vaddr - it->first >= it->second.size)
+        return false;
+
+    start = it->first;
+    mapping = it->second;
+    cached = { this, generation, start, mapping.size, mapping.paddr,
+               mapping.flags };
+    return true;
+}
+
+Addr
+EmulationPageTable::removeRange(Addr start, Addr end,
+                                vector<pair<Addr, Mapping>> *removed)
+{
+    Addr bytes = 0;
+
+    auto it = mappings.upper_bound(start);
+    if (it != mappings.begin() &&
+        start - prev(it)->first < prev(it)->second.size) {
+        --it;
+    }
+
+    while (it != mappings.end() && it->first < end) {
+        Addr m_start = it->first;
+        Addr m_end = m_start + it->second.size;
+        Mapping &m = it->second;
+
+        Addr r_start = max(start, m_start);
+        Addr r_end = min(end, m_end);
+        bytes += r_end - r_start;
+        if (removed) {
+            removed->emplace_back(r_start, Mapping(r_end - r_start,
+                m.paddr + (r_start - m_start), m.flags));
+        }
+
+        // Keep the pieces on either side of the removed range
+        if (m_end > end) {
+            mappings.emplace(end, Mapping(m_end - end,
+                                          m.paddr + (end - m_start),
+                                          m.flags));
+        }
+        if (m_start < start) {
+            m.size = start - m_start;
+            ++it;
+        } else {
+            it = mappings.erase(it);
+        }
+    }
+
+    changed();
+    return bytes;
+}
+
+void
+EmulationPageTable::insertMapping(Addr vaddr, const Mapping &mapping)
+{
+    auto it = mappings.emplace(vaddr, mapping).first;
+
+    auto next = std::next(it);
+    if (next != mappings.end() && next->first == vaddr + mapping.size &&
+        next->second.paddr == mapping.paddr + mapping.size &&
+        next->second.flags == mapping.flags) {
+        it->second.size += next->second.size;
+        mappings.erase(next);
+    }
+
+    if (it != mappings.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second.size == vaddr &&
+            prev->second.paddr + prev->second.size == mapping.paddr &&
+            prev->second.flags == mapping.flags) {
+            prev->second.size += it->second.size;
+            mappings.erase(it);
+        }
+    }
+
+    changed();
+}
+
 void
 EmulationPageTable::map(Addr vaddr, Addr paddr, int64_t size, uint64_t flags)
 {
@@ -55,22 +189,24 @@ EmulationPageTable::map(Addr vaddr, Addr paddr, int64_t size, uint64_t flags)
 
     DPRINTF(MMU, "Allocating Page: %#x-%#x\n", vaddr, vaddr + size);
 
-    while (size > 0) {
-        auto it = pTable.find(vaddr);
-        if (it != pTable.end()) {
-            // already mapped
-            panic_if(!clobber,
-                     "EmulationPageTable::allocate: addr %#x already mapped",
-                     vaddr);
-            it->second = Entry(paddr, flags);
-        } else {
-            pTable.emplace(vaddr, Entry(paddr, flags));
-        }
+    if (size <= 0)
+        return;
+
+    // Partial pages are mapped whole
+    Addr end = vaddr + roundUp(size, pageSize);
 
-        size -= pageSize;
-        vaddr += pageSize;
-        paddr += pageSize;
+    if (!clobber && !isUnmapped(vaddr, end - vaddr)) {
+        Addr start;
+        Mapping mapping;
+        Addr page = vaddr;
+        while (!find(page, start, mapping))
+            page += pageSize;
+        panic("EmulationPageTable::allocate: addr %#x already mapped", page);
     }
+
+    removeRange(vaddr, end);
+    insertMapping(vaddr, Mapping(end - vaddr, paddr,
+                                 flags & ~uint64_t(Clobber)));
 }
 
 void
@@ -82,24 +218,30 @@ EmulationPageTable::remap(Addr vaddr, int64_t size, Addr new_vaddr)
     DPRINTF(MMU, "moving pages from vaddr %08p to %08p, size = %d\n", vaddr,
             new_vaddr, size);
 
-    while (size > 0) {
-        auto new_it = pTable.find(new_vaddr);
-        auto old_it = pTable.find(vaddr);
-        assert(old_it != pTable.end() && new_it == pTable.end());
+    if (size <= 0)
+        return;
 
-        new_it->second = old_it->second;
-        pTable.erase(old_it);
-        size -= pageSize;
-        vaddr += pageSize;
-        new_vaddr += pageSize;
-    }
+    Addr len = roundUp(size, pageSize);
+    assert(isUnmapped(new_vaddr, len));
+
+    vector<pair<Addr, Mapping>> moved;
+    M5_VAR_USED Addr bytes = removeRange(vaddr, vaddr + len, &moved);
+    assert(bytes == len);
+
+    for (auto &piece : moved)
+        insertMapping(piece.first - vaddr + new_vaddr, piece.second);
 }
 
 void
 EmulationPageTable::getMappings(std::vector<std::pair<Addr, Addr>> *addr_maps)
 {
-    for (auto &iter : pTable)
-        addr_maps->push_back(make_pair(iter.first, iter.second.paddr));
+    for (auto &mapping : mappings) {
+        for (Addr offset = 0; offset < mapping.second.size;
+             offset += pageSize) {
+            addr_maps->push_back(make_pair(mapping.first + offset,
+                                           mapping.second.paddr + offset));
+        }
+    }
 }
 
 void
@@ -109,13 +251,12 @@ EmulationPageTable::unmap(Addr vaddr, int64_t size)
 
     DPRINTF(MMU, "Unmapping page: %#x-%#x\n", vaddr, vaddr + size);
 
-    while (size > 0) {
-        auto it = pTable.find(vaddr);
-        assert(it != pTable.end());
-        pTable.erase(it);
-        size -= pageSize;
-        vaddr += pageSize;
-    }
+    if (size <= 0)
+        return;
+
+    Addr len = roundUp(size, pageSize);
+    M5_VAR_USED Addr bytes = removeRange(vaddr, vaddr + len);
+    assert(bytes == len);
 }
 
 bool
@@ -124,36 +265,67 @@ EmulationPageTable::isUnmapped(Addr vaddr, int64_t size)
     // starting address must be page aligned
     assert(pageOffset(vaddr) == 0);
 
-    for (int64_t offset = 0; offset < size; offset += pageSize)
-        if (pTable.find(vaddr + offset) != pTable.end())
-            return false;
+    if (size <= 0)
+        return true;
 
-    return true;
+    // The first mapping that ends after vaddr must start after the region
+    auto it = mappings.upper_bound(vaddr);
+    if (it != mappings.begin() &&
+        vaddr - prev(it)->first < prev(it)->second.size) {
+        return false;
+    }
+    return it == mappings.end() || it->first >= vaddr + size;
 }
 
 const EmulationPageTable::Entry *
 EmulationPageTable::lookup(Addr vaddr)
 {
-    Addr page_addr = pageAlign(vaddr);
-    PTableItr iter = pTable.find(page_addr);
-    if (iter == pTable.end())
+    Addr start;
+    Mapping mapping;
+    if (!find(vaddr, start, mapping))
         return nullptr;
-    return &(iter->second);
+
+    lookupEntry = Entry(mapping.paddr + pageAlign(vaddr - start),
+                        mapping.flags);
+    return &lookupEntry;
 }
 
 bool
 EmulationPageTable::translate(Addr vaddr, Addr &paddr)
 {
-    const Entry *entry = lookup(vaddr);
-    if (!entry) {
+    Addr start;
+    Mapping mapping;
+    if (!find(vaddr, start, mapping)) {
         DPRINTF(MMU, "Couldn't Translate: %#x\n", vaddr);
         return false;
     }
-    paddr = pageOffset(vaddr) + entry->paddr;
+    paddr = mapping.paddr + (vaddr - start);
     DPRINTF(MMU, "Translating: %#x->%#x\n", vaddr, paddr);
     return true;
 }
 
+Addr
+EmulationPageTable::translateRange(Addr vaddr, Addr size, Addr &paddr)
+{
+    Addr start;
+    Mapping mapping;
+    if (!find(vaddr, start, mapping))
+        return 0;
+
+    paddr = mapping.paddr + (vaddr - start);
+    Addr len = start + mapping.size - vaddr;
+
+    // Mappings with different flags can still be physically contiguous
+    while (len < size && find(vaddr + len, start, mapping) &&
+           mapping.paddr == paddr + len) {
+        len += mapping.size;
+    }
+
+    DPRINTF(MMU, "Translating range: %#x-%#x->%#x\n", vaddr,
+            vaddr + min(len, size), paddr);
+    return min(len, size);
+}
+
 Fault
 EmulationPageTable::translate(RequestPtr req)
 {
@@ -173,36 +345,57 @@ EmulationPageTable::translate(RequestPtr req)
 void
 EmulationPageTable::serialize(CheckpointOut &cp) const
 {
-    paramOut(cp, "ptable.size", pTable.size());
+    paramOut(cp, "ptable.ranges", mappings.size());
 
-    PTable::size_type count = 0;
-    for (auto &pte : pTable) {
-        ScopedCheckpointSection sec(cp, csprintf("Entry%d", count++));
+    MappingMap::size_type count = 0;
+    for (auto &mapping : mappings) {
+        ScopedCheckpointSection sec(cp, csprintf("Range%d", count++));
 
-        paramOut(cp, "vaddr", pte.first);
-        paramOut(cp, "paddr", pte.second.paddr);
-        paramOut(cp, "flags", pte.second.flags);
+        paramOut(cp, "vaddr", mapping.first);
+        paramOut(cp, "size", mapping.second.size);
+        paramOut(cp, "paddr", mapping.second.paddr);
+        paramOut(cp, "flags", mapping.second.flags);
     }
-    assert(count == pTable.size());
+    assert(count == mappings.size());
 }
 
 void
 EmulationPageTable::unserialize(CheckpointIn &cp)
 {
+    mappings.clear();
+    changed();
+
+    // Checkpoints from before range mappings have an entry per page
     int count;
-    paramIn(cp, "ptable.size", count);
+    if (optParamIn(cp, "ptable.size", count, false)) {
+        for (int i = 0; i < count; ++i) {
+            ScopedCheckpointSection sec(cp, csprintf("Entry%d", i));
+
+            Addr vaddr;
+            UNSERIALIZE_SCALAR(vaddr);
+            Addr paddr;
+            uint64_t flags;
+            UNSERIALIZE_SCALAR(paddr);
+            UNSERIALIZE_SCALAR(flags);
+
+            insertMapping(vaddr, Mapping(pageSize, paddr,
+                                         flags & ~uint64_t(Clobber)));
+        }
+        return;
+    }
+
+    paramIn(cp, "ptable.ranges", count);
 
     for (int i = 0; i < count; ++i) {
-        ScopedCheckpointSection sec(cp, csprintf("Entry%d", i));
+        ScopedCheckpointSection sec(cp, csprintf("Range%d", i));
 
         Addr vaddr;
         UNSERIALIZE_SCALAR(vaddr);
-        Addr paddr;
-        uint64_t flags;
-        UNSERIALIZE_SCALAR(paddr);
-        UNSERIALIZE_SCALAR(flags);
+        Mapping mapping;
+        paramIn(cp, "size", mapping.size);
+        paramIn(cp, "paddr", mapping.paddr);
+        paramIn(cp, "flags", mapping.flags);
 
-        pTable.emplace(vaddr, Entry(paddr, flags));
+        insertMapping(vaddr, mapping);
     }
 }
-
@@ -37,8 +37,9 @@
 #ifndef __MEM_PAGE_TABLE_HH__
 #define __MEM_PAGE_TABLE_HH__
 
+#include <map>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "base/intmath.hh"
 #include "base/types.hh"
@@ -56,13 +57,36 @@ class EmulationPageTable : public Serializable
         uint64_t flags;
 
         Entry(Addr paddr, uint64_t flags) : paddr(paddr), flags(flags) {}
-        Entry() {}
+        Entry() = default;
     };
 
   protected:
-    typedef std::unordered_map<Addr, Entry> PTable;
-    typedef PTable::iterator PTableItr;
-    PTable pTable;
+    /**
+     * A run of virtual pages mapped to contiguous physical memory with
+     * the same flags. Mapping adjacent pages merges them, so a large
+     * region, or a huge page, takes a single entry.
+     */
+    struct Mapping
+    {
+        Addr size;
+        Addr paddr;
+        uint64_t flags;
+
+        Mapping(Addr size, Addr paddr, uint64_t flags)
+            : size(size), paddr(paddr), flags(flags)
+        {}
+        Mapping() {}
+    };
+
+    /** Mappings by starting virtual address, they never overlap */
+    typedef std::map<Addr, Mapping> MappingMap;
+    MappingMap mappings;
+
+    /**
+     * Changed whenever the mappings change, invalidating the
+     * translations cached from this table.
+     */
+    uint64_t generation;
 
     const Addr pageSize;
     const Addr offsetMask;
@@ -78,6 +102,7 @@ class EmulationPageTable : public Serializable
             _pid(_pid), _name(__name)
     {
         assert(isPowerOf2(pageSize));
+        changed();
     }
 
     uint64_t pid() const { return _pid; };
@@ -104,6 +129,33 @@ class EmulationPageTable : public Serializable
     Addr pageAlign(Addr a)  { return (a & ~offsetMask); }
     Addr pageOffset(Addr a) { return (a &  offsetMask); }
 
+  protected:
+    /** Give the table a new generation after changing the mappings */
+    void changed();
+
+    /**
+     * Find the mapping containing vaddr, looking in the calling
+     * thread's translation cache first.
+     * @return False if vaddr isn't mapped.
+     */
+    bool find(Addr vaddr, Addr &start, Mapping &mapping) const;
+
+    /**
+     * Remove the mappings of [start, end), splitting the mappings it
+     * partially covers.
+     * @param removed If not null, the removed pieces are added to it.
+     * @return The number of bytes that were mapped.
+     */
+    Addr removeRange(Addr start, Addr end,
+                     std::vector<std::pair<Addr, Mapping>> *removed = nullptr);
+
+    /** Add a mapping, merging it with its neighbours if possible */
+    void insertMapping(Addr vaddr, const Mapping &mapping);
+
+  public:
+    /** Number of mappings the table holds */
+    size_t numMappings() const { return mappings.size(); }
+
     /**
      * Maps a virtual memory region to a physical memory region.
      * @param vaddr The starting virtual address of the region.
@@ -127,7 +179,8 @@ class EmulationPageTable : public Serializable
     /**
      * Lookup function
      * @param vaddr The virtual address.
-     * @return The page table entry corresponding to vaddr.
+     * @return The page table entry for the page containing vaddr. It
+     *         stays valid until the calling thread's next lookup.
      */
     const Entry *lookup(Addr vaddr);
 
@@ -139,6 +192,16 @@ class EmulationPageTable : public Serializable
      */
     bool translate(Addr vaddr, Addr &paddr);
 
+    /**
+     * Translate the part of a virtual range that is mapped to
+     * contiguous physical memory, which may span several mappings.
+     * @param vaddr The start of the virtual range.
+     * @param size The size of the virtual range.
+     * @param paddr Physical address of vaddr.
+     * @return The number of bytes translated, 0 if vaddr isn't mapped.
+     */
+    Addr translateRange(Addr vaddr, Addr size, Addr &paddr);
+
     /**
      * Simplified translate function (just check for translation)
      * @param vaddr The virtual address.
@@ -49,13 +49,17 @@
 #include <cerrno>
 #include <climits>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <map>
 #include <string>
 
+#include "base/str.hh"
 #include "base/trace.hh"
 #include "debug/AddrRanges.hh"
 #include "debug/Checkpoint.hh"
 #include "mem/abstract_mem.hh"
+#include "mem/sparse_store.hh"
 
 /**
  * On Linux, MAP_NORESERVE allow us to simulate a very large memory
@@ -71,11 +75,106 @@
 
 using namespace std;
 
+namespace {
+
+/**
+ * A memory image inflated ahead of time by a sweep server, waiting to
+ * be adopted by the backing store of a forked child.
+ */
+struct PreloadedStore
+{
+    uint8_t* pmem;
+    uint64_t size;
+};
+
+// Preloaded images, keyed on the path of the store file they came from
+map<string, PreloadedStore> preloadedStores;
+
+/**
+ * Read a store file of the given format into host memory, which is
+ * expected to be zero-filled.
+ */
+void
+readStore(const string& filepath, const string& store_format,
+          uint8_t* pmem, uint64_t size, unsigned threads, bool allow_mmap)
+{
+    if (store_format != "gzip") {
+        SparseStore::Stats stats =
+            SparseStore::read(filepath, pmem, size, threads, allow_mmap);
+        DPRINTF(Checkpoint, "Restored %d non-zero pages, %d mapped\n",
+                stats.pages, stats.mappedPages);
+        return;
+    }
+
+    const uint32_t chunk_size = 16384;
+
+    // mmap memoryfile
+    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
+    if (compressed_mem == NULL)
+        fatal("Can't open physical memory checkpoint file '%s'", filepath);
+
+    uint64_t curr_size = 0;
+    long* temp_page = new long[chunk_size];
+    long* pmem_current;
+    uint32_t bytes_read;
+    while (curr_size < size) {
+        bytes_read = gzread(compressed_mem, temp_page, chunk_size);
+        if (bytes_read == 0)
+            break;
+
+        assert(bytes_read % sizeof(long) == 0);
+
+        for (uint32_t x = 0; x < bytes_read / sizeof(long); x++) {
+            // Only copy bytes that are non-zero, so we don't give
+            // the VM system hell
+            if (*(temp_page + x) != 0) {
+                pmem_current = (long*)(pmem + curr_size + x * sizeof(long));
+                *pmem_current = *(temp_page + x);
+            }
+        }
+        curr_size += bytes_read;
+    }
+
+    delete[] temp_page;
+
+    if (gzclose(compressed_mem))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filepath);
+}
+
+/**
+ * Replace the backing store at pmem by a preloaded image. The image
+ * pages are moved rather than copied, so pages the parent has not
+ * touched since the fork stay shared copy-on-write.
+ */
+void
+adoptStore(const PreloadedStore& store, uint8_t* pmem)
+{
+#if defined(__linux__)
+    void* moved = mremap(store.pmem, store.size, store.size,
+                         MREMAP_MAYMOVE | MREMAP_FIXED, pmem);
+    if (moved != MAP_FAILED)
+        return;
+    warn("Could not move preloaded memory image, copying it instead\n");
+#endif
+    memcpy(pmem, store.pmem, store.size);
+    munmap(store.pmem, store.size);
+}
+
+} // anonymous namespace
+
 PhysicalMemory::PhysicalMemory(const string& _name,
                                const vector<AbstractMemory*>& _memories,
-                               bool mmap_using_noreserve) :
+                               bool mmap_using_noreserve,
+                               Enums::MemoryCheckpointFormat
+                               checkpoint_format,
+                               unsigned checkpoint_threads,
+                               bool checkpoint_mmap) :
     _name(_name), rangeCache(addrMap.end()), size(0),
-    mmapUsingNoReserve(mmap_using_noreserve)
+    mmapUsingNoReserve(mmap_using_noreserve),
+    checkpointFormat(checkpoint_format),
+    checkpointThreads(checkpoint_threads),
+    checkpointMmap(checkpoint_mmap)
 {
     if (mmap_using_noreserve)
         warn("Not reserving swap space. May cause SIGSEGV on actual usage\n");
@@ -252,6 +351,18 @@ PhysicalMemory::isMemAddr(Addr addr) const
     }
 }
 
+uint8_t *
+PhysicalMemory::hostAddr(Addr addr, Addr size) const
+{
+    for (const auto &entry : backingStore) {
+        if (entry.inAddrMap && entry.range.contains(addr) &&
+            addr + size - 1 <= entry.range.end()) {
+            return entry.pmem + (addr - entry.range.start());
+        }
+    }
+    return nullptr;
+}
+
 AddrRangeList
 PhysicalMemory::getConfAddrRanges() const
 {
@@ -354,9 +465,12 @@ void
 PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
                                AddrRange range, uint8_t* pmem) const
 {
+    const bool sparse = checkpointFormat != Enums::gzip;
+
     // we cannot use the address range for the name as the
     // memories that are not part of the address map can overlap
-    string filename = name() + ".store" + to_string(store_id) + ".pmem";
+    string filename = name() + ".store" + to_string(store_id) +
+        (sparse ? ".spmem" : ".pmem");
     long range_size = range.size();
 
     DPRINTF(Checkpoint, "Serializing physical memory %s with size %d\n",
@@ -366,8 +480,24 @@ PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
     SERIALIZE_SCALAR(filename);
     SERIALIZE_SCALAR(range_size);
 
-    // write memory file
     string filepath = CheckpointIn::dir() + "/" + filename.c_str();
+
+    if (sparse) {
+        // checkpoints without this entry use the gzip format
+        string store_format =
+            Enums::MemoryCheckpointFormatStrings[checkpointFormat];
+        SERIALIZE_SCALAR(store_format);
+
+        SparseStore::Stats stats =
+            SparseStore::write(filepath, pmem, range_size,
+                               checkpointFormat == Enums::sparse,
+                               checkpointThreads);
+        DPRINTF(Checkpoint, "Wrote %d non-zero pages in %d bytes\n",
+                stats.pages, stats.fileBytes);
+        return;
+    }
+
+    // write memory file
     gzFile compressed_mem = gzopen(filepath.c_str(), "wb");
     if (compressed_mem == NULL)
         fatal("Can't open physical memory checkpoint file '%s'\n",
@@ -424,8 +554,6 @@ PhysicalMemory::unserialize(CheckpointIn &cp)
 void
 PhysicalMemory::unserializeStore(CheckpointIn &cp)
 {
-    const uint32_t chunk_size = 16384;
-
     unsigned int store_id;
     UNSERIALIZE_SCALAR(store_id);
 
@@ -433,11 +561,6 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
     UNSERIALIZE_SCALAR(filename);
     string filepath = cp.cptDir + "/" + filename;
 
-    // mmap memoryfile
-    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
-    if (compressed_mem == NULL)
-        fatal("Can't open physical memory checkpoint file '%s'", filename);
-
     // we've already got the actual backing store mapped
     uint8_t* pmem = backingStore[store_id].pmem;
     AddrRange range = backingStore[store_id].range;
@@ -452,31 +575,71 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
         fatal("Memory range size has changed! Saw %lld, expected %lld\n",
               range_size, range.size());
 
-    uint64_t curr_size = 0;
-    long* temp_page = new long[chunk_size];
-    long* pmem_current;
-    uint32_t bytes_read;
-    while (curr_size < range.size()) {
-        bytes_read = gzread(compressed_mem, temp_page, chunk_size);
-        if (bytes_read == 0)
-            break;
+    // the format is recorded with the checkpoint, so a checkpoint can
+    // be restored whatever the configured format is
+    string store_format = "gzip";
+    optParamIn(cp, "store_format", store_format, false);
+
+    // a sweep server may already have inflated this store before
+    // forking, in which case the image is adopted rather than re-read
+    auto preloaded = preloadedStores.find(filepath);
+    if (preloaded != preloadedStores.end() &&
+        preloaded->second.size == range.size()) {
+        adoptStore(preloaded->second, pmem);
+        preloadedStores.erase(preloaded);
+        DPRINTF(Checkpoint, "Adopted preloaded memory image %s\n",
+                filename);
+        return;
+    }
 
-        assert(bytes_read % sizeof(long) == 0);
+    // mapped pages keep reading the checkpoint file, so they are only
+    // used when asked for
+    readStore(filepath, store_format, pmem, range.size(),
+              checkpointThreads, checkpointMmap);
+}
 
-        for (uint32_t x = 0; x < bytes_read / sizeof(long); x++) {
-            // Only copy bytes that are non-zero, so we don't give
-            // the VM system hell
-            if (*(temp_page + x) != 0) {
-                pmem_current = (long*)(pmem + curr_size + x * sizeof(long));
-                *pmem_current = *(temp_page + x);
-            }
+void
+PhysicalMemory::preloadStores(CheckpointIn &cp, unsigned threads)
+{
+    vector<string> sections;
+    cp.getSectionNames(sections);
+
+    for (const auto& section : sections) {
+        string filename, range_size_str;
+        if (!cp.find(section, "filename", filename) ||
+            !cp.find(section, "range_size", range_size_str) ||
+            !cp.entryExists(section, "store_id"))
+            continue;
+
+        uint64_t range_size;
+        if (!to_number(range_size_str, range_size))
+            fatal("Bad range_size '%s' in checkpoint section %s\n",
+                  range_size_str, section);
+
+        string store_format = "gzip";
+        cp.find(section, "store_format", store_format);
+
+        string filepath = cp.cptDir + "/" + filename;
+        if (preloadedStores.count(filepath))
+            continue;
+
+        // a single private anonymous mapping, so that a forked child
+        // can move it over its own backing store in one go
+        uint8_t* image = (uint8_t*) mmap(NULL, range_size,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_ANON | MAP_PRIVATE |
+                                         MAP_NORESERVE, -1, 0);
+        if (image == (uint8_t*) MAP_FAILED) {
+            perror("mmap");
+            fatal("Could not mmap %d bytes to preload %s\n", range_size,
+                  filepath);
         }
-        curr_size += bytes_read;
-    }
 
-    delete[] temp_page;
+        readStore(filepath, store_format, image, range_size, threads,
+                  false);
+        preloadedStores[filepath] = PreloadedStore{image, range_size};
 
-    if (gzclose(compressed_mem))
-        fatal("Close failed on physical memory checkpoint file '%s'\n",
-              filename);
+        inform("Preloaded physical memory image %s (%d bytes)\n",
+               filepath, range_size);
+    }
 }
@@ -41,6 +41,7 @@
 #define __MEM_PHYSICAL_HH__
 
 #include "base/addr_range_map.hh"
+#include "enums/MemoryCheckpointFormat.hh"
 #include "mem/packet.hh"
 
 /**
@@ -133,6 +134,15 @@ class PhysicalMemory : public Serializable
     // Let the user choose if we reserve swap space when calling mmap
     const bool mmapUsingNoReserve;
 
+    // Format used when checkpointing the backing stores
+    const Enums::MemoryCheckpointFormat checkpointFormat;
+
+    // Host threads used for sparse checkpoints, 0 for one per core
+    const unsigned checkpointThreads;
+
+    // Map raw sparse checkpoints into the backing store on restore
+    const bool checkpointMmap;
+
     // The physical memory used to provide the memory in the simulated
     // system
     std::vector<BackingStoreEntry> backingStore;
@@ -164,7 +174,11 @@ class PhysicalMemory : public Serializable
      */
     PhysicalMemory(const std::string& _name,
                    const std::vector<AbstractMemory*>& _memories,
-                   bool mmap_using_noreserve);
+                   bool mmap_using_noreserve,
+                   Enums::MemoryCheckpointFormat checkpoint_format =
+                   Enums::gzip,
+                   unsigned checkpoint_threads = 0,
+                   bool checkpoint_mmap = false);
 
     /**
      * Unmap all the backing store we have used.
@@ -218,6 +232,19 @@ class PhysicalMemory : public Serializable
     std::vector<BackingStoreEntry> getBackingStore() const
     { return backingStore; }
 
+    /**
+     * Get a pointer to the host memory backing the given range, for
+     * functional accesses that bypass the memory system. This is only
+     * correct when no cache can hold a copy of the data that differs
+     * from memory.
+     *
+     * @param addr Start of the range
+     * @param size Size of the range
+     * @return The host memory, or nullptr if the range isn't entirely
+     *         in one backing store
+     */
+    uint8_t *hostAddr(Addr addr, Addr size) const;
+
     /**
      * Perform an untimed memory access and update all the state
      * (e.g. locked addresses) and statistics accordingly. The packet
@@ -269,6 +296,19 @@ class PhysicalMemory : public Serializable
      */
     void unserializeStore(CheckpointIn &cp);
 
+    /**
+     * Inflate every backing store image of a checkpoint into host
+     * memory ahead of instantiation. A process that forks afterwards,
+     * such as a design sweep server, hands each child a copy-on-write
+     * view of the images, and the child's unserializeStore adopts
+     * them instead of reading the checkpoint files again.
+     *
+     * @param cp The checkpoint to preload
+     * @param threads Host threads used for sparse stores, 0 for one
+     *                per core
+     */
+    static void preloadStores(CheckpointIn &cp, unsigned threads);
+
 };
 
 #endif //__MEM_PHYSICAL_HH__
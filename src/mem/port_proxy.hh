@@ -59,6 +59,8 @@
 #ifndef __MEM_PORT_PROXY_HH__
 #define __MEM_PORT_PROXY_HH__
 
+#include <sys/types.h>
+
 #include "config/the_isa.hh"
 #if THE_ISA != NULL_ISA
     #include "arch/isa_traits.hh"
@@ -111,6 +113,15 @@ class PortProxy
      */
     virtual void memsetBlob(Addr addr, uint8_t v, int size) const;
 
+    /**
+     * Write size bytes of an open file, starting at offset, to
+     * address. p holds the same bytes, e.g. from a mapping of the
+     * file, and is written if the proxy can't load the file directly.
+     */
+    virtual void writeFileBlob(Addr addr, const uint8_t* p, int size,
+                               int fd, off_t offset) const
+    { writeBlob(addr, p, size); }
+
     /**
      * Read sizeof(T) bytes from address and return as object T.
      */
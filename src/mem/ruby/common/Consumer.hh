@@ -36,8 +36,8 @@
 #define __MEM_RUBY_COMMON_CONSUMER_HH__
 
 #include <iostream>
-#include <set>
 
+#include "mem/ruby/common/WakeupSet.hh"
 #include "sim/clocked_object.hh"
 
 class Consumer
@@ -59,7 +59,7 @@ class Consumer
     bool
     alreadyScheduled(Tick time)
     {
-        return m_scheduled_wakeups.find(time) != m_scheduled_wakeups.end();
+        return m_scheduled_wakeups.contains(time);
     }
 
     void
@@ -74,7 +74,7 @@ class Consumer
     void scheduleEvent(Cycles timeDelta);
 
   private:
-    std::set<Tick> m_scheduled_wakeups;
+    WakeupSet m_scheduled_wakeups;
     ClockedObject *em;
 };
 
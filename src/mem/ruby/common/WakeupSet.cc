@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mem/ruby/common/WakeupSet.hh"
+
+#include <algorithm>
+
+#include "base/bitfield.hh"
+
+void
+WakeupSet::advance(Tick edge, Tick period)
+{
+    if (edge < m_base)
+        return;
+
+    if (period == m_period && (edge - m_base) % period == 0) {
+        Tick cycles = (edge - m_base) / period;
+        if (cycles == 0)
+            return;
+
+        if (cycles >= horizonCycles) {
+            clearFromHead(horizonCycles);
+            m_head = 0;
+        } else {
+            clearFromHead(cycles);
+            m_head = (m_head + cycles) % horizonCycles;
+        }
+    } else {
+        // The clock period changed or the new edge is not on the old
+        // grid, so the bitmap can no longer be shifted. Spill the
+        // entries that are still pending into the far set and rebuild
+        // the window from there.
+        for (unsigned i = 0; i < horizonCycles; i++) {
+            unsigned idx = (m_head + i) % horizonCycles;
+            if (!(m_bits[idx / bitsPerWord] & (1ULL << (idx % bitsPerWord))))
+                continue;
+            Tick time = m_base + i * m_period;
+            if (time >= edge)
+                m_far.insert(time);
+        }
+        clearFromHead(horizonCycles);
+        m_head = 0;
+        m_period = period;
+    }
+    m_base = edge;
+
+    if (!m_far.empty()) {
+        m_far.erase(m_far.begin(), m_far.lower_bound(edge));
+        pullFarEntries();
+    }
+}
+
+size_t
+WakeupSet::size() const
+{
+    size_t count = m_far.size();
+    for (unsigned i = 0; i < numWords; i++)
+        count += popCount(m_bits[i]);
+    return count;
+}
+
+void
+WakeupSet::clearFromHead(unsigned count)
+{
+    unsigned pos = m_head;
+    while (count > 0) {
+        unsigned bit = pos % bitsPerWord;
+        unsigned n = std::min(bitsPerWord - bit, count);
+        uint64_t mask = (n == bitsPerWord) ? ~0ULL : ((1ULL << n) - 1) << bit;
+        m_bits[pos / bitsPerWord] &= ~mask;
+        pos = (pos + n) % horizonCycles;
+        count -= n;
+    }
+}
+
+void
+WakeupSet::pullFarEntries()
+{
+    Tick limit = m_base + horizonCycles * m_period;
+    auto it = m_far.begin();
+    while (it != m_far.end() && *it < limit) {
+        unsigned idx;
+        if (inWindow(*it, idx)) {
+            m_bits[idx / bitsPerWord] |= 1ULL << (idx % bitsPerWord);
+            it = m_far.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
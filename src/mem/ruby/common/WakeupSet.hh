@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * WakeupSet remembers the ticks at which a Consumer already has a
+ * wakeup event pending so that redundant events are not scheduled.
+ *
+ * Almost all wakeups land on one of the next few clock edges of the
+ * consumer, so those are kept in a rolling bitmap with one bit per
+ * cycle, starting at the most recent clock edge seen by advance().
+ * Ticks that are further away than the horizon, or that do not fall
+ * on a clock edge of the consumer, are kept in an ordered set instead.
+ * Whenever the window moves forward, far entries that come into range
+ * are pulled into the bitmap, so a tick is only ever in one of the two.
+ */
+
+#ifndef __MEM_RUBY_COMMON_WAKEUPSET_HH__
+#define __MEM_RUBY_COMMON_WAKEUPSET_HH__
+
+#include <cstdint>
+#include <set>
+
+#include "base/types.hh"
+
+class WakeupSet
+{
+  public:
+    /** Number of clock edges tracked by the bitmap. */
+    static const unsigned horizonCycles = 256;
+
+    WakeupSet()
+        : m_base(0), m_period(0), m_head(0)
+    {
+        for (unsigned i = 0; i < numWords; i++)
+            m_bits[i] = 0;
+    }
+
+    /**
+     * Check if a wakeup at the given tick has been recorded. Ticks
+     * before the current window have already been retired.
+     */
+    bool
+    contains(Tick time) const
+    {
+        unsigned idx;
+        if (inWindow(time, idx))
+            return m_bits[idx / bitsPerWord] & (1ULL << (idx % bitsPerWord));
+        if (time < m_base || m_far.empty())
+            return false;
+        return m_far.find(time) != m_far.end();
+    }
+
+    /** Record a wakeup at the given tick. */
+    void
+    insert(Tick time)
+    {
+        unsigned idx;
+        if (inWindow(time, idx)) {
+            m_bits[idx / bitsPerWord] |= 1ULL << (idx % bitsPerWord);
+        } else if (time >= m_base) {
+            m_far.insert(time);
+        }
+    }
+
+    /**
+     * Retire all wakeups before the given clock edge and move the
+     * window so that it starts at that edge.
+     *
+     * @param edge The current clock edge of the consumer
+     * @param period The current clock period of the consumer
+     */
+    void advance(Tick edge, Tick period);
+
+    /** Number of wakeups currently recorded. */
+    size_t size() const;
+
+  private:
+    static const unsigned bitsPerWord = 64;
+    static const unsigned numWords = horizonCycles / bitsPerWord;
+
+    /**
+     * Map a tick to its bit in the ring if it lies on a clock edge
+     * within the horizon.
+     */
+    bool
+    inWindow(Tick time, unsigned &idx) const
+    {
+        if (time < m_base || m_period == 0)
+            return false;
+        Tick offset = time - m_base;
+        if (offset >= horizonCycles * m_period || offset % m_period != 0)
+            return false;
+        idx = (m_head + offset / m_period) % horizonCycles;
+        return true;
+    }
+
+    /** Clear count bits of the ring starting at the head. */
+    void clearFromHead(unsigned count);
+
+    /** Move far entries that fall inside the window into the bitmap. */
+    void pullFarEntries();
+
+    /** Tick of the clock edge that bit m_head stands for. */
+    Tick m_base;
+    /** Clock period the window was built with. */
+    Tick m_period;
+    /** Ring position of the first cycle in the window. */
+    unsigned m_head;
+    uint64_t m_bits[numWords];
+
+    /** Wakeups beyond the horizon or off the clock edge. */
+    std::set<Tick> m_far;
+};
+
+#endif // __MEM_RUBY_COMMON_WAKEUPSET_HH__
@@ -29,6 +29,8 @@
 #ifndef __MEM_RUBY_FILTERS_ABSTRACTBLOOMFILTER_HH__
 #define __MEM_RUBY_FILTERS_ABSTRACTBLOOMFILTER_HH__
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 #include "mem/ruby/common/Address.hh"
@@ -36,6 +38,10 @@
 class AbstractBloomFilter
 {
   public:
+    AbstractBloomFilter()
+        : m_num_inserts(0), m_num_queries(0), m_num_positives(0)
+    {}
+
     virtual ~AbstractBloomFilter() {};
     virtual void clear() = 0;
     virtual void increment(Addr addr) = 0;
@@ -48,11 +54,68 @@ class AbstractBloomFilter
     virtual int getCount(Addr addr) = 0;
     virtual int getTotalCount() = 0;
 
-    virtual void print(std::ostream& out) const = 0;
+    /**
+     * Insert a batch of addresses. Filters whose hashes are cheaper to
+     * compute for many addresses at once override this.
+     */
+    virtual void
+    setBulk(const Addr *addrs, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+            set(addrs[i]);
+    }
+
+    /**
+     * Look up a batch of addresses, storing one result per address.
+     * Returns the number of addresses found in the filter.
+     */
+    virtual size_t
+    isSetBulk(const Addr *addrs, size_t n, bool *results)
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < n; i++) {
+            results[i] = isSet(addrs[i]);
+            found += results[i];
+        }
+        return found;
+    }
+
+    // Access counters, kept the same way by every filter. clear()
+    // empties the filter but leaves these alone.
+    uint64_t getNumInserts() const { return m_num_inserts; }
+    uint64_t getNumQueries() const { return m_num_queries; }
+    uint64_t getNumPositives() const { return m_num_positives; }
+
+    void
+    resetStats()
+    {
+        m_num_inserts = m_num_queries = m_num_positives = 0;
+    }
+
+    virtual void
+    print(std::ostream& out) const
+    {
+        out << "[BloomFilter inserts: " << m_num_inserts
+            << " queries: " << m_num_queries
+            << " positives: " << m_num_positives << "]";
+    }
 
     virtual int getIndex(Addr addr) = 0;
     virtual int readBit(const int index) = 0;
     virtual void writeBit(const int index, const int value) = 0;
+
+  protected:
+    bool
+    recordQuery(bool found)
+    {
+        m_num_queries++;
+        m_num_positives += found;
+        return found;
+    }
+
+    uint64_t m_num_inserts;
+    uint64_t m_num_queries;
+    uint64_t m_num_positives;
 };
 
 #endif // __MEM_RUBY_FILTERS_ABSTRACTBLOOMFILTER_HH__
@@ -40,8 +40,6 @@ BlockBloomFilter::BlockBloomFilter(int size)
     m_filter_size_bits = floorLog2(m_filter_size);
 
     m_filter.resize(m_filter_size);
-
-    clear();
 }
 
 BlockBloomFilter::~BlockBloomFilter()
@@ -51,9 +49,7 @@ BlockBloomFilter::~BlockBloomFilter()
 void
 BlockBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    m_filter.clear();
 }
 
 void
@@ -77,41 +73,32 @@ BlockBloomFilter::merge(AbstractBloomFilter * other_filter)
 void
 BlockBloomFilter::set(Addr addr)
 {
-    int i = get_index(addr);
-    m_filter[i] = 1;
+    m_filter.set(get_index(addr));
+    m_num_inserts++;
 }
 
 void
 BlockBloomFilter::unset(Addr addr)
 {
-    int i = get_index(addr);
-    m_filter[i] = 0;
+    m_filter.reset(get_index(addr));
 }
 
 bool
 BlockBloomFilter::isSet(Addr addr)
 {
-    int i = get_index(addr);
-    return (m_filter[i]);
+    return recordQuery(m_filter.test(get_index(addr)));
 }
 
 int
 BlockBloomFilter::getCount(Addr addr)
 {
-    return m_filter[get_index(addr)];
+    return m_filter.test(get_index(addr));
 }
 
 int
 BlockBloomFilter::getTotalCount()
 {
-    int count = 0;
-
-    for (int i = 0; i < m_filter_size; i++) {
-        if (m_filter[i]) {
-            count++;
-        }
-    }
-    return count;
+    return m_filter.count();
 }
 
 int
@@ -120,21 +107,16 @@ BlockBloomFilter::getIndex(Addr addr)
     return get_index(addr);
 }
 
-void
-BlockBloomFilter::print(ostream& out) const
-{
-}
-
 int
 BlockBloomFilter::readBit(const int index)
 {
-    return m_filter[index];
+    return m_filter.test(index);
 }
 
 void
 BlockBloomFilter::writeBit(const int index, const int value)
 {
-    m_filter[index] = value;
+    m_filter.write(index, value);
 }
 
 int
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Bit-packed storage shared by the Ruby Bloom filters. Bits are held
+ * 64 to a word so that clearing, merging and counting a filter touch
+ * size/64 words instead of one int per bit.
+ */
+
+#ifndef __MEM_RUBY_FILTERS_BLOOMBITS_HH__
+#define __MEM_RUBY_FILTERS_BLOOMBITS_HH__
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "base/bitfield.hh"
+
+class BloomBits
+{
+  public:
+    BloomBits() : m_size(0) {}
+
+    void
+    resize(int size)
+    {
+        m_size = size;
+        m_words.assign((size + 63) / 64, 0);
+    }
+
+    int size() const { return m_size; }
+
+    void
+    clear()
+    {
+        std::fill(m_words.begin(), m_words.end(), 0);
+    }
+
+    bool
+    test(int index) const
+    {
+        assert(index >= 0 && index < m_size);
+        return (m_words[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void
+    set(int index)
+    {
+        assert(index >= 0 && index < m_size);
+        m_words[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+
+    void
+    reset(int index)
+    {
+        assert(index >= 0 && index < m_size);
+        m_words[index >> 6] &= ~(uint64_t(1) << (index & 63));
+    }
+
+    void
+    write(int index, bool value)
+    {
+        if (value)
+            set(index);
+        else
+            reset(index);
+    }
+
+    /** Number of bits set in the whole filter. */
+    int
+    count() const
+    {
+        int n = 0;
+        for (uint64_t w : m_words)
+            n += popCount(w);
+        return n;
+    }
+
+    /** OR another filter of the same size into this one. */
+    void
+    merge(const BloomBits &other)
+    {
+        assert(other.m_size == m_size);
+        for (size_t i = 0; i < m_words.size(); i++)
+            m_words[i] |= other.m_words[i];
+    }
+
+  private:
+    std::vector<uint64_t> m_words;
+    int m_size;
+};
+
+#endif // __MEM_RUBY_FILTERS_BLOOMBITS_HH__
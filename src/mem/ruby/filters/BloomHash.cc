@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mem/ruby/filters/BloomHash.hh"
+
+#include <cassert>
+
+void
+BloomHash::init(int num_hashes, int input_bits, const BitMaskFunc &bit_mask)
+{
+    assert(num_hashes > 0 && num_hashes <= maxHashes);
+    assert(input_bits > 0 && input_bits <= 64);
+
+    m_num_hashes = num_hashes;
+    m_num_bytes = (input_bits + 7) / 8;
+    m_table.assign(m_num_bytes * 256 * num_hashes, 0);
+
+    for (int b = 0; b < m_num_bytes; b++) {
+        for (int v = 0; v < 256; v++) {
+            uint32_t *row = &m_table[((b << 8) | v) * num_hashes];
+            for (int i = 0; i < 8; i++) {
+                int bit = 8 * b + i;
+                if (!(v & (1 << i)) || bit >= input_bits)
+                    continue;
+                for (int h = 0; h < num_hashes; h++)
+                    row[h] ^= bit_mask(bit, h);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Table-driven evaluation of hash families that are linear over GF(2),
+ * such as H3 and bit selection. Hash h of a value is the XOR of a
+ * per-bit mask over the set bits of the value, so it can be computed a
+ * byte at a time from precomputed tables. The tables are laid out with
+ * all hashes of one byte value next to each other, so a single call
+ * produces every hash of the value with a short, vectorizable inner
+ * loop and no data-dependent branches.
+ */
+
+#ifndef __MEM_RUBY_FILTERS_BLOOMHASH_HH__
+#define __MEM_RUBY_FILTERS_BLOOMHASH_HH__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class BloomHash
+{
+  public:
+    /** Returns the mask hash @p hash contributes for input bit @p bit. */
+    typedef std::function<uint32_t(int bit, int hash)> BitMaskFunc;
+
+    BloomHash() : m_num_hashes(0), m_num_bytes(0) {}
+
+    /**
+     * Build the lookup tables.
+     *
+     * @param num_hashes Number of hashes computed per value.
+     * @param input_bits Number of low-order input bits that are hashed;
+     *                   higher bits are ignored.
+     * @param bit_mask   Mask of every (input bit, hash) pair.
+     */
+    void init(int num_hashes, int input_bits, const BitMaskFunc &bit_mask);
+
+    int numHashes() const { return m_num_hashes; }
+
+    /** Compute all hashes of @p value into @p out[0..numHashes()). */
+    void
+    hash(uint64_t value, uint32_t *out) const
+    {
+        // Accumulate in a local array so the compiler does not have to
+        // assume @p out aliases the tables.
+        uint32_t acc[maxHashes] = {};
+        const uint32_t *table = m_table.data();
+        for (int b = 0; b < m_num_bytes; b++) {
+            const uint32_t *row =
+                table + ((b << 8) | ((value >> (8 * b)) & 0xff)) *
+                m_num_hashes;
+            for (int h = 0; h < m_num_hashes; h++)
+                acc[h] ^= row[h];
+        }
+        for (int h = 0; h < m_num_hashes; h++)
+            out[h] = acc[h];
+    }
+
+    static const int maxHashes = 32;
+
+  private:
+    int m_num_hashes;
+    int m_num_bytes;
+    // [input byte][byte value][hash]
+    std::vector<uint32_t> m_table;
+};
+
+#endif // __MEM_RUBY_FILTERS_BLOOMHASH_HH__
@@ -43,14 +43,7 @@ BulkBloomFilter::BulkBloomFilter(int size)
     // split the filter bits in half, c0 and c1
     m_sector_bits = m_filter_size_bits - 1;
 
-    m_temp_filter.resize(m_filter_size);
     m_filter.resize(m_filter_size);
-    clear();
-
-    // clear temp filter
-    for (int i = 0; i < m_filter_size; ++i) {
-        m_temp_filter[i] = 0;
-    }
 }
 
 BulkBloomFilter::~BulkBloomFilter()
@@ -60,9 +53,7 @@ BulkBloomFilter::~BulkBloomFilter()
 void
 BulkBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    m_filter.clear();
 }
 
 void
@@ -94,13 +85,11 @@ BulkBloomFilter::set(Addr addr)
     //Address permuted_bits = permute(addr);
     //int c1 = permuted_bits.bitSelect(0, set_bits-1);
     int c1 = bitSelect(addr, block_bits+set_bits, (block_bits+2*set_bits) - 1);
-    //assert(c0 < (m_filter_size/2));
-    //assert(c0 + (m_filter_size/2) < m_filter_size);
-    //assert(c1 < (m_filter_size/2));
     // set v0 bit
-    m_filter[c0 + (m_filter_size/2)] = 1;
+    m_filter.set(c0 + (m_filter_size/2));
     // set v1 bit
-    m_filter[c1] = 1;
+    m_filter.set(c1);
+    m_num_inserts++;
 }
 
 void
@@ -120,49 +109,14 @@ BulkBloomFilter::isSet(Addr addr)
     //Address permuted_bits = permute(addr);
     //int c1 = permuted_bits.bitSelect(0, set_bits-1);
     int c1 = bitSelect(addr, block_bits+set_bits, (block_bits+2*set_bits) - 1);
-    //assert(c0 < (m_filter_size/2));
-    //assert(c0 + (m_filter_size/2) < m_filter_size);
-    //assert(c1 < (m_filter_size/2));
-    // set v0 bit
-    m_temp_filter[c0 + (m_filter_size/2)] = 1;
-    // set v1 bit
-    m_temp_filter[c1] = 1;
-
-    // perform filter intersection. If any c part is 0, no possibility
-    // of address being in signature.  get first c intersection part
-    bool zero = false;
-    for (int i = 0; i < m_filter_size/2; ++i){
-        // get intersection of signatures
-        m_temp_filter[i] = m_temp_filter[i] && m_filter[i];
-        zero = zero || m_temp_filter[i];
-    }
-    zero = !zero;
-    if (zero) {
-        // one section is zero, no possiblility of address in signature
-        // reset bits we just set
-        m_temp_filter[c0 + (m_filter_size / 2)] = 0;
-        m_temp_filter[c1] = 0;
-        return false;
-    }
-
-    // check second section
-    zero = false;
-    for (int i = m_filter_size / 2; i < m_filter_size; ++i) {
-        // get intersection of signatures
-        m_temp_filter[i] =  m_temp_filter[i] && m_filter[i];
-        zero = zero || m_temp_filter[i];
-    }
-    zero = !zero;
-    if (zero) {
-        // one section is zero, no possiblility of address in signature
-        m_temp_filter[c0 + (m_filter_size / 2)] = 0;
-        m_temp_filter[c1] = 0;
-        return false;
-    }
-    // one section has at least one bit set
-    m_temp_filter[c0 + (m_filter_size / 2)] = 0;
-    m_temp_filter[c1] = 0;
-    return true;
+
+    // The query signature has a single bit set in each half, v1 at c1
+    // and v0 at c0 + m_filter_size/2, so intersecting it with the
+    // filter leaves a half non-zero exactly when the filter has that
+    // bit set. If either half is zero there is no possibility of the
+    // address being in the signature.
+    return recordQuery(m_filter.test(c1) &&
+                       m_filter.test(c0 + (m_filter_size / 2)));
 }
 
 int
@@ -175,13 +129,7 @@ BulkBloomFilter::getCount(Addr addr)
 int
 BulkBloomFilter::getTotalCount()
 {
-    int count = 0;
-    for (int i = 0; i < m_filter_size; i++) {
-        if (m_filter[i]) {
-            count++;
-        }
-    }
-    return count;
+    return m_filter.count();
 }
 
 int
@@ -193,19 +141,13 @@ BulkBloomFilter::getIndex(Addr addr)
 int
 BulkBloomFilter::readBit(const int index)
 {
-    return 0;
-    // TODO
+    return m_filter.test(index);
 }
 
 void
 BulkBloomFilter::writeBit(const int index, const int value)
 {
-    // TODO
-}
-
-void
-BulkBloomFilter::print(ostream& out) const
-{
+    m_filter.write(index, value);
 }
 
 int
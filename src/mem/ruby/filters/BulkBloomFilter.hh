@@ -34,6 +34,7 @@
 
 #include "mem/ruby/common/Address.hh"
 #include "mem/ruby/filters/AbstractBloomFilter.hh"
+#include "mem/ruby/filters/BloomBits.hh"
 
 class BulkBloomFilter : public AbstractBloomFilter
 {
@@ -55,14 +56,12 @@ class BulkBloomFilter : public AbstractBloomFilter
     int readBit(const int index);
     void writeBit(const int index, const int value);
 
-    void print(std::ostream& out) const;
 
   private:
     int get_index(Addr addr);
     Addr permute(Addr addr);
 
-    std::vector<int> m_filter;
-    std::vector<int> m_temp_filter;
+    BloomBits m_filter;
 
     int m_filter_size;
     int m_filter_size_bits;
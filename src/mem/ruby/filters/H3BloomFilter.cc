@@ -29,10 +29,11 @@
 #include "mem/ruby/filters/H3BloomFilter.hh"
 
 #include "base/intmath.hh"
+#include "base/logging.hh"
 
 using namespace std;
 
-static int H3[64][16] = {
+static const int H3[64][16] = {
     { 33268410,   395488709,  311024285,  456111753,
       181495008,  119997521,  220697869,  433891432,
       755927921,  515226970,  719448198,  349842774,
@@ -356,37 +357,26 @@ static int H3[64][16] = {
 
 H3BloomFilter::H3BloomFilter(int size, int hashes, bool parallel)
 {
-    //TODO: change this ugly init code...
-    primes_list[0] = 9323;
-    primes_list[1] = 11279;
-    primes_list[2] = 10247;
-    primes_list[3] = 30637;
-    primes_list[4] = 25717;
-    primes_list[5] = 43711;
-
-    mults_list[0] = 255;
-    mults_list[1] = 29;
-    mults_list[2] = 51;
-    mults_list[3] = 3;
-    mults_list[4] = 77;
-    mults_list[5] = 43;
-
-    adds_list[0] = 841;
-    adds_list[1] = 627;
-    adds_list[2] = 1555;
-    adds_list[3] = 241;
-    adds_list[4] = 7777;
-    adds_list[5] = 65931;
-
     m_filter_size = size;
     m_num_hashes = hashes;
     isParallel = parallel;
 
+    fatal_if(m_num_hashes < 1 || m_num_hashes > 16,
+             "H3 Bloom filter supports 1 to 16 hashes, not %d\n",
+             m_num_hashes);
+
     m_filter_size_bits = floorLog2(m_filter_size);
 
     m_par_filter_size = m_filter_size / m_num_hashes;
     m_par_filter_size_bits = floorLog2(m_par_filter_size);
 
+    m_filter_mask = isPowerOf2(m_filter_size) ? m_filter_size - 1 : 0;
+    m_par_filter_mask =
+        isPowerOf2(m_par_filter_size) ? m_par_filter_size - 1 : 0;
+
+    m_hash.init(m_num_hashes, 64,
+                [](int bit, int hash) { return uint32_t(H3[bit][hash]); });
+
     m_filter.resize(m_filter_size);
     clear();
 }
@@ -398,9 +388,7 @@ H3BloomFilter::~H3BloomFilter()
 void
 H3BloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    m_filter.clear();
 }
 
 void
@@ -420,37 +408,71 @@ H3BloomFilter::merge(AbstractBloomFilter *other_filter)
 {
     // assumes both filters are the same size!
     H3BloomFilter * temp = (H3BloomFilter*) other_filter;
-    for (int i = 0; i < m_filter_size; ++i){
-        m_filter[i] |= (*temp)[i];
-    }
+    m_filter.merge(temp->m_filter);
+}
+
+void
+H3BloomFilter::hashAll(Addr addr, uint32_t *hashes) const
+{
+    m_hash.hash(makeLineAddress(addr), hashes);
 }
 
 void
 H3BloomFilter::set(Addr addr)
 {
-    for (int i = 0; i < m_num_hashes; i++) {
-        int idx = get_index(addr, i);
-        m_filter[idx] = 1;
-    }
+    uint32_t hashes[16];
+    hashAll(addr, hashes);
+    for (int i = 0; i < m_num_hashes; i++)
+        m_filter.set(get_index(hashes[i], i));
+    m_num_inserts++;
 }
 
 void
 H3BloomFilter::unset(Addr addr)
 {
-    cout << "ERROR: Unset should never be called in a Bloom filter";
-    assert(0);
+    panic("Unset should never be called in a Bloom filter");
 }
 
 bool
 H3BloomFilter::isSet(Addr addr)
 {
+    uint32_t hashes[16];
+    hashAll(addr, hashes);
+
     bool res = true;
+    for (int i = 0; i < m_num_hashes; i++)
+        res &= m_filter.test(get_index(hashes[i], i));
+    return recordQuery(res);
+}
 
-    for (int i = 0; i < m_num_hashes; i++) {
-        int idx = get_index(addr, i);
-        res = res && m_filter[idx];
+void
+H3BloomFilter::setBulk(const Addr *addrs, size_t n)
+{
+    uint32_t hashes[16];
+    for (size_t a = 0; a < n; a++) {
+        hashAll(addrs[a], hashes);
+        for (int i = 0; i < m_num_hashes; i++)
+            m_filter.set(get_index(hashes[i], i));
+    }
+    m_num_inserts += n;
+}
+
+size_t
+H3BloomFilter::isSetBulk(const Addr *addrs, size_t n, bool *results)
+{
+    uint32_t hashes[16];
+    size_t found = 0;
+    for (size_t a = 0; a < n; a++) {
+        hashAll(addrs[a], hashes);
+        bool res = true;
+        for (int i = 0; i < m_num_hashes; i++)
+            res &= m_filter.test(get_index(hashes[i], i));
+        results[a] = res;
+        found += res;
     }
-    return res;
+    m_num_queries += n;
+    m_num_positives += found;
+    return found;
 }
 
 int
@@ -468,55 +490,17 @@ H3BloomFilter::getIndex(Addr addr)
 int
 H3BloomFilter::readBit(const int index)
 {
-    return 0;
+    return m_filter.test(index);
 }
 
 void
 H3BloomFilter::writeBit(const int index, const int value)
 {
+    m_filter.write(index, value);
 }
 
 int
 H3BloomFilter::getTotalCount()
 {
-    int count = 0;
-
-    for (int i = 0; i < m_filter_size; i++) {
-        count += m_filter[i];
-    }
-    return count;
-}
-
-void
-H3BloomFilter::print(ostream& out) const
-{
+    return m_filter.count();
 }
-
-int
-H3BloomFilter::get_index(Addr addr, int i)
-{
-    uint64_t x = makeLineAddress(addr);
-    // uint64_t y = (x*mults_list[i] + adds_list[i]) % primes_list[i];
-    int y = hash_H3(x,i);
-
-    if (isParallel) {
-        return (y % m_par_filter_size) + i*m_par_filter_size;
-    } else {
-        return y % m_filter_size;
-    }
-}
-
-int
-H3BloomFilter::hash_H3(uint64_t value, int index)
-{
-    uint64_t mask = 1;
-    uint64_t val = value;
-    int result = 0;
-
-    for (int i = 0; i < 64; i++) {
-        if (val&mask) result ^= H3[i][index];
-        val = val >> 1;
-    }
-    return result;
-}
-
@@ -34,6 +34,8 @@
 
 #include "mem/ruby/common/Address.hh"
 #include "mem/ruby/filters/AbstractBloomFilter.hh"
+#include "mem/ruby/filters/BloomBits.hh"
+#include "mem/ruby/filters/BloomHash.hh"
 
 class H3BloomFilter : public AbstractBloomFilter
 {
@@ -51,7 +53,9 @@ class H3BloomFilter : public AbstractBloomFilter
     bool isSet(Addr addr);
     int getCount(Addr addr);
     int getTotalCount();
-    void print(std::ostream& out) const;
+
+    void setBulk(const Addr *addrs, size_t n);
+    size_t isSetBulk(const Addr *addrs, size_t n, bool *results);
 
     int getIndex(Addr addr);
     int readBit(const int index);
@@ -60,15 +64,26 @@ class H3BloomFilter : public AbstractBloomFilter
     int
     operator[](const int index) const
     {
-        return this->m_filter[index];
+        return m_filter.test(index);
     }
 
   private:
-    int get_index(Addr addr, int hashNumber);
+    /** Map hash @p y of hash function @p i onto a filter bit. */
+    int
+    get_index(uint32_t y, int i) const
+    {
+        if (isParallel) {
+            return (m_par_filter_mask ? (y & m_par_filter_mask) :
+                    (y % m_par_filter_size)) + i * m_par_filter_size;
+        } else {
+            return m_filter_mask ? (y & m_filter_mask) : (y % m_filter_size);
+        }
+    }
 
-    int hash_H3(uint64_t value, int index);
+    void hashAll(Addr addr, uint32_t *hashes) const;
 
-    std::vector<int> m_filter;
+    BloomBits m_filter;
+    BloomHash m_hash;
     int m_filter_size;
     int m_num_hashes;
     int m_filter_size_bits;
@@ -76,9 +91,9 @@ class H3BloomFilter : public AbstractBloomFilter
     int m_par_filter_size;
     int m_par_filter_size_bits;
 
-    int primes_list[6];// = {9323,11279,10247,30637,25717,43711};
-    int mults_list[6]; //= {255,29,51,3,77,43};
-    int adds_list[6]; //= {841,627,1555,241,7777,65391};
+    // Masks replacing the modulo when the sizes are powers of two
+    uint32_t m_filter_mask;
+    uint32_t m_par_filter_mask;
 
     bool isParallel;
 };
@@ -28,6 +28,8 @@
 
 #include "mem/ruby/filters/LSB_CountingBloomFilter.hh"
 
+#include <algorithm>
+
 #include "base/intmath.hh"
 #include "mem/ruby/system/RubySystem.hh"
 
@@ -41,8 +43,7 @@ LSB_CountingBloomFilter::LSB_CountingBloomFilter(int head, int tail)
     m_count = tail;
     m_count_bits = floorLog2(m_count);
 
-    m_filter.resize(m_filter_size);
-    clear();
+    m_filter.resize(m_filter_size, 0);
 }
 
 LSB_CountingBloomFilter::~LSB_CountingBloomFilter()
@@ -52,9 +53,7 @@ LSB_CountingBloomFilter::~LSB_CountingBloomFilter()
 void
 LSB_CountingBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    std::fill(m_filter.begin(), m_filter.end(), 0);
 }
 
 void
@@ -63,6 +62,7 @@ LSB_CountingBloomFilter::increment(Addr addr)
     int i = get_index(addr);
     if (m_filter[i] < m_count)
         m_filter[i] += 1;
+    m_num_inserts++;
 }
 
 
@@ -95,8 +95,7 @@ LSB_CountingBloomFilter::unset(Addr addr)
 bool
 LSB_CountingBloomFilter::isSet(Addr addr)
 {
-    // TODO
-    return false;
+    return recordQuery(m_filter[get_index(addr)] > 0);
 }
 
 int
@@ -122,11 +121,6 @@ LSB_CountingBloomFilter::getIndex(Addr addr)
     return get_index(addr);
 }
 
-void
-LSB_CountingBloomFilter::print(ostream& out) const
-{
-}
-
 int
 LSB_CountingBloomFilter::readBit(const int index)
 {
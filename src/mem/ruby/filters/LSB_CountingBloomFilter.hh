@@ -55,7 +55,6 @@ class LSB_CountingBloomFilter : public AbstractBloomFilter
     int readBit(const int index);
     void writeBit(const int index, const int value);
 
-    void print(std::ostream& out) const;
 
   private:
     int get_index(Addr addr);
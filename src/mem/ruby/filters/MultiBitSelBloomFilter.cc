@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "base/intmath.hh"
+#include "base/logging.hh"
 #include "base/str.hh"
 
 using namespace std;
@@ -60,6 +61,23 @@ MultiBitSelBloomFilter::MultiBitSelBloomFilter(string str)
     m_par_filter_size = m_filter_size / m_num_hashes;
     m_par_filter_size_bits = floorLog2(m_par_filter_size);
 
+    // Bit k of hash i selects address bit (i + k * m_num_hashes) % 30,
+    // skipping the block offset and m_skip_bits (36-bit addresses,
+    // 6-bit cache lines).
+    static const int maxBits = 30;
+    const int num_hashes = m_num_hashes;
+    const int num_bits = m_filter_size_bits;
+    m_hash.init(m_num_hashes, maxBits,
+                [num_hashes, num_bits](int bit, int hash) {
+                    uint32_t mask = 0;
+                    for (int k = 0; k < num_bits; k++) {
+                        if ((hash + num_hashes * k) % maxBits == bit)
+                            mask |= uint32_t(1) << k;
+                    }
+                    return mask;
+                });
+    m_hashes.resize(m_num_hashes);
+
     m_filter.resize(m_filter_size);
     clear();
 }
@@ -71,9 +89,7 @@ MultiBitSelBloomFilter::~MultiBitSelBloomFilter()
 void
 MultiBitSelBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    m_filter.clear();
 }
 
 void
@@ -94,37 +110,75 @@ MultiBitSelBloomFilter::merge(AbstractBloomFilter *other_filter)
 {
     // assumes both filters are the same size!
     MultiBitSelBloomFilter * temp = (MultiBitSelBloomFilter*) other_filter;
-    for (int i = 0; i < m_filter_size; ++i){
-        m_filter[i] |= (*temp)[i];
-    }
+    m_filter.merge(temp->m_filter);
+}
+
+void
+MultiBitSelBloomFilter::hashAll(Addr addr, uint32_t *hashes) const
+{
+    // m_skip_bits is used to perform BitSelect after skipping some
+    // bits. Used to simulate BitSel hashing on larger than cache-line
+    // granularities
+    m_hash.hash(makeLineAddress(addr) >> m_skip_bits, hashes);
 }
 
 void
 MultiBitSelBloomFilter::set(Addr addr)
 {
-    for (int i = 0; i < m_num_hashes; i++) {
-        int idx = get_index(addr, i);
-        m_filter[idx] = 1;
-    }
+    uint32_t *hashes = m_hashes.data();
+    hashAll(addr, hashes);
+    for (int i = 0; i < m_num_hashes; i++)
+        m_filter.set(get_index(hashes[i], i));
+    m_num_inserts++;
 }
 
 void
 MultiBitSelBloomFilter::unset(Addr addr)
 {
-    cout << "ERROR: Unset should never be called in a Bloom filter";
-    assert(0);
+    panic("Unset should never be called in a Bloom filter");
 }
 
 bool
 MultiBitSelBloomFilter::isSet(Addr addr)
 {
+    uint32_t *hashes = m_hashes.data();
+    hashAll(addr, hashes);
+
     bool res = true;
+    for (int i = 0; i < m_num_hashes; i++)
+        res &= m_filter.test(get_index(hashes[i], i));
+    return recordQuery(res);
+}
 
-    for (int i=0; i < m_num_hashes; i++) {
-        int idx = get_index(addr, i);
-        res = res && m_filter[idx];
+void
+MultiBitSelBloomFilter::setBulk(const Addr *addrs, size_t n)
+{
+    uint32_t *hashes = m_hashes.data();
+    for (size_t a = 0; a < n; a++) {
+        hashAll(addrs[a], hashes);
+        for (int i = 0; i < m_num_hashes; i++)
+            m_filter.set(get_index(hashes[i], i));
     }
-    return res;
+    m_num_inserts += n;
+}
+
+size_t
+MultiBitSelBloomFilter::isSetBulk(const Addr *addrs, size_t n,
+                                  bool *results)
+{
+    uint32_t *hashes = m_hashes.data();
+    size_t found = 0;
+    for (size_t a = 0; a < n; a++) {
+        hashAll(addrs[a], hashes);
+        bool res = true;
+        for (int i = 0; i < m_num_hashes; i++)
+            res &= m_filter.test(get_index(hashes[i], i));
+        results[a] = res;
+        found += res;
+    }
+    m_num_queries += n;
+    m_num_positives += found;
+    return found;
 }
 
 int
@@ -142,58 +196,17 @@ MultiBitSelBloomFilter::getIndex(Addr addr)
 int
 MultiBitSelBloomFilter::readBit(const int index)
 {
-    return 0;
+    return m_filter.test(index);
 }
 
 void
 MultiBitSelBloomFilter::writeBit(const int index, const int value)
 {
+    m_filter.write(index, value);
 }
 
 int
 MultiBitSelBloomFilter::getTotalCount()
 {
-    int count = 0;
-
-    for (int i = 0; i < m_filter_size; i++) {
-        count += m_filter[i];
-    }
-    return count;
-}
-
-void
-MultiBitSelBloomFilter::print(ostream& out) const
-{
-}
-
-int
-MultiBitSelBloomFilter::get_index(Addr addr, int i)
-{
-    // m_skip_bits is used to perform BitSelect after skipping some
-    // bits. Used to simulate BitSel hashing on larger than cache-line
-    // granularities
-    uint64_t x = (makeLineAddress(addr) >> m_skip_bits);
-    int y = hash_bitsel(x, i, m_num_hashes, 30, m_filter_size_bits);
-    //36-bit addresses, 6-bit cache lines
-
-    if (isParallel) {
-        return (y % m_par_filter_size) + i*m_par_filter_size;
-    } else {
-        return y % m_filter_size;
-    }
-}
-
-int
-MultiBitSelBloomFilter::hash_bitsel(uint64_t value, int index, int jump,
-                                    int maxBits, int numBits)
-{
-    uint64_t mask = 1;
-    int result = 0;
-    int bit, i;
-
-    for (i = 0; i < numBits; i++) {
-        bit = (index + jump*i) % maxBits;
-        if (value & (mask << bit)) result += mask << i;
-    }
-    return result;
+    return m_filter.count();
 }
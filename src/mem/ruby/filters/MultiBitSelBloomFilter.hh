@@ -36,6 +36,8 @@
 #include "mem/ruby/common/Address.hh"
 #include "mem/ruby/common/TypeDefines.hh"
 #include "mem/ruby/filters/AbstractBloomFilter.hh"
+#include "mem/ruby/filters/BloomBits.hh"
+#include "mem/ruby/filters/BloomHash.hh"
 
 class MultiBitSelBloomFilter : public AbstractBloomFilter
 {
@@ -53,7 +55,9 @@ class MultiBitSelBloomFilter : public AbstractBloomFilter
     bool isSet(Addr addr);
     int getCount(Addr addr);
     int getTotalCount();
-    void print(std::ostream& out) const;
+
+    void setBulk(const Addr *addrs, size_t n);
+    size_t isSetBulk(const Addr *addrs, size_t n, bool *results);
 
     int getIndex(Addr addr);
     int readBit(const int index);
@@ -62,16 +66,27 @@ class MultiBitSelBloomFilter : public AbstractBloomFilter
     int
     operator[](const int index) const
     {
-        return this->m_filter[index];
+        return m_filter.test(index);
     }
 
   private:
-    int get_index(Addr addr, int hashNumber);
+    /** Map hash @p y of hash function @p i onto a filter bit. */
+    int
+    get_index(uint32_t y, int i) const
+    {
+        if (isParallel) {
+            return (y % m_par_filter_size) + i * m_par_filter_size;
+        } else {
+            return y % m_filter_size;
+        }
+    }
 
-    int hash_bitsel(uint64_t value, int index, int jump, int maxBits,
-                    int numBits);
+    void hashAll(Addr addr, uint32_t *hashes) const;
 
-    std::vector<int> m_filter;
+    BloomBits m_filter;
+    BloomHash m_hash;
+    // Scratch space for the hashes of one address
+    std::vector<uint32_t> m_hashes;
     int m_filter_size;
     int m_num_hashes;
     int m_filter_size_bits;
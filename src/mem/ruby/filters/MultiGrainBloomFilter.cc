@@ -46,7 +46,6 @@ MultiGrainBloomFilter::MultiGrainBloomFilter(int head, int tail)
 
     m_filter.resize(m_filter_size);
     m_page_filter.resize(m_page_filter_size);
-    clear();
 }
 
 MultiGrainBloomFilter::~MultiGrainBloomFilter()
@@ -56,12 +55,8 @@ MultiGrainBloomFilter::~MultiGrainBloomFilter()
 void
 MultiGrainBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
-    for (int i=0; i < m_page_filter_size; ++i){
-        m_page_filter[i] = 0;
-    }
+    m_filter.clear();
+    m_page_filter.clear();
 }
 
 void
@@ -87,11 +82,12 @@ void
 MultiGrainBloomFilter::set(Addr addr)
 {
     int i = get_block_index(addr);
+    int j = get_page_index(addr);
     assert(i < m_filter_size);
-    assert(get_page_index(addr) < m_page_filter_size);
-    m_filter[i] = 1;
-    m_page_filter[i] = 1;
-
+    assert(j < m_page_filter_size);
+    m_filter.set(i);
+    m_page_filter.set(j);
+    m_num_inserts++;
 }
 
 void
@@ -104,10 +100,11 @@ bool
 MultiGrainBloomFilter::isSet(Addr addr)
 {
     int i = get_block_index(addr);
+    int j = get_page_index(addr);
     assert(i < m_filter_size);
-    assert(get_page_index(addr) < m_page_filter_size);
+    assert(j < m_page_filter_size);
     // we have to have both indices set
-    return (m_filter[i] && m_page_filter[i]);
+    return recordQuery(m_filter.test(i) && m_page_filter.test(j));
 }
 
 int
@@ -120,17 +117,7 @@ MultiGrainBloomFilter::getCount(Addr addr)
 int
 MultiGrainBloomFilter::getTotalCount()
 {
-    int count = 0;
-
-    for (int i = 0; i < m_filter_size; i++) {
-        count += m_filter[i];
-    }
-
-    for (int i=0; i < m_page_filter_size; ++i) {
-        count += m_page_filter[i] = 0;
-    }
-
-    return count;
+    return m_filter.count() + m_page_filter.count();
 }
 
 int
@@ -153,11 +140,6 @@ MultiGrainBloomFilter::writeBit(const int index, const int value)
     // TODO
 }
 
-void
-MultiGrainBloomFilter::print(ostream& out) const
-{
-}
-
 int
 MultiGrainBloomFilter::get_block_index(Addr addr)
 {
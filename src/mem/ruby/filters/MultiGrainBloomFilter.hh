@@ -34,6 +34,7 @@
 
 #include "mem/ruby/common/Address.hh"
 #include "mem/ruby/filters/AbstractBloomFilter.hh"
+#include "mem/ruby/filters/BloomBits.hh"
 
 class MultiGrainBloomFilter : public AbstractBloomFilter
 {
@@ -55,18 +56,17 @@ class MultiGrainBloomFilter : public AbstractBloomFilter
     int readBit(const int index);
     void writeBit(const int index, const int value);
 
-    void print(std::ostream& out) const;
 
   private:
     int get_block_index(Addr addr);
     int get_page_index(Addr addr);
 
     // The block filter
-    std::vector<int> m_filter;
+    BloomBits m_filter;
     int m_filter_size;
     int m_filter_size_bits;
     // The page number filter
-    std::vector<int> m_page_filter;
+    BloomBits m_page_filter;
     int m_page_filter_size;
     int m_page_filter_size_bits;
 };
@@ -42,7 +42,6 @@ NonCountingBloomFilter::NonCountingBloomFilter(int head, int tail)
     m_filter_size_bits = floorLog2(m_filter_size);
 
     m_filter.resize(m_filter_size);
-    clear();
 }
 
 NonCountingBloomFilter::~NonCountingBloomFilter()
@@ -52,9 +51,7 @@ NonCountingBloomFilter::~NonCountingBloomFilter()
 void
 NonCountingBloomFilter::clear()
 {
-    for (int i = 0; i < m_filter_size; i++) {
-        m_filter[i] = 0;
-    }
+    m_filter.clear();
 }
 
 void
@@ -74,53 +71,39 @@ NonCountingBloomFilter::merge(AbstractBloomFilter *other_filter)
 {
     // assumes both filters are the same size!
     NonCountingBloomFilter * temp = (NonCountingBloomFilter*) other_filter;
-    for (int i = 0; i < m_filter_size; ++i){
-        m_filter[i] |= (*temp)[i];
-    }
+    m_filter.merge(temp->m_filter);
 }
 
 void
 NonCountingBloomFilter::set(Addr addr)
 {
-    int i = get_index(addr);
-    m_filter[i] = 1;
+    m_filter.set(get_index(addr));
+    m_num_inserts++;
 }
 
 void
 NonCountingBloomFilter::unset(Addr addr)
 {
-    int i = get_index(addr);
-    m_filter[i] = 0;
+    m_filter.reset(get_index(addr));
 }
 
 bool
 NonCountingBloomFilter::isSet(Addr addr)
 {
-    int i = get_index(addr);
-    return (m_filter[i]);
+    return recordQuery(m_filter.test(get_index(addr)));
 }
 
 
 int
 NonCountingBloomFilter::getCount(Addr addr)
 {
-    return m_filter[get_index(addr)];
+    return m_filter.test(get_index(addr));
 }
 
 int
 NonCountingBloomFilter::getTotalCount()
 {
-    int count = 0;
-
-    for (int i = 0; i < m_filter_size; i++) {
-        count += m_filter[i];
-    }
-    return count;
-}
-
-void
-NonCountingBloomFilter::print(ostream& out) const
-{
+    return m_filter.count();
 }
 
 int
@@ -132,13 +115,13 @@ NonCountingBloomFilter::getIndex(Addr addr)
 int
 NonCountingBloomFilter::readBit(const int index)
 {
-    return m_filter[index];
+    return m_filter.test(index);
 }
 
 void
 NonCountingBloomFilter::writeBit(const int index, const int value)
 {
-    m_filter[index] = value;
+    m_filter.write(index, value);
 }
 
 int
@@ -34,6 +34,7 @@
 
 #include "mem/ruby/common/Address.hh"
 #include "mem/ruby/filters/AbstractBloomFilter.hh"
+#include "mem/ruby/filters/BloomBits.hh"
 
 class NonCountingBloomFilter : public AbstractBloomFilter
 {
@@ -56,18 +57,17 @@ class NonCountingBloomFilter : public AbstractBloomFilter
     int readBit(const int index);
     void writeBit(const int index, const int value);
 
-    void print(std::ostream& out) const;
 
     int
     operator[](const int index) const
     {
-        return this->m_filter[index];
+        return m_filter.test(index);
     }
 
   private:
     int get_index(Addr addr);
 
-    std::vector<int> m_filter;
+    BloomBits m_filter;
     int m_filter_size;
     int m_offset;
     int m_filter_size_bits;
@@ -28,9 +28,90 @@
 
 #include "mem/ruby/slicc_interface/AbstractCacheEntry.hh"
 
+#include <vector>
+
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/RubyCache.hh"
 
+namespace {
+
+/**
+ * Fixed-size slab allocator for cache entries. Memory is obtained in
+ * chunks of entriesPerChunk entries and is never returned; freed
+ * entries are threaded onto a free list and reused.
+ */
+class EntryArena
+{
+  public:
+    static const size_t entriesPerChunk = 256;
+
+    EntryArena(size_t size) : m_size(size), m_free(nullptr) {}
+
+    size_t getSize() const { return m_size; }
+
+    void *
+    allocate()
+    {
+        if (!m_free)
+            grow();
+        void *ptr = m_free;
+        m_free = *static_cast<void **>(ptr);
+        return ptr;
+    }
+
+    void
+    release(void *ptr)
+    {
+        *static_cast<void **>(ptr) = m_free;
+        m_free = ptr;
+    }
+
+  private:
+    void
+    grow()
+    {
+        char *chunk = static_cast<char *>(
+            ::operator new(m_size * entriesPerChunk));
+        for (size_t i = entriesPerChunk; i > 0; i--)
+            release(chunk + (i - 1) * m_size);
+    }
+
+    size_t m_size;
+    void *m_free;
+};
+
+EntryArena &
+entryArena(size_t size)
+{
+    // Entry types generated by SLICC come in a handful of sizes, so a
+    // linear search over the arenas is cheaper than a map.
+    static std::vector<EntryArena> arenas;
+
+    size = roundUp(size, alignof(std::max_align_t));
+    for (auto &arena : arenas) {
+        if (arena.getSize() == size)
+            return arena;
+    }
+    arenas.emplace_back(size);
+    return arenas.back();
+}
+
+} // anonymous namespace
+
+void *
+AbstractCacheEntry::operator new(size_t size)
+{
+    return entryArena(size).allocate();
+}
+
+void
+AbstractCacheEntry::operator delete(void *ptr, size_t size)
+{
+    if (ptr)
+        entryArena(size).release(ptr);
+}
+
 AbstractCacheEntry::AbstractCacheEntry()
 {
     m_Permission = AccessPermission_NotPresent;
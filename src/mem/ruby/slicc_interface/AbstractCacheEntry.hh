@@ -33,6 +33,7 @@
 #ifndef __MEM_RUBY_SLICC_INTERFACE_ABSTRACTCACHEENTRY_HH__
 #define __MEM_RUBY_SLICC_INTERFACE_ABSTRACTCACHEENTRY_HH__
 
+#include <cstddef>
 #include <iostream>
 
 #include "base/logging.hh"
@@ -48,6 +49,13 @@ class AbstractCacheEntry : public AbstractEntry
     AbstractCacheEntry();
     virtual ~AbstractCacheEntry() = 0;
 
+    // Cache entries are created and destroyed by the protocol every
+    // time a line is filled or evicted. They are carved out of an arena
+    // shared by all entries of the same size, and freed entries are
+    // recycled rather than handed back to the heap.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     // Get/Set permission of the entry
     void changePermission(AccessPermission new_perm);
 
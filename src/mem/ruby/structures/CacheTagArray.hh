@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tag storage for CacheMemory. The line addresses held by all ways of
+ * a set are stored next to each other so that a lookup is a single
+ * sweep over one short, contiguous run of tags instead of a hash probe.
+ */
+
+#ifndef __MEM_RUBY_STRUCTURES_CACHETAGARRAY_HH__
+#define __MEM_RUBY_STRUCTURES_CACHETAGARRAY_HH__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "base/types.hh"
+
+class CacheTagArray
+{
+  public:
+    /** Tag of an unused way; never a valid line address. */
+    static const Addr invalidTag = ~Addr(0);
+
+    CacheTagArray() : m_num_sets(0), m_assoc(0) {}
+
+    void
+    init(int num_sets, int assoc)
+    {
+        m_num_sets = num_sets;
+        m_assoc = assoc;
+        m_tags.assign((size_t)num_sets * assoc, Addr(invalidTag));
+    }
+
+    /**
+     * Find the way of a set holding the given line address.
+     *
+     * @return The way index, or -1 if no way holds the tag.
+     */
+    int
+    find(int64_t set, Addr tag) const
+    {
+        assert(set < m_num_sets);
+        const Addr *ways = &m_tags[set * m_assoc];
+
+        for (int i = 0; i < m_assoc; i++) {
+            if (ways[i] == tag)
+                return i;
+        }
+        return -1;
+    }
+
+    Addr
+    get(int64_t set, int way) const
+    {
+        return m_tags[set * m_assoc + way];
+    }
+
+    void
+    set(int64_t set, int way, Addr tag)
+    {
+        m_tags[set * m_assoc + way] = tag;
+    }
+
+    void
+    clear(int64_t set, int way)
+    {
+        m_tags[set * m_assoc + way] = invalidTag;
+    }
+
+  private:
+    int m_num_sets;
+    int m_assoc;
+
+    /** Tags of set s are m_tags[s * m_assoc ... s * m_assoc + m_assoc). */
+    std::vector<Addr> m_tags;
+};
+
+#endif // __MEM_RUBY_STRUCTURES_CACHETAGARRAY_HH__
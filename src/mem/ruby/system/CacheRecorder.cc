@@ -29,12 +29,99 @@
 
 #include "mem/ruby/system/CacheRecorder.hh"
 
+#include <algorithm>
+#include <cstring>
+
+#include "base/intmath.hh"
 #include "debug/RubyCacheTrace.hh"
 #include "mem/ruby/system/RubySystem.hh"
 #include "mem/ruby/system/Sequencer.hh"
 
 using namespace std;
 
+namespace {
+
+void
+putVarint(vector<uint8_t> &buf, uint64_t val)
+{
+    while (val >= 0x80) {
+        buf.push_back(uint8_t(val) | 0x80);
+        val >>= 7;
+    }
+    buf.push_back(uint8_t(val));
+}
+
+void
+putSigned(vector<uint8_t> &buf, int64_t val)
+{
+    putVarint(buf, (uint64_t(val) << 1) ^ uint64_t(val >> 63));
+}
+
+template <class T>
+void
+putFixed(vector<uint8_t> &buf, T val)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&val);
+    buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+/**
+ * Cursor over an encoded trace that refuses to read past its end.
+ */
+class TraceReader
+{
+  public:
+    TraceReader(const uint8_t *data, uint64_t size)
+        : m_data(data), m_size(size), m_pos(0)
+    {}
+
+    uint64_t
+    getVarint()
+    {
+        uint64_t val = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = *get(1);
+            val |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return val;
+        }
+        fatal("Malformed varint in ruby cache trace\n");
+    }
+
+    int64_t
+    getSigned()
+    {
+        uint64_t val = getVarint();
+        return int64_t(val >> 1) ^ -int64_t(val & 1);
+    }
+
+    template <class T>
+    T
+    getFixed()
+    {
+        T val;
+        memcpy(&val, get(sizeof(T)), sizeof(T));
+        return val;
+    }
+
+    const uint8_t *
+    get(uint64_t bytes)
+    {
+        if (m_pos + bytes > m_size)
+            fatal("Truncated ruby cache trace\n");
+        const uint8_t *p = m_data + m_pos;
+        m_pos += bytes;
+        return p;
+    }
+
+  private:
+    const uint8_t *m_data;
+    uint64_t m_size;
+    uint64_t m_pos;
+};
+
+} // anonymous namespace
+
 void
 TraceRecord::print(ostream& out) const
 {
@@ -46,20 +133,25 @@ TraceRecord::print(ostream& out) const
 CacheRecorder::CacheRecorder()
     : m_uncompressed_trace(NULL),
       m_uncompressed_trace_size(0),
-      m_block_size_bytes(RubySystem::getBlockSizeBytes())
+      m_block_size_bytes(RubySystem::getBlockSizeBytes()),
+      m_parallel_fetch(false)
 {
 }
 
 CacheRecorder::CacheRecorder(uint8_t* uncompressed_trace,
                              uint64_t uncompressed_trace_size,
                              std::vector<Sequencer*>& seq_map,
-                             uint64_t block_size_bytes)
+                             uint64_t block_size_bytes,
+                             bool parallel_fetch)
     : m_uncompressed_trace(uncompressed_trace),
       m_uncompressed_trace_size(uncompressed_trace_size),
       m_seq_map(seq_map),  m_bytes_read(0), m_records_read(0),
-      m_records_flushed(0), m_block_size_bytes(block_size_bytes)
+      m_records_flushed(0), m_block_size_bytes(block_size_bytes),
+      m_parallel_fetch(parallel_fetch)
 {
     if (m_uncompressed_trace != NULL) {
+        decodeTrace();
+
         if (m_block_size_bytes < RubySystem::getBlockSizeBytes()) {
             // Block sizes larger than when the trace was recorded are not
             // supported, as we cannot reliably turn accesses to smaller blocks
@@ -67,6 +159,24 @@ CacheRecorder::CacheRecorder(uint8_t* uncompressed_trace,
             panic("Recorded cache block size (%d) < current block size (%d) !!",
                     m_block_size_bytes, RubySystem::getBlockSizeBytes());
         }
+
+        if (m_parallel_fetch) {
+            // Give every sequencer the records it replays, keeping the
+            // order of the trace within each sequencer.
+            for (uint64_t i = 0; i < getNumRecords(); i++) {
+                TraceRecord *rec = getRecord(m_uncompressed_trace, i);
+                Sequencer *seq = m_seq_map[rec->m_cntrl_id];
+                auto it = find_if(m_fetch_queues.begin(),
+                                  m_fetch_queues.end(),
+                                  [seq](const FetchQueue &q)
+                                  { return q.seq == seq; });
+                if (it == m_fetch_queues.end()) {
+                    m_fetch_queues.push_back(FetchQueue{seq, {}, 0, 0});
+                    it = m_fetch_queues.end() - 1;
+                }
+                it->records.push_back(i);
+            }
+        }
     }
 }
 
@@ -79,11 +189,71 @@ CacheRecorder::~CacheRecorder()
     m_seq_map.clear();
 }
 
+void
+CacheRecorder::decodeTrace()
+{
+    if (m_uncompressed_trace_size < sizeof(uint32_t))
+        return;
+
+    uint32_t magic;
+    memcpy(&magic, m_uncompressed_trace, sizeof(magic));
+    if (magic != traceMagic) {
+        // A trace from before delta encoding, already in the flat layout
+        DPRINTF(RubyCacheTrace, "Restoring unencoded cache trace\n");
+        return;
+    }
+
+    TraceReader reader(m_uncompressed_trace, m_uncompressed_trace_size);
+    reader.getFixed<uint32_t>();
+    m_block_size_bytes = reader.getFixed<uint32_t>();
+    uint64_t num_records = reader.getFixed<uint64_t>();
+    fatal_if(!isPowerOf2(m_block_size_bytes),
+             "Invalid block size %d in ruby cache trace\n",
+             m_block_size_bytes);
+    int block_bits = floorLog2(m_block_size_bytes);
+
+    uint64_t flat_size = num_records * recordSize();
+    uint8_t *flat = new uint8_t[flat_size];
+
+    Tick time = 0;
+    int64_t block = 0;
+    for (uint64_t i = 0; i < num_records; i++) {
+        TraceRecord *rec = getRecord(flat, i);
+        rec->m_cntrl_id = reader.getVarint();
+        time += reader.getSigned();
+        rec->m_time = time;
+        block += reader.getSigned();
+        rec->m_data_address = Addr(block) << block_bits;
+        rec->m_pc_address = reader.getVarint();
+        uint8_t type = reader.getFixed<uint8_t>();
+        rec->m_type = RubyRequestType(type & ~traceZeroData);
+        if (type & traceZeroData) {
+            memset(rec->m_data, 0, m_block_size_bytes);
+        } else {
+            memcpy(rec->m_data, reader.get(m_block_size_bytes),
+                   m_block_size_bytes);
+        }
+    }
+
+    DPRINTF(RubyCacheTrace, "Decoded %d records from %d byte trace\n",
+            num_records, m_uncompressed_trace_size);
+
+    delete [] m_uncompressed_trace;
+    m_uncompressed_trace = flat;
+    m_uncompressed_trace_size = flat_size;
+}
+
+uint64_t
+CacheRecorder::getNumRecords() const
+{
+    return m_uncompressed_trace_size / recordSize();
+}
+
 void
 CacheRecorder::enqueueNextFlushRequest()
 {
-    if (m_records_flushed < m_records.size()) {
-        TraceRecord* rec = m_records[m_records_flushed];
+    if (m_records_flushed < m_records.size() / recordSize()) {
+        TraceRecord* rec = getRecord(m_records.data(), m_records_flushed);
         m_records_flushed++;
         Request* req = new Request(rec->m_data_address,
                                    m_block_size_bytes, 0,
@@ -102,55 +272,96 @@ CacheRecorder::enqueueNextFlushRequest()
 }
 
 void
-CacheRecorder::enqueueNextFetchRequest()
+CacheRecorder::issueFetch(const TraceRecord *traceRecord)
 {
-    if (m_bytes_read < m_uncompressed_trace_size) {
-        TraceRecord* traceRecord = (TraceRecord*) (m_uncompressed_trace +
-                                                                m_bytes_read);
+    DPRINTF(RubyCacheTrace, "Issuing %s\n", *traceRecord);
 
-        DPRINTF(RubyCacheTrace, "Issuing %s\n", *traceRecord);
-
-        for (int rec_bytes_read = 0; rec_bytes_read < m_block_size_bytes;
-                rec_bytes_read += RubySystem::getBlockSizeBytes()) {
-            Request* req = nullptr;
-            MemCmd::Command requestType;
-
-            if (traceRecord->m_type == RubyRequestType_LD) {
-                requestType = MemCmd::ReadReq;
-                req = new Request(traceRecord->m_data_address + rec_bytes_read,
-                    RubySystem::getBlockSizeBytes(), 0, Request::funcMasterId);
-            }   else if (traceRecord->m_type == RubyRequestType_IFETCH) {
-                requestType = MemCmd::ReadReq;
-                req = new Request(traceRecord->m_data_address + rec_bytes_read,
-                        RubySystem::getBlockSizeBytes(),
-                        Request::INST_FETCH, Request::funcMasterId);
-            }   else {
-                requestType = MemCmd::WriteReq;
-                req = new Request(traceRecord->m_data_address + rec_bytes_read,
-                    RubySystem::getBlockSizeBytes(), 0, Request::funcMasterId);
-            }
+    for (int rec_bytes_read = 0; rec_bytes_read < m_block_size_bytes;
+            rec_bytes_read += RubySystem::getBlockSizeBytes()) {
+        Request* req = nullptr;
+        MemCmd::Command requestType;
+
+        if (traceRecord->m_type == RubyRequestType_LD) {
+            requestType = MemCmd::ReadReq;
+            req = new Request(traceRecord->m_data_address + rec_bytes_read,
+                RubySystem::getBlockSizeBytes(), 0, Request::funcMasterId);
+        }   else if (traceRecord->m_type == RubyRequestType_IFETCH) {
+            requestType = MemCmd::ReadReq;
+            req = new Request(traceRecord->m_data_address + rec_bytes_read,
+                    RubySystem::getBlockSizeBytes(),
+                    Request::INST_FETCH, Request::funcMasterId);
+        }   else {
+            requestType = MemCmd::WriteReq;
+            req = new Request(traceRecord->m_data_address + rec_bytes_read,
+                RubySystem::getBlockSizeBytes(), 0, Request::funcMasterId);
+        }
+
+        Packet *pkt = new Packet(req, requestType);
+        pkt->dataStatic(traceRecord->m_data + rec_bytes_read);
+
+        Sequencer* m_sequencer_ptr = m_seq_map[traceRecord->m_cntrl_id];
+        assert(m_sequencer_ptr != NULL);
+        m_sequencer_ptr->makeRequest(pkt);
+    }
+}
 
-            Packet *pkt = new Packet(req, requestType);
-            pkt->dataStatic(traceRecord->m_data + rec_bytes_read);
+void
+CacheRecorder::enqueueNextFetchRequest(Sequencer *seq)
+{
+    if (m_parallel_fetch) {
+        if (seq == nullptr) {
+            // Start replaying on all sequencers at once
+            for (auto &queue : m_fetch_queues)
+                fetchNextRecord(queue);
+            return;
+        }
 
-            Sequencer* m_sequencer_ptr = m_seq_map[traceRecord->m_cntrl_id];
-            assert(m_sequencer_ptr != NULL);
-            m_sequencer_ptr->makeRequest(pkt);
+        for (auto &queue : m_fetch_queues) {
+            if (queue.seq == seq) {
+                assert(queue.outstanding > 0);
+                if (--queue.outstanding == 0)
+                    fetchNextRecord(queue);
+                return;
+            }
         }
+        panic("Fetch completed on a sequencer without warmup records\n");
+    }
 
-        m_bytes_read += (sizeof(TraceRecord) + m_block_size_bytes);
+    if (m_bytes_read < m_uncompressed_trace_size) {
+        TraceRecord* traceRecord = (TraceRecord*) (m_uncompressed_trace +
+                                                                m_bytes_read);
+        issueFetch(traceRecord);
+
+        m_bytes_read += recordSize();
         m_records_read++;
     } else {
         DPRINTF(RubyCacheTrace, "Fetched all %d records\n", m_records_read);
     }
 }
 
+void
+CacheRecorder::fetchNextRecord(FetchQueue &queue)
+{
+    if (queue.next < queue.records.size()) {
+        issueFetch(getRecord(m_uncompressed_trace,
+                             queue.records[queue.next]));
+        queue.next++;
+        queue.outstanding = m_block_size_bytes /
+            RubySystem::getBlockSizeBytes();
+        m_records_read++;
+    } else {
+        DPRINTF(RubyCacheTrace, "Fetched all %d records\n",
+                queue.records.size());
+    }
+}
+
 void
 CacheRecorder::addRecord(int cntrl, Addr data_addr, Addr pc_addr,
                          RubyRequestType type, Tick time, DataBlock& data)
 {
-    TraceRecord* rec = (TraceRecord*)malloc(sizeof(TraceRecord) +
-                                            m_block_size_bytes);
+    m_records.resize(m_records.size() + recordSize());
+    TraceRecord* rec = (TraceRecord*)(m_records.data() + m_records.size() -
+                                      recordSize());
     rec->m_cntrl_id     = cntrl;
     rec->m_time         = time;
     rec->m_data_address = data_addr;
@@ -158,42 +369,64 @@ CacheRecorder::addRecord(int cntrl, Addr data_addr, Addr pc_addr,
     rec->m_type         = type;
     memcpy(rec->m_data, data.getData(0, m_block_size_bytes),
            m_block_size_bytes);
-
-    m_records.push_back(rec);
 }
 
 uint64_t
 CacheRecorder::aggregateRecords(uint8_t **buf, uint64_t total_size)
 {
-    std::sort(m_records.begin(), m_records.end(), compareTraceRecords);
+    uint64_t num_records = m_records.size() / recordSize();
+    vector<const TraceRecord*> order(num_records);
+    for (uint64_t i = 0; i < num_records; i++)
+        order[i] = getRecord(m_records.data(), i);
+    std::stable_sort(order.begin(), order.end(), compareTraceRecords);
 
-    int size = m_records.size();
-    uint64_t current_size = 0;
-    int record_size = sizeof(TraceRecord) + m_block_size_bytes;
+    vector<uint8_t> trace;
+    trace.reserve(m_records.size() / 4);
+    putFixed<uint32_t>(trace, traceMagic);
+    putFixed<uint32_t>(trace, m_block_size_bytes);
+    putFixed<uint64_t>(trace, num_records);
 
-    for (int i = 0; i < size; ++i) {
-        // Determine if we need to expand the buffer size
-        if (current_size + record_size > total_size) {
-            uint8_t* new_buf = new (nothrow) uint8_t[total_size * 2];
-            if (new_buf == NULL) {
-                fatal("Unable to allocate buffer of size %s\n",
-                      total_size * 2);
-            }
-            total_size = total_size * 2;
-            uint8_t* old_buf = *buf;
-            memcpy(new_buf, old_buf, current_size);
-            *buf = new_buf;
-            delete [] old_buf;
+    int block_bits = floorLog2(m_block_size_bytes);
+    Tick time = 0;
+    int64_t block = 0;
+    uint64_t zero_blocks = 0;
+    for (auto rec : order) {
+        putVarint(trace, rec->m_cntrl_id);
+        putSigned(trace, int64_t(rec->m_time - time));
+        time = rec->m_time;
+        assert(rec->m_data_address % m_block_size_bytes == 0);
+        int64_t rec_block = rec->m_data_address >> block_bits;
+        putSigned(trace, rec_block - block);
+        block = rec_block;
+        putVarint(trace, rec->m_pc_address);
+
+        bool zero = all_of(rec->m_data, rec->m_data + m_block_size_bytes,
+                           [](uint8_t b) { return b == 0; });
+        uint8_t type = rec->m_type;
+        assert(!(type & traceZeroData));
+        if (zero) {
+            trace.push_back(type | traceZeroData);
+            zero_blocks++;
+        } else {
+            trace.push_back(type);
+            trace.insert(trace.end(), rec->m_data,
+                         rec->m_data + m_block_size_bytes);
         }
+    }
 
-        // Copy the current record into the buffer
-        memcpy(&((*buf)[current_size]), m_records[i], record_size);
-        current_size += record_size;
+    DPRINTF(RubyCacheTrace, "Encoded %d records (%d zero blocks) in %d "
+            "bytes, %d bytes unencoded\n", num_records, zero_blocks,
+            trace.size(), m_records.size());
 
-        free(m_records[i]);
-        m_records[i] = NULL;
+    if (trace.size() > total_size) {
+        delete [] *buf;
+        *buf = new (nothrow) uint8_t[trace.size()];
+        if (*buf == NULL) {
+            fatal("Unable to allocate buffer of size %s\n", trace.size());
+        }
     }
+    memcpy(*buf, trace.data(), trace.size());
 
     m_records.clear();
-    return current_size;
+    return trace.size();
 }
@@ -43,6 +43,7 @@
 #include "mem/ruby/common/DataBlock.hh"
 #include "mem/ruby/common/TypeDefines.hh"
 
+class RubySystem;
 class Sequencer;
 
 /*!
@@ -50,6 +51,10 @@ class Sequencer;
  * class is an array of length zero. It is used for creating variable
  * length object, so that while writing the data to a file one does not
  * need to copy the meta data and the actual data separately.
+ *
+ * Records are kept back to back in a flat buffer, each one followed by
+ * its data block. This is also the layout of the cache traces written
+ * by older versions of gem5, which can still be restored.
  */
 class TraceRecord {
   public:
@@ -63,19 +68,51 @@ class TraceRecord {
     void print(std::ostream& out) const;
 };
 
+/*!
+ * The cache trace stored in a checkpoint is delta encoded before it is
+ * compressed:
+ *
+ *   uint32_t magic         CacheRecorder::traceMagic
+ *   uint32_t block size    size of the data block of each record
+ *   uint64_t record count
+ *
+ * followed by one entry per record, in replay order:
+ *
+ *   varint   controller id
+ *   varint   zigzag delta of the time to the previous record
+ *   varint   zigzag delta of the block number to the previous record
+ *   varint   pc address
+ *   uint8_t  request type, with traceZeroData set if the block is zero
+ *   data     the data block, omitted if it is all zero
+ *
+ * Fixed size fields are stored in host byte order, just like the flat
+ * record layout used by older traces.
+ */
 class CacheRecorder
 {
   public:
+    static const uint32_t traceMagic = 0x32544352; // "RCT2"
+    static const uint8_t traceZeroData = 0x80;
+
     CacheRecorder();
     ~CacheRecorder();
 
     CacheRecorder(uint8_t* uncompressed_trace,
                   uint64_t uncompressed_trace_size,
                   std::vector<Sequencer*>& SequencerMap,
-                  uint64_t block_size_bytes);
+                  uint64_t block_size_bytes,
+                  bool parallel_fetch = false);
     void addRecord(int cntrl, Addr data_addr, Addr pc_addr,
                    RubyRequestType type, Tick time, DataBlock& data);
 
+    /*!
+     * Sort the recorded cache contents in replay order and encode
+     * them in the trace format described above.
+     *
+     * @param data Buffer for the trace, reallocated if too small.
+     * @param size Size of the buffer passed in.
+     * @return Number of bytes of the encoded trace.
+     */
     uint64_t aggregateRecords(uint8_t **data, uint64_t size);
 
     /*!
@@ -94,15 +131,49 @@ class CacheRecorder
      * checkpoint and issues fetch requests. Except for the first one, a
      * fetch request is issued only after the previous one has completed.
      * It should be possible to use this with any protocol.
+     *
+     * When parallel fetching is enabled, every sequencer replays its own
+     * share of the trace, so up to one record per sequencer is in flight.
+     *
+     * @param seq The sequencer that completed a fetch, if any.
      */
-    void enqueueNextFetchRequest();
+    void enqueueNextFetchRequest(Sequencer *seq = nullptr);
+
+    uint64_t getNumRecords() const;
 
   private:
     // Private copy constructor and assignment operator
     CacheRecorder(const CacheRecorder& obj);
     CacheRecorder& operator=(const CacheRecorder& obj);
 
-    std::vector<TraceRecord*> m_records;
+    uint64_t recordSize() const
+    { return sizeof(TraceRecord) + m_block_size_bytes; }
+
+    TraceRecord *
+    getRecord(uint8_t *buf, uint64_t idx) const
+    {
+        return (TraceRecord*)(buf + idx * recordSize());
+    }
+
+    /*! Decode a delta encoded trace into the flat record layout. */
+    void decodeTrace();
+
+    /*! Issue the fetch requests of one record to its sequencer. */
+    void issueFetch(const TraceRecord *rec);
+
+    /*! Per sequencer replay state used by parallel fetching. */
+    struct FetchQueue
+    {
+        Sequencer *seq;
+        std::vector<uint64_t> records;
+        uint64_t next;
+        int outstanding;
+    };
+
+    void fetchNextRecord(FetchQueue &queue);
+
+    /*! Flat buffer of records being recorded for a checkpoint. */
+    std::vector<uint8_t> m_records;
     uint8_t* m_uncompressed_trace;
     uint64_t m_uncompressed_trace_size;
     std::vector<Sequencer*> m_seq_map;
@@ -110,6 +181,9 @@ class CacheRecorder
     uint64_t m_records_read;
     uint64_t m_records_flushed;
     uint64_t m_block_size_bytes;
+
+    bool m_parallel_fetch;
+    std::vector<FetchQueue> m_fetch_queues;
 };
 
 inline bool
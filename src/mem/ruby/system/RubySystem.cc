@@ -36,6 +36,7 @@
 
 #include "base/intmath.hh"
 #include "base/statistics.hh"
+#include "base/time.hh"
 #include "debug/RubyCacheTrace.hh"
 #include "debug/RubySystem.hh"
 #include "mem/ruby/common/Address.hh"
@@ -58,6 +59,7 @@ bool RubySystem::m_cooldown_enabled = false;
 
 RubySystem::RubySystem(const Params *p)
     : ClockedObject(p), m_access_backing_store(p->access_backing_store),
+      m_warmup_mode(p->warmup_mode), m_warmup_seconds(0),
       m_cache_recorder(NULL)
 {
     m_randomization = p->randomization;
@@ -98,6 +100,21 @@ RubySystem::~RubySystem()
     delete m_profiler;
 }
 
+void
+RubySystem::regStats()
+{
+    ClockedObject::regStats();
+    m_profiler->regStats(name());
+
+    m_warmup_host_seconds
+        .name(name() + ".warmup_host_seconds")
+        .desc("Host time spent restoring the caches from a checkpoint")
+        .scalar(m_warmup_seconds)
+        .precision(2)
+        .flags(Stats::nozero)
+        ;
+}
+
 void
 RubySystem::makeCacheRecorder(uint8_t *uncompressed_trace,
                               uint64_t cache_trace_size,
@@ -128,7 +145,9 @@ RubySystem::makeCacheRecorder(uint8_t *uncompressed_trace,
 
     // Create the CacheRecorder and record the cache trace
     m_cache_recorder = new CacheRecorder(uncompressed_trace, cache_trace_size,
-                                         sequencer_map, block_size_bytes);
+                                         sequencer_map, block_size_bytes,
+                                         m_warmup_mode ==
+                                         Enums::parallel_replay);
 }
 
 void
@@ -350,6 +369,9 @@ RubySystem::startup()
 
     if (m_warmup_enabled) {
         DPRINTF(RubyCacheTrace, "Starting ruby cache warmup\n");
+        Time start;
+        start.setTimer();
+
         // save the current tick value
         Tick curtick_original = curTick();
         // save the event queue head
@@ -374,6 +396,10 @@ RubySystem::startup()
         // Restore curTick and Ruby System's clock
         setCurTick(curtick_original);
         resetClock();
+
+        Time end;
+        end.setTimer();
+        m_warmup_seconds = end - start;
     }
 
     resetStats();
@@ -37,6 +37,8 @@
 
 #include "base/callback.hh"
 #include "base/output.hh"
+#include "base/statistics.hh"
+#include "enums/RubyWarmupMode.hh"
 #include "mem/packet.hh"
 #include "mem/ruby/profiler/Profiler.hh"
 #include "mem/ruby/slicc_interface/AbstractController.hh"
@@ -74,10 +76,7 @@ class RubySystem : public ClockedObject
         return m_profiler;
     }
 
-    void regStats() override {
-        ClockedObject::regStats();
-        m_profiler->regStats(name());
-    }
+    void regStats() override;
     void collateStats() { m_profiler->collateStats(); }
     void resetStats() override;
 
@@ -129,6 +128,11 @@ class RubySystem : public ClockedObject
     static bool m_cooldown_enabled;
     SimpleMemory *m_phys_mem;
     const bool m_access_backing_store;
+    const Enums::RubyWarmupMode m_warmup_mode;
+
+    // Host time spent restoring the caches from a checkpoint
+    double m_warmup_seconds;
+    Stats::Value m_warmup_host_seconds;
 
     Network* m_network;
     std::vector<AbstractController *> m_abs_cntrl_vec;
@@ -31,6 +31,11 @@ from m5.params import *
 from ClockedObject import ClockedObject
 from SimpleMemory import *
 
+# How the caches are restored from the trace in a checkpoint. 'replay'
+# issues the recorded requests one at a time, 'parallel_replay' issues
+# them on all sequencers concurrently.
+class RubyWarmupMode(Enum): vals = ['replay', 'parallel_replay']
+
 class RubySystem(ClockedObject):
     type = 'RubySystem'
     cxx_header = "mem/ruby/system/RubySystem.hh"
@@ -43,6 +48,9 @@ class RubySystem(ClockedObject):
 
     phys_mem = Param.SimpleMemory(NULL, "")
 
+    warmup_mode = Param.RubyWarmupMode('replay',
+        "how to restore the cache contents from a checkpoint")
+
     access_backing_store = Param.Bool(False, "Use phys_mem as the functional \
         store and only use ruby for timing.")
 
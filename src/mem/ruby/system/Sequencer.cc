@@ -63,10 +63,12 @@ Sequencer::Sequencer(const Params *p)
     m_data_cache_hit_latency = p->dcache_hit_latency;
     m_inst_cache_hit_latency = p->icache_hit_latency;
     m_max_outstanding_requests = p->max_outstanding_requests;
+    m_max_requests_per_line = p->max_requests_per_line;
     m_deadlock_threshold = p->deadlock_threshold;
 
     m_coreId = p->coreid; // for tracking the two CorePair sequencers
     assert(m_max_outstanding_requests > 0);
+    assert(m_max_requests_per_line > 0);
     assert(m_deadlock_threshold > 0);
     assert(m_instCache_ptr != NULL);
     assert(m_dataCache_ptr != NULL);
@@ -91,39 +93,23 @@ Sequencer::wakeup()
     // Check across all outstanding requests
     int total_outstanding = 0;
 
-    RequestTable::iterator read = m_readRequestTable.begin();
-    RequestTable::iterator read_end = m_readRequestTable.end();
-    for (; read != read_end; ++read) {
-        SequencerRequest* request = read->second;
-        if (current_time - request->issue_time < m_deadlock_threshold)
-            continue;
-
-        panic("Possible Deadlock detected. Aborting!\n"
-              "version: %d request.paddr: 0x%x m_readRequestTable: %d "
-              "current time: %u issue_time: %d difference: %d\n", m_version,
-              request->pkt->getAddr(), m_readRequestTable.size(),
-              current_time * clockPeriod(), request->issue_time * clockPeriod(),
-              (current_time * clockPeriod()) - (request->issue_time * clockPeriod()));
-    }
-
-    RequestTable::iterator write = m_writeRequestTable.begin();
-    RequestTable::iterator write_end = m_writeRequestTable.end();
-    for (; write != write_end; ++write) {
-        SequencerRequest* request = write->second;
-        if (current_time - request->issue_time < m_deadlock_threshold)
-            continue;
-
-        panic("Possible Deadlock detected. Aborting!\n"
-              "version: %d request.paddr: 0x%x m_writeRequestTable: %d "
-              "current time: %u issue_time: %d difference: %d\n", m_version,
-              request->pkt->getAddr(), m_writeRequestTable.size(),
-              current_time * clockPeriod(), request->issue_time * clockPeriod(),
-              (current_time * clockPeriod()) - (request->issue_time * clockPeriod()));
+    for (const auto &table_entry : m_RequestTable) {
+        for (const auto &request : table_entry.second) {
+            if (current_time - request.issue_time < m_deadlock_threshold)
+                continue;
+
+            panic("Possible Deadlock detected. Aborting!\n"
+                  "version: %d request.paddr: 0x%x m_RequestTable: %d "
+                  "current time: %u issue_time: %d difference: %d\n",
+                  m_version, request.pkt->getAddr(),
+                  m_RequestTable.size(), current_time * clockPeriod(),
+                  request.issue_time * clockPeriod(),
+                  (current_time * clockPeriod()) -
+                  (request.issue_time * clockPeriod()));
+        }
+        total_outstanding += table_entry.second.size();
     }
 
-    total_outstanding += m_writeRequestTable.size();
-    total_outstanding += m_readRequestTable.size();
-
     assert(m_outstanding_count == total_outstanding);
 
     if (m_outstanding_count > 0) {
@@ -160,14 +146,30 @@ void Sequencer::resetStats()
     }
 }
 
-// Insert the request on the correct request table.  Return true if
-// the entry was already present.
-RequestStatus
-Sequencer::insertRequest(PacketPtr pkt, RubyRequestType request_type)
+bool
+Sequencer::canCoalesce(RubyRequestType type)
 {
-    assert(m_outstanding_count ==
-        (m_writeRequestTable.size() + m_readRequestTable.size()));
+    return (type == RubyRequestType_LD) ||
+           (type == RubyRequestType_IFETCH) ||
+           (type == RubyRequestType_ST) ||
+           (type == RubyRequestType_RMW_Read);
+}
+
+bool
+Sequencer::isWriteType(RubyRequestType type)
+{
+    return (type != RubyRequestType_LD) &&
+           (type != RubyRequestType_IFETCH);
+}
 
+// Insert the request in the queue of its cache line. Returns Ready if
+// the request must be issued to the controller, Issued if it was queued
+// behind an outstanding request to the same line, and Aliased if it has
+// to be retried later.
+RequestStatus
+Sequencer::insertRequest(PacketPtr pkt, RubyRequestType request_type,
+                         RubyRequestType secondary_type)
+{
     // See if we should schedule a deadlock check
     if (!deadlockCheckEvent.scheduled() &&
         drainState() != DrainState::Draining) {
@@ -185,63 +187,43 @@ Sequencer::insertRequest(PacketPtr pkt, RubyRequestType request_type)
         return RequestStatus_Aliased;
     }
 
-    // Create a default entry, mapping the address to NULL, the cast is
-    // there to make gcc 4.4 happy
-    RequestTable::value_type default_entry(line_addr,
-                                           (SequencerRequest*) NULL);
-
-    if ((request_type == RubyRequestType_ST) ||
-        (request_type == RubyRequestType_RMW_Read) ||
-        (request_type == RubyRequestType_RMW_Write) ||
-        (request_type == RubyRequestType_Load_Linked) ||
-        (request_type == RubyRequestType_Store_Conditional) ||
-        (request_type == RubyRequestType_Locked_RMW_Read) ||
-        (request_type == RubyRequestType_Locked_RMW_Write) ||
-        (request_type == RubyRequestType_FLUSH)) {
-
-        // Check if there is any outstanding read request for the same
-        // cache line.
-        if (m_readRequestTable.count(line_addr) > 0) {
-            m_store_waiting_on_load++;
-            return RequestStatus_Aliased;
-        }
-
-        pair<RequestTable::iterator, bool> r =
-            m_writeRequestTable.insert(default_entry);
-        if (r.second) {
-            RequestTable::iterator i = r.first;
-            i->second = new SequencerRequest(pkt, request_type, curCycle());
-            m_outstanding_count++;
-        } else {
-          // There is an outstanding write request for the cache line
-          m_store_waiting_on_store++;
-          return RequestStatus_Aliased;
-        }
-    } else {
-        // Check if there is any outstanding write request for the same
-        // cache line.
-        if (m_writeRequestTable.count(line_addr) > 0) {
-            m_load_waiting_on_store++;
+    auto table_entry = m_RequestTable.find(line_addr);
+    if (table_entry != m_RequestTable.end()) {
+        std::list<SequencerRequest> &seq_req_list = table_entry->second;
+        assert(!seq_req_list.empty());
+
+        if (seq_req_list.size() >= m_max_requests_per_line ||
+            !canCoalesce(request_type) ||
+            !canCoalesce(seq_req_list.back().m_type)) {
+            // The line is busy and this request cannot wait on it, so
+            // the CPU has to retry it.
+            bool pending_write = isWriteType(seq_req_list.front().m_type);
+            if (isWriteType(request_type)) {
+                if (pending_write)
+                    m_store_waiting_on_store++;
+                else
+                    m_store_waiting_on_load++;
+            } else {
+                if (pending_write)
+                    m_load_waiting_on_store++;
+                else
+                    m_load_waiting_on_load++;
+            }
             return RequestStatus_Aliased;
         }
 
-        pair<RequestTable::iterator, bool> r =
-            m_readRequestTable.insert(default_entry);
-
-        if (r.second) {
-            RequestTable::iterator i = r.first;
-            i->second = new SequencerRequest(pkt, request_type, curCycle());
-            m_outstanding_count++;
-        } else {
-            // There is an outstanding read request for the cache line
-            m_load_waiting_on_load++;
-            return RequestStatus_Aliased;
-        }
+        seq_req_list.emplace_back(pkt, request_type, secondary_type,
+                                  curCycle());
+        m_outstanding_count++;
+        m_alias_retries_avoided++;
+        m_outstandReqHist.sample(m_outstanding_count);
+        return RequestStatus_Issued;
     }
 
+    m_RequestTable[line_addr].emplace_back(pkt, request_type,
+                                           secondary_type, curCycle());
+    m_outstanding_count++;
     m_outstandReqHist.sample(m_outstanding_count);
-    assert(m_outstanding_count ==
-        (m_writeRequestTable.size() + m_readRequestTable.size()));
 
     return RequestStatus_Ready;
 }
@@ -250,8 +232,7 @@ void
 Sequencer::markRemoved()
 {
     m_outstanding_count--;
-    assert(m_outstanding_count ==
-           m_writeRequestTable.size() + m_readRequestTable.size());
+    assert(m_outstanding_count >= 0);
 }
 
 void
@@ -365,51 +346,71 @@ Sequencer::writeCallback(Addr address, DataBlock& data,
                          const Cycles firstResponseTime)
 {
     assert(address == makeLineAddress(address));
-    assert(m_writeRequestTable.count(makeLineAddress(address)));
-
-    RequestTable::iterator i = m_writeRequestTable.find(address);
-    assert(i != m_writeRequestTable.end());
-    SequencerRequest* request = i->second;
-
-    m_writeRequestTable.erase(i);
-    markRemoved();
-
-    assert((request->m_type == RubyRequestType_ST) ||
-           (request->m_type == RubyRequestType_ATOMIC) ||
-           (request->m_type == RubyRequestType_RMW_Read) ||
-           (request->m_type == RubyRequestType_RMW_Write) ||
-           (request->m_type == RubyRequestType_Load_Linked) ||
-           (request->m_type == RubyRequestType_Store_Conditional) ||
-           (request->m_type == RubyRequestType_Locked_RMW_Read) ||
-           (request->m_type == RubyRequestType_Locked_RMW_Write) ||
-           (request->m_type == RubyRequestType_FLUSH));
-
-    //
-    // For Alpha, properly handle LL, SC, and write requests with respect to
-    // locked cache blocks.
-    //
-    // Not valid for Garnet_standalone protocl
-    //
-    bool success = true;
-    if (!m_runningGarnetStandalone)
-        success = handleLlsc(address, request);
-
-    // Handle SLICC block_on behavior for Locked_RMW accesses. NOTE: the
-    // address variable here is assumed to be a line address, so when
-    // blocking buffers, must check line addresses.
-    if (request->m_type == RubyRequestType_Locked_RMW_Read) {
-        // blockOnQueue blocks all first-level cache controller queues
-        // waiting on memory accesses for the specified address that go to
-        // the specified queue. In this case, a Locked_RMW_Write must go to
-        // the mandatory_q before unblocking the first-level controller.
-        // This will block standard loads, stores, ifetches, etc.
-        m_controller->blockOnQueue(address, m_mandatory_q_ptr);
-    } else if (request->m_type == RubyRequestType_Locked_RMW_Write) {
-        m_controller->unblock(address);
+    assert(m_RequestTable.count(address));
+
+    // The list is not erased from the table until it drains, and
+    // std::unordered_map keeps references stable across rehashing, so
+    // requests inserted by the hit callbacks below are safe to append.
+    std::list<SequencerRequest> &seq_req_list = m_RequestTable[address];
+    assert(isWriteType(seq_req_list.front().m_type));
+
+    // Write permission satisfies every request waiting on the line,
+    // whatever its type. The first one is the request the controller
+    // actually serviced.
+    bool ruby_request = true;
+    while (!seq_req_list.empty()) {
+        SequencerRequest &request = seq_req_list.front();
+
+        assert((request.m_type == RubyRequestType_LD) ||
+               (request.m_type == RubyRequestType_IFETCH) ||
+               (request.m_type == RubyRequestType_ST) ||
+               (request.m_type == RubyRequestType_ATOMIC) ||
+               (request.m_type == RubyRequestType_RMW_Read) ||
+               (request.m_type == RubyRequestType_RMW_Write) ||
+               (request.m_type == RubyRequestType_Load_Linked) ||
+               (request.m_type == RubyRequestType_Store_Conditional) ||
+               (request.m_type == RubyRequestType_Locked_RMW_Read) ||
+               (request.m_type == RubyRequestType_Locked_RMW_Write) ||
+               (request.m_type == RubyRequestType_FLUSH));
+
+        //
+        // For Alpha, properly handle LL, SC, and write requests with
+        // respect to locked cache blocks.
+        //
+        // Not valid for Garnet_standalone protocl
+        //
+        bool success = true;
+        if (!m_runningGarnetStandalone && isWriteType(request.m_type))
+            success = handleLlsc(address, &request);
+
+        // Handle SLICC block_on behavior for Locked_RMW accesses. NOTE: the
+        // address variable here is assumed to be a line address, so when
+        // blocking buffers, must check line addresses.
+        if (request.m_type == RubyRequestType_Locked_RMW_Read) {
+            // blockOnQueue blocks all first-level cache controller queues
+            // waiting on memory accesses for the specified address that go
+            // to the specified queue. In this case, a Locked_RMW_Write must
+            // go to the mandatory_q before unblocking the first-level
+            // controller. This will block standard loads, stores, ifetches,
+            // etc.
+            m_controller->blockOnQueue(address, m_mandatory_q_ptr);
+        } else if (request.m_type == RubyRequestType_Locked_RMW_Write) {
+            m_controller->unblock(address);
+        }
+
+        if (!ruby_request)
+            m_coalesced_requests++;
+
+        hitCallback(&request, data, success, mach, externalHit,
+                    initialRequestTime, forwardRequestTime,
+                    firstResponseTime, ruby_request);
+        ruby_request = false;
+
+        seq_req_list.pop_front();
+        markRemoved();
     }
 
-    hitCallback(request, data, success, mach, externalHit,
-                initialRequestTime, forwardRequestTime, firstResponseTime);
+    m_RequestTable.erase(address);
 }
 
 void
@@ -420,20 +421,41 @@ Sequencer::readCallback(Addr address, DataBlock& data,
                         Cycles firstResponseTime)
 {
     assert(address == makeLineAddress(address));
-    assert(m_readRequestTable.count(makeLineAddress(address)));
+    assert(m_RequestTable.count(address));
+
+    std::list<SequencerRequest> &seq_req_list = m_RequestTable[address];
+    assert(!isWriteType(seq_req_list.front().m_type));
+
+    // Read permission satisfies the leading run of reads. The first
+    // request needing write permission is sent to the controller in
+    // turn and keeps the rest of the queue waiting behind it.
+    bool ruby_request = true;
+    while (!seq_req_list.empty()) {
+        SequencerRequest &request = seq_req_list.front();
+
+        if (isWriteType(request.m_type)) {
+            assert(!ruby_request);
+            request.issue_time = curCycle();
+            issueRequest(request.pkt, request.m_second_type);
+            return;
+        }
 
-    RequestTable::iterator i = m_readRequestTable.find(address);
-    assert(i != m_readRequestTable.end());
-    SequencerRequest* request = i->second;
+        assert((request.m_type == RubyRequestType_LD) ||
+               (request.m_type == RubyRequestType_IFETCH));
 
-    m_readRequestTable.erase(i);
-    markRemoved();
+        if (!ruby_request)
+            m_coalesced_requests++;
 
-    assert((request->m_type == RubyRequestType_LD) ||
-           (request->m_type == RubyRequestType_IFETCH));
+        hitCallback(&request, data, true, mach, externalHit,
+                    initialRequestTime, forwardRequestTime,
+                    firstResponseTime, ruby_request);
+        ruby_request = false;
 
-    hitCallback(request, data, true, mach, externalHit,
-                initialRequestTime, forwardRequestTime, firstResponseTime);
+        seq_req_list.pop_front();
+        markRemoved();
+    }
+
+    m_RequestTable.erase(address);
 }
 
 void
@@ -442,7 +464,8 @@ Sequencer::hitCallback(SequencerRequest* srequest, DataBlock& data,
                        const MachineType mach, const bool externalHit,
                        const Cycles initialRequestTime,
                        const Cycles forwardRequestTime,
-                       const Cycles firstResponseTime)
+                       const Cycles firstResponseTime,
+                       const bool ruby_request)
 {
     warn_once("Replacement policy updates recently became the responsibility "
               "of SLICC state machines. Make sure to setMRU() near callbacks "
@@ -456,10 +479,14 @@ Sequencer::hitCallback(SequencerRequest* srequest, DataBlock& data,
     assert(curCycle() >= issued_time);
     Cycles total_latency = curCycle() - issued_time;
 
-    // Profile the latency for all demand accesses.
-    recordMissLatency(total_latency, type, mach, externalHit, issued_time,
-                      initialRequestTime, forwardRequestTime,
-                      firstResponseTime, curCycle());
+    // Profile the latency for all demand accesses the controller
+    // serviced; coalesced requests only rode along on the same fill.
+    if (ruby_request) {
+        recordMissLatency(total_latency, type, mach, externalHit,
+                          issued_time, initialRequestTime,
+                          forwardRequestTime, firstResponseTime,
+                          curCycle());
+    }
 
     DPRINTFR(ProtocolTrace, "%15s %3s %10s%20s %6s>%-6s %#x %d cycles\n",
              curTick(), m_version, "Seq",
@@ -511,14 +538,12 @@ Sequencer::hitCallback(SequencerRequest* srequest, DataBlock& data,
         testerSenderState->subBlock.mergeFrom(data);
     }
 
-    delete srequest;
-
     RubySystem *rs = m_ruby_system;
     if (RubySystem::getWarmupEnabled()) {
         assert(pkt->req);
         delete pkt->req;
         delete pkt;
-        rs->m_cache_recorder->enqueueNextFetchRequest();
+        rs->m_cache_recorder->enqueueNextFetchRequest(this);
     } else if (RubySystem::getCooldownEnabled()) {
         delete pkt;
         rs->m_cache_recorder->enqueueNextFlushRequest();
@@ -531,7 +556,7 @@ Sequencer::hitCallback(SequencerRequest* srequest, DataBlock& data,
 bool
 Sequencer::empty() const
 {
-    return m_writeRequestTable.empty() && m_readRequestTable.empty();
+    return m_RequestTable.empty();
 }
 
 RequestStatus
@@ -614,7 +639,7 @@ Sequencer::makeRequest(PacketPtr pkt)
         }
     }
 
-    RequestStatus status = insertRequest(pkt, primary_type);
+    RequestStatus status = insertRequest(pkt, primary_type, secondary_type);
     if (status != RequestStatus_Ready)
         return status;
 
@@ -673,29 +698,19 @@ Sequencer::issueRequest(PacketPtr pkt, RubyRequestType secondary_type)
     m_mandatory_q_ptr->enqueue(msg, clockEdge(), cyclesToTicks(latency));
 }
 
-template <class KEY, class VALUE>
-std::ostream &
-operator<<(ostream &out, const std::unordered_map<KEY, VALUE> &map)
-{
-    auto i = map.begin();
-    auto end = map.end();
-
-    out << "[";
-    for (; i != end; ++i)
-        out << " " << i->first << "=" << i->second;
-    out << " ]";
-
-    return out;
-}
-
 void
 Sequencer::print(ostream& out) const
 {
     out << "[Sequencer: " << m_version
         << ", outstanding requests: " << m_outstanding_count
-        << ", read request table: " << m_readRequestTable
-        << ", write request table: " << m_writeRequestTable
-        << "]";
+        << ", request table: [";
+    for (const auto &table_entry : m_RequestTable) {
+        out << " " << table_entry.first << "=[";
+        for (const auto &request : table_entry.second)
+            out << " " << RubyRequestType_to_string(request.m_type);
+        out << " ]";
+    }
+    out << " ]]";
 }
 
 // this can be called from setState whenever coherence permissions are
@@ -743,6 +758,16 @@ Sequencer::regStats()
         .name(name() + ".load_waiting_on_store")
         .desc("Number of times a load aliased with a pending store")
         .flags(Stats::nozero);
+    m_coalesced_requests
+        .name(name() + ".coalesced_requests")
+        .desc("Number of requests satisfied by a fill for an earlier "
+              "request to the same line")
+        .flags(Stats::nozero);
+    m_alias_retries_avoided
+        .name(name() + ".alias_retries_avoided")
+        .desc("Number of requests queued on a busy line instead of "
+              "being retried")
+        .flags(Stats::nozero);
 
     // These statistical variables are not for display.
     // The profiler will collate these across different
@@ -30,6 +30,7 @@
 #define __MEM_RUBY_SYSTEM_SEQUENCER_HH__
 
 #include <iostream>
+#include <list>
 #include <unordered_map>
 
 #include "mem/protocol/MachineType.hh"
@@ -44,11 +45,15 @@ struct SequencerRequest
 {
     PacketPtr pkt;
     RubyRequestType m_type;
+    // The type actually sent to the controller, needed to reissue a
+    // request that was queued behind one of a different kind.
+    RubyRequestType m_second_type;
     Cycles issue_time;
 
     SequencerRequest(PacketPtr _pkt, RubyRequestType _m_type,
-                     Cycles _issue_time)
-        : pkt(_pkt), m_type(_m_type), issue_time(_issue_time)
+                     RubyRequestType _m_second_type, Cycles _issue_time)
+        : pkt(_pkt), m_type(_m_type), m_second_type(_m_second_type),
+          issue_time(_issue_time)
     {}
 };
 
@@ -156,7 +161,8 @@ class Sequencer : public RubyPort
                      const MachineType mach, const bool externalHit,
                      const Cycles initialRequestTime,
                      const Cycles forwardRequestTime,
-                     const Cycles firstResponseTime);
+                     const Cycles firstResponseTime,
+                     const bool ruby_request);
 
     void recordMissLatency(const Cycles t, const RubyRequestType type,
                            const MachineType respondingMach,
@@ -165,9 +171,16 @@ class Sequencer : public RubyPort
                            Cycles forwardRequestTime, Cycles firstResponseTime,
                            Cycles completionTime);
 
-    RequestStatus insertRequest(PacketPtr pkt, RubyRequestType request_type);
+    RequestStatus insertRequest(PacketPtr pkt, RubyRequestType request_type,
+                                RubyRequestType secondary_type);
     bool handleLlsc(Addr address, SequencerRequest* request);
 
+    // True if a request of this type may wait behind, or be waited on
+    // by, other requests to the same line. LL/SC, locked RMWs and
+    // flushes keep exclusive use of the line while outstanding.
+    static bool canCoalesce(RubyRequestType type);
+    static bool isWriteType(RubyRequestType type);
+
     // Private copy constructor and assignment operator
     Sequencer(const Sequencer& obj);
     Sequencer& operator=(const Sequencer& obj);
@@ -186,10 +199,15 @@ class Sequencer : public RubyPort
     Cycles m_data_cache_hit_latency;
     Cycles m_inst_cache_hit_latency;
 
-    typedef std::unordered_map<Addr, SequencerRequest*> RequestTable;
-    RequestTable m_writeRequestTable;
-    RequestTable m_readRequestTable;
-    // Global outstanding request count, across all request tables
+    // Outstanding requests, queued per cache line in arrival order.
+    // Only the request at the head of each queue has been sent to the
+    // controller; the rest are satisfied by the same fill.
+    typedef std::unordered_map<Addr, std::list<SequencerRequest>>
+        RequestTable;
+    RequestTable m_RequestTable;
+    // Maximum number of requests queued on a single line
+    unsigned m_max_requests_per_line;
+    // Global outstanding request count, across all request queues
     int m_outstanding_count;
     bool m_deadlock_check_scheduled;
 
@@ -199,6 +217,12 @@ class Sequencer : public RubyPort
     Stats::Scalar m_load_waiting_on_store;
     Stats::Scalar m_load_waiting_on_load;
 
+    //! Requests satisfied by a fill issued for an earlier request.
+    Stats::Scalar m_coalesced_requests;
+    //! Requests queued on a busy line instead of being returned as
+    //! aliased and retried by the CPU.
+    Stats::Scalar m_alias_retries_avoided;
+
     int m_coreId;
 
     bool m_runningGarnetStandalone;
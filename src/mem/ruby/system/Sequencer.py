@@ -71,6 +71,9 @@ class RubySequencer(RubyPort):
    dcache_hit_latency = Param.Cycles(1, "Data cache hit latency")
    max_outstanding_requests = Param.Int(16,
        "max requests (incl. prefetches) outstanding")
+   max_requests_per_line = Param.Unsigned(1,
+       "max requests queued on one cache line; later requests to a busy "
+       "line are satisfied by the same fill instead of being retried")
    deadlock_threshold = Param.Cycles(500000,
        "max outstanding cycles for a request before deadlock/livelock declared")
    garnet_standalone = Param.Bool(False, "")
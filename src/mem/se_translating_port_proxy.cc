@@ -44,13 +44,17 @@
 
 #include "mem/se_translating_port_proxy.hh"
 
+#include <cstring>
 #include <string>
 
 #include "arch/isa_traits.hh"
 #include "base/chunk_generator.hh"
+#include "base/loader/file_image.hh"
 #include "config/the_isa.hh"
 #include "mem/page_table.hh"
+#include "mem/physical.hh"
 #include "sim/process.hh"
+#include "sim/simulate.hh"
 #include "sim/system.hh"
 
 using namespace TheISA;
@@ -64,19 +68,67 @@ SETranslatingPortProxy::SETranslatingPortProxy(MasterPort& port, Process *p,
 SETranslatingPortProxy::~SETranslatingPortProxy()
 { }
 
+uint8_t *
+SETranslatingPortProxy::hostAddr(Addr paddr, Addr size) const
+{
+    process->functionalBytes += size;
+
+    // The caches are empty until the simulation starts
+    if (!process->system->bypassCaches() && simulate_limit_event)
+        return nullptr;
+
+    uint8_t *host = process->system->getPhysMem().hostAddr(paddr, size);
+    if (host)
+        process->directFunctionalBytes += size;
+    return host;
+}
+
+Addr
+SETranslatingPortProxy::translateOrAllocate(Addr vaddr, Addr size,
+                                            Addr &paddr) const
+{
+    Addr len = pTable->translateRange(vaddr, size, paddr);
+    if (len)
+        return len;
+
+    if (allocating == Always) {
+        // Allocate the whole range at once if none of it is mapped,
+        // so it ends up physically contiguous
+        Addr start = roundDown(vaddr, PageBytes);
+        Addr bytes = roundUp(vaddr + size, PageBytes) - start;
+        if (!pTable->isUnmapped(start, bytes))
+            bytes = PageBytes;
+        process->allocateMem(start, bytes);
+    } else if (allocating == NextPage) {
+        // check if we've accessed the next page on the stack
+        if (!process->fixupStackFault(vaddr))
+            panic("Page table fault when accessing virtual address %#x "
+                    "during functional write\n", vaddr);
+    } else {
+        return 0;
+    }
+    return pTable->translateRange(vaddr, size, paddr);
+}
+
 bool
 SETranslatingPortProxy::tryReadBlob(Addr addr, uint8_t *p, int size) const
 {
-    int prevSize = 0;
-
-    for (ChunkGenerator gen(addr, size, PageBytes); !gen.done(); gen.next()) {
+    // Copy each physically contiguous span in one go
+    while (size > 0) {
         Addr paddr;
-
-        if (!pTable->translate(gen.addr(),paddr))
+        Addr len = pTable->translateRange(addr, size, paddr);
+        if (!len)
             return false;
 
-        PortProxy::readBlob(paddr, p + prevSize, gen.size());
-        prevSize += gen.size();
+        uint8_t *host = hostAddr(paddr, len);
+        if (host)
+            std::memcpy(p, host, len);
+        else
+            PortProxy::readBlob(paddr, p, len);
+
+        addr += len;
+        p += len;
+        size -= len;
     }
 
     return true;
@@ -94,28 +146,21 @@ bool
 SETranslatingPortProxy::tryWriteBlob(Addr addr, const uint8_t *p,
                                      int size) const
 {
-    int prevSize = 0;
-
-    for (ChunkGenerator gen(addr, size, PageBytes); !gen.done(); gen.next()) {
+    while (size > 0) {
         Addr paddr;
+        Addr len = translateOrAllocate(addr, size, paddr);
+        if (!len)
+            return false;
+
+        uint8_t *host = hostAddr(paddr, len);
+        if (host)
+            std::memcpy(host, p, len);
+        else
+            PortProxy::writeBlob(paddr, p, len);
 
-        if (!pTable->translate(gen.addr(), paddr)) {
-            if (allocating == Always) {
-                process->allocateMem(roundDown(gen.addr(), PageBytes),
-                                     PageBytes);
-            } else if (allocating == NextPage) {
-                // check if we've accessed the next page on the stack
-                if (!process->fixupStackFault(gen.addr()))
-                    panic("Page table fault when accessing virtual address %#x "
-                            "during functional write\n", gen.addr());
-            } else {
-                return false;
-            }
-            pTable->translate(gen.addr(), paddr);
-        }
-
-        PortProxy::writeBlob(paddr, p + prevSize, gen.size());
-        prevSize += gen.size();
+        addr += len;
+        p += len;
+        size -= len;
     }
 
     return true;
@@ -129,23 +174,47 @@ SETranslatingPortProxy::writeBlob(Addr addr, const uint8_t *p, int size) const
         fatal("writeBlob(0x%x, ...) failed", addr);
 }
 
+void
+SETranslatingPortProxy::writeFileBlob(Addr addr, const uint8_t *p, int size,
+                                      int fd, off_t offset) const
+{
+    while (size > 0) {
+        Addr paddr;
+        Addr len = translateOrAllocate(addr, size, paddr);
+        if (!len)
+            fatal("writeFileBlob(0x%x, ...) failed", addr);
+
+        uint8_t *host = hostAddr(paddr, len);
+        if (!host || loadFileImage(host, len, fd, offset) < 0)
+            PortProxy::writeBlob(paddr, p, len);
+
+        addr += len;
+        p += len;
+        offset += len;
+        size -= len;
+    }
+}
+
 bool
 SETranslatingPortProxy::tryMemsetBlob(Addr addr, uint8_t val, int size) const
 {
-    for (ChunkGenerator gen(addr, size, PageBytes); !gen.done(); gen.next()) {
+    while (size > 0) {
         Addr paddr;
+        // Unlike writes, memsets don't grow the stack
+        Addr len = pTable->translateRange(addr, size, paddr);
+        if (!len && allocating == Always)
+            len = translateOrAllocate(addr, size, paddr);
+        if (!len)
+            return false;
+
+        uint8_t *host = hostAddr(paddr, len);
+        if (host)
+            std::memset(host, val, len);
+        else
+            PortProxy::memsetBlob(paddr, val, len);
 
-        if (!pTable->translate(gen.addr(), paddr)) {
-            if (allocating == Always) {
-                process->allocateMem(roundDown(gen.addr(), PageBytes),
-                                     PageBytes);
-                pTable->translate(gen.addr(), paddr);
-            } else {
-                return false;
-            }
-        }
-
-        PortProxy::memsetBlob(paddr, val, gen.size());
+        addr += len;
+        size -= len;
     }
 
     return true;
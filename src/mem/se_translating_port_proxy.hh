@@ -79,6 +79,21 @@ class SETranslatingPortProxy : public PortProxy
     Process *process;
     AllocType allocating;
 
+    /**
+     * Get the host memory backing a physical range, if it can be
+     * accessed directly rather than through the port. That's the case
+     * when no cache can hold a copy of the data: before the simulation
+     * starts, and when the system bypasses the caches.
+     */
+    uint8_t *hostAddr(Addr paddr, Addr size) const;
+
+    /**
+     * Translate the physically contiguous part of a virtual range,
+     * allocating it if it isn't mapped and the proxy allocates pages.
+     * @return The number of bytes translated, 0 on a page fault.
+     */
+    Addr translateOrAllocate(Addr vaddr, Addr size, Addr &paddr) const;
+
   public:
     SETranslatingPortProxy(MasterPort& port, Process* p, AllocType alloc);
     virtual ~SETranslatingPortProxy();
@@ -95,6 +110,14 @@ class SETranslatingPortProxy : public PortProxy
     virtual void writeBlob(Addr addr, const uint8_t *p, int size) const;
     virtual void memsetBlob(Addr addr, uint8_t val, int size) const;
 
+    /**
+     * Map the file into the memory backing store copy-on-write where
+     * it can be accessed directly, so its pages are only read in when
+     * first touched.
+     */
+    void writeFileBlob(Addr addr, const uint8_t *p, int size,
+                       int fd, off_t offset) const override;
+
     void writeString(Addr addr, const char *str) const;
     void readString(std::string &str, Addr addr) const;
 };
@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mem/sparse_store.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+using namespace std;
+
+namespace
+{
+
+const char fileMagic[8] = { 'G', 'E', 'M', '5', 'S', 'P', 'M', '1' };
+const uint32_t fileVersion = 1;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pageSize;
+    uint64_t size;
+    uint32_t groupPages;
+    uint32_t reserved;
+};
+
+// Each group is a GroupHeader, the offsets of its non-zero pages from
+// firstPage, and the page data. Raw page data starts on a page
+// boundary so that it can be mapped.
+struct GroupHeader
+{
+    uint64_t firstPage;
+    uint32_t numPages;
+    uint32_t flags;
+    uint64_t dataSize;
+};
+
+const uint32_t groupCompressed = 0x1;
+
+// The file ends with the offsets of all groups followed by the footer
+struct Footer
+{
+    uint64_t indexOffset;
+    uint64_t numGroups;
+    uint64_t numPages;
+    char magic[8];
+};
+
+unsigned
+numThreads(unsigned threads)
+{
+    if (threads == 0)
+        threads = thread::hardware_concurrency();
+    return max(threads, 1u);
+}
+
+/** Run work(i) for every i in [0, n) on up to @p threads threads. */
+void
+parallelFor(unsigned threads, size_t n, const function<void(size_t)> &work)
+{
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++)
+            work(i);
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 1; t < min<size_t>(threads, n); t++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+}
+
+/** Collects the first error raised by a worker thread. */
+class ErrorLatch
+{
+  public:
+    void
+    set(const string &msg)
+    {
+        lock_guard<mutex> lock(m);
+        if (error.empty())
+            error = msg;
+    }
+
+    const string &get() const { return error; }
+
+  private:
+    mutex m;
+    string error;
+};
+
+uint64_t
+pageBytes(uint64_t size, uint64_t page)
+{
+    return min<uint64_t>(SparseStore::pageSize,
+                         size - page * SparseStore::pageSize);
+}
+
+bool
+pageIsZero(const uint8_t *pmem, uint64_t size, uint64_t page)
+{
+    const uint8_t *p = pmem + page * SparseStore::pageSize;
+    uint64_t bytes = pageBytes(size, page);
+    if (bytes != SparseStore::pageSize) {
+        for (uint64_t i = 0; i < bytes; i++)
+            if (p[i])
+                return false;
+        return true;
+    }
+
+    // OR the whole page together rather than exiting early; this keeps
+    // the loop branch free and lets the compiler vectorize it
+    uint64_t acc = 0;
+    const uint64_t *w = reinterpret_cast<const uint64_t *>(p);
+    for (uint64_t i = 0; i < SparseStore::pageSize / sizeof(uint64_t); i++)
+        acc |= w[i];
+    return acc == 0;
+}
+
+void
+writeAll(int fd, const void *buf, uint64_t len, const string &filename)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, min<uint64_t>(len, 1ULL << 30));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            fatal("Write failed on physical memory checkpoint file "
+                  "'%s'\n", filename);
+        p += n;
+        len -= n;
+    }
+}
+
+bool
+preadAll(int fd, void *buf, uint64_t len, uint64_t offset)
+{
+    uint8_t *p = static_cast<uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = ::pread(fd, p, min<uint64_t>(len, 1ULL << 30), offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+SparseStore::Stats
+SparseStore::write(const string &filename, const uint8_t *pmem,
+                   uint64_t size, bool compress, unsigned threads)
+{
+    threads = numThreads(threads);
+
+    // Write under a temporary name and rename it into place, so that a
+    // store restored from an older file of the same name, and possibly
+    // still mapping it, never sees the file change under it
+    const string tmp_filename = filename + ".tmp";
+    int fd = ::open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                    0644);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              tmp_filename);
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.pageSize = pageSize;
+    header.size = size;
+    header.groupPages = groupPages;
+    writeAll(fd, &header, sizeof(header), filename);
+    uint64_t offset = sizeof(header);
+
+    const uint64_t total_pages = divCeil(size, pageSize);
+    const uint64_t total_groups = divCeil(total_pages, groupPages);
+
+    struct GroupBuf
+    {
+        vector<uint16_t> pages;
+        vector<uint8_t> data;
+        bool compressed;
+    };
+
+    // Groups are scanned and compressed a window at a time, so the
+    // compressed data held in memory stays bounded however large the
+    // store is, and are then written out in order.
+    vector<GroupBuf> bufs(threads * 4);
+    vector<uint64_t> index;
+    ErrorLatch error;
+    Stats stats;
+    static const uint8_t zeros[pageSize] = {};
+
+    for (uint64_t base = 0; base < total_groups; base += bufs.size()) {
+        size_t count = min<uint64_t>(bufs.size(), total_groups - base);
+
+        parallelFor(threads, count, [&](size_t i) {
+            GroupBuf &buf = bufs[i];
+            buf.pages.clear();
+            buf.data.clear();
+            buf.compressed = false;
+
+            uint64_t first = (base + i) * groupPages;
+            uint64_t last = min(first + groupPages, total_pages);
+            for (uint64_t p = first; p < last; p++) {
+                if (!pageIsZero(pmem, size, p))
+                    buf.pages.push_back(p - first);
+            }
+            if (buf.pages.empty() || !compress)
+                return;
+
+            vector<uint8_t> raw(buf.pages.size() * pageSize, 0);
+            for (size_t k = 0; k < buf.pages.size(); k++) {
+                uint64_t p = first + buf.pages[k];
+                memcpy(&raw[k * pageSize], pmem + p * pageSize,
+                       pageBytes(size, p));
+            }
+
+            uLongf len = compressBound(raw.size());
+            buf.data.resize(len);
+            int ret = compress2(buf.data.data(), &len, raw.data(),
+                                raw.size(), Z_BEST_SPEED);
+            if (ret != Z_OK) {
+                error.set(csprintf("zlib error %d", ret));
+                return;
+            }
+            // Store incompressible groups raw
+            if (len < raw.size()) {
+                buf.data.resize(len);
+                buf.compressed = true;
+            } else {
+                buf.data.clear();
+            }
+        });
+
+        if (!error.get().empty())
+            fatal("Compression failed on physical memory checkpoint file "
+                  "'%s': %s\n", filename, error.get());
+
+        for (size_t i = 0; i < count; i++) {
+            GroupBuf &buf = bufs[i];
+            if (buf.pages.empty())
+                continue;
+
+            uint64_t first = (base + i) * groupPages;
+            GroupHeader gh;
+            gh.firstPage = first;
+            gh.numPages = buf.pages.size();
+            gh.flags = buf.compressed ? groupCompressed : 0;
+            gh.dataSize = buf.compressed ? buf.data.size() :
+                buf.pages.size() * pageSize;
+
+            index.push_back(offset);
+            writeAll(fd, &gh, sizeof(gh), filename);
+            writeAll(fd, buf.pages.data(),
+                     buf.pages.size() * sizeof(uint16_t), filename);
+            offset += sizeof(gh) + buf.pages.size() * sizeof(uint16_t);
+
+            if (buf.compressed) {
+                writeAll(fd, buf.data.data(), buf.data.size(), filename);
+                offset += buf.data.size();
+            } else {
+                uint64_t pad = roundUp(offset, pageSize) - offset;
+                writeAll(fd, zeros, pad, filename);
+                offset += pad;
+
+                // write runs of consecutive pages straight from the
+                // store
+                size_t k = 0;
+                while (k < buf.pages.size()) {
+                    size_t run = 1;
+                    while (k + run < buf.pages.size() &&
+                           buf.pages[k + run] == buf.pages[k] + run)
+                        run++;
+                    uint64_t p = first + buf.pages[k];
+                    uint64_t bytes = (run - 1) * pageSize +
+                        pageBytes(size, p + run - 1);
+                    writeAll(fd, pmem + p * pageSize, bytes, filename);
+                    writeAll(fd, zeros, run * pageSize - bytes, filename);
+                    offset += run * pageSize;
+                    k += run;
+                }
+            }
+            stats.pages += buf.pages.size();
+        }
+    }
+
+    Footer footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.indexOffset = offset;
+    footer.numGroups = index.size();
+    footer.numPages = stats.pages;
+    memcpy(footer.magic, fileMagic, sizeof(fileMagic));
+    writeAll(fd, index.data(), index.size() * sizeof(uint64_t), filename);
+    writeAll(fd, &footer, sizeof(footer), filename);
+    offset += index.size() * sizeof(uint64_t) + sizeof(footer);
+
+    if (::close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              tmp_filename);
+    if (::rename(tmp_filename.c_str(), filename.c_str()))
+        fatal("Can't rename '%s' to '%s': %s\n", tmp_filename, filename,
+              strerror(errno));
+
+    stats.fileBytes = offset;
+    return stats;
+}
+
+SparseStore::Stats
+SparseStore::read(const string &filename, uint8_t *pmem, uint64_t size,
+                  unsigned threads, bool allow_mmap)
+{
+    threads = numThreads(threads);
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    FileHeader header;
+    struct stat st;
+    if (!preadAll(fd, &header, sizeof(header), 0) ||
+        memcmp(header.magic, fileMagic, sizeof(fileMagic)) ||
+        header.version != fileVersion || fstat(fd, &st) ||
+        st.st_size < (off_t)(sizeof(header) + sizeof(Footer)))
+        fatal("'%s' is not a sparse physical memory checkpoint\n",
+              filename);
+
+    fatal_if(header.pageSize != pageSize || header.groupPages != groupPages,
+             "Unsupported page layout in physical memory checkpoint '%s'\n",
+             filename);
+    if (header.size != size)
+        fatal("Memory range size has changed! Saw %lld, expected %lld\n",
+              header.size, size);
+
+    Footer footer;
+    if (!preadAll(fd, &footer, sizeof(footer), st.st_size - sizeof(footer))
+        || memcmp(footer.magic, fileMagic, sizeof(fileMagic)))
+        fatal("Physical memory checkpoint '%s' is truncated\n", filename);
+
+    vector<uint64_t> index(footer.numGroups);
+    if (!preadAll(fd, index.data(), index.size() * sizeof(uint64_t),
+                  footer.indexOffset))
+        fatal("Can't read the page index of physical memory checkpoint "
+              "'%s'\n", filename);
+
+    // Raw pages can only be mapped if host pages match the file's
+    const bool can_map = allow_mmap &&
+        sysconf(_SC_PAGESIZE) == (long)pageSize &&
+        (reinterpret_cast<uintptr_t>(pmem) % pageSize) == 0;
+
+    atomic<uint64_t> mapped_pages(0);
+    ErrorLatch error;
+
+    parallelFor(threads, index.size(), [&](size_t g) {
+        GroupHeader gh;
+        if (!preadAll(fd, &gh, sizeof(gh), index[g]) ||
+            gh.numPages == 0 || gh.numPages > groupPages ||
+            gh.firstPage >= divCeil(size, pageSize)) {
+            error.set("bad group header");
+            return;
+        }
+
+        vector<uint16_t> pages(gh.numPages);
+        uint64_t data_offset = index[g] + sizeof(gh);
+        if (!preadAll(fd, pages.data(), pages.size() * sizeof(uint16_t),
+                      data_offset)) {
+            error.set("truncated page list");
+            return;
+        }
+        data_offset += pages.size() * sizeof(uint16_t);
+
+        for (uint16_t off : pages) {
+            if (off >= groupPages || (gh.firstPage + off) * pageSize >= size) {
+                error.set("page outside the store");
+                return;
+            }
+        }
+
+        if (gh.flags & groupCompressed) {
+            vector<uint8_t> data(gh.dataSize);
+            vector<uint8_t> raw(pages.size() * pageSize);
+            uLongf len = raw.size();
+            if (!preadAll(fd, data.data(), data.size(), data_offset) ||
+                uncompress(raw.data(), &len, data.data(), data.size()) !=
+                Z_OK || len != raw.size()) {
+                error.set("corrupt compressed group");
+                return;
+            }
+            for (size_t k = 0; k < pages.size(); k++) {
+                uint64_t p = gh.firstPage + pages[k];
+                memcpy(pmem + p * pageSize, &raw[k * pageSize],
+                       pageBytes(size, p));
+            }
+            return;
+        }
+
+        data_offset = roundUp(data_offset, pageSize);
+        size_t k = 0;
+        while (k < pages.size()) {
+            size_t run = 1;
+            while (k + run < pages.size() && pages[k + run] == pages[k] + run)
+                run++;
+
+            uint64_t p = gh.firstPage + pages[k];
+            uint8_t *host = pmem + p * pageSize;
+            uint64_t file_offset = data_offset + k * pageSize;
+            uint64_t bytes = (run - 1) * pageSize +
+                pageBytes(size, p + run - 1);
+
+            // Map whole pages copy-on-write so they are only read in
+            // when first touched, and copy anything else
+            bool done = false;
+            if (can_map && bytes == run * pageSize) {
+                void *m = mmap(host, bytes, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_FIXED, fd, file_offset);
+                if (m != MAP_FAILED) {
+                    mapped_pages += run;
+                    done = true;
+                }
+            }
+            if (!done && !preadAll(fd, host, bytes, file_offset)) {
+                error.set("truncated raw group");
+                return;
+            }
+            k += run;
+        }
+    });
+
+    // Mappings stay valid after the descriptor is closed
+    ::close(fd);
+
+    if (!error.get().empty())
+        fatal("Physical memory checkpoint '%s' is corrupt: %s\n", filename,
+              error.get());
+
+    Stats stats;
+    stats.pages = footer.numPages;
+    stats.mappedPages = mapped_pages;
+    stats.fileBytes = st.st_size;
+    return stats;
+}
+
+bool
+SparseStore::isSparseStore(const string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    char magic[sizeof(fileMagic)];
+    bool match = preadAll(fd, magic, sizeof(magic), 0) &&
+        !memcmp(magic, fileMagic, sizeof(fileMagic));
+    ::close(fd);
+    return match;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Sparse file format for checkpointing the physical memory backing
+ * stores. Only pages holding non-zero data are written. The store is
+ * split into fixed-size groups of pages that are scanned and
+ * compressed by several host threads. Each group records which of its
+ * pages are present, and an index at the end of the file lets the
+ * groups be restored in parallel as well.
+ *
+ * Groups are either zlib compressed at the fastest level or stored
+ * raw. Raw groups are page aligned in the file, so on restore they can
+ * be mapped copy-on-write straight into the backing store. Their pages
+ * are then only read from disk when the simulation first touches them.
+ */
+
+#ifndef __MEM_SPARSE_STORE_HH__
+#define __MEM_SPARSE_STORE_HH__
+
+#include <cstdint>
+#include <string>
+
+class SparseStore
+{
+  public:
+    /** Granularity at which zero data is skipped. */
+    static const uint32_t pageSize = 4096;
+
+    /** Pages per group, the unit of parallel work. */
+    static const uint32_t groupPages = 256;
+
+    struct Stats
+    {
+        /** Non-zero pages stored in the file. */
+        uint64_t pages = 0;
+        /** Pages mapped from the file rather than copied. */
+        uint64_t mappedPages = 0;
+        /** Size of the file in bytes. */
+        uint64_t fileBytes = 0;
+    };
+
+    /**
+     * Write a backing store to a file. The file is written under a
+     * temporary name and renamed into place, so stores still mapping
+     * an older file of the same name are not affected.
+     *
+     * @param filename File to create.
+     * @param pmem Host pointer to the backing store.
+     * @param size Size of the backing store in bytes.
+     * @param compress Compress the groups rather than storing them raw.
+     * @param threads Host threads to use, 0 for one per host core.
+     */
+    static Stats write(const std::string &filename, const uint8_t *pmem,
+                       uint64_t size, bool compress, unsigned threads);
+
+    /**
+     * Restore a backing store from a file. The backing store is
+     * expected to be zero filled, as pages missing from the file are
+     * not written.
+     *
+     * @param allow_mmap Map raw groups into the store instead of
+     *                   copying them. The file must then stay unchanged
+     *                   for as long as the store is in use.
+     */
+    static Stats read(const std::string &filename, uint8_t *pmem,
+                      uint64_t size, unsigned threads, bool allow_mmap);
+
+    /** Check whether a file starts with the sparse store magic. */
+    static bool isSparseStore(const std::string &filename);
+};
+
+#endif //__MEM_SPARSE_STORE_HH__
@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "proto/packed_trace.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "base/logging.hh"
+
+const char PackedTrace::magic[8] = {'g', 'e', 'm', '5', 'p', 't', 'r', 'c'};
+const uint32_t PackedTrace::version;
+const uint32_t PackedTrace::byteOrderMark;
+const uint32_t PackedTrace::defaultBatchRecords;
+
+size_t
+PackedTrace::batchBytes(Kind kind, uint32_t num_records, uint32_t num_deps)
+{
+    size_t n = num_records;
+    if (kind == PacketTrace)
+        return 4 * 8 * n + 3 * pad8(4 * n) + pad8(n);
+    else
+        return 5 * 8 * n + 4 * pad8(4 * n) + 4 * pad8(n) + 8 * num_deps;
+}
+
+bool
+PackedTrace::isPackedTrace(const std::string &filename)
+{
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    char buf[sizeof(magic)];
+    bool packed = fread(buf, 1, sizeof(buf), f) == sizeof(buf) &&
+        memcmp(buf, magic, sizeof(magic)) == 0;
+    fclose(f);
+    return packed;
+}
+
+namespace
+{
+
+/** Helper to step through the columns of a batch */
+struct ColumnCursor
+{
+    const uint8_t *pos;
+
+    template <class T>
+    const T *
+    take(uint32_t count)
+    {
+        const T *col = reinterpret_cast<const T *>(pos);
+        pos += PackedTrace::pad8(sizeof(T) * count);
+        return col;
+    }
+};
+
+/** Helper to lay out the columns of a batch */
+struct ColumnWriter
+{
+    uint8_t *pos;
+
+    template <class T, class Record, class F>
+    void
+    put(const std::vector<Record> &records, F field)
+    {
+        T *col = reinterpret_cast<T *>(pos);
+        for (size_t i = 0; i < records.size(); i++)
+            col[i] = field(records[i]);
+        size_t bytes = sizeof(T) * records.size();
+        memset(pos + bytes, 0, PackedTrace::pad8(bytes) - bytes);
+        pos += PackedTrace::pad8(bytes);
+    }
+};
+
+} // anonymous namespace
+
+PackedTraceReader::PackedTraceReader(const std::string &_filename)
+    : filename(_filename), data(nullptr), fileSize(0),
+      compression(NoCompression), firstBatch(0), nextBatchOffset(0),
+      _batchRecords(0), packetCols(), instDepCols(), readPos(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        fatal("Can't open packed trace %s: %s\n", filename, strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        fatal("Can't stat packed trace %s: %s\n", filename, strerror(errno));
+    fileSize = st.st_size;
+
+    FileHeader fh;
+    if (fileSize < sizeof(fh))
+        fatal("Packed trace %s is too short\n", filename);
+
+    void *map = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        fatal("Can't map packed trace %s: %s\n", filename, strerror(errno));
+    data = static_cast<const uint8_t *>(map);
+    madvise(map, fileSize, MADV_SEQUENTIAL);
+
+    memcpy(&fh, data, sizeof(fh));
+    if (memcmp(fh.magic, magic, sizeof(magic)) != 0)
+        fatal("%s is not a packed trace\n", filename);
+    if (fh.byteOrderMark != byteOrderMark)
+        fatal("Packed trace %s has a different byte order\n", filename);
+    if (fh.version != version)
+        fatal("Packed trace %s has version %d, expected %d\n", filename,
+              fh.version, version);
+    if (fh.kind != PacketTrace && fh.kind != InstDepTrace)
+        fatal("Packed trace %s has unknown kind %d\n", filename, fh.kind);
+    if (fh.compression != NoCompression && fh.compression != Zlib)
+        fatal("Packed trace %s has unknown compression %d\n", filename,
+              fh.compression);
+
+    _header.kind = Kind(fh.kind);
+    _header.ver = fh.ver;
+    _header.tickFreq = fh.tickFreq;
+    _header.windowSize = fh.windowSize;
+    compression = Compression(fh.compression);
+
+    firstBatch = sizeof(fh) + pad8(fh.extraBytes);
+    if (firstBatch > fileSize)
+        fatal("Packed trace %s is truncated\n", filename);
+
+    // Object id and id strings
+    size_t pos = sizeof(fh);
+    size_t end = sizeof(fh) + fh.extraBytes;
+    auto get_u32 = [&]() {
+        uint32_t v;
+        if (pos + sizeof(v) > end)
+            fatal("Bad header in packed trace %s\n", filename);
+        memcpy(&v, data + pos, sizeof(v));
+        pos += sizeof(v);
+        return v;
+    };
+    auto get_str = [&]() {
+        uint32_t len = get_u32();
+        if (pos + len > end)
+            fatal("Bad header in packed trace %s\n", filename);
+        std::string str(reinterpret_cast<const char *>(data + pos), len);
+        pos += len;
+        return str;
+    };
+    _header.objId = get_str();
+    uint32_t num_ids = get_u32();
+    for (uint32_t i = 0; i < num_ids; i++) {
+        uint32_t key = get_u32();
+        _header.idStrings.emplace_back(key, get_str());
+    }
+
+    reset();
+}
+
+PackedTraceReader::~PackedTraceReader()
+{
+    munmap(const_cast<uint8_t *>(data), fileSize);
+}
+
+void
+PackedTraceReader::reset()
+{
+    nextBatchOffset = firstBatch;
+    _batchRecords = 0;
+    readPos = 0;
+}
+
+bool
+PackedTraceReader::nextBatch()
+{
+    readPos = 0;
+    _batchRecords = 0;
+
+    if (nextBatchOffset == fileSize)
+        return false;
+
+    BatchHeader bh;
+    if (nextBatchOffset + sizeof(bh) > fileSize)
+        fatal("Packed trace %s is truncated\n", filename);
+    memcpy(&bh, data + nextBatchOffset, sizeof(bh));
+
+    size_t start = nextBatchOffset + sizeof(bh);
+    if (bh.storedBytes > fileSize - start ||
+        bh.rawBytes != batchBytes(_header.kind, bh.numRecords, bh.numDeps))
+        fatal("Bad batch at offset %d of packed trace %s\n",
+              nextBatchOffset, filename);
+    nextBatchOffset = std::min<size_t>(start + pad8(bh.storedBytes),
+                                       fileSize);
+
+    const uint8_t *cols = data + start;
+    if (compression == Zlib) {
+        inflated.resize(bh.rawBytes / 8);
+        uLongf len = bh.rawBytes;
+        if (uncompress(reinterpret_cast<Bytef *>(inflated.data()), &len,
+                       cols, bh.storedBytes) != Z_OK || len != bh.rawBytes)
+            fatal("Can't inflate batch of packed trace %s\n", filename);
+        cols = reinterpret_cast<const uint8_t *>(inflated.data());
+    } else if (bh.storedBytes != bh.rawBytes) {
+        fatal("Bad batch at offset %d of packed trace %s\n",
+              start - sizeof(bh), filename);
+    }
+
+    setColumns(cols, bh.numRecords, bh.numDeps);
+    _batchRecords = bh.numRecords;
+    return true;
+}
+
+void
+PackedTraceReader::setColumns(const uint8_t *cols, uint32_t n,
+                              uint32_t num_deps)
+{
+    ColumnCursor cursor{cols};
+
+    if (_header.kind == PacketTrace) {
+        auto &c = packetCols;
+        c.tick = cursor.take<uint64_t>(n);
+        c.addr = cursor.take<uint64_t>(n);
+        c.pc = cursor.take<uint64_t>(n);
+        c.pktId = cursor.take<uint64_t>(n);
+        c.cmd = cursor.take<uint32_t>(n);
+        c.size = cursor.take<uint32_t>(n);
+        c.flags = cursor.take<uint32_t>(n);
+        c.present = cursor.take<uint8_t>(n);
+        return;
+    }
+
+    auto &c = instDepCols;
+    c.seqNum = cursor.take<uint64_t>(n);
+    c.compDelay = cursor.take<uint64_t>(n);
+    c.pAddr = cursor.take<uint64_t>(n);
+    c.vAddr = cursor.take<uint64_t>(n);
+    c.pc = cursor.take<uint64_t>(n);
+    c.size = cursor.take<uint32_t>(n);
+    c.flags = cursor.take<uint32_t>(n);
+    c.asid = cursor.take<uint32_t>(n);
+    c.weight = cursor.take<uint32_t>(n);
+    c.type = cursor.take<uint8_t>(n);
+    c.numRobDep = cursor.take<uint8_t>(n);
+    c.numRegDep = cursor.take<uint8_t>(n);
+    c.present = cursor.take<uint8_t>(n);
+    c.deps = cursor.take<uint64_t>(num_deps);
+
+    depStart.resize(n);
+    uint32_t deps = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        depStart[i] = deps;
+        deps += c.numRobDep[i] + c.numRegDep[i];
+    }
+    if (deps != num_deps)
+        fatal("Bad dependency count in packed trace %s\n", filename);
+}
+
+void
+PackedTraceReader::get(uint32_t i, Packet &pkt) const
+{
+    assert(_header.kind == PacketTrace && i < _batchRecords);
+    const auto &c = packetCols;
+    pkt.tick = c.tick[i];
+    pkt.addr = c.addr[i];
+    pkt.pc = c.pc[i];
+    pkt.pktId = c.pktId[i];
+    pkt.cmd = c.cmd[i];
+    pkt.size = c.size[i];
+    pkt.flags = c.flags[i];
+    pkt.present = c.present[i];
+}
+
+void
+PackedTraceReader::get(uint32_t i, InstDep &inst) const
+{
+    assert(_header.kind == InstDepTrace && i < _batchRecords);
+    const auto &c = instDepCols;
+    inst.seqNum = c.seqNum[i];
+    inst.compDelay = c.compDelay[i];
+    inst.pAddr = c.pAddr[i];
+    inst.vAddr = c.vAddr[i];
+    inst.pc = c.pc[i];
+    inst.size = c.size[i];
+    inst.flags = c.flags[i];
+    inst.asid = c.asid[i];
+    inst.weight = c.weight[i];
+    inst.type = c.type[i];
+    inst.numRobDep = c.numRobDep[i];
+    inst.numRegDep = c.numRegDep[i];
+    inst.present = c.present[i];
+    inst.deps = c.deps + depStart[i];
+}
+
+PackedTraceWriter::PackedTraceWriter(const std::string &_filename,
+                                     const Header &header, bool compress,
+                                     uint32_t batch_records)
+    : filename(_filename), file(nullptr), kind(header.kind),
+      compression(compress ? Zlib : NoCompression),
+      maxRecords(batch_records)
+{
+    fatal_if(maxRecords == 0, "Packed trace batches can't be empty\n");
+
+    file = fopen(filename.c_str(), "wb");
+    if (!file)
+        fatal("Can't create packed trace %s: %s\n", filename,
+              strerror(errno));
+
+    std::vector<uint8_t> extra;
+    auto put_u32 = [&](uint32_t v) {
+        const uint8_t *b = reinterpret_cast<const uint8_t *>(&v);
+        extra.insert(extra.end(), b, b + sizeof(v));
+    };
+    auto put_str = [&](const std::string &str) {
+        put_u32(str.size());
+        extra.insert(extra.end(), str.begin(), str.end());
+    };
+    put_str(header.objId);
+    put_u32(header.idStrings.size());
+    for (const auto &id : header.idStrings) {
+        put_u32(id.first);
+        put_str(id.second);
+    }
+
+    FileHeader fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, magic, sizeof(magic));
+    fh.version = version;
+    fh.byteOrderMark = byteOrderMark;
+    fh.kind = kind;
+    fh.compression = compression;
+    fh.tickFreq = header.tickFreq;
+    fh.ver = header.ver;
+    fh.windowSize = header.windowSize;
+    fh.extraBytes = extra.size();
+    extra.resize(pad8(extra.size()));
+
+    writeBytes(&fh, sizeof(fh));
+    writeBytes(extra.data(), extra.size());
+}
+
+PackedTraceWriter::~PackedTraceWriter()
+{
+    if (file)
+        close();
+}
+
+void
+PackedTraceWriter::writeBytes(const void *bytes, size_t size)
+{
+    if (fwrite(bytes, 1, size, file) != size)
+        fatal("Can't write packed trace %s: %s\n", filename,
+              strerror(errno));
+}
+
+void
+PackedTraceWriter::write(const Packet &pkt)
+{
+    panic_if(kind != PacketTrace, "Packet written to instruction trace %s\n",
+             filename);
+    packets.push_back(pkt);
+    if (packets.size() == maxRecords)
+        flushBatch();
+}
+
+void
+PackedTraceWriter::write(const InstDep &inst)
+{
+    panic_if(kind != InstDepTrace, "Instruction written to packet trace %s\n",
+             filename);
+    instDeps.push_back(inst);
+    deps.insert(deps.end(), inst.deps,
+                inst.deps + inst.numRobDep + inst.numRegDep);
+    if (instDeps.size() == maxRecords)
+        flushBatch();
+}
+
+void
+PackedTraceWriter::flushBatch()
+{
+    BatchHeader bh;
+    bh.numRecords = kind == PacketTrace ? packets.size() : instDeps.size();
+    bh.numDeps = deps.size();
+    bh.rawBytes = batchBytes(kind, bh.numRecords, bh.numDeps);
+    if (bh.numRecords == 0)
+        return;
+
+    buffer.resize(bh.rawBytes);
+    ColumnWriter cols{buffer.data()};
+    if (kind == PacketTrace) {
+        typedef const Packet &P;
+        cols.put<uint64_t>(packets, [](P p) { return p.tick; });
+        cols.put<uint64_t>(packets, [](P p) { return p.addr; });
+        cols.put<uint64_t>(packets, [](P p) { return p.pc; });
+        cols.put<uint64_t>(packets, [](P p) { return p.pktId; });
+        cols.put<uint32_t>(packets, [](P p) { return p.cmd; });
+        cols.put<uint32_t>(packets, [](P p) { return p.size; });
+        cols.put<uint32_t>(packets, [](P p) { return p.flags; });
+        cols.put<uint8_t>(packets, [](P p) { return p.present; });
+    } else {
+        typedef const InstDep &I;
+        cols.put<uint64_t>(instDeps, [](I i) { return i.seqNum; });
+        cols.put<uint64_t>(instDeps, [](I i) { return i.compDelay; });
+        cols.put<uint64_t>(instDeps, [](I i) { return i.pAddr; });
+        cols.put<uint64_t>(instDeps, [](I i) { return i.vAddr; });
+        cols.put<uint64_t>(instDeps, [](I i) { return i.pc; });
+        cols.put<uint32_t>(instDeps, [](I i) { return i.size; });
+        cols.put<uint32_t>(instDeps, [](I i) { return i.flags; });
+        cols.put<uint32_t>(instDeps, [](I i) { return i.asid; });
+        cols.put<uint32_t>(instDeps, [](I i) { return i.weight; });
+        cols.put<uint8_t>(instDeps, [](I i) { return i.type; });
+        cols.put<uint8_t>(instDeps, [](I i) { return i.numRobDep; });
+        cols.put<uint8_t>(instDeps, [](I i) { return i.numRegDep; });
+        cols.put<uint8_t>(instDeps, [](I i) { return i.present; });
+        cols.put<uint64_t>(deps, [](uint64_t d) { return d; });
+    }
+    assert(cols.pos == buffer.data() + buffer.size());
+
+    const uint8_t *stored = buffer.data();
+    bh.storedBytes = bh.rawBytes;
+    if (compression == Zlib) {
+        uLongf len = compressBound(bh.rawBytes);
+        compressed.resize(len);
+        if (compress(compressed.data(), &len, buffer.data(),
+                     bh.rawBytes) != Z_OK)
+            panic("Can't deflate batch of packed trace %s\n", filename);
+        stored = compressed.data();
+        bh.storedBytes = len;
+    }
+
+    static const uint8_t zeros[8] = {};
+    writeBytes(&bh, sizeof(bh));
+    writeBytes(stored, bh.storedBytes);
+    writeBytes(zeros, pad8(bh.storedBytes) - bh.storedBytes);
+
+    packets.clear();
+    instDeps.clear();
+    deps.clear();
+}
+
+void
+PackedTraceWriter::close()
+{
+    flushBatch();
+    if (fclose(file) != 0)
+        fatal("Can't write packed trace %s: %s\n", filename,
+              strerror(errno));
+    file = nullptr;
+}
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * A fixed width, columnar container for packet traces and elastic
+ * instruction dependency traces, holding the same information as the
+ * protobuf formats of packet.proto and inst_dep_record.proto.
+ *
+ * The file starts with a header carrying the fields of the protobuf
+ * header message. It is followed by batches of records. Each batch
+ * stores every field of its records as an array of fixed width little
+ * endian values, a column, and the dependencies of instruction records
+ * in one more array. Columns are padded to 8 bytes. A batch is
+ * optionally deflated with zlib as a whole.
+ *
+ * The reader maps the file in memory. Columns of batches that are not
+ * compressed are used in place, others are inflated into a buffer
+ * once per batch. Either way records are decoded a batch at a time
+ * instead of parsing a message per record.
+ *
+ * util/packed_trace.py converts between this format and the protobuf
+ * traces.
+ */
+
+#ifndef __PROTO_PACKED_TRACE_HH__
+#define __PROTO_PACKED_TRACE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+class PackedTrace
+{
+  public:
+    static const char magic[8];
+    static const uint32_t version = 1;
+    static const uint32_t byteOrderMark = 0x01020304;
+
+    /** Default number of records per batch */
+    static const uint32_t defaultBatchRecords = 4096;
+
+    enum Kind : uint32_t
+    {
+        /** Records of packet.proto */
+        PacketTrace = 1,
+        /** Records of inst_dep_record.proto */
+        InstDepTrace = 2,
+    };
+
+    enum Compression : uint32_t
+    {
+        NoCompression = 0,
+        Zlib = 1,
+    };
+
+    /** Fixed part of the file header */
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint32_t kind;
+        uint32_t compression;
+        uint64_t tickFreq;
+        /** Version field of the protobuf header */
+        uint32_t ver;
+        /** Dependency window size of instruction traces */
+        uint32_t windowSize;
+        /**
+         * Bytes of the header fields of variable size that follow: the
+         * object id and the master id strings of packet traces, each
+         * as a 32 bit length and the characters, the id strings after
+         * their count and each after its 32 bit key. Padded to 8.
+         */
+        uint32_t extraBytes;
+        uint32_t pad;
+    };
+
+    struct BatchHeader
+    {
+        uint32_t numRecords;
+        /** Number of dependencies of instruction records */
+        uint32_t numDeps;
+        /** Bytes of the columns */
+        uint64_t rawBytes;
+        /**
+         * Bytes that follow in the file, the same as rawBytes unless the
+         * batch is compressed. They are padded to 8 in the file.
+         */
+        uint64_t storedBytes;
+    };
+
+    /** Header of a trace, as in the protobuf header messages */
+    struct Header
+    {
+        Kind kind;
+        std::string objId;
+        uint32_t ver;
+        uint64_t tickFreq;
+        uint32_t windowSize;
+        std::vector<std::pair<uint32_t, std::string>> idStrings;
+
+        Header(Kind _kind = PacketTrace)
+            : kind(_kind), ver(0), tickFreq(0), windowSize(0)
+        {}
+    };
+
+    /** A record of packet.proto */
+    struct Packet
+    {
+        /** Bits of the optional fields that are set */
+        enum : uint8_t
+        {
+            HasFlags = 1,
+            HasPktId = 2,
+            HasPc = 4,
+        };
+
+        uint64_t tick;
+        uint64_t addr;
+        uint64_t pc;
+        uint64_t pktId;
+        uint32_t cmd;
+        uint32_t size;
+        uint32_t flags;
+        uint8_t present;
+    };
+
+    /** A record of inst_dep_record.proto */
+    struct InstDep
+    {
+        /** Bits of the optional fields that are set */
+        enum : uint8_t
+        {
+            HasPAddr = 1,
+            HasSize = 2,
+            HasFlags = 4,
+            HasWeight = 8,
+            HasPc = 16,
+            HasVAddr = 32,
+            HasAsid = 64,
+        };
+
+        uint64_t seqNum;
+        uint64_t compDelay;
+        uint64_t pAddr;
+        uint64_t vAddr;
+        uint64_t pc;
+        uint32_t size;
+        uint32_t flags;
+        uint32_t asid;
+        uint32_t weight;
+        uint8_t type;
+        uint8_t numRobDep;
+        uint8_t numRegDep;
+        uint8_t present;
+        /**
+         * The order dependencies followed by the register dependencies.
+         * When reading, it points into the batch and is valid until the
+         * next batch is read.
+         */
+        const uint64_t *deps;
+    };
+
+    /** Columns of a batch of packet records */
+    struct PacketColumns
+    {
+        const uint64_t *tick;
+        const uint64_t *addr;
+        const uint64_t *pc;
+        const uint64_t *pktId;
+        const uint32_t *cmd;
+        const uint32_t *size;
+        const uint32_t *flags;
+        const uint8_t *present;
+    };
+
+    /** Columns of a batch of instruction records */
+    struct InstDepColumns
+    {
+        const uint64_t *seqNum;
+        const uint64_t *compDelay;
+        const uint64_t *pAddr;
+        const uint64_t *vAddr;
+        const uint64_t *pc;
+        const uint32_t *size;
+        const uint32_t *flags;
+        const uint32_t *asid;
+        const uint32_t *weight;
+        const uint8_t *type;
+        const uint8_t *numRobDep;
+        const uint8_t *numRegDep;
+        const uint8_t *present;
+        const uint64_t *deps;
+    };
+
+    /** Bytes of the columns of a batch */
+    static size_t batchBytes(Kind kind, uint32_t num_records,
+                             uint32_t num_deps);
+
+    /** Round up to a multiple of 8 bytes */
+    static size_t pad8(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+    /** True if the file starts like a packed trace */
+    static bool isPackedTrace(const std::string &filename);
+};
+
+/**
+ * Reads a packed trace through a memory mapping of the file.
+ */
+class PackedTraceReader : public PackedTrace
+{
+  private:
+    std::string filename;
+    const uint8_t *data;
+    size_t fileSize;
+    Header _header;
+    Compression compression;
+
+    /** Offset of the first batch and of the next one to read */
+    size_t firstBatch;
+    size_t nextBatchOffset;
+
+    /** Current batch */
+    uint32_t _batchRecords;
+    PacketColumns packetCols;
+    InstDepColumns instDepCols;
+    /** Offset of the dependencies of each record of the batch */
+    std::vector<uint32_t> depStart;
+    /** Columns of the batch if it was inflated */
+    std::vector<uint64_t> inflated;
+
+    /** Position of the next record for read() */
+    uint32_t readPos;
+
+    /** Set up the column pointers of a batch stored at cols */
+    void setColumns(const uint8_t *cols, uint32_t num_records,
+                    uint32_t num_deps);
+
+  public:
+    /** Map a trace, fatal if it can't be read or isn't a packed trace */
+    PackedTraceReader(const std::string &filename);
+    ~PackedTraceReader();
+
+    PackedTraceReader(const PackedTraceReader &) = delete;
+    PackedTraceReader &operator=(const PackedTraceReader &) = delete;
+
+    const Header &header() const { return _header; }
+
+    /** Go back to the first record */
+    void reset();
+
+    /**
+     * Move to the next batch.
+     *
+     * @return false at the end of the trace
+     */
+    bool nextBatch();
+
+    /** Number of records of the current batch */
+    uint32_t batchRecords() const { return _batchRecords; }
+
+    /** Columns of the current batch */
+    const PacketColumns &packets() const { return packetCols; }
+    const InstDepColumns &instDeps() const { return instDepCols; }
+
+    /** Get record i of the current batch */
+    void get(uint32_t i, Packet &pkt) const;
+    void get(uint32_t i, InstDep &inst) const;
+
+    /**
+     * Read the next record, moving on to the next batch as needed.
+     *
+     * @return false at the end of the trace
+     */
+    template <class Record>
+    bool
+    read(Record &rec)
+    {
+        if (readPos == _batchRecords) {
+            // Batches may be empty
+            do {
+                if (!nextBatch())
+                    return false;
+            } while (_batchRecords == 0);
+        }
+        get(readPos++, rec);
+        return true;
+    }
+};
+
+/**
+ * Writes a packed trace, a batch at a time.
+ */
+class PackedTraceWriter : public PackedTrace
+{
+  private:
+    std::string filename;
+    FILE *file;
+    const Kind kind;
+    const Compression compression;
+    const uint32_t maxRecords;
+
+    /** Records of the batch being filled */
+    std::vector<Packet> packets;
+    std::vector<InstDep> instDeps;
+    std::vector<uint64_t> deps;
+
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> compressed;
+
+    void writeBytes(const void *bytes, size_t size);
+    void flushBatch();
+
+  public:
+    /**
+     * Create a trace, fatal if the file can't be written.
+     *
+     * @param filename File to write
+     * @param header Header of the trace, which sets its kind
+     * @param compress Deflate the batches with zlib
+     * @param batch_records Records per batch
+     */
+    PackedTraceWriter(const std::string &filename, const Header &header,
+                      bool compress = false,
+                      uint32_t batch_records = defaultBatchRecords);
+
+    /** Closes the trace if close() wasn't called */
+    ~PackedTraceWriter();
+
+    PackedTraceWriter(const PackedTraceWriter &) = delete;
+    PackedTraceWriter &operator=(const PackedTraceWriter &) = delete;
+
+    void write(const Packet &pkt);
+    /** The dependencies are copied */
+    void write(const InstDep &inst);
+
+    /** Write out the last batch and close the file */
+    void close();
+};
+
+#endif // __PROTO_PACKED_TRACE_HH__
@@ -106,6 +106,12 @@ def parse_options():
     option("--stats-db-file", metavar="FILE", default="",
         help = "Sets the output database file for statistics [Default: \
             %default]")
+    option("--stats-columnar-file", metavar="FILE", default="",
+        help="Also write statistics to FILE in the columnar binary format, "
+        "appending to it if it exists [Default: %default]")
+    option("--stats-columnar-deltas", action="store_true", default=False,
+        help="Only store the stats that changed since the previous dump "
+        "in the columnar statistics file")
 
     # Configuration Options
     group("Configuration Options")
@@ -118,6 +124,17 @@ def parse_options():
     option("--dot-dvfs-config", metavar="FILE", default=None,
         help="Create DOT & pdf outputs of the DVFS configuration" + \
              " [Default: %default]")
+    option("--elab-cache", metavar="DIR", default="",
+        help="Cache the elaborated configuration in DIR, keyed on its "
+             "hash. Runs of the same configuration reuse the cached JSON "
+             "and DOT outputs, and the cached config.ini can be loaded by "
+             "the C++ configuration manager without Python")
+    option("--startup-profile", metavar="FILE", default="",
+        help="Write the time spent in each startup phase, by SimObject "
+             "type, to FILE")
+    option("--binary-checkpoints", action="store_true", default=False,
+        help="Also write checkpoints in the binary format, which is " \
+             "used instead of the ini file when restoring")
 
     # Debugging options
     group("Debugging Options")
@@ -134,6 +151,11 @@ def parse_options():
         help="End debug output at TICK")
     option("--debug-file", metavar="FILE", default="cout",
         help="Sets the output file for debug [Default: %default]")
+    option("--debug-binary", action="store_true",
+        help="Write debug output in a binary format that is faster to "
+             "write, decode it with util/decode_debug_trace.py")
+    option("--debug-ring", metavar="MB", type='int', default=0,
+        help="Keep only the last MB megabytes of binary debug output")
     option("--debug-ignore", metavar="EXPR", action='append', split=':',
         help="Ignore EXPR sim objects")
     option("--remote-gdb-port", type='int', default=7000,
@@ -349,6 +371,10 @@ def main(*args):
     if options.stats_file:
         stats.initText(options.stats_file)
 
+    if options.stats_columnar_file:
+        stats.initColumnar(options.stats_columnar_file,
+                           options.stats_columnar_deltas)
+
     # Check that at least one stats output format is enabled
     if not stats.stats_output_enabled():
         warn("Unable to output statistics.")
@@ -406,7 +432,13 @@ def main(*args):
         e = event.create(trace.disable, event.Event.Debug_Enable_Pri)
         event.mainq.schedule(e, options.debug_end)
 
-    trace.output(options.debug_file)
+    if options.debug_binary or options.debug_ring:
+        # Binary output can't go to the terminal
+        if options.debug_file in ("cout", "cerr"):
+            options.debug_file = "trace.bin"
+        trace.outputBinary(options.debug_file, options.debug_ring)
+    else:
+        trace.output(options.debug_file)
 
     for ignore in options.debug_ignore:
         check_tracing()
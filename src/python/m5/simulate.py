@@ -41,8 +41,11 @@
 #          Steve Reinhardt
 
 import atexit
+import hashlib
 import os
+import shutil
 import sys
+from cStringIO import StringIO
 
 # import the wrapped C++ functions
 import _m5.drain
@@ -53,6 +56,7 @@ import stats
 import SimObject
 import ticks
 import objects
+from m5.startup_profile import StartupProfile
 from m5.util.dot_writer import do_dot, do_dvfs_dot
 
 from util import fatal
@@ -69,81 +73,169 @@ _memory_modes = {
 
 _drain_manager = _m5.drain.DrainManager.instance()
 
+# Times the startup phases when --startup-profile is given
+_profile = None
+
+def _phase(name, fn, *args):
+    if _profile:
+        return _profile.phase(name, fn, *args)
+    return fn(*args)
+
+def _foreach(name, root, method, *args):
+    if _profile:
+        _profile.foreach(name, root.descendants(), method, *args)
+    else:
+        for obj in root.descendants(): getattr(obj, method)(*args)
+
+def _config_ini(root):
+    ini_file = StringIO()
+    # Print ini sections in sorted order for easier diffing
+    for obj in sorted(root.descendants(), key=lambda o: o.path()):
+        obj.print_ini(ini_file)
+    return ini_file.getvalue()
+
+def _write_atomic(path, data):
+    # Several runs may share the cache, so never expose a partial file
+    tmp = '%s.%d.tmp' % (path, os.getpid())
+    with open(tmp, 'w') as f:
+        f.write(data)
+    os.rename(tmp, path)
+
+def _cache_entry(cache_dir, config_hash):
+    entry = os.path.join(cache_dir, config_hash)
+    try:
+        os.makedirs(entry)
+    except OSError:
+        if not os.path.isdir(entry):
+            raise
+    return entry
+
+def _cached_outputs(cache_dir, outdir, config_hash, names, generate, *args):
+    """Generate output files that only depend on the configuration, or
+    copy them from the elaboration cache if an earlier run of the same
+    configuration left them there."""
+    if not cache_dir:
+        generate(*args)
+        return
+
+    entry = _cache_entry(cache_dir, config_hash)
+    cached = [ os.path.join(entry, os.path.basename(n)) for n in names ]
+    outputs = [ os.path.join(outdir, n) for n in names ]
+    if os.path.exists(cached[0]):
+        for src, dst in zip(cached, outputs):
+            if os.path.exists(src):
+                shutil.copyfile(src, dst)
+        return
+
+    generate(*args)
+    for src, dst in zip(outputs, cached):
+        if os.path.exists(src):
+            with open(src) as f:
+                _write_atomic(dst, f.read())
+
+def _write_json(root, filename):
+    try:
+        import json
+        json_file = file(filename, 'w')
+        d = root.get_config_as_dict()
+        json.dump(d, json_file, indent=4)
+        json_file.close()
+    except ImportError:
+        pass
+
 # The final hook to generate .ini files.  Called from the user script
 # once the config is built.
 def instantiate(ckpt_dir=None):
     from m5 import options
+    global _profile
 
     root = objects.Root.getInstance()
 
     if not root:
         fatal("Need to instantiate Root() before calling instantiate()")
 
+    if options.startup_profile and not _profile:
+        _profile = StartupProfile(os.path.join(options.outdir,
+                                               options.startup_profile))
+
     # we need to fix the global frequency
-    ticks.fixGlobalFrequency()
+    _phase("fixGlobalFrequency", ticks.fixGlobalFrequency)
 
     # Make sure SimObject-valued params are in the configuration
     # hierarchy so we catch them with future descendants() walks
-    for obj in root.descendants(): obj.adoptOrphanParams()
+    _foreach("adoptOrphanParams", root, "adoptOrphanParams")
 
     # Unproxy in sorted order for determinism
-    for obj in root.descendants(): obj.unproxyParams()
+    _foreach("unproxyParams", root, "unproxyParams")
+
+    # The elaborated config is identified by a hash of its ini file,
+    # which is also what the C++ CxxConfigManager loads
+    config_hash = None
+    if options.dump_config or options.elab_cache:
+        ini = _phase("config.ini", _config_ini, root)
+        config_hash = hashlib.sha1(ini).hexdigest()
 
     if options.dump_config:
         ini_file = file(os.path.join(options.outdir, options.dump_config), 'w')
-        # Print ini sections in sorted order for easier diffing
-        for obj in sorted(root.descendants(), key=lambda o: o.path()):
-            obj.print_ini(ini_file)
+        ini_file.write(ini)
         ini_file.close()
 
+    if options.elab_cache:
+        ini_path = os.path.join(_cache_entry(options.elab_cache, config_hash),
+                                "config.ini")
+        if not os.path.exists(ini_path):
+            _write_atomic(ini_path, ini)
+        print "Elaborated config cached as %s" % ini_path
+
     if options.json_config:
-        try:
-            import json
-            json_file = file(os.path.join(options.outdir, options.json_config), 'w')
-            d = root.get_config_as_dict()
-            json.dump(d, json_file, indent=4)
-            json_file.close()
-        except ImportError:
-            pass
+        _phase("config.json", _cached_outputs, options.elab_cache,
+               options.outdir, config_hash, [ options.json_config ],
+               _write_json, root,
+               os.path.join(options.outdir, options.json_config))
 
-    do_dot(root, options.outdir, options.dot_config)
+    if options.dot_config:
+        dot = options.dot_config
+        _phase("config.dot", _cached_outputs, options.elab_cache,
+               options.outdir, config_hash, [ dot, dot + ".svg", dot + ".pdf" ],
+               do_dot, root, options.outdir, dot)
 
     # Initialize the global statistics
-    stats.initSimStats()
+    _phase("initSimStats", stats.initSimStats)
 
     # Create the C++ sim objects and connect ports
-    for obj in root.descendants(): obj.createCCObject()
-    for obj in root.descendants(): obj.connectPorts()
+    _foreach("createCCObject", root, "createCCObject")
+    _foreach("connectPorts", root, "connectPorts")
 
     # Do a second pass to finish initializing the sim objects
-    for obj in root.descendants(): obj.init()
+    _foreach("init", root, "init")
 
     # Do a third pass to initialize statistics
-    for obj in root.descendants(): obj.regStats()
+    _foreach("regStats", root, "regStats")
 
     # Do a fourth pass to initialize probe points
-    for obj in root.descendants(): obj.regProbePoints()
+    _foreach("regProbePoints", root, "regProbePoints")
 
     # Do a fifth pass to connect probe listeners
-    for obj in root.descendants(): obj.regProbeListeners()
+    _foreach("regProbeListeners", root, "regProbeListeners")
 
     # We want to generate the DVFS diagram for the system. This can only be
     # done once all of the CPP objects have been created and initialised so
     # that we are able to figure out which object belongs to which domain.
     if options.dot_dvfs_config:
-        do_dvfs_dot(root, options.outdir, options.dot_dvfs_config)
+        _phase("dvfs.dot", do_dvfs_dot, root, options.outdir,
+               options.dot_dvfs_config)
 
     # We're done registering statistics.  Enable the stats package now.
-    stats.enable()
+    _phase("enableStats", stats.enable)
 
     # Restore checkpoint (if any)
     if ckpt_dir:
         _drain_manager.preCheckpointRestore()
         ckpt = _m5.core.getCheckpoint(ckpt_dir)
-        _m5.core.unserializeGlobals(ckpt);
-        for obj in root.descendants(): obj.loadState(ckpt)
+        _phase("unserializeGlobals", _m5.core.unserializeGlobals, ckpt)
+        _foreach("loadState", root, "loadState", ckpt)
     else:
-        for obj in root.descendants(): obj.initState()
+        _foreach("initState", root, "initState")
 
     # Check to see if any of the stat events are in the past after resuming from
     # a checkpoint, If so, this call will shift them to be at a valid time.
@@ -155,9 +247,12 @@ def simulate(*args, **kwargs):
 
     if need_startup:
         root = objects.Root.getInstance()
-        for obj in root.descendants(): obj.startup()
+        _foreach("startup", root, "startup")
         need_startup = False
 
+        if _profile:
+            _profile.write()
+
         # Python exit handlers happen in reverse order.
         # We want to dump stats last.
         atexit.register(stats.dump)
@@ -217,6 +312,8 @@ def memInvalidate(root):
         obj.memInvalidate()
 
 def checkpoint(dir):
+    from m5 import options
+
     root = objects.Root.getInstance()
     if not isinstance(root, objects.Root):
         raise TypeError, "Checkpoint must be called on a root object."
@@ -224,7 +321,7 @@ def checkpoint(dir):
     drain()
     memWriteback(root)
     print "Writing checkpoint"
-    _m5.core.serializeAll(dir)
+    _m5.core.serializeAll(dir, options.binary_checkpoints)
 
 def _changeMemoryMode(system, mode):
     if not isinstance(system, (objects.Root, objects.System)):
@@ -367,6 +464,21 @@ def fork(simout="%(parent)s.f%(fork_seq)i"):
 
     return pid
 
+def preloadCheckpoint(ckpt_dir, threads=0):
+    """Parse a checkpoint and inflate its memory images ahead of time.
+
+    Meant to be called before forking a child per design point of a
+    sweep. Every child that later calls instantiate() on the same
+    checkpoint directory reuses the parsed checkpoint, and adopts the
+    memory images as copy-on-write pages instead of reading the
+    checkpoint files again.
+
+    Keyword Arguments:
+      threads -- Host threads used to read sparse memory images, 0
+                 for one per core.
+    """
+    _m5.core.preloadCheckpoint(ckpt_dir, threads)
+
 from _m5.core import disableAllListeners, listenersDisabled
 from _m5.core import listenersLoopbackOnly
 from _m5.core import curTick
@@ -0,0 +1,94 @@
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Startup profiling
+
+Times the phases of m5.instantiate() and the first m5.simulate() call
+that set up the simulated system. Phases that call a method on every
+SimObject are also broken down by SimObject type, which includes the
+time spent creating and initializing the C++ objects. The report is
+written when the simulation starts, or at exit if it never does.
+"""
+
+from __future__ import print_function
+
+import atexit
+import time
+
+class StartupProfile(object):
+    def __init__(self, filename):
+        self.filename = filename
+        self.phases = []
+        # (phase, type) -> [seconds, objects]
+        self.types = {}
+        self.start = time.time()
+        self.written = False
+        atexit.register(self.write)
+
+    def phase(self, name, fn, *args):
+        """Time a phase that isn't split across SimObjects."""
+        start = time.time()
+        result = fn(*args)
+        self.phases.append((name, time.time() - start))
+        return result
+
+    def foreach(self, name, objs, method, *args):
+        """Call method on every object and time it per SimObject type."""
+        clock = time.time
+        types = self.types
+        start = clock()
+        for obj in objs:
+            obj_start = clock()
+            getattr(obj, method)(*args)
+            key = (name, getattr(obj, 'type', type(obj).__name__))
+            entry = types.get(key)
+            if entry is None:
+                entry = types[key] = [0.0, 0]
+            entry[0] += clock() - obj_start
+            entry[1] += 1
+        self.phases.append((name, clock() - start))
+
+    def write(self):
+        if self.written:
+            return
+        self.written = True
+
+        total = time.time() - self.start
+        with open(self.filename, 'w') as f:
+            print("Startup time %.3fs" % total, file=f)
+            print(file=f)
+            print("%-32s %10s %6s" % ("Phase", "Seconds", "%"), file=f)
+            for name, secs in self.phases:
+                print("%-32s %10.4f %6.1f" % (name, secs,
+                      100 * secs / total if total else 0), file=f)
+
+            print(file=f)
+            print("%-24s %-32s %8s %10s %10s" % ("Phase", "Type", "Objects",
+                  "Seconds", "Per object"), file=f)
+            rows = sorted(self.types.items(), key=lambda i: -i[1][0])
+            for (name, obj_type), (secs, count) in rows:
+                print("%-24s %-32s %8d %10.4f %10.6f" % (name, obj_type,
+                      count, secs, secs / count), file=f)
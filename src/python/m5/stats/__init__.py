@@ -58,6 +58,12 @@ def initText(filename, desc=True):
     global STATS_OUTPUT_ENABLED
     STATS_OUTPUT_ENABLED = True
 
+def initColumnar(filename, deltas=False):
+    output = _m5.stats.initColumnar(filename, deltas)
+    outputList.append(output)
+    global STATS_OUTPUT_ENABLED
+    STATS_OUTPUT_ENABLED = True
+
 # Stat exports
 from _m5.stats import schedStatEvent as schedEvent
 from _m5.stats import periodicStatDump
@@ -125,11 +131,28 @@ def _textFactory(fn, desc=True):
 
     return _m5.stats.initText(fn, desc)
 
+@_url_factory
+def _columnarFactory(fn, deltas=False):
+    """Output stats in the columnar binary format.
+
+    Columnar stat files store the names of the stats once and one row
+    of values per dump. They are appended to if they exist, and can be
+    loaded as numpy arrays using m5.stats.columnar. If the deltas
+    parameter is set, dumps after the first one only store the stats
+    that changed.
+
+    Example: columnar://stats.col?deltas=True
+
+    """
+
+    return _m5.stats.initColumnar(fn, deltas)
+
 factories = {
     # Default to the text factory if we're given a naked path
     "" : _textFactory,
     "file" : _textFactory,
     "text" : _textFactory,
+    "columnar" : _columnarFactory,
 }
 
 def addStatVisitor(url):
@@ -243,14 +266,28 @@ def dump(stats_desc=""):
 
     _m5.stats.processDumpQueue()
 
-    prepare()
+    # Outputs that store changes only visit the stats updated since the
+    # last dump, which saves walking all stats when they are the only
+    # outputs.
+    outputs = [ o for o in outputList if o.valid() ]
+    full = [ o for o in outputs if not o.incremental() ]
+
+    if full:
+        prepare()
 
-    for output in outputList:
-        if output.valid():
+    for output in outputs:
+        if output in full:
             output.begin(stats_desc)
             for stat in stats_list:
                 stat.visit(output)
             output.end()
+        else:
+            _m5.stats.dumpDirty(output, stats_desc)
+
+    # Only the incremental outputs look at the dirty flags, so there is
+    # no need to walk all stats to clear them otherwise.
+    if len(full) != len(outputs):
+        _m5.stats.clearDirty()
 
     # global dump_count
     # dump_count = dump_count + 1
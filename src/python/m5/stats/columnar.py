@@ -0,0 +1,439 @@
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Reader for columnar stats files
+
+Stats::Columnar writes a schema describing the row of values of every
+dump, followed by one row per dump. This module loads such a file and
+returns every stat as a numpy array with one row per dump, without
+parsing any text. It only needs numpy, so it can also be used outside
+of gem5:
+
+    from m5.stats import columnar
+    stats = columnar.load("m5out/stats.col")
+    cycles = stats["system.acc0.cycles"]          # shape (dumps,)
+    loads = stats["system.acc0.loads"]            # shape (dumps, 8)
+    first = stats["system.acc0.loads::input"]     # shape (dumps,)
+
+Files written with deltas only store the stats that changed in every
+dump but the first one of a run. Loading such a file rebuilds the full
+rows, so they read like any other file. snapshot() returns all stats
+of one dump, and expand() writes the file again with full dumps for
+tools that don't read deltas.
+
+Running the module as a script lists the stats in a file, prints the
+values of the stats given after the file name, or expands the file.
+"""
+
+from __future__ import print_function
+
+import mmap
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b"GEM5STC1"
+VERSION = 1
+BYTE_ORDER_MARK = 0x01020304
+
+SCHEMA = 1
+DUMP = 2
+SPARSE = 3
+DELTA = 4
+
+KINDS = ("scalar", "vector", "dist", "vectordist", "vector2d", "formula",
+         "sparsehist")
+
+class Stat(object):
+    """Layout of one stat in the rows of a schema"""
+
+    def __init__(self, id, kind, name, desc, elements, offset):
+        self.id = id
+        self.kind = kind
+        self.name = name
+        self.desc = desc
+        self.elements = elements
+        self.offset = offset
+
+    def __repr__(self):
+        return "Stat(%s, %s, %d values)" % (self.name, self.kind,
+                                            len(self.elements))
+
+class Segment(object):
+    """Dumps sharing one schema"""
+
+    def __init__(self, stats, width, raw):
+        self.stats = stats
+        self.raw = raw
+        self.byName = dict((s.name, s) for s in stats)
+        self.width = width
+        self.dumps = []
+        self._values = None
+
+    def values(self):
+        """All rows of the segment as one (dumps, width) array"""
+        if self._values is None:
+            if self.dumps:
+                self._values = np.vstack([ row for _, row in self.dumps ])
+            else:
+                self._values = np.empty((0, self.width))
+        return self._values
+
+class StatsFile(object):
+    """A columnar stats file loaded for reading
+
+    The values of a stat are indexed by the stat's name and, optionally,
+    the name of one of its elements separated by '::'. Dumps from
+    segments of the file that don't have the stat, or have a different
+    number of values for it, read as NaN.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.segments = []
+        self.ticks = []
+        self.descs = []
+        self._sparse = []
+
+        with open(path, "rb") as f:
+            try:
+                self._buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            except ValueError:
+                # Empty files can't be mapped
+                self._buf = b""
+        self._parse()
+        self.ticks = np.array(self.ticks, dtype=np.uint64)
+
+    def _parse(self):
+        buf = self._buf
+        if len(buf) < 16 or buf[0:8] != MAGIC:
+            raise ValueError("%s isn't a columnar stats file" % self.path)
+
+        for order in "<>":
+            if struct.unpack_from(order + "I", buf, 12)[0] == \
+               BYTE_ORDER_MARK:
+                break
+        else:
+            raise ValueError("%s has an invalid byte order mark" % self.path)
+        self.order = order
+        self.dtype = np.dtype(order + "f8")
+
+        version, = struct.unpack_from(order + "I", buf, 8)
+        if version != VERSION:
+            raise ValueError("%s has unsupported version %d" %
+                             (self.path, version))
+
+        pos = 16
+        chunk = struct.Struct(order + "IIQ")
+        while pos + chunk.size <= len(buf):
+            kind, _, size = chunk.unpack_from(buf, pos)
+            pos += chunk.size
+            if pos + size > len(buf):
+                # A dump that was cut short, e.g., by a crash
+                break
+
+            if kind == SCHEMA:
+                self._parseSchema(pos, size)
+            elif kind == DUMP:
+                self._parseDump(pos, size)
+            elif kind == DELTA:
+                self._parseDelta(pos, size)
+            elif kind == SPARSE:
+                self._parseSparse(pos)
+            pos += size
+
+    def _string(self, pos):
+        length, = struct.unpack_from(self.order + "I", self._buf, pos)
+        pos += 4
+        return self._buf[pos:pos + length].decode("utf-8"), pos + length
+
+    def _parseSchema(self, pos, size):
+        raw = self._buf[pos:pos + size]
+        num_stats, width = struct.unpack_from(self.order + "QQ", self._buf,
+                                              pos)
+        pos += 16
+
+        stats = []
+        offset = 0
+        head = struct.Struct(self.order + "iII")
+        for _ in range(num_stats):
+            id, kind, count = head.unpack_from(self._buf, pos)
+            pos += head.size
+            name, pos = self._string(pos)
+            desc, pos = self._string(pos)
+            elements = []
+            for _ in range(count):
+                element, pos = self._string(pos)
+                elements.append(element)
+            stats.append(Stat(id, KINDS[kind], name, desc, elements, offset))
+            offset += count
+
+        self.segments.append(Segment(stats, width, raw))
+
+    def _parseDump(self, pos, size):
+        if not self.segments:
+            raise ValueError("%s has a dump before its schema" % self.path)
+
+        tick, count = struct.unpack_from(self.order + "QQ", self._buf, pos)
+        desc, end = self._string(pos + 16)
+        start = pos + (end - pos + 7) // 8 * 8
+
+        segment = self.segments[-1]
+        if count != segment.width or start + count * 8 != pos + size:
+            raise ValueError("%s: dump %d doesn't match its schema" %
+                             (self.path, len(self.ticks)))
+
+        row = np.frombuffer(self._buf, dtype=self.dtype, count=count,
+                            offset=start)
+        self._addDump(segment, tick, desc, row, {})
+
+    def _parseDelta(self, pos, size):
+        segment = self.segments[-1] if self.segments else None
+        if segment is None or not segment.dumps:
+            raise ValueError("%s has a delta before the first dump of its "
+                             "schema" % self.path)
+
+        tick, num_stats, count = struct.unpack_from(self.order + "QQQ",
+                                                    self._buf, pos)
+        desc, end = self._string(pos + 24)
+        start = pos + (end - pos + 7) // 8 * 8
+        indices = np.frombuffer(self._buf, dtype=self.order + "u4",
+                                count=num_stats, offset=start)
+        start += (4 * num_stats + 7) // 8 * 8
+        if start + count * 8 != pos + size:
+            raise ValueError("%s: delta %d is corrupt" %
+                             (self.path, len(self.ticks)))
+        values = np.frombuffer(self._buf, dtype=self.dtype, count=count,
+                               offset=start)
+
+        # Start from the previous dump and update the stats that changed
+        row = segment.dumps[-1][1].copy()
+        used = 0
+        for index in indices.tolist():
+            stat = segment.stats[index]
+            width = len(stat.elements)
+            row[stat.offset:stat.offset + width] = values[used:used + width]
+            used += width
+        if used != count:
+            raise ValueError("%s: delta %d doesn't match its schema" %
+                             (self.path, len(self.ticks)))
+
+        self._addDump(segment, tick, desc, row, dict(self._sparse[-1]))
+
+    def _addDump(self, segment, tick, desc, row, sparse):
+        segment.dumps.append((len(self.ticks), row))
+        segment._values = None
+        self.ticks.append(tick)
+        self.descs.append(desc)
+        self._sparse.append(sparse)
+
+    def _parseSparse(self, pos):
+        num_stats, = struct.unpack_from(self.order + "Q", self._buf, pos)
+        pos += 8
+
+        stats = self.segments[-1].stats
+        entries = {}
+        for _ in range(num_stats):
+            index, _, count = struct.unpack_from(self.order + "IIQ",
+                                                 self._buf, pos)
+            pos += 16
+            pairs = np.frombuffer(self._buf, dtype=self.dtype,
+                                  count=2 * count, offset=pos)
+            pos += 16 * count
+            entries[stats[index].name] = dict(zip(pairs[0::2].tolist(),
+                                                  pairs[1::2].tolist()))
+        self._sparse[-1].update(entries)
+
+    def __len__(self):
+        return len(self.ticks)
+
+    def __contains__(self, name):
+        try:
+            self._lookup(name)
+            return True
+        except KeyError:
+            return False
+
+    def names(self):
+        """Names of all stats, in the order they were dumped"""
+        seen = set()
+        names = []
+        for segment in self.segments:
+            for stat in segment.stats:
+                if stat.name not in seen:
+                    seen.add(stat.name)
+                    names.append(stat.name)
+        return names
+
+    def stat(self, name):
+        """Layout of a stat in the last schema that has it"""
+        for segment in reversed(self.segments):
+            if name in segment.byName:
+                return segment.byName[name]
+        raise KeyError(name)
+
+    def elements(self, name):
+        """Names of the values of a stat"""
+        return self.stat(name).elements
+
+    def _lookup(self, name):
+        """Split a name into a stat and the index of one of its values"""
+        try:
+            return self.stat(name), None
+        except KeyError:
+            pass
+
+        # Element names can contain '::' themselves, e.g., for vector
+        # distributions, so try every split.
+        pos = name.find("::")
+        while pos >= 0:
+            try:
+                stat = self.stat(name[:pos])
+                return stat, stat.elements.index(name[pos + 2:])
+            except (KeyError, ValueError):
+                pos = name.find("::", pos + 2)
+        raise KeyError(name)
+
+    def __getitem__(self, name):
+        """Values of a stat, or one of its values, in every dump
+
+        Stats with a single value, and single values of a stat, are
+        returned as an array of shape (dumps,), other stats as an array
+        of shape (dumps, values).
+        """
+        stat, index = self._lookup(name)
+        width = 1 if index is not None else len(stat.elements)
+
+        result = np.full((len(self), width), np.nan)
+        for segment in self.segments:
+            seg_stat = segment.byName.get(stat.name)
+            if seg_stat is None or \
+               len(seg_stat.elements) != len(stat.elements) or \
+               not segment.dumps:
+                continue
+            first = seg_stat.offset + (index or 0)
+            rows = [ d for d, _ in segment.dumps ]
+            result[rows] = segment.values()[:, first:first + width]
+
+        return result[:, 0] if width == 1 else result
+
+    def sparse(self, name):
+        """Buckets of a sparse histogram as one {key: count} per dump"""
+        if self.stat(name).kind != "sparsehist":
+            raise KeyError("%s isn't a sparse histogram" % name)
+        return [ sparse.get(name, {}) for sparse in self._sparse ]
+
+    def snapshot(self, dump=-1):
+        """All stats of one dump as a dictionary from name to value"""
+        dump = range(len(self))[dump]
+        for segment in self.segments:
+            for index, row in segment.dumps:
+                if index == dump:
+                    return dict(
+                        (s.name, row[s.offset] if len(s.elements) == 1 else
+                         row[s.offset:s.offset + len(s.elements)].copy())
+                        for s in segment.stats)
+        raise IndexError(dump)
+
+    def expand(self, path):
+        """Write the file again, storing every dump in full"""
+        order = self.order
+        chunk = struct.Struct(order + "IIQ")
+
+        def write_chunk(f, kind, payload):
+            payload += b"\0" * (-len(payload) % 8)
+            f.write(chunk.pack(kind, 0, len(payload)))
+            f.write(payload)
+
+        with open(path, "wb") as f:
+            f.write(MAGIC + struct.pack(order + "II", VERSION,
+                                        BYTE_ORDER_MARK))
+            for segment in self.segments:
+                write_chunk(f, SCHEMA, segment.raw)
+                sparse_stats = [ (i, s.name)
+                                 for i, s in enumerate(segment.stats)
+                                 if s.kind == "sparsehist" ]
+
+                for index, row in segment.dumps:
+                    desc = self.descs[index].encode("utf-8")
+                    head = struct.pack(order + "QQI", int(self.ticks[index]),
+                                       len(row), len(desc)) + desc
+                    head += b"\0" * (-len(head) % 8)
+                    write_chunk(f, DUMP, head +
+                                row.astype(self.dtype).tobytes())
+
+                    if not sparse_stats:
+                        continue
+                    payload = struct.pack(order + "Q", len(sparse_stats))
+                    for stat_index, name in sparse_stats:
+                        buckets = sorted(self._sparse[index].get(name,
+                                                                 {}).items())
+                        payload += struct.pack(order + "IIQ", stat_index, 0,
+                                               len(buckets))
+                        payload += np.array(buckets, dtype=self.dtype) \
+                                     .tobytes()
+                    write_chunk(f, SPARSE, payload)
+
+def load(path):
+    """Load a columnar stats file"""
+    return StatsFile(path)
+
+def main(argv=None):
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="List the stats in a columnar stats file, or print "
+        "their values in every dump.")
+    parser.add_argument("file", help="Columnar stats file")
+    parser.add_argument("stats", nargs="*",
+                        help="Stats, or stat::element, to print")
+    parser.add_argument("--expand", metavar="FILE",
+                        help="Write the file again to FILE with every dump "
+                        "stored in full")
+    args = parser.parse_args(argv)
+
+    stats = load(args.file)
+    if args.expand:
+        stats.expand(args.expand)
+        return
+
+    if not args.stats:
+        print("%d dumps" % len(stats))
+        for name in stats.names():
+            stat = stats.stat(name)
+            print("%-60s %-10s %5d  # %s" % (name, stat.kind,
+                                             len(stat.elements), stat.desc))
+        return
+
+    for name in args.stats:
+        values = stats[name]
+        print(name)
+        for tick, value in zip(stats.ticks, values):
+            print("%20d %s" % (tick, value))
+
+if __name__ == "__main__":
+    main()
@@ -56,6 +56,7 @@
 #include "base/random.hh"
 #include "base/socket.hh"
 #include "base/types.hh"
+#include "mem/physical.hh"
 #include "sim/core.hh"
 #include "sim/drain.hh"
 #include "sim/serialize.hh"
@@ -263,11 +264,18 @@ pybind_init_core(py::module &m_native)
      * Serialization helpers
      */
     m_core
-        .def("serializeAll", &Serializable::serializeAll)
+        .def("serializeAll", &Serializable::serializeAll,
+             py::arg("cpt_dir"), py::arg("binary") = false)
         .def("unserializeGlobals", &Serializable::unserializeGlobals)
         .def("getCheckpoint", [](const std::string &cpt_dir) {
             return new CheckpointIn(cpt_dir, pybindSimObjectResolver);
         })
+        .def("preloadCheckpoint", [](const std::string &cpt_dir,
+                                     unsigned threads) {
+            CheckpointIn::preload(cpt_dir);
+            CheckpointIn cp(cpt_dir, pybindSimObjectResolver);
+            PhysicalMemory::preloadStores(cp, threads);
+        })
 
         ;
 
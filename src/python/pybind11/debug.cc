@@ -45,12 +45,16 @@
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
 
+#include <fstream>
+#include <iostream>
 #include <map>
 #include <vector>
 
 #include "base/debug.hh"
+#include "base/logging.hh"
 #include "base/output.hh"
 #include "base/trace.hh"
+#include "base/trace_binary.hh"
 #include "sim/debug.hh"
 
 namespace py = pybind11;
@@ -70,6 +74,26 @@ output(const char *filename)
     Trace::setDebugLogger(new Trace::OstreamLogger(*file_stream->stream()));
 }
 
+static void
+outputBinary(const char *filename, int ring_mb)
+{
+    Trace::setDebugLogger(new Trace::BinaryLogger(simout.resolve(filename),
+                                                  size_t(ring_mb) << 20));
+}
+
+static void
+decodeBinary(const char *in, const char *out)
+{
+    if (std::string(out) == "cout") {
+        Trace::decodeBinaryTrace(in, std::cout);
+    } else {
+        std::ofstream file(out);
+        if (!file)
+            fatal("Can't open %s\n", out);
+        Trace::decodeBinaryTrace(in, file);
+    }
+}
+
 static void
 ignore(const char *expr)
 {
@@ -112,6 +136,8 @@ pybind_init_debug(py::module &m_native)
     py::module m_trace = m_native.def_submodule("trace");
     m_trace
         .def("output", &output)
+        .def("outputBinary", &outputBinary)
+        .def("decodeBinary", &decodeBinary)
         .def("ignore", &ignore)
         .def("enable", &Trace::enable)
         .def("disable", &Trace::disable)
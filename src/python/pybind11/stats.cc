@@ -45,6 +45,7 @@
 #include "pybind11/stl.h"
 
 #include "base/statistics.hh"
+#include "base/stats/columnar.hh"
 #include "base/stats/text.hh"
 #include "base/stats/sql.hh"
 #include "sim/stat_control.hh"
@@ -79,6 +80,8 @@ pybind_init_stats(py::module &m_native)
         .def("initSimStats", &Stats::initSimStats)
         .def("initText", &Stats::initText, py::return_value_policy::reference)
         .def("initOutputSQL", &Stats::initOutputSQL, py::return_value_policy::reference)
+        .def("initColumnar", &Stats::initColumnar,
+             py::return_value_policy::reference)
         .def("registerPythonStatsHandlers",
              &Stats::registerPythonStatsHandlers)
         .def("schedStatEvent", &Stats::schedStatEvent)
@@ -86,6 +89,8 @@ pybind_init_stats(py::module &m_native)
         .def("updateEvents", &Stats::updateEvents)
         .def("processResetQueue", &Stats::processResetQueue)
         .def("processDumpQueue", &Stats::processDumpQueue)
+        .def("dumpDirty", &Stats::dumpDirty)
+        .def("clearDirty", &Stats::clearDirty)
         .def("enable", &Stats::enable)
         .def("enabled", &Stats::enabled)
         .def("statsList", &Stats::statsList)
@@ -95,6 +100,7 @@ pybind_init_stats(py::module &m_native)
         .def("begin", &Stats::Output::begin)
         .def("end", &Stats::Output::end)
         .def("valid", &Stats::Output::valid)
+        .def("incremental", &Stats::Output::incremental)
         ;
 
     py::class_<Stats::Info>(m, "Info")
@@ -46,6 +46,9 @@ class Process(SimObject):
                             table in an architecture-specific format')
     kvmInSE = Param.Bool('false', 'initialize the process for KvmCPU in SE')
     maxStackSize = Param.MemorySize('64MB', 'maximum size of the stack')
+    mapExecutable = Param.Bool(False, 'map the executable copy-on-write \
+                               instead of copying it, it must not be \
+                               modified until the simulation ends')
 
     uid = Param.Int(100, 'user id')
     euid = Param.Int(100, 'effective user id')
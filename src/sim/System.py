@@ -51,6 +51,13 @@ from SimpleMemory import *
 class MemoryMode(Enum): vals = ['invalid', 'atomic', 'timing',
                                 'atomic_noncaching']
 
+# Checkpoint formats for the physical memory backing stores. 'gzip'
+# compresses the whole store as one stream. The sparse formats only
+# store non-zero pages, spread the work across host threads, and either
+# compress them ('sparse') or store them raw so that they can be mapped
+# back in on restore ('sparse_raw', see memory_checkpoint_mmap).
+class MemoryCheckpointFormat(Enum): vals = ['gzip', 'sparse', 'sparse_raw']
+
 class System(MemObject):
     type = 'System'
     cxx_header = "sim/system.hh"
@@ -59,6 +66,7 @@ class System(MemObject):
     cxx_exports = [
         PyBindMethod("getMemoryMode"),
         PyBindMethod("setMemoryMode"),
+        PyBindMethod("acceleratorWaitTicks"),
     ]
 
     memories = VectorParam.AbstractMemory(Self.all,
@@ -76,6 +84,15 @@ class System(MemObject):
     mmap_using_noreserve = Param.Bool(False, "mmap the backing store " \
                                           "without reserving swap")
 
+    memory_checkpoint_format = Param.MemoryCheckpointFormat('gzip',
+        "Format used to checkpoint the physical memory")
+    memory_checkpoint_threads = Param.Unsigned(0, "Host threads used to "
+        "write and restore sparse memory checkpoints (0 for one per core)")
+    # Mapped pages are only read from the checkpoint when first touched,
+    # so the checkpoint files must not change while the run goes on.
+    memory_checkpoint_mmap = Param.Bool(False, "Map 'sparse_raw' memory "
+        "checkpoints into the backing store instead of copying them")
+
     # The memory ranges are to be populated when creating the system
     # such that these can be passed from the I/O subsystem through an
     # I/O bridge or cache
@@ -117,6 +134,11 @@ class System(MemObject):
     multi_thread = Param.Bool(False,
             "Supports multi-threaded CPUs? Impacts Thread/Context IDs")
 
+    # Sampled simulation sets this to measure how long the host waits
+    # for its accelerators, see acceleratorWaitTicks()
+    accel_poll_period = Param.Latency('0ns', "How often to check the "
+            "finish flags of running accelerators, 0 to not check them")
+
     # Dynamic voltage and frequency handler for the system, disabled by default
     # Provide list of domains that need to be controlled by the handler
     dvfs_handler = DVFSHandler()
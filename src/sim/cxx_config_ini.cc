@@ -104,3 +104,10 @@ CxxIniFile::load(const std::string &filename)
 {
     return iniFile.load(filename);
 }
+
+bool
+CxxIniFile::loadCached(const std::string &cache_dir,
+    const std::string &config_hash)
+{
+    return load(cache_dir + "/" + config_hash + "/config.ini");
+}
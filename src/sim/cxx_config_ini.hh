@@ -81,6 +81,16 @@ class CxxIniFile : public CxxConfigFileBase
         bool return_paths = false) const;
 
     bool load(const std::string &filename);
+
+    /**
+     * Load an elaborated config that Python gem5 left in the cache
+     * given by --elab-cache, without rerunning the Python config.
+     *
+     * @param cache_dir The elaboration cache
+     * @param config_hash Hash of the config, as printed when it was cached
+     */
+    bool loadCached(const std::string &cache_dir,
+        const std::string &config_hash);
 };
 
 #endif // __SIM_CXX_CONFIG_INI_HH__
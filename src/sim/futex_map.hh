@@ -33,6 +33,7 @@
 #ifndef __FUTEX_MAP_HH__
 #define __FUTEX_MAP_HH__
 
+#include <mutex>
 #include <unordered_map>
 
 #include <cpu/thread_context.hh>
@@ -91,6 +92,7 @@ class FutexMap : public std::unordered_map<FutexKey, ThreadContextList>
     void
     suspend(Addr addr, uint64_t tgid, ThreadContext *tc)
     {
+        std::lock_guard<std::mutex> guard(lock);
         FutexKey key(addr, tgid);
         auto it = find(key);
 
@@ -109,6 +111,7 @@ class FutexMap : public std::unordered_map<FutexKey, ThreadContextList>
     int
     wakeup(Addr addr, uint64_t tgid, int count)
     {
+        std::lock_guard<std::mutex> guard(lock);
         FutexKey key(addr, tgid);
         auto it = find(key);
 
@@ -130,6 +133,14 @@ class FutexMap : public std::unordered_map<FutexKey, ThreadContextList>
         return woken_up;
     }
 
+  private:
+    /**
+     * Processes on cores serviced by different event queues may use
+     * their futexes at once. A process itself is never shared between
+     * event queues (see Process::initState), so the contexts woken up
+     * are always on the queue of the caller.
+     */
+    std::mutex lock;
 };
 
 #endif // __FUTEX_MAP_HH__
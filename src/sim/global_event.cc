@@ -149,11 +149,27 @@ GlobalSyncEvent::BarrierEvent::process()
     // to finish before continuing
     globalBarrier();
     curEventQueue()->handleAsyncInsertions();
+
+    auto callbacks = quantumCallbacks.find(curEventQueue());
+    if (callbacks != quantumCallbacks.end())
+        callbacks->second.process();
+}
+
+uint64_t GlobalSyncEvent::_quantumCount = 0;
+std::map<EventQueue *, CallbackQueue> GlobalSyncEvent::quantumCallbacks;
+
+void
+GlobalSyncEvent::registerQuantumCallback(EventQueue *eq, Callback *cb)
+{
+    assert(!inParallelMode);
+    quantumCallbacks[eq].add(cb);
 }
 
 void
 GlobalSyncEvent::process()
 {
+    ++_quantumCount;
+
     if (repeat) {
         schedule(curTick() + repeat);
     }
@@ -32,10 +32,12 @@
 #ifndef __SIM_GLOBAL_EVENT_HH__
 #define __SIM_GLOBAL_EVENT_HH__
 
+#include <map>
 #include <mutex>
 #include <vector>
 
 #include "base/barrier.hh"
+#include "base/callback.hh"
 #include "sim/eventq_impl.hh"
 
 /**
@@ -232,7 +234,29 @@ class GlobalSyncEvent : public BaseGlobalEventTemplate<GlobalSyncEvent>
 
     const char *description() const;
 
+    /**
+     * Register a callback that the thread servicing the given event
+     * queue runs each time it leaves a synchronisation barrier,
+     * before it executes any event of the next quantum. All threads
+     * have finished the previous quantum at that point, so whatever
+     * they produced during it is complete, although they may already
+     * be running the next one. Callbacks must be registered before
+     * the simulation starts.
+     */
+    static void registerQuantumCallback(EventQueue *eq, Callback *cb);
+
+    /**
+     * Number of synchronisation barriers passed so far. It only
+     * changes while every thread is held at a barrier, so threads
+     * can use it to tell quanta apart without locking.
+     */
+    static uint64_t quantumCount() { return _quantumCount; }
+
     Tick repeat;
+
+  private:
+    static uint64_t _quantumCount;
+    static std::map<EventQueue *, CallbackQueue> quantumCallbacks;
 };
 
 
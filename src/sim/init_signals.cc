@@ -58,6 +58,7 @@
 #include "base/atomicio.hh"
 #include "base/cprintf.hh"
 #include "base/logging.hh"
+#include "base/trace.hh"
 #include "sim/async.hh"
 #include "sim/backtrace.hh"
 #include "sim/core.hh"
@@ -153,6 +154,9 @@ abortHandler(int sigtype)
         STATIC_ERR("Program aborted\n\n");
     }
 
+    // Save the buffered debug messages leading up to the abort
+    Trace::getDebugLogger()->signalFlush();
+
     print_backtrace();
     raiseFatalSignal(sigtype);
 }
@@ -163,6 +167,8 @@ segvHandler(int sigtype)
 {
     STATIC_ERR("gem5 has encountered a segmentation fault!\n\n");
 
+    Trace::getDebugLogger()->signalFlush();
+
     print_backtrace();
     raiseFatalSignal(SIGSEGV);
 }
@@ -60,6 +60,7 @@
 #include "base/loader/symtab.hh"
 #include "base/statistics.hh"
 #include "config/the_isa.hh"
+#include "cpu/base.hh"
 #include "cpu/thread_context.hh"
 #include "mem/page_table.hh"
 #include "mem/se_translating_port_proxy.hh"
@@ -143,6 +144,8 @@ Process::Process(ProcessParams *params, EmulationPageTable *pTable,
     exitGroup = new bool();
     sigchld = new bool();
 
+    objFile->setMapImage(params->mapExecutable);
+
     if (!debugSymbolTable) {
         debugSymbolTable = new SymbolTable();
         if (!objFile->loadGlobalSymbols(debugSymbolTable) ||
@@ -257,13 +260,26 @@ Process::regStats()
         .name(name() + ".numSyscalls")
         .desc("Number of system calls")
         ;
+
+    functionalBytes
+        .name(name() + ".functionalBytes")
+        .desc("Bytes copied by functional accesses")
+        ;
+
+    directFunctionalBytes
+        .name(name() + ".directFunctionalBytes")
+        .desc("Bytes copied by functional accesses directly to memory")
+        ;
 }
 
 ThreadContext *
 Process::findFreeContext()
 {
+    // the contexts of a process stay on the event queue of the core
+    // that runs it, see initState()
     for (auto &it : system->threadContexts) {
-        if (ThreadContext::Halted == it->status())
+        if (it->getCpuPtr()->eventQueue() == curEventQueue() &&
+            ThreadContext::Halted == it->status())
             return it;
     }
     return nullptr;
@@ -291,6 +307,16 @@ Process::initState()
     // first thread context for this process... initialize & enable
     ThreadContext *tc = system->getThreadContext(contextIds[0]);
 
+    // the state of a process, e.g. its page table, its file descriptors
+    // and its futexes, is not locked, so all its threads must run on
+    // cores serviced by the same event queue
+    for (auto id : contextIds) {
+        if (system->getThreadContext(id)->getCpuPtr()->eventQueue() !=
+            tc->getCpuPtr()->eventQueue())
+            fatal("Process %s runs on cores on different event queues, "
+                  "which is not supported.\n", name());
+    }
+
     // mark this context as active so it will start ticking.
     tc->activate();
 
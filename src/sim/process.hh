@@ -173,6 +173,10 @@ class Process : public SimObject
     System *system;
 
     Stats::Scalar numSyscalls;  // track how many system calls are executed
+    // Bytes copied by functional accesses to the process' memory, and
+    // how many of them went straight to the backing store
+    Stats::Scalar functionalBytes;
+    Stats::Scalar directFunctionalBytes;
 
     bool useArchPT; // flag for using architecture specific page table
     bool kvmInSE;   // running KVM requires special initialization
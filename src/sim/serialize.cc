@@ -53,8 +53,10 @@
 
 #include <cerrno>
 #include <fstream>
+#include <limits>
 #include <list>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "arch/generic/vec_reg.hh"
@@ -165,6 +167,57 @@ parseParam(const string &s, string &value)
     return true;
 }
 
+//
+// Binary checkpoints store integer values as 64-bit words. These are
+// range checked into integral types the same way to_number() checks
+// text, rather than being printed and parsed again. Values of other
+// types always go through their text form.
+//
+template <class T>
+struct ReadFromWords
+{
+    static const bool value = std::is_integral<T>::value &&
+        !std::is_same<T, bool>::value;
+};
+
+template <class T>
+typename std::enable_if<ReadFromWords<T>::value, bool>::type
+parseWord(const BinaryIni::Ints &ints, uint64_t i, T &value)
+{
+    if (std::is_signed<T>::value) {
+        if (!ints.isSigned() &&
+            ints[i] > (uint64_t)std::numeric_limits<long long>::max())
+            return false;
+        long long r = (long long)ints[i];
+        if (r < (long long)std::numeric_limits<T>::min() ||
+            r > (long long)std::numeric_limits<T>::max())
+            return false;
+        value = static_cast<T>(r);
+    } else {
+        // Negative words wrap around like stoull() does
+        unsigned long long r = ints[i];
+        if (r > (unsigned long long)std::numeric_limits<T>::max())
+            return false;
+        value = static_cast<T>(r);
+    }
+    return true;
+}
+
+template <class T>
+typename std::enable_if<!ReadFromWords<T>::value, bool>::type
+parseWord(const BinaryIni::Ints &ints, uint64_t i, T &value)
+{
+    return false;
+}
+
+template <class T>
+bool
+findWords(CheckpointIn &cp, const string &section, const string &name,
+          BinaryIni::Ints &ints)
+{
+    return ReadFromWords<T>::value && cp.findInts(section, name, ints);
+}
+
 int Serializable::ckptMaxCount = 0;
 int Serializable::ckptCount = 0;
 int Serializable::ckptPrevCount = -1;
@@ -235,6 +288,13 @@ void
 paramIn(CheckpointIn &cp, const string &name, T &param)
 {
     const string &section(Serializable::currentSection());
+    BinaryIni::Ints ints;
+    if (findWords<T>(cp, section, name, ints)) {
+        if (!parseWord(ints, 0, param))
+            fatal("Can't unserialize '%s:%s'\n", section, name);
+        return;
+    }
+
     string str;
     if (!cp.find(section, name, str) || !parseParam(str, param)) {
         fatal("Can't unserialize '%s:%s'\n", section, name);
@@ -246,6 +306,11 @@ bool
 optParamIn(CheckpointIn &cp, const string &name, T &param, bool warn)
 {
     const string &section(Serializable::currentSection());
+    BinaryIni::Ints ints;
+    if (findWords<T>(cp, section, name, ints) &&
+        parseWord(ints, 0, param))
+        return true;
+
     string str;
     if (!cp.find(section, name, str) || !parseParam(str, param)) {
         if (warn)
@@ -277,6 +342,18 @@ void
 arrayParamIn(CheckpointIn &cp, const string &name, T *param, unsigned size)
 {
     const string &section(Serializable::currentSection());
+    BinaryIni::Ints ints;
+    if (findWords<T>(cp, section, name, ints)) {
+        if (ints.size() != size)
+            fatal("Array size mismatch on %s:%s'\n", section, name);
+        for (unsigned i = 0; i < size; i++) {
+            if (!parseWord(ints, i, param[i]))
+                fatal("could not parse element %d of %s:%s\n", i,
+                      section, name);
+        }
+        return;
+    }
+
     string str;
     if (!cp.find(section, name, str)) {
         fatal("Can't unserialize '%s:%s'\n", section, name);
@@ -321,6 +398,19 @@ void
 arrayParamIn(CheckpointIn &cp, const string &name, vector<T> &param)
 {
     const string &section(Serializable::currentSection());
+    BinaryIni::Ints ints;
+    if (findWords<T>(cp, section, name, ints)) {
+        param.resize(ints.size());
+        for (uint64_t i = 0; i < ints.size(); i++) {
+            T scalar_value;
+            if (!parseWord(ints, i, scalar_value))
+                fatal("could not parse element %d of %s:%s\n", i,
+                      section, name);
+            param[i] = scalar_value;
+        }
+        return;
+    }
+
     string str;
     if (!cp.find(section, name, str)) {
         fatal("Can't unserialize '%s:%s'\n", section, name);
@@ -363,6 +453,19 @@ void
 arrayParamIn(CheckpointIn &cp, const string &name, list<T> &param)
 {
     const string &section(Serializable::currentSection());
+    BinaryIni::Ints ints;
+    if (findWords<T>(cp, section, name, ints)) {
+        param.clear();
+        for (uint64_t i = 0; i < ints.size(); i++) {
+            T scalar_value;
+            if (!parseWord(ints, i, scalar_value))
+                fatal("could not parse element %d of %s:%s\n", i,
+                      section, name);
+            param.push_back(scalar_value);
+        }
+        return;
+    }
+
     string str;
     if (!cp.find(section, name, str)) {
         fatal("Can't unserialize '%s:%s'\n", section, name);
@@ -592,7 +695,7 @@ Serializable::unserializeSection(CheckpointIn &cp, const char *name)
 }
 
 void
-Serializable::serializeAll(const string &cpt_dir)
+Serializable::serializeAll(const string &cpt_dir, bool binary)
 {
     string dir = CheckpointIn::setDir(cpt_dir);
     if (mkdir(dir.c_str(), 0775) == -1 && errno != EEXIST)
@@ -608,6 +711,21 @@ Serializable::serializeAll(const string &cpt_dir)
     globals.serializeSection(outstream, "Globals");
 
     SimObject::serializeAll(outstream);
+    outstream.close();
+
+    // The binary form is derived from the ini file rather than
+    // written directly, so that both always hold the same state
+    if (binary) {
+        IniFile ini;
+        if (!ini.load(cpt_file))
+            fatal("Can't load checkpoint file '%s'\n", cpt_file);
+
+        BinaryIniWriter writer;
+        writer.add(ini);
+        string bin_file = dir + CheckpointIn::binaryFilename;
+        if (!writer.write(bin_file))
+            fatal("Unable to write binary checkpoint file %s\n", bin_file);
+    }
 }
 
 void
@@ -660,6 +778,7 @@ Serializable::currentSection()
 }
 
 const char *CheckpointIn::baseFilename = "m5.cpt";
+const char *CheckpointIn::binaryFilename = "m5.cpt.bin";
 
 string CheckpointIn::currentDirectory;
 
@@ -682,32 +801,112 @@ CheckpointIn::dir()
 }
 
 
+IniFile *CheckpointIn::preloadedDb = nullptr;
+BinaryIni *CheckpointIn::preloadedBinDb = nullptr;
+string CheckpointIn::preloadedDir;
+
 CheckpointIn::CheckpointIn(const string &cpt_dir, SimObjectResolver &resolver)
-    : db(new IniFile), objNameResolver(resolver), cptDir(setDir(cpt_dir))
+    : db(nullptr), binDb(nullptr), ownsDb(false), objNameResolver(resolver),
+      cptDir(setDir(cpt_dir))
 {
-    string filename = cptDir + "/" + CheckpointIn::baseFilename;
-    if (!db->load(filename)) {
-        fatal("Can't load checkpoint file '%s'\n", filename);
+    if ((preloadedDb || preloadedBinDb) && preloadedDir == cptDir) {
+        db = preloadedDb;
+        binDb = preloadedBinDb;
+        return;
     }
+
+    loadDb(cptDir, db, binDb);
+    ownsDb = true;
 }
 
 CheckpointIn::~CheckpointIn()
 {
-    delete db;
+    if (ownsDb) {
+        delete db;
+        delete binDb;
+    }
+}
+
+void
+CheckpointIn::loadDb(const string &cpt_dir, IniFile *&ini_db,
+                     BinaryIni *&bin_db)
+{
+    string filename = cpt_dir + "/" + CheckpointIn::baseFilename;
+    string bin_filename = cpt_dir + "/" + CheckpointIn::binaryFilename;
+
+    // A binary checkpoint older than the ini file, as left behind by
+    // editing or upgrading the ini file, is stale
+    struct stat ini_stat, bin_stat;
+    bool has_ini = stat(filename.c_str(), &ini_stat) == 0;
+    bool has_bin = stat(bin_filename.c_str(), &bin_stat) == 0;
+    if (has_bin && (!has_ini || bin_stat.st_mtime >= ini_stat.st_mtime)) {
+        bin_db = new BinaryIni;
+        if (bin_db->load(bin_filename)) {
+            DPRINTF(Checkpoint, "Using binary checkpoint file %s\n",
+                    bin_filename);
+            return;
+        }
+        delete bin_db;
+        bin_db = nullptr;
+        warn("Can't load binary checkpoint file '%s', using '%s'\n",
+             bin_filename, filename);
+    } else if (has_bin) {
+        warn("Ignoring binary checkpoint file '%s', which is older "
+             "than '%s'\n", bin_filename, filename);
+    }
+
+    ini_db = new IniFile;
+    if (!ini_db->load(filename)) {
+        fatal("Can't load checkpoint file '%s'\n", filename);
+    }
+}
+
+void
+CheckpointIn::preload(const string &cpt_dir)
+{
+    const string dir = setDir(cpt_dir);
+    IniFile *ini_db = nullptr;
+    BinaryIni *bin_db = nullptr;
+    loadDb(dir, ini_db, bin_db);
+
+    delete preloadedDb;
+    delete preloadedBinDb;
+    preloadedDb = ini_db;
+    preloadedBinDb = bin_db;
+    preloadedDir = dir;
+}
+
+void
+CheckpointIn::getSectionNames(vector<string> &list)
+{
+    if (binDb)
+        binDb->getSectionNames(list);
+    else
+        db->getSectionNames(list);
 }
 
 bool
 CheckpointIn::entryExists(const string &section, const string &entry)
 {
+    if (binDb)
+        return binDb->entryExists(section, entry);
     return db->entryExists(section, entry);
 }
 
 bool
 CheckpointIn::find(const string &section, const string &entry, string &value)
 {
+    if (binDb)
+        return binDb->find(section, entry, value);
     return db->find(section, entry, value);
 }
 
+bool
+CheckpointIn::findInts(const string &section, const string &entry,
+                       BinaryIni::Ints &ints)
+{
+    return binDb && binDb->findInts(section, entry, ints);
+}
 
 bool
 CheckpointIn::findObj(const string &section, const string &entry,
@@ -715,7 +914,7 @@ CheckpointIn::findObj(const string &section, const string &entry,
 {
     string path;
 
-    if (!db->find(section, entry, path))
+    if (!find(section, entry, path))
         return false;
 
     value = objNameResolver.resolveSimObject(path);
@@ -726,5 +925,7 @@ CheckpointIn::findObj(const string &section, const string &entry,
 bool
 CheckpointIn::sectionExists(const string &section)
 {
+    if (binDb)
+        return binDb->sectionExists(section);
     return db->sectionExists(section);
 }
@@ -58,6 +58,7 @@
 #include <set>
 #include <vector>
 
+#include "base/binary_ini.hh"
 #include "base/bitunion.hh"
 
 class CheckpointIn;
@@ -335,7 +336,8 @@ class Serializable
     static int ckptCount;
     static int ckptMaxCount;
     static int ckptPrevCount;
-    static void serializeAll(const std::string &cpt_dir);
+    static void serializeAll(const std::string &cpt_dir,
+                             bool binary = false);
     static void unserializeGlobals(CheckpointIn &cp);
 
   private:
@@ -349,10 +351,25 @@ class CheckpointIn
 {
   private:
 
+    // Exactly one of db and binDb is used, depending on the format
+    // of the checkpoint
     IniFile *db;
+    BinaryIni *binDb;
+    // False if the database is the shared preloaded one
+    bool ownsDb;
 
     SimObjectResolver &objNameResolver;
 
+    // Database parsed ahead of time by preload(), and its directory
+    static IniFile *preloadedDb;
+    static BinaryIni *preloadedBinDb;
+    static std::string preloadedDir;
+
+    // Open the binary checkpoint file of cpt_dir if there is an up to
+    // date one, or parse its ini file
+    static void loadDb(const std::string &cpt_dir, IniFile *&ini_db,
+                       BinaryIni *&bin_db);
+
   public:
     CheckpointIn(const std::string &cpt_dir, SimObjectResolver &resolver);
     ~CheckpointIn();
@@ -365,9 +382,22 @@ class CheckpointIn
     bool findObj(const std::string &section, const std::string &entry,
                  SimObject *&value);
 
+    // Find an entry stored as a list of integers, which only binary
+    // checkpoints do. Returns false if the value has to be parsed
+    // from the text returned by find() instead.
+    bool findInts(const std::string &section, const std::string &entry,
+                  BinaryIni::Ints &ints);
+
 
     bool entryExists(const std::string &section, const std::string &entry);
     bool sectionExists(const std::string &section);
+    void getSectionNames(std::vector<std::string> &list);
+
+    // Parse the checkpoint in cpt_dir once and keep it, so that later
+    // CheckpointIn objects for the same directory share it instead of
+    // parsing it again. Used by design sweep servers, which fork a
+    // child per design point after preloading.
+    static void preload(const std::string &cpt_dir);
 
     // The following static functions have to do with checkpoint
     // creation rather than restoration.  This class makes a handy
@@ -394,6 +424,10 @@ class CheckpointIn
 
     // Filename for base checkpoint file within directory.
     static const char *baseFilename;
+
+    // Filename for the binary form of the base checkpoint file, which
+    // is used instead of it unless it is older.
+    static const char *binaryFilename;
 };
 
 #endif // __SERIALIZE_HH__
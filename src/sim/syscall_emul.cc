@@ -98,6 +98,7 @@ exitImpl(SyscallDesc *desc, int callnum, Process *p, ThreadContext *tc,
     int status = p->getSyscallArg(tc, index);
 
     System *sys = tc->getSystemPtr();
+    std::lock_guard<std::mutex> guard(sys->processLock);
 
     int activeContexts = 0;
     for (auto &system: sys->systemList)
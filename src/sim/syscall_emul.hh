@@ -1311,6 +1311,8 @@ cloneFunc(SyscallDesc *desc, int callnum, Process *p, ThreadContext *tc)
         ((flags & OS::TGT_CLONE_VM)     && !(newStack)))
         return -EINVAL;
 
+    std::lock_guard<std::mutex> guard(p->system->processLock);
+
     ThreadContext *ctc;
     if (!(ctc = p->findFreeContext()))
         fatal("clone: no spare thread context in system");
@@ -1962,6 +1964,7 @@ execveFunc(SyscallDesc *desc, int callnum, Process *p, ThreadContext *tc)
      * the process object in the simulator, we create a new process object
      * and bind to the previous process' thread below (hijacking the thread).
      */
+    std::lock_guard<std::mutex> guard(p->system->processLock);
     p->system->PIDs.erase(p->pid());
     Process *new_p = pp->create();
     delete pp;
@@ -47,6 +47,8 @@
 
 #include "sim/system.hh"
 
+#include <algorithm>
+
 #include "arch/remote_gdb.hh"
 #include "arch/utility.hh"
 #include "base/loader/object_file.hh"
@@ -89,6 +91,11 @@ System::System(Params *p)
     : MemObject(p), _systemPort("system_port", this),
       _numContexts(0),
       multiThread(p->multi_thread),
+      ppAccelInvoke(nullptr),
+      accelPollPeriod(p->accel_poll_period),
+      accelWaitSince(0),
+      accelWaitTicks(0),
+      accelPollEvent([this]{ pollAccelerators(); }, name() + ".accelPoll"),
       pagePtr(0),
       init_param(p->init_param),
       physProxy(_systemPort, p->cache_line_size),
@@ -101,7 +108,9 @@ System::System(Params *p)
 #else
       kvmVM(nullptr),
 #endif
-      physmem(name() + ".physmem", p->memories, p->mmap_using_noreserve),
+      physmem(name() + ".physmem", p->memories, p->mmap_using_noreserve,
+              p->memory_checkpoint_format, p->memory_checkpoint_threads,
+              p->memory_checkpoint_mmap),
       memoryMode(p->mem_mode),
       _cacheLineSize(p->cache_line_size),
       workItemsBegin(0),
@@ -370,6 +379,8 @@ System::validKvmEnvironment() const
 Addr
 System::allocPhysPages(int npages)
 {
+    std::lock_guard<std::mutex> guard(pagePtrLock);
+
     Addr return_addr = pagePtr << PageShift;
     pagePtr += npages;
 
@@ -452,6 +463,46 @@ System::regStats()
     }
 }
 
+void
+System::regProbePoints()
+{
+    MemObject::regProbePoints();
+
+    ppAccelInvoke = new ProbePointArg<int>(getProbeManager(), "AccelInvoke");
+}
+
+void
+System::trackAccelerator(Addr finish_flag)
+{
+    if (!accelPollPeriod)
+        return;
+
+    if (runningFinishFlags.empty())
+        accelWaitSince = curTick();
+    runningFinishFlags.push_back(finish_flag);
+    if (!accelPollEvent.scheduled())
+        schedule(accelPollEvent, curTick() + accelPollPeriod);
+}
+
+void
+System::pollAccelerators()
+{
+    // The host clears the flag before invoking the accelerator, and
+    // the datapath sets it when done
+    auto finished = [this](Addr flag) {
+        return physProxy.read<uint32_t>(flag) != 0;
+    };
+    runningFinishFlags.erase(
+        std::remove_if(runningFinishFlags.begin(), runningFinishFlags.end(),
+                       finished),
+        runningFinishFlags.end());
+
+    if (runningFinishFlags.empty())
+        accelWaitTicks += curTick() - accelWaitSince;
+    else
+        schedule(accelPollEvent, curTick() + accelPollPeriod);
+}
+
 void
 System::workItemEnd(uint32_t tid, uint32_t workid)
 {
@@ -47,6 +47,7 @@
 #ifndef __SYSTEM_HH__
 #define __SYSTEM_HH__
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -63,6 +64,7 @@
 #include "mem/port_proxy.hh"
 #include "params/System.hh"
 #include "sim/futex_map.hh"
+#include "sim/probe/probe.hh"
 #include "sim/se_signal.hh"
 
 #include "aladdin/gem5/Gem5Datapath.h"
@@ -307,8 +309,47 @@ class System : public MemObject
         setAcceleratorFinishFlag(accel_id, finish_flag);
         setAcceleratorIds(accel_id, context_id, thread_id);
         scheduleAccelerator(accel_id, 1);
+        ppAccelInvoke->notify(accel_id);
+        trackAccelerator(finish_flag);
     }
 
+    /* Notified with the accelerator id each time the host invokes one, so
+     * that samplers can tell the accelerator phases of a workload apart.
+     */
+    ProbePointArg<int> *ppAccelInvoke;
+
+    /* Returns the number of ticks during which at least one accelerator
+     * invocation was running, i.e., during which the host was waiting
+     * for an accelerator. Only counted when accel_poll_period is set.
+     */
+    Tick acceleratorWaitTicks() const
+    {
+        return accelWaitTicks +
+            (runningFinishFlags.empty() ? 0 : curTick() - accelWaitSince);
+    }
+
+  protected:
+    /* How often the finish flags of running invocations are checked */
+    const Tick accelPollPeriod;
+    /* Finish flags of the invocations in progress */
+    std::vector<Addr> runningFinishFlags;
+    /* Start of the current stretch of accelerator activity */
+    Tick accelWaitSince;
+    /* Ticks of accelerator activity before the current stretch */
+    Tick accelWaitTicks;
+    EventFunctionWrapper accelPollEvent;
+
+    /* Starts checking the finish flag of a new invocation. */
+    void trackAccelerator(Addr finish_flag);
+
+    /* Ends the invocations whose datapath has set the finish flag. The
+     * datapaths write the flag through their own ports, outside this
+     * tree, so it is read back rather than reported to the system.
+     */
+    void pollAccelerators();
+
+  public:
+
     /* Add an address tranlation into the datapath TLB for the specified array. */
     void insertAddressTranslationMapping(int id, Addr sim_vaddr, Addr sim_paddr) {
         if (accelerators.find(id) == accelerators.end())
@@ -343,6 +384,9 @@ class System : public MemObject
 
     Addr pagePtr;
 
+    /** Cores on different event queues may allocate pages at once. */
+    std::mutex pagePtrLock;
+
     uint64_t init_param;
 
     /** Port to physical memory used for writing object files into ram at
@@ -479,6 +523,7 @@ class System : public MemObject
     }
 
     void regStats() override;
+    void regProbePoints() override;
     /**
      * Called by pseudo_inst to track the number of work items started by this
      * system.
@@ -690,6 +735,13 @@ class System : public MemObject
     /** Process set to track which PIDs have already been allocated */
     std::set<int> PIDs;
 
+    /**
+     * Serialises the syscalls that create and destroy processes and
+     * threads, which look at the PIDs, the signals and the contexts of
+     * all cores, and may run on different event queues at once.
+     */
+    std::mutex processLock;
+
     // By convention, all signals are owned by the receiving process. The
     // receiver will delete the signal upon reception.
     std::list<BasicSignal> signalList;
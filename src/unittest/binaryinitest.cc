@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "base/binary_ini.hh"
+#include "base/inifile.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+int
+main()
+{
+    char dir_template[] = "/tmp/binaryiniXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    EXPECT_TRUE(dir != nullptr);
+    if (!dir)
+        return UnitTest::printResults();
+    string ini_path = string(dir) + "/m5.cpt";
+    string bin_path = string(dir) + "/m5.cpt.bin";
+
+    {
+        ofstream os(ini_path.c_str());
+        os << "## checkpoint generated: test\n"
+              "\n[Globals]\ncurTick=123456789\n"
+              "version_tags=arm-ccregs smt-interrupts\n"
+              "\n[system.cpu0.xc.0]\n"
+              "regs.integer=0 1 18446744073709551615\n"
+              "regs.floating_point=-5 7 -9223372036854775808\n"
+              "_pcState=4198400\n_status=1\n"
+              "\n[system.cpu0.dtb.Entry0]\n"
+              "vaddr=4194304\nwritable=true\nlabel=0x10\n"
+              "\n[system.cpu0.empty]\n";
+    }
+
+    IniFile ini;
+    BinaryIni bin;
+    UnitTest::setCase("Conversion");
+    {
+        EXPECT_TRUE(ini.load(ini_path));
+        BinaryIniWriter writer;
+        writer.add(ini);
+        EXPECT_TRUE(writer.write(bin_path));
+        EXPECT_TRUE(bin.load(bin_path));
+        EXPECT_TRUE(BinaryIni::isBinaryIni(bin_path));
+        EXPECT_FALSE(BinaryIni::isBinaryIni(ini_path));
+        BinaryIni text;
+        EXPECT_FALSE(text.load(ini_path));
+    }
+
+    // Every value reads back as the same text, including the ones
+    // stored as integer lists
+    UnitTest::setCase("Text round trip");
+    {
+        vector<string> sections, bin_sections;
+        ini.getSectionNames(sections);
+        bin.getSectionNames(bin_sections);
+        EXPECT_EQ(sections.size(), bin_sections.size());
+        EXPECT_EQ(sections.size(), 4);
+        int mismatches = 0;
+        for (const auto &sec : sections) {
+            EXPECT_TRUE(bin.sectionExists(sec));
+            ini.visitSection(sec,
+                [&](const string &entry, const string &value) {
+                    string bin_value;
+                    if (!bin.find(sec, entry, bin_value) ||
+                        bin_value != value)
+                        mismatches++;
+                });
+        }
+        EXPECT_EQ(mismatches, 0);
+        EXPECT_TRUE(bin.sectionExists("system.cpu0.empty"));
+        EXPECT_FALSE(bin.sectionExists("system.cpu0.dtb.Entry1"));
+        EXPECT_FALSE(bin.entryExists("Globals", "curTock"));
+        EXPECT_TRUE(bin.entryExists("system.cpu0.dtb.Entry0", "writable"));
+    }
+
+    UnitTest::setCase("Integer lists");
+    {
+        BinaryIni::Ints ints;
+        EXPECT_TRUE(bin.findInts("system.cpu0.xc.0", "regs.integer", ints));
+        EXPECT_EQ(ints.size(), 3);
+        EXPECT_FALSE(ints.isSigned());
+        EXPECT_EQ(ints[2], UINT64_MAX);
+
+        EXPECT_TRUE(bin.findInts("system.cpu0.xc.0", "regs.floating_point",
+                                 ints));
+        EXPECT_TRUE(ints.isSigned());
+        EXPECT_EQ((int64_t)ints[0], -5);
+        EXPECT_EQ((int64_t)ints[2], INT64_MIN);
+
+        EXPECT_TRUE(bin.findInts("Globals", "curTick", ints));
+        EXPECT_EQ(ints.size(), 1);
+        EXPECT_EQ(ints[0], 123456789);
+
+        EXPECT_FALSE(bin.findInts("Globals", "version_tags", ints));
+        EXPECT_FALSE(bin.findInts("system.cpu0.dtb.Entry0", "label", ints));
+        EXPECT_FALSE(bin.findInts("Globals", "curTock", ints));
+    }
+
+    UnitTest::setCase("Parsing integer lists");
+    {
+        vector<uint64_t> words;
+        bool is_signed;
+        EXPECT_TRUE(BinaryIniWriter::parseInts("0 1 18446744073709551615",
+                                               words, is_signed));
+        EXPECT_FALSE(is_signed);
+        EXPECT_EQ(words.size(), 3);
+        EXPECT_TRUE(BinaryIniWriter::parseInts("-9223372036854775808 7",
+                                               words, is_signed));
+        EXPECT_TRUE(is_signed);
+        EXPECT_FALSE(BinaryIniWriter::parseInts("-1 9223372036854775808",
+                                                words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("18446744073709551616",
+                                                words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("0x10", words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("010", words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("-0", words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("1  2", words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("1 ", words, is_signed));
+        EXPECT_FALSE(BinaryIniWriter::parseInts("true", words, is_signed));
+    }
+
+    UnitTest::setCase("Replacing entries");
+    {
+        BinaryIniWriter writer;
+        writer.add("a", "x", "1");
+        writer.add("a", "x", "text");
+        writer.addSection("b");
+        EXPECT_TRUE(writer.write(bin_path));
+        BinaryIni replaced;
+        EXPECT_TRUE(replaced.load(bin_path));
+        string value;
+        EXPECT_TRUE(replaced.find("a", "x", value));
+        EXPECT_EQ(value, "text");
+        EXPECT_TRUE(replaced.sectionExists("b"));
+    }
+
+    unlink(ini_path.c_str());
+    unlink(bin_path.c_str());
+    rmdir(dir);
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include "arch/isa_traits.hh"
+#include "cpu/simple/block_cache.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+/** Stands in for a decoded instruction, only its flags matter */
+class FakeInst : public StaticInst
+{
+  public:
+    FakeInst(bool control)
+        : StaticInst("fake", ExtMachInst(), No_OpClass)
+    {
+        flags[IsControl] = control;
+    }
+
+    Fault
+    execute(ExecContext *xc, Trace::InstRecord *traceData) const override
+    {
+        return NoFault;
+    }
+
+    void advancePC(TheISA::PCState &pc) const override { pc.advance(); }
+
+    string
+    generateDisassembly(Addr pc, const SymbolTable *symtab) const override
+    {
+        return mnemonic;
+    }
+};
+
+static const Addr loopStart = 0x401000;
+static const Addr loopEnd = 0x401008;
+
+/**
+ * Run a loop of two instructions and a branch back, the way the atomic
+ * CPU drives the cache, and return the number of instructions decoded.
+ */
+static int
+runLoop(DecodedBlockCache &cache, int iterations)
+{
+    StaticInstPtr add = new FakeInst(false);
+    StaticInstPtr branch = new FakeInst(true);
+    int decoded = 0;
+    for (int i = 0; i < iterations; i++) {
+        for (Addr addr = loopStart; addr <= loopEnd; addr += 4) {
+            TheISA::PCState key(addr);
+            const DecodedBlockCache::Inst *inst = cache.lookup(key);
+            if (inst) {
+                EXPECT_TRUE(inst->key == key);
+                continue;
+            }
+            TheISA::PCState pc = key;
+            pc.npc(addr + 4);
+            pc.size(4);
+            cache.record(key, pc, addr == loopEnd ? branch : add);
+            decoded++;
+        }
+    }
+    return decoded;
+}
+
+int
+main()
+{
+    // Stats can't be registered twice, so the cases share one cache
+    DecodedBlockCache cache;
+
+    UnitTest::setCase("Loop");
+    EXPECT_EQ(runLoop(cache, 10), 3);
+    EXPECT_EQ(runLoop(cache, 10), 0);
+
+    // Writes to other pages keep the blocks
+    UnitTest::setCase("Data writes");
+    cache.invalidate(0x7fff0000, 8);
+    cache.invalidate(loopStart - TheISA::PageBytes, 8);
+    cache.invalidate(loopStart + TheISA::PageBytes, 8);
+    EXPECT_EQ(runLoop(cache, 1), 0);
+
+    // Writes to the code page, also partly, drop them
+    UnitTest::setCase("Code writes");
+    Addr page = loopStart & ~(TheISA::PageBytes - 1);
+    cache.invalidate(loopEnd, 4);
+    EXPECT_EQ(runLoop(cache, 2), 3);
+    cache.invalidate(page + TheISA::PageBytes - 4, 4);
+    EXPECT_EQ(runLoop(cache, 1), 3);
+    cache.invalidate(page - 4, 8);
+    EXPECT_EQ(runLoop(cache, 1), 3);
+
+    // As done after a syscall, in the middle of a block
+    UnitTest::setCase("Flush");
+    EXPECT_TRUE(cache.lookup(TheISA::PCState(loopStart)) != nullptr);
+    cache.flush();
+    EXPECT_TRUE(cache.lookup(TheISA::PCState(loopStart + 4)) == nullptr);
+    EXPECT_EQ(runLoop(cache, 2), 3);
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/ruby/filters/BlockBloomFilter.hh"
+#include "mem/ruby/filters/BloomHash.hh"
+#include "mem/ruby/filters/BulkBloomFilter.hh"
+#include "mem/ruby/filters/H3BloomFilter.hh"
+#include "mem/ruby/filters/LSB_CountingBloomFilter.hh"
+#include "mem/ruby/filters/MultiBitSelBloomFilter.hh"
+#include "mem/ruby/filters/MultiGrainBloomFilter.hh"
+#include "mem/ruby/filters/NonCountingBloomFilter.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static const int filterSize = 1 << 16;
+static const size_t numAddrs = 1 << 12;
+static const int numHashes = 4;
+
+static vector<Addr>
+makeAddrs(mt19937_64 &rng)
+{
+    vector<Addr> addrs(numAddrs);
+    for (auto &a : addrs)
+        a = rng() & ((Addr(1) << 40) - 1);
+    return addrs;
+}
+
+/**
+ * Check that a filter reports every address inserted into it, keeps
+ * its statistics, and that the bulk operations agree with the scalar
+ * ones.
+ */
+static void
+checkFilter(const char *name, AbstractBloomFilter &filter, bool counting,
+            const vector<Addr> &present, const vector<Addr> &absent)
+{
+    UnitTest::setCase(name);
+
+    for (Addr a : present) {
+        if (counting)
+            filter.increment(a);
+        else
+            filter.set(a);
+    }
+
+    size_t hits = 0;
+    for (Addr a : present)
+        hits += filter.isSet(a);
+    size_t false_pos = 0;
+    for (Addr a : absent)
+        false_pos += filter.isSet(a);
+
+    EXPECT_EQ(hits, present.size());
+    EXPECT_EQ(filter.getNumInserts(), present.size());
+    EXPECT_EQ(filter.getNumQueries(), present.size() + absent.size());
+    EXPECT_EQ(filter.getNumPositives(), hits + false_pos);
+
+    if (!counting) {
+        int total = filter.getTotalCount();
+        filter.clear();
+        EXPECT_EQ(filter.getTotalCount(), 0);
+        filter.setBulk(present.data(), present.size());
+        EXPECT_EQ(filter.getTotalCount(), total);
+    }
+
+    unique_ptr<bool[]> results(new bool[absent.size()]);
+    EXPECT_EQ(filter.isSetBulk(present.data(), present.size(),
+                               results.get()), hits);
+    bool same = true;
+    size_t bulk_false_pos =
+        filter.isSetBulk(absent.data(), absent.size(), results.get());
+    for (size_t i = 0; i < absent.size(); i++)
+        same &= results[i] == filter.isSet(absent[i]);
+    EXPECT_EQ(bulk_false_pos, false_pos);
+    EXPECT_TRUE(same);
+}
+
+int
+main()
+{
+    mt19937_64 rng(1234);
+    vector<Addr> present = makeAddrs(rng);
+    vector<Addr> absent = makeAddrs(rng);
+
+    UnitTest::setCase("BloomHash matches bit-serial hashing");
+    {
+        vector<vector<uint32_t>> masks(64, vector<uint32_t>(numHashes));
+        for (auto &row : masks)
+            for (auto &m : row)
+                m = rng() & 0x3fffffff;
+
+        BloomHash table;
+        table.init(numHashes, 64,
+                   [&masks](int bit, int hash) { return masks[bit][hash]; });
+
+        bool same = true;
+        uint32_t hashes[numHashes];
+        for (Addr a : present) {
+            table.hash(a, hashes);
+            for (int h = 0; h < numHashes; h++) {
+                uint32_t result = 0;
+                for (int i = 0; i < 64; i++)
+                    if ((a >> i) & 1)
+                        result ^= masks[i][h];
+                same &= result == hashes[h];
+            }
+        }
+        EXPECT_TRUE(same);
+    }
+
+    H3BloomFilter h3(filterSize, numHashes, false);
+    checkFilter("H3", h3, false, present, absent);
+
+    H3BloomFilter h3_par(filterSize, numHashes, true);
+    checkFilter("H3 parallel", h3_par, false, present, absent);
+
+    MultiBitSelBloomFilter bitsel(csprintf("%d_%d_0_Regular", filterSize,
+                                           numHashes));
+    checkFilter("MultiBitSel", bitsel, false, present, absent);
+
+    NonCountingBloomFilter noncounting(filterSize, 0);
+    checkFilter("NonCounting", noncounting, false, present, absent);
+
+    BlockBloomFilter block(filterSize);
+    checkFilter("Block", block, false, present, absent);
+
+    BulkBloomFilter bulk(filterSize);
+    checkFilter("Bulk", bulk, false, present, absent);
+
+    MultiGrainBloomFilter multigrain(filterSize, filterSize / 16);
+    checkFilter("MultiGrain", multigrain, false, present, absent);
+
+    LSB_CountingBloomFilter lsb(filterSize, 15);
+    checkFilter("LSB_Counting", lsb, true, present, absent);
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Times the table-driven BloomHash against the bit-by-bit evaluation
+ * the filters used before, then times scalar and bulk inserts and
+ * queries on every Ruby Bloom filter type and reports its false
+ * positive rate.
+ */
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/ruby/filters/BlockBloomFilter.hh"
+#include "mem/ruby/filters/BloomHash.hh"
+#include "mem/ruby/filters/BulkBloomFilter.hh"
+#include "mem/ruby/filters/H3BloomFilter.hh"
+#include "mem/ruby/filters/LSB_CountingBloomFilter.hh"
+#include "mem/ruby/filters/MultiBitSelBloomFilter.hh"
+#include "mem/ruby/filters/MultiGrainBloomFilter.hh"
+#include "mem/ruby/filters/NonCountingBloomFilter.hh"
+
+using namespace std;
+
+static const int filterSize = 1 << 22;
+static const size_t numAddrs = 1 << 19;
+static const int numHashes = 4;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+static vector<Addr>
+makeAddrs(mt19937_64 &rng)
+{
+    vector<Addr> addrs(numAddrs);
+    for (auto &a : addrs)
+        a = rng() & ((Addr(1) << 40) - 1);
+    return addrs;
+}
+
+/** Time BloomHash against the bit-serial loop it replaces. */
+static bool
+benchHash(mt19937_64 &rng, const vector<Addr> &addrs)
+{
+    vector<vector<uint32_t>> masks(64, vector<uint32_t>(numHashes));
+    for (auto &row : masks)
+        for (auto &m : row)
+            m = rng() & 0x3fffffff;
+
+    BloomHash table;
+    table.init(numHashes, 64,
+               [&masks](int bit, int hash) { return masks[bit][hash]; });
+
+    uint64_t ref_sum = 0, new_sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (Addr a : addrs) {
+        for (int h = 0; h < numHashes; h++) {
+            uint64_t val = a;
+            uint32_t result = 0;
+            for (int i = 0; i < 64; i++) {
+                if (val & 1)
+                    result ^= masks[i][h];
+                val >>= 1;
+            }
+            ref_sum += result;
+        }
+    }
+    double ref_secs = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    uint32_t hashes[numHashes];
+    for (Addr a : addrs) {
+        table.hash(a, hashes);
+        for (int h = 0; h < numHashes; h++)
+            new_sum += hashes[h];
+    }
+    double new_secs = secondsSince(start);
+
+    cprintf("%-24s %6.1f ns/addr bit-serial, %6.1f ns/addr table "
+            "(%.1fx)\n", "hash x4", ref_secs * 1e9 / numAddrs,
+            new_secs * 1e9 / numAddrs, ref_secs / new_secs);
+    return ref_sum == new_sum;
+}
+
+static void
+benchFilter(const char *name, AbstractBloomFilter &filter, bool counting,
+            const vector<Addr> &present, const vector<Addr> &absent)
+{
+    auto start = chrono::steady_clock::now();
+    for (Addr a : present) {
+        if (counting)
+            filter.increment(a);
+        else
+            filter.set(a);
+    }
+    double insert_secs = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    size_t hits = 0;
+    for (Addr a : present)
+        hits += filter.isSet(a);
+    size_t false_pos = 0;
+    for (Addr a : absent)
+        false_pos += filter.isSet(a);
+    double query_secs = secondsSince(start);
+
+    double bulk_insert_secs = 0;
+    if (!counting) {
+        filter.clear();
+        start = chrono::steady_clock::now();
+        filter.setBulk(present.data(), present.size());
+        bulk_insert_secs = secondsSince(start);
+    }
+
+    unique_ptr<bool[]> results(new bool[absent.size()]);
+    start = chrono::steady_clock::now();
+    size_t bulk_hits =
+        filter.isSetBulk(present.data(), present.size(), results.get());
+    size_t bulk_false_pos =
+        filter.isSetBulk(absent.data(), absent.size(), results.get());
+    double bulk_query_secs = secondsSince(start);
+    if (bulk_hits != hits || bulk_false_pos != false_pos)
+        cprintf("%s: bulk and scalar queries disagree\n", name);
+
+    size_t ops = present.size() + absent.size();
+    cprintf("%-24s insert %6.1f/%6.1f ns, query %6.1f/%6.1f ns "
+            "(scalar/bulk), fp rate %.4f\n", name,
+            insert_secs * 1e9 / present.size(),
+            bulk_insert_secs * 1e9 / present.size(),
+            query_secs * 1e9 / ops, bulk_query_secs * 1e9 / ops,
+            double(false_pos) / absent.size());
+}
+
+int
+main()
+{
+    mt19937_64 rng(1234);
+    vector<Addr> present = makeAddrs(rng);
+    vector<Addr> absent = makeAddrs(rng);
+
+    if (!benchHash(rng, present)) {
+        cprintf("BloomHash and bit-serial hashing disagree\n");
+        return 1;
+    }
+
+    H3BloomFilter h3(filterSize, numHashes, false);
+    benchFilter("H3", h3, false, present, absent);
+
+    H3BloomFilter h3_par(filterSize, numHashes, true);
+    benchFilter("H3 parallel", h3_par, false, present, absent);
+
+    MultiBitSelBloomFilter bitsel(csprintf("%d_%d_0_Regular", filterSize,
+                                           numHashes));
+    benchFilter("MultiBitSel", bitsel, false, present, absent);
+
+    NonCountingBloomFilter noncounting(filterSize, 0);
+    benchFilter("NonCounting", noncounting, false, present, absent);
+
+    BlockBloomFilter block(filterSize);
+    benchFilter("Block", block, false, present, absent);
+
+    BulkBloomFilter bulk(filterSize);
+    benchFilter("Bulk", bulk, false, present, absent);
+
+    MultiGrainBloomFilter multigrain(filterSize, filterSize / 16);
+    benchFilter("MultiGrain", multigrain, false, present, absent);
+
+    LSB_CountingBloomFilter lsb(filterSize, 15);
+    benchFilter("LSB_Counting", lsb, true, present, absent);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <random>
+#include <unordered_map>
+
+#include "mem/ruby/structures/CacheTagArray.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static const int numSets = 64;
+static const int assoc = 8;
+static const int blockBits = 6;
+
+int
+main()
+{
+    UnitTest::setCase("Empty array");
+    {
+        CacheTagArray tags;
+        tags.init(numSets, assoc);
+        EXPECT_EQ(tags.find(0, 0), -1);
+        EXPECT_EQ(tags.find(numSets - 1, Addr(1) << blockBits), -1);
+        EXPECT_EQ(tags.get(3, 5), CacheTagArray::invalidTag);
+    }
+
+    UnitTest::setCase("Set, find and clear");
+    {
+        CacheTagArray tags;
+        tags.init(numSets, assoc);
+        Addr a = Addr(5) << blockBits;
+        Addr b = Addr(5 + numSets) << blockBits;
+        tags.set(5, 0, a);
+        tags.set(5, 7, b);
+        EXPECT_EQ(tags.find(5, a), 0);
+        EXPECT_EQ(tags.find(5, b), 7);
+        EXPECT_EQ(tags.get(5, 7), b);
+        // the same tag in another set is not found
+        EXPECT_EQ(tags.find(6, a), -1);
+
+        tags.clear(5, 0);
+        EXPECT_EQ(tags.find(5, a), -1);
+        EXPECT_EQ(tags.find(5, b), 7);
+
+        // a way can be refilled with another line
+        tags.set(5, 7, a);
+        EXPECT_EQ(tags.find(5, a), 7);
+        EXPECT_EQ(tags.find(5, b), -1);
+    }
+
+    UnitTest::setCase("CacheTagArray matches a hash map");
+    {
+        CacheTagArray tags;
+        tags.init(numSets, assoc);
+        unordered_map<Addr, int> ref;
+
+        // fill the lower half of the lines, and look up lines of which
+        // half hit
+        for (int i = 0; i < numSets * assoc; i++) {
+            Addr addr = Addr(i) << blockBits;
+            tags.set(i % numSets, i / numSets, addr);
+            ref[addr] = i / numSets;
+        }
+
+        mt19937 rng(1234);
+        uniform_int_distribution<Addr> line(0, 2 * numSets * assoc - 1);
+        bool same = true;
+        for (int i = 0; i < 100000; i++) {
+            Addr addr = line(rng) << blockBits;
+            int set = (addr >> blockBits) % numSets;
+            auto it = ref.find(addr);
+            int way = it == ref.end() ? -1 : it->second;
+            same &= tags.find(set, addr) == way;
+        }
+        EXPECT_TRUE(same);
+    }
+
+    return UnitTest::printResults();
+}
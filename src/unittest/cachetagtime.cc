@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures the host time of a Ruby CacheMemory tag lookup, comparing
+ * the CacheTagArray used by CacheMemory with the hash map plus
+ * vector-of-sets layout it replaced.
+ */
+
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/ruby/structures/CacheTagArray.hh"
+
+using namespace std;
+
+static const int numSets = 1024;
+static const int assoc = 8;
+static const int blockBits = 6;
+static const int lookups = 20000000;
+
+struct Entry
+{
+    Addr addr;
+    int permission;
+};
+
+int
+main()
+{
+    mt19937 rng(1234);
+    // Half of the lookups hit, as for a busy L1
+    uniform_int_distribution<Addr> line(0, 2 * numSets * assoc - 1);
+
+    vector<Addr> trace(lookups);
+    for (auto &addr : trace)
+        addr = line(rng) << blockBits;
+
+    // Fill both structures with the lines of the lower half
+    unordered_map<Addr, int> tag_index;
+    vector<vector<Entry *>> sets(numSets, vector<Entry *>(assoc, nullptr));
+    CacheTagArray tags;
+    vector<Entry *> entries(numSets * assoc, nullptr);
+    tags.init(numSets, assoc);
+
+    for (int i = 0; i < numSets * assoc; i++) {
+        Addr addr = Addr(i) << blockBits;
+        int set = i % numSets;
+        int way = i / numSets;
+        Entry *entry = new Entry{addr, 1};
+        tag_index[addr] = way;
+        sets[set][way] = entry;
+        tags.set(set, way, addr);
+        entries[set * assoc + way] = entry;
+    }
+
+    uint64_t ref_hits = 0;
+    auto start = chrono::steady_clock::now();
+    for (Addr addr : trace) {
+        int set = (addr >> blockBits) % numSets;
+        auto it = tag_index.find(addr);
+        if (it != tag_index.end() && sets[set][it->second]->permission)
+            ref_hits++;
+    }
+    double ref_ns = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / lookups;
+
+    uint64_t new_hits = 0;
+    start = chrono::steady_clock::now();
+    for (Addr addr : trace) {
+        int set = (addr >> blockBits) % numSets;
+        int way = tags.find(set, addr);
+        if (way != -1 && entries[set * assoc + way]->permission)
+            new_hits++;
+    }
+    double new_ns = chrono::duration<double, nano>(
+        chrono::steady_clock::now() - start).count() / lookups;
+
+    cprintf("%d sets x %d ways, %d lookups\n", numSets, assoc, lookups);
+    cprintf("hash map:      %.2f ns/lookup\n", ref_ns);
+    cprintf("CacheTagArray: %.2f ns/lookup\n", new_ns);
+
+    for (auto entry : entries)
+        delete entry;
+
+    if (ref_hits != new_hits) {
+        cprintf("CacheTagArray and the hash map disagree\n");
+        return 1;
+    }
+
+    return 0;
+}
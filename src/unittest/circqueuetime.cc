@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Runs CircularQueue and std::list on the access pattern of the O3 ROB
+ * and instruction queue: instructions are pushed at the back, retired
+ * from the front and squashed from the back. Prints the host time of
+ * both. The number of instructions in millions can be given as the
+ * first argument.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <random>
+
+#include "base/circular_queue.hh"
+#include "base/cprintf.hh"
+
+using namespace std;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+/** Stands in for a reference counted DynInstPtr. */
+typedef shared_ptr<uint64_t> InstPtr;
+
+/**
+ * Run the pipeline on a queue and return a checksum of the sequence
+ * numbers that were retired.
+ */
+template <class Queue>
+static uint64_t
+run(Queue &queue, uint64_t insts, size_t capacity)
+{
+    mt19937_64 rng(1234);
+    uint64_t seq = 0;
+    uint64_t sum = 0;
+
+    while (seq < insts) {
+        // Dispatch
+        for (int i = 0; i < 8 && queue.size() < capacity; i++)
+            queue.push_back(make_shared<uint64_t>(++seq));
+
+        // Commit
+        for (int i = 0; i < 8 && !queue.empty() && rng() % 4; i++) {
+            sum = sum * 31 + *queue.front();
+            queue.pop_front();
+        }
+
+        // Squash on a mispredict
+        if (!queue.empty() && rng() % 64 == 0) {
+            uint64_t squash = *queue.front() + rng() % queue.size();
+            while (!queue.empty() && *queue.back() > squash)
+                queue.pop_back();
+        }
+    }
+    return sum;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t insts = (argc > 1 ? atoi(argv[1]) : 20) * 1000000ULL;
+    const size_t capacity = 192;
+
+    list<InstPtr> l;
+    auto start = chrono::steady_clock::now();
+    uint64_t list_sum = run(l, insts, capacity);
+    double list_secs = secondsSince(start);
+
+    CircularQueue<InstPtr> q(capacity);
+    start = chrono::steady_clock::now();
+    uint64_t queue_sum = run(q, insts, capacity);
+    double queue_secs = secondsSince(start);
+
+    if (list_sum != queue_sum) {
+        cprintf("CircularQueue retired different instructions\n");
+        return 1;
+    }
+
+    cprintf("%d M instructions: std::list %.3fs, CircularQueue %.3fs "
+            "(%.2fx)\n", insts / 1000000, list_secs, queue_secs,
+            list_secs / queue_secs);
+
+    return 0;
+}
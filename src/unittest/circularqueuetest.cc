@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <list>
+#include <memory>
+#include <random>
+
+#include "base/circular_queue.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+/** Stands in for a reference counted DynInstPtr. */
+typedef shared_ptr<uint64_t> InstPtr;
+
+/**
+ * Run the O3 ROB access pattern on a queue: instructions are pushed
+ * at the back, retired from the front and squashed from the back.
+ * Returns a checksum of the sequence numbers that were retired.
+ */
+template <class Queue>
+static uint64_t
+run(Queue &queue, uint64_t insts, size_t capacity)
+{
+    mt19937_64 rng(1234);
+    uint64_t seq = 0;
+    uint64_t sum = 0;
+
+    while (seq < insts) {
+        // Dispatch
+        for (int i = 0; i < 8 && queue.size() < capacity; i++)
+            queue.push_back(make_shared<uint64_t>(++seq));
+
+        // Commit
+        for (int i = 0; i < 8 && !queue.empty() && rng() % 4; i++) {
+            sum = sum * 31 + *queue.front();
+            queue.pop_front();
+        }
+
+        // Squash on a mispredict
+        if (!queue.empty() && rng() % 64 == 0) {
+            uint64_t squash = *queue.front() + rng() % queue.size();
+            while (!queue.empty() && *queue.back() > squash)
+                queue.pop_back();
+        }
+    }
+    return sum;
+}
+
+int
+main()
+{
+    const uint64_t insts = 200000;
+    const size_t capacity = 192;
+
+    UnitTest::setCase("Basic operations");
+    {
+        CircularQueue<int> q(4);
+        EXPECT_TRUE(q.empty());
+        EXPECT_EQ(q.capacity(), 4);
+        for (int i = 0; i < 4; i++)
+            q.push_back(i);
+        auto it = ++q.begin();
+        EXPECT_EQ(*it, 1);
+
+        // Iterators stay on their element
+        q.pop_front();
+        q.push_back(4);
+        EXPECT_EQ(*it, 1);
+        EXPECT_EQ(q.front(), 1);
+        EXPECT_EQ(q.back(), 4);
+        EXPECT_EQ(q[2], 3);
+
+        // Growing keeps the order and the iterators
+        q.push_back(5);
+        EXPECT_EQ(q.capacity(), 8);
+        EXPECT_EQ(q.size(), 5);
+        EXPECT_EQ(*it, 1);
+        int expect = 1;
+        bool in_order = true;
+        for (auto i = q.begin(); i != q.end(); ++i)
+            in_order = in_order && *i == expect++;
+        EXPECT_TRUE(in_order);
+
+        q.truncate(++it);
+        EXPECT_EQ(q.size(), 1);
+        EXPECT_EQ(q.back(), 1);
+        EXPECT_TRUE(--q.end() == q.begin());
+        q.clear();
+        EXPECT_TRUE(q.empty());
+    }
+
+    UnitTest::setCase("Releases popped elements");
+    {
+        InstPtr inst = make_shared<uint64_t>(1);
+        CircularQueue<InstPtr> q(4);
+        q.push_back(inst);
+        q.push_back(inst);
+        EXPECT_EQ(inst.use_count(), 3);
+        q.pop_front();
+        q.pop_back();
+        EXPECT_EQ(inst.use_count(), 1);
+    }
+
+    UnitTest::setCase("Matches std::list");
+    {
+        list<InstPtr> l;
+        CircularQueue<InstPtr> q(capacity);
+        EXPECT_EQ(run(l, insts, capacity), run(q, insts, capacity));
+        EXPECT_EQ(q.capacity(), 256);
+    }
+
+    return UnitTest::printResults();
+}
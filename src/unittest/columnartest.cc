@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/output.hh"
+#include "base/statistics.hh"
+#include "base/stats/columnar.hh"
+#include "base/stats/info.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+/** The stats a typical accelerator registers */
+struct AccelStats
+{
+    Stats::Scalar cycles;
+    Stats::Vector loads;
+    Stats::Histogram latency;
+    Stats::StandardDeviation occupancy;
+    Stats::Vector2d fuUse;
+    Stats::VectorDistribution portLatency;
+    Stats::SparseHistogram strides;
+    Stats::Formula loadsPerCycle;
+
+    AccelStats(int id)
+    {
+        string name = csprintf("system.acc%d", id);
+
+        cycles.name(name + ".cycles").desc("Cycles run");
+        loads.init(8).name(name + ".loads").desc("Loads per array")
+            .subname(0, "input");
+        latency.init(16).name(name + ".latency").desc("Load latency");
+        occupancy.name(name + ".occupancy").desc("Scratchpad occupancy");
+        fuUse.init(4, 3).name(name + ".fuUse").desc("Functional unit use");
+        portLatency.init(2, 0, 63, 8).name(name + ".portLatency")
+            .desc("Latency per port");
+        strides.init(16).name(name + ".strides").desc("Load strides");
+        loadsPerCycle.name(name + ".loadsPerCycle").desc("Loads per cycle");
+        loadsPerCycle = loads / cycles;
+    }
+
+    void
+    run(mt19937 &rng)
+    {
+        cycles += 1000 + rng() % 1000;
+        for (int i = 0; i < 64; i++) {
+            loads[rng() % 8]++;
+            latency.sample(rng() % 200);
+            occupancy.sample(rng() % 64);
+            fuUse[rng() % 4][rng() % 3]++;
+            portLatency[rng() % 2].sample(rng() % 64);
+        }
+        strides.sample(rng() % 4 * 8);
+    }
+};
+
+/** Chunks of a columnar file, as the Python reader sees them */
+struct ColumnarFile
+{
+    bool headerOk = false;
+    bool chunksOk = true;
+    int schemas = 0;
+    int sparse = 0;
+    int deltas = 0;
+    uint64_t schemaValues = 0;
+    vector<string> names;
+    /** Offset and number of values of every stat in the schema */
+    vector<pair<uint64_t, uint32_t>> columns;
+    vector<vector<double>> rows;
+
+    ColumnarFile(const string &path)
+    {
+        ifstream is(path.c_str(), ios::binary);
+        string buf((istreambuf_iterator<char>(is)),
+                   istreambuf_iterator<char>());
+
+        const char *p = buf.data();
+        const char *end = p + buf.size();
+        uint32_t version, bom;
+        if (buf.size() < 16)
+            return;
+        memcpy(&version, p + 8, 4);
+        memcpy(&bom, p + 12, 4);
+        headerOk = memcmp(p, Stats::Columnar::magic, 8) == 0 &&
+            version == Stats::Columnar::version &&
+            bom == Stats::Columnar::byteOrderMark;
+        p += 16;
+
+        while (p < end) {
+            Stats::Columnar::ChunkHeader header;
+            memcpy(&header, p, sizeof(header));
+            p += sizeof(header);
+            if (header.size % 8 || p + header.size > end) {
+                chunksOk = false;
+                return;
+            }
+
+            if (header.type == Stats::Columnar::Schema) {
+                schemas++;
+                readSchema(p);
+            } else if (header.type == Stats::Columnar::Dump) {
+                uint64_t count;
+                uint32_t desc_len;
+                memcpy(&count, p + 8, 8);
+                memcpy(&desc_len, p + 16, 4);
+                const char *values = p + (20 + desc_len + 7) / 8 * 8;
+                rows.emplace_back(count);
+                memcpy(rows.back().data(), values, count * sizeof(double));
+                chunksOk &= values + count * sizeof(double) == p + header.size;
+            } else if (header.type == Stats::Columnar::Delta) {
+                deltas++;
+                readDelta(p, header.size);
+            } else if (header.type == Stats::Columnar::Sparse) {
+                sparse++;
+            } else {
+                chunksOk = false;
+            }
+            p += header.size;
+        }
+    }
+
+    string
+    readString(const char *&p)
+    {
+        uint32_t len;
+        memcpy(&len, p, 4);
+        string str(p + 4, len);
+        p += 4 + len;
+        return str;
+    }
+
+    void
+    readSchema(const char *p)
+    {
+        uint64_t stats;
+        memcpy(&stats, p, 8);
+        memcpy(&schemaValues, p + 8, 8);
+        p += 16;
+
+        names.clear();
+        columns.clear();
+        for (uint64_t s = 0; s < stats; s++) {
+            uint32_t count;
+            memcpy(&count, p + 8, 4);
+            p += 12;
+            columns.emplace_back(names.size(), count);
+            string name = readString(p);
+            readString(p);
+            for (uint32_t i = 0; i < count; i++) {
+                string element = readString(p);
+                names.push_back(element.empty() ? name :
+                                name + "::" + element);
+            }
+        }
+    }
+
+    /** Rebuild a dump from the one before and the stats that changed */
+    void
+    readDelta(const char *p, uint64_t size)
+    {
+        uint64_t num_stats, count;
+        uint32_t desc_len;
+        memcpy(&num_stats, p + 8, 8);
+        memcpy(&count, p + 16, 8);
+        memcpy(&desc_len, p + 24, 4);
+        const char *indices = p + (28 + desc_len + 7) / 8 * 8;
+        const char *values = indices + (num_stats * 4 + 7) / 8 * 8;
+        if (rows.empty() || values + count * sizeof(double) != p + size) {
+            chunksOk = false;
+            return;
+        }
+
+        rows.push_back(rows.back());
+        uint64_t used = 0;
+        for (uint64_t s = 0; s < num_stats; s++) {
+            uint32_t index;
+            memcpy(&index, indices + 4 * s, 4);
+            if (index >= columns.size() ||
+                used + columns[index].second > count) {
+                chunksOk = false;
+                return;
+            }
+            memcpy(&rows.back()[columns[index].first],
+                   values + used * sizeof(double),
+                   columns[index].second * sizeof(double));
+            used += columns[index].second;
+        }
+        chunksOk &= used == count;
+    }
+
+    /** Value of a column in the last dump, NaN if there's none */
+    double
+    last(const string &name) const
+    {
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name && !rows.empty() && i < rows.back().size())
+                return rows.back()[i];
+        }
+        return NAN;
+    }
+};
+
+static void
+dump(Stats::Output &output)
+{
+    output.begin("accelerator invocation");
+    for (auto *info : Stats::statsList())
+        info->visit(output);
+    output.end();
+}
+
+static const int numAccels = 4;
+static const int numDumps = 6;
+
+int
+main()
+{
+    char dir_template[] = "/tmp/columnarXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    EXPECT_TRUE(dir != nullptr);
+    if (!dir)
+        return UnitTest::printResults();
+    string col_path = string(dir) + "/stats.col";
+
+    vector<unique_ptr<AccelStats>> accels;
+    for (int i = 0; i < numAccels; i++)
+        accels.emplace_back(new AccelStats(i));
+    for (auto *info : Stats::statsList())
+        info->enable();
+    Stats::enable();
+
+    mt19937 rng(1234);
+    {
+        Stats::Columnar columnar(col_path);
+
+        for (int d = 0; d < numDumps; d++) {
+            for (auto &accel : accels)
+                accel->run(rng);
+            for (auto *info : Stats::statsList())
+                info->prepare();
+            dump(columnar);
+        }
+    }
+
+    UnitTest::setCase("Layout");
+    ColumnarFile file(col_path);
+    EXPECT_TRUE(file.headerOk);
+    EXPECT_TRUE(file.chunksOk);
+    EXPECT_EQ(file.schemas, 1);
+    EXPECT_EQ(file.sparse, numDumps);
+    EXPECT_EQ(file.rows.size(), numDumps);
+    EXPECT_EQ(file.names.size(), file.schemaValues);
+    EXPECT_EQ(file.rows.back().size(), file.schemaValues);
+
+    UnitTest::setCase("Values");
+    AccelStats &acc = *accels.back();
+    string name = csprintf("system.acc%d.", numAccels - 1);
+    EXPECT_EQ(file.last(name + "cycles"), acc.cycles.value());
+    EXPECT_EQ(file.last(name + "loads::input"), acc.loads[0].value());
+    EXPECT_EQ(file.last(name + "loads::7"), acc.loads[7].value());
+    EXPECT_EQ(file.last(name + "latency::samples"), numDumps * 64);
+    EXPECT_EQ(file.last(name + "occupancy::samples"), numDumps * 64);
+    EXPECT_EQ(file.last(name + "occupancy::bucket_size"), 0);
+    EXPECT_EQ(file.last(name + "fuUse::3::2"), acc.fuUse[3][2].value());
+    EXPECT_EQ(file.last(name + "portLatency::1::bucket_size"), 8);
+    EXPECT_EQ(file.last(name + "strides"), numDumps);
+    EXPECT_EQ(file.last(name + "loadsPerCycle::0"),
+              acc.loads[0].value() / acc.cycles.value());
+
+    // A later run appends to the file, starting with its own schema
+    UnitTest::setCase("Appending");
+    {
+        Stats::Columnar columnar(col_path);
+        dump(columnar);
+    }
+    ColumnarFile appended(col_path);
+    EXPECT_TRUE(appended.chunksOk);
+    EXPECT_EQ(appended.schemas, 2);
+    EXPECT_EQ(appended.rows.size(), numDumps + 1);
+
+    UnitTest::setCase("Dirty bits");
+    Stats::clearDirty();
+    EXPECT_FALSE(acc.cycles.dirty());
+    EXPECT_FALSE(acc.loads.dirty());
+    EXPECT_FALSE(acc.portLatency.dirty());
+    EXPECT_TRUE(acc.loadsPerCycle.dirty());
+    acc.loads[3]++;
+    acc.portLatency[1].sample(5);
+    EXPECT_FALSE(acc.cycles.dirty());
+    EXPECT_TRUE(acc.loads.dirty());
+    EXPECT_TRUE(acc.portLatency.dirty());
+    acc.cycles.reset();
+    EXPECT_TRUE(acc.cycles.dirty());
+
+    // Sweeps dump after every accelerator invocation, which only
+    // updates the stats of one accelerator
+    UnitTest::setCase("Deltas");
+    string full_path = string(dir) + "/full.col";
+    string delta_path = string(dir) + "/delta.col";
+    {
+        Stats::Columnar full(full_path);
+        Stats::Columnar deltas(delta_path, true);
+        EXPECT_FALSE(deltas.incremental());
+
+        for (int d = 0; d < numDumps; d++) {
+            accels[rng() % numAccels]->run(rng);
+            for (auto *info : Stats::statsList())
+                info->prepare();
+            dump(full);
+
+            if (deltas.incremental())
+                Stats::dumpDirty(deltas, "accelerator invocation");
+            else
+                dump(deltas);
+            Stats::clearDirty();
+        }
+        EXPECT_TRUE(deltas.incremental());
+    }
+
+    ColumnarFile full_file(full_path);
+    ColumnarFile delta_file(delta_path);
+    EXPECT_TRUE(delta_file.chunksOk);
+    EXPECT_EQ(delta_file.schemas, 1);
+    EXPECT_EQ(delta_file.deltas, numDumps - 1);
+    EXPECT_EQ(delta_file.sparse, numDumps);
+    EXPECT_EQ(delta_file.rows.size(), numDumps);
+    EXPECT_TRUE(delta_file.rows == full_file.rows);
+    EXPECT_TRUE(fileSize(delta_path) < fileSize(full_path));
+
+    // A forked child moves simout, and its dumps must go to a file of
+    // its own that starts with a header and a schema
+    UnitTest::setCase("Moving the output directory");
+    string parent_dir = string(dir) + "/parent";
+    string child_dir = string(dir) + "/child";
+    {
+        simout.setDirectory(parent_dir);
+        Stats::Output *output = Stats::initColumnar("stats.col", true);
+        for (auto *info : Stats::statsList())
+            info->prepare();
+        dump(*output);
+        dump(*output);
+        EXPECT_TRUE(output->incremental());
+
+        simout.setDirectory(child_dir);
+        EXPECT_FALSE(output->incremental());
+        dump(*output);
+        EXPECT_TRUE(output->incremental());
+    }
+    ColumnarFile parent_file(parent_dir + "/stats.col");
+    ColumnarFile child_file(child_dir + "/stats.col");
+    EXPECT_TRUE(parent_file.headerOk);
+    EXPECT_TRUE(parent_file.chunksOk);
+    EXPECT_EQ(parent_file.rows.size(), 2);
+    EXPECT_TRUE(child_file.headerOk);
+    EXPECT_TRUE(child_file.chunksOk);
+    EXPECT_EQ(child_file.schemas, 1);
+    EXPECT_EQ(child_file.rows.size(), 1);
+
+    unlink(col_path.c_str());
+    unlink(full_path.c_str());
+    unlink(delta_path.c_str());
+    unlink((parent_dir + "/stats.col").c_str());
+    unlink((child_dir + "/stats.col").c_str());
+    rmdir(parent_dir.c_str());
+    rmdir(child_dir.c_str());
+    rmdir(dir);
+
+    return UnitTest::printResults();
+}
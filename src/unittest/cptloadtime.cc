@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Loads a synthetic checkpoint the size of a many-core SE run, once
+ * from its ini file and once from the binary file converted from it,
+ * doing the lookups and conversions unserialization would, and prints
+ * the host time of each.
+ * The number of page table entries can be given as the first
+ * argument.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/binary_ini.hh"
+#include "base/cprintf.hh"
+#include "base/inifile.hh"
+#include "base/str.hh"
+
+using namespace std;
+
+static const int numCpus = 64;
+static const int numIntRegs = 48;
+static const int numFloatRegs = 96;
+static const int numMiscRegs = 600;
+static const int numTlbEntries = 64;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+static string
+cpuName(int cpu)
+{
+    return csprintf("system.cpu%d", cpu);
+}
+
+/** Write an m5.cpt the way paramOut() and arrayParamOut() would. */
+static void
+writeIni(const string &path, int num_ptes)
+{
+    mt19937_64 rng(1234);
+    ofstream os(path.c_str());
+
+    os << "## checkpoint generated: synthetic\n";
+    os << "\n[Globals]\ncurTick=123456789\nversion_tags=arm-ccregs "
+          "arm-contextidr-el2 smt-interrupts\n";
+
+    for (int c = 0; c < numCpus; c++) {
+        os << "\n[" << cpuName(c) << ".xc.0]\n";
+        os << "regs.integer=";
+        for (int i = 0; i < numIntRegs; i++)
+            os << (i ? " " : "") << (rng() >> (rng() % 64));
+        os << "\nregs.floating_point=";
+        for (int i = 0; i < numFloatRegs; i++)
+            os << (i ? " " : "") << (rng() % 1000);
+        os << "\nregs.misc=";
+        for (int i = 0; i < numMiscRegs; i++)
+            os << (i ? " " : "") << (i % 7 ? 0 : rng() >> 32);
+        os << "\n_pcState=4198400\n_status=1\nfuncExeInst=" << rng() % 1000000
+           << "\n";
+
+        for (int e = 0; e < numTlbEntries; e++) {
+            os << "\n[" << cpuName(c) << ".dtb.Entry" << e << "]\n";
+            os << "vaddr=" << (rng() & ~0xfffULL) << "\npaddr="
+               << (rng() & 0xfffff000ULL) << "\nlogBytes=12\nwritable=true"
+               << "\nuser=true\nuncacheable=false\nglobal=false"
+               << "\npatBit=0\nnoExec=false\nlruSeq=" << e << "\n";
+        }
+    }
+
+    os << "\n[system.cpu0.workload]\nptable.size=" << num_ptes << "\n";
+    for (int e = 0; e < num_ptes; e++) {
+        os << "\n[system.cpu0.workload.Entry" << e << "]\n";
+        os << "vaddr=" << (0x400000ULL + e * 4096ULL) << "\npaddr="
+           << (rng() & 0xfffff000ULL) << "\nflags=" << rng() % 8 << "\n";
+    }
+}
+
+/** Unserialized state, summed up so that the two loads can be compared */
+struct Restored
+{
+    uint64_t sum = 0;
+    uint64_t values = 0;
+
+    void add(uint64_t v) { sum = sum * 31 + v; values++; }
+};
+
+/**
+ * The lookups and conversions of paramIn() and arrayParamIn() on a
+ * database that only has text values.
+ */
+template <class DB>
+static bool
+textParam(const DB &db, const string &section, const string &name,
+          Restored &r)
+{
+    string str;
+    uint64_t v;
+    if (!db.find(section, name, str) || !to_number(str, v))
+        return false;
+    r.add(v);
+    return true;
+}
+
+template <class DB>
+static bool
+textArray(const DB &db, const string &section, const string &name,
+          Restored &r)
+{
+    string str;
+    if (!db.find(section, name, str))
+        return false;
+    vector<string> tokens;
+    tokenize(tokens, str, ' ');
+    for (const auto &token : tokens) {
+        uint64_t v;
+        if (!to_number(token, v))
+            return false;
+        r.add(v);
+    }
+    return true;
+}
+
+/** The same, using the integer lists of a binary database */
+static bool
+binaryParam(const BinaryIni &db, const string &section, const string &name,
+            Restored &r)
+{
+    BinaryIni::Ints ints;
+    if (!db.findInts(section, name, ints)) {
+        string str;
+        return db.find(section, name, str);
+    }
+    for (uint64_t i = 0; i < ints.size(); i++)
+        r.add(ints[i]);
+    return true;
+}
+
+template <class DB, class Param, class Array>
+static Restored
+restore(const DB &db, int num_ptes, Param param, Array array)
+{
+    Restored r;
+    bool ok = param(db, "Globals", "curTick", r);
+
+    for (int c = 0; c < numCpus; c++) {
+        string xc = cpuName(c) + ".xc.0";
+        ok &= array(db, xc, "regs.integer", r);
+        ok &= array(db, xc, "regs.floating_point", r);
+        ok &= array(db, xc, "regs.misc", r);
+        ok &= param(db, xc, "_pcState", r);
+        ok &= param(db, xc, "funcExeInst", r);
+        for (int e = 0; e < numTlbEntries; e++) {
+            string sec = csprintf("%s.dtb.Entry%d", cpuName(c), e);
+            ok &= param(db, sec, "vaddr", r);
+            ok &= param(db, sec, "paddr", r);
+            ok &= param(db, sec, "lruSeq", r);
+            ok &= db.entryExists(sec, "writable");
+        }
+    }
+
+    for (int e = 0; e < num_ptes; e++) {
+        string sec = csprintf("system.cpu0.workload.Entry%d", e);
+        ok &= param(db, sec, "vaddr", r);
+        ok &= param(db, sec, "paddr", r);
+        ok &= param(db, sec, "flags", r);
+    }
+
+    if (!ok)
+        r.values = 0;
+    return r;
+}
+
+int
+main(int argc, char **argv)
+{
+    int num_ptes = argc > 1 ? atoi(argv[1]) : 200000;
+
+    char dir_template[] = "/tmp/cptloadXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    if (!dir) {
+        cprintf("Can't create a temporary directory\n");
+        return 1;
+    }
+    string ini_path = string(dir) + "/m5.cpt";
+    string bin_path = string(dir) + "/m5.cpt.bin";
+
+    writeIni(ini_path, num_ptes);
+
+    // ini load, as CheckpointIn does today
+    auto start = chrono::steady_clock::now();
+    IniFile *ini = new IniFile;
+    bool ini_loaded = ini->load(ini_path);
+    double ini_load = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    Restored from_ini = restore(*ini, num_ptes, textParam<IniFile>,
+                                textArray<IniFile>);
+    double ini_restore = secondsSince(start);
+
+    // conversion, as done at checkpoint time
+    start = chrono::steady_clock::now();
+    BinaryIniWriter writer;
+    writer.add(*ini);
+    bool written = writer.write(bin_path);
+    double convert = secondsSince(start);
+
+    // binary load
+    start = chrono::steady_clock::now();
+    BinaryIni bin;
+    bool bin_loaded = bin.load(bin_path);
+    double bin_load = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    Restored from_bin = restore(bin, num_ptes, binaryParam, binaryParam);
+    double bin_restore = secondsSince(start);
+
+    if (!ini_loaded || !written || !bin_loaded || from_ini.values == 0 ||
+        from_ini.values != from_bin.values || from_ini.sum != from_bin.sum) {
+        cprintf("The binary checkpoint doesn't restore the same state\n");
+        return 1;
+    }
+
+    vector<string> sections;
+    ini->getSectionNames(sections);
+    cprintf("%d sections, %d values\n", sections.size(), from_ini.values);
+    cprintf("ini     load %7.3fs restore %7.3fs size %9d KB\n", ini_load,
+            ini_restore, fileSize(ini_path) >> 10);
+    cprintf("binary  load %7.3fs restore %7.3fs size %9d KB "
+            "(%.1fx faster in total, converted in %.3fs)\n", bin_load,
+            bin_restore, fileSize(bin_path) >> 10,
+            (ini_load + ini_restore) / (bin_load + bin_restore), convert);
+
+    delete ini;
+    unlink(ini_path.c_str());
+    unlink(bin_path.c_str());
+    rmdir(dir);
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compares SlabPool with the heap on the way a CPU allocates its
+ * dynamic instructions: reference counted instructions are fetched in
+ * groups, retired in order and squashed in bursts. Prints the host
+ * time of both. The number of instructions in millions can be given
+ * as the first argument.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <random>
+
+#include "base/cprintf.hh"
+#include "base/refcnt.hh"
+#include "base/slab_pool.hh"
+
+using namespace std;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+/** Stands in for a dynamic instruction, about the size of an O3 one. */
+class Inst : public RefCounted, public SlabAllocated
+{
+  public:
+    static int alive;
+
+    uint64_t seqNum;
+    uint64_t regs[160];
+
+    Inst(uint64_t seq_num) : seqNum(seq_num) { regs[0] = seq_num; ++alive; }
+    ~Inst() { --alive; }
+};
+
+int Inst::alive = 0;
+
+typedef RefCountingPtr<Inst> InstPtr;
+
+/**
+ * Run the pipeline, allocating from the pool if one is given, and
+ * return a checksum of the sequence numbers that were retired.
+ */
+static uint64_t
+run(SlabPool *pool, uint64_t insts, size_t capacity)
+{
+    mt19937_64 rng(1234);
+    deque<InstPtr> rob;
+    uint64_t seq = 0;
+    uint64_t sum = 0;
+
+    while (seq < insts) {
+        // Fetch
+        for (int i = 0; i < 8 && rob.size() < capacity; i++) {
+            ++seq;
+            rob.push_back(pool ? new (*pool) Inst(seq) : new Inst(seq));
+        }
+
+        // Commit
+        for (int i = 0; i < 8 && !rob.empty() && rng() % 4; i++) {
+            sum = sum * 31 + rob.front()->regs[0];
+            rob.pop_front();
+        }
+
+        // Squash the wrong path on a mispredict
+        if (!rob.empty() && rng() % 16 == 0) {
+            uint64_t squash = rob.front()->seqNum + rng() % rob.size();
+            while (!rob.empty() && rob.back()->seqNum > squash)
+                rob.pop_back();
+        }
+    }
+    return sum;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t insts = (argc > 1 ? atoi(argv[1]) : 20) * 1000000ULL;
+    const size_t capacity = 192;
+
+    auto start = chrono::steady_clock::now();
+    uint64_t heap_sum = run(nullptr, insts, capacity);
+    double heap_secs = secondsSince(start);
+
+    SlabPool *pool = new SlabPool(capacity + 8);
+    start = chrono::steady_clock::now();
+    uint64_t pool_sum = run(pool, insts, capacity);
+    double pool_secs = secondsSince(start);
+
+    if (heap_sum != pool_sum || Inst::alive != 0) {
+        cprintf("SlabPool retired different instructions\n");
+        return 1;
+    }
+
+    cprintf("%d M instructions, %d reused from the pool: heap %.3fs, "
+            "SlabPool %.3fs (%.2fx)\n", insts / 1000000, pool->reused(),
+            heap_secs, pool_secs, heap_secs / pool_secs);
+    pool->detach();
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Loads a large initialized data segment from a file into a backing
+ * store, the way SE mode loads an object file, by copying it from a
+ * mapping of the file and with loadFileImage(), and prints the host
+ * time to load it and to then touch part of it. The segment size in MB
+ * can be given as the first argument.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/loader/file_image.hh"
+
+using namespace std;
+
+static const size_t pageSize = 4096;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+static uint8_t *
+allocStore(size_t size)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+}
+
+/** Sum a byte in every page the program touches, a tenth of them. */
+static uint64_t
+touchPages(const uint8_t *p, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t off = 0; off < size; off += 10 * pageSize)
+        sum += p[off];
+    return sum;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 512) * (1ULL << 20);
+
+    char path[] = "/tmp/elfloadXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        cprintf("Can't create a temporary file\n");
+        return 1;
+    }
+    unlink(path);
+
+    // A segment that starts part way into a page, after the headers,
+    // and ends part way into one
+    const size_t offset = pageSize + 0x123;
+    size += 0x456;
+    vector<uint8_t> chunk(1 << 20);
+    mt19937_64 rng(1234);
+    for (auto &b : chunk)
+        b = rng();
+    for (size_t done = 0; done < offset + size; done += chunk.size()) {
+        if (write(fd, chunk.data(), chunk.size()) != (ssize_t)chunk.size()) {
+            cprintf("Can't write the temporary file\n");
+            return 1;
+        }
+    }
+    const size_t file_size = offset + size;
+    uint8_t *image = static_cast<uint8_t *>(
+        mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0));
+
+    cprintf("%d MB segment\n", size >> 20);
+
+    // The segment lands at the same offset into a page in memory
+    const size_t store_size = size + 2 * pageSize;
+    const size_t base = offset % pageSize;
+
+    uint8_t *copied = allocStore(store_size);
+    auto start = chrono::steady_clock::now();
+    memcpy(copied + base, image + offset, size);
+    double copy_load = secondsSince(start);
+    start = chrono::steady_clock::now();
+    uint64_t copy_sum = touchPages(copied + base, size);
+    double copy_touch = secondsSince(start);
+
+    uint8_t *loaded = allocStore(store_size);
+    start = chrono::steady_clock::now();
+    ssize_t mapped = loadFileImage(loaded + base, size, fd, offset);
+    double map_load = secondsSince(start);
+    start = chrono::steady_clock::now();
+    uint64_t map_sum = touchPages(loaded + base, size);
+    double map_touch = secondsSince(start);
+
+    if (mapped < 0 || copy_sum != map_sum ||
+        memcmp(copied, loaded, store_size) != 0) {
+        cprintf("The loaded segment doesn't match the file\n");
+        return 1;
+    }
+
+    cprintf("%-8s load %8.4fs touch %8.4fs\n", "copy", copy_load,
+            copy_touch);
+    cprintf("%-8s load %8.4fs touch %8.4fs (%.1fx faster to load, "
+            "%.1fx overall, %d MB mapped)\n", "mapped", map_load,
+            map_touch, copy_load / map_load,
+            (copy_load + copy_touch) / (map_load + map_touch),
+            mapped >> 20);
+
+    munmap(loaded, store_size);
+    munmap(copied, store_size);
+    munmap(image, file_size);
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "base/loader/file_image.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static const size_t pageSize = 4096;
+
+static uint8_t *
+allocStore(size_t size)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+}
+
+int
+main()
+{
+    char path[] = "/tmp/fileimageXXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_TRUE(fd >= 0);
+    if (fd < 0)
+        return UnitTest::printResults();
+    unlink(path);
+
+    // A segment that starts part way into a page, after the headers,
+    // and ends part way into one
+    const size_t offset = pageSize + 0x123;
+    const size_t size = (4 << 20) + 0x456;
+    vector<uint8_t> chunk(1 << 20);
+    mt19937_64 rng(1234);
+    for (auto &b : chunk)
+        b = rng();
+    for (size_t done = 0; done < offset + size; done += chunk.size()) {
+        EXPECT_EQ(write(fd, chunk.data(), chunk.size()),
+                  (ssize_t)chunk.size());
+    }
+    const size_t file_size = offset + size;
+    uint8_t *image = static_cast<uint8_t *>(
+        mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0));
+
+    // The segment lands at the same offset into a page in memory
+    const size_t store_size = size + 2 * pageSize;
+    const size_t base = offset % pageSize;
+
+    uint8_t *copied = allocStore(store_size);
+    memcpy(copied + base, image + offset, size);
+
+    // Only the whole pages are mapped
+    UnitTest::setCase("Mapped");
+    uint8_t *loaded = allocStore(store_size);
+    ssize_t mapped = loadFileImage(loaded + base, size, fd, offset);
+    EXPECT_EQ(mapped, (ssize_t)(size - (pageSize - base) -
+                                (base + size) % pageSize));
+    EXPECT_TRUE(memcmp(copied, loaded, store_size) == 0);
+
+    // Writes to the memory must not reach the file
+    loaded[base + size / 2] ^= 0xff;
+    EXPECT_EQ(image[offset + size / 2], copied[base + size / 2]);
+    EXPECT_TRUE(loaded[base + size / 2] != copied[base + size / 2]);
+
+    // Memory that isn't aligned like the file is read
+    UnitTest::setCase("Misaligned");
+    uint8_t *misaligned = allocStore(store_size);
+    EXPECT_EQ(loadFileImage(misaligned + base + 1, size, fd, offset), 0);
+    EXPECT_TRUE(memcmp(misaligned + base + 1, image + offset, size) == 0);
+
+    // So is a segment that doesn't cover a whole page
+    UnitTest::setCase("Small");
+    EXPECT_EQ(loadFileImage(misaligned, 100, fd, 0), 0);
+    EXPECT_TRUE(memcmp(misaligned, image, 100) == 0);
+    EXPECT_EQ(loadFileImage(misaligned, 100, fd, lseek(fd, 0, SEEK_END)),
+              -1);
+
+    munmap(misaligned, store_size);
+    munmap(loaded, store_size);
+    munmap(copied, store_size);
+    munmap(image, file_size);
+    close(fd);
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures the host time of L-TAGE predictions and updates on a
+ * synthetic branch trace, driving the predictor the way the simple
+ * CPUs do: every branch is resolved right after it is predicted, and
+ * mispredictions repair the histories before the tables are updated.
+ * The predictions are hashed so that changes to the predictor's data
+ * structures can be checked to predict exactly as before; ltagetest
+ * does the same on a shorter trace.
+ */
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/random.hh"
+#include "cpu/pred/ltage.hh"
+#include "params/LTAGE.hh"
+
+using namespace std;
+
+static const int staticBranches = 2048;
+static const int dynamicBranches = 4000000;
+
+struct Branch
+{
+    Addr pc;
+    bool cond;
+    bool taken;
+};
+
+/**
+ * Build a trace mixing loop branches, biased branches, branches
+ * correlated with the previous outcomes and unconditional branches.
+ */
+static vector<Branch>
+makeTrace()
+{
+    mt19937 rng(1234);
+    uniform_int_distribution<int> pick(0, staticBranches - 1);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+
+    vector<int> kind(staticBranches), trips(staticBranches);
+    vector<double> bias(staticBranches);
+    for (int i = 0; i < staticBranches; i++) {
+        kind[i] = i % 5;
+        trips[i] = 2 + rng() % 30;
+        bias[i] = coin(rng) < 0.5 ? 0.95 : 0.1;
+    }
+
+    vector<Branch> trace;
+    trace.reserve(dynamicBranches);
+    bool h1 = false, h2 = false;
+    while (trace.size() < dynamicBranches) {
+        int i = pick(rng);
+        Addr pc = 0x400000 + i * 36;
+        switch (kind[i]) {
+          case 0:
+            for (int t = 1; t <= trips[i]; t++)
+                trace.push_back(Branch{pc, true, t != trips[i]});
+            break;
+          case 1:
+            trace.push_back(Branch{pc, true, coin(rng) < bias[i]});
+            break;
+          case 2:
+            trace.push_back(Branch{pc, true, h1 != h2});
+            break;
+          case 3:
+            trace.push_back(Branch{pc, true, (trace.size() & 3) == 0});
+            break;
+          default:
+            trace.push_back(Branch{pc, false, true});
+            break;
+        }
+        h2 = h1;
+        h1 = trace.back().taken;
+    }
+    trace.resize(dynamicBranches);
+    return trace;
+}
+
+int
+main()
+{
+    vector<Branch> trace = makeTrace();
+
+    LTAGEParams params = LTAGEParams();
+    params.name = "ltage";
+    params.numThreads = 1;
+    params.BTBEntries = 4096;
+    params.BTBTagSize = 16;
+    params.RASSize = 16;
+    params.instShiftAmt = 2;
+    params.useIndirect = false;
+    params.indirectHashGHR = true;
+    params.indirectHashTargets = true;
+    params.indirectSets = 256;
+    params.indirectWays = 2;
+    params.indirectTagSize = 16;
+    params.indirectPathLength = 3;
+    params.logSizeBiMP = 14;
+    params.logSizeTagTables = 11;
+    params.logSizeLoopPred = 8;
+    params.nHistoryTables = 12;
+    params.tagTableCounterBits = 3;
+    params.histBufferSize = 2097152;
+    params.minHist = 4;
+    params.maxHist = 640;
+    params.minTagWidth = 7;
+
+    random_mt.init(5489);
+    LTAGE *ltage = params.create();
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t mispredicts = 0;
+    auto start = chrono::steady_clock::now();
+    for (const Branch &br : trace) {
+        void *history = nullptr;
+        bool pred = true;
+        if (br.cond) {
+            pred = ltage->lookup(0, br.pc, history);
+            // Some taken predictions miss in the BTB
+            if (pred && br.pc % 7 == 0) {
+                ltage->btbUpdate(0, br.pc, history);
+                pred = false;
+            }
+        } else {
+            ltage->uncondBranch(0, br.pc, history);
+        }
+
+        hash = (hash ^ (pred | ltage->getGHR(0, history) << 1)) *
+            0x100000001b3ULL;
+
+        if (pred != br.taken) {
+            mispredicts++;
+            ltage->update(0, br.pc, br.taken, history, true);
+        }
+        ltage->update(0, br.pc, br.taken, history, false);
+    }
+    double secs = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+
+    // Hash of the predictions and global histories of the original
+    // L-TAGE implementation on this trace
+    if (hash != 0xb50397fc813fe6bfULL) {
+        cprintf("Predictions differ from the original L-TAGE: %#x\n",
+                hash);
+        delete ltage;
+        return 1;
+    }
+
+    cprintf("%d branches, %.2f%% mispredicted\n", dynamicBranches,
+            100.0 * mispredicts / dynamicBranches);
+    cprintf("%.2f Mbranches/s\n", dynamicBranches / secs / 1e6);
+
+    delete ltage;
+
+    return 0;
+}
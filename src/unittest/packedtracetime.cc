@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Writes the same packet and instruction dependency records as a
+ * protobuf trace and as packed traces, with and without compression,
+ * and prints the host time it takes to replay each. The number of
+ * records can be given as the first argument.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "proto/inst_dep_record.pb.h"
+#include "proto/packed_trace.hh"
+#include "proto/packet.pb.h"
+#include "proto/protoio.hh"
+
+using namespace std;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+/** Loads and stores with some locality, like a TrafficGen trace */
+static vector<PackedTrace::Packet>
+makePackets(int count)
+{
+    vector<PackedTrace::Packet> pkts(count);
+    uint64_t addr = 0x80000000ULL;
+    for (int i = 0; i < count; i++) {
+        PackedTrace::Packet &pkt = pkts[i];
+        addr = i % 16 ? addr + 64 : 0x80000000ULL + (i * 7919 % 65536) * 64;
+        pkt.tick = i * 500ULL;
+        pkt.addr = addr;
+        pkt.cmd = i % 3 ? 1 : 4;
+        pkt.size = 64;
+        pkt.present = 0;
+        pkt.flags = pkt.pktId = pkt.pc = 0;
+        if (i % 2) {
+            pkt.present |= PackedTrace::Packet::HasFlags;
+            pkt.flags = i % 5;
+        }
+        if (i % 3 == 0) {
+            pkt.present |= PackedTrace::Packet::HasPc;
+            pkt.pc = 0x400000 + (i % 1000) * 4;
+        }
+        if (i % 7 == 0) {
+            pkt.present |= PackedTrace::Packet::HasPktId;
+            pkt.pktId = i;
+        }
+    }
+    return pkts;
+}
+
+/**
+ * Instructions of an elastic trace. The dependencies of record i are
+ * kept in deps[i] since the records only point at them.
+ */
+static vector<PackedTrace::InstDep>
+makeInstDeps(int count, vector<vector<uint64_t>> &deps)
+{
+    vector<PackedTrace::InstDep> insts(count);
+    deps.assign(count, vector<uint64_t>());
+    uint64_t seq_num = 1;
+    for (int i = 0; i < count; i++) {
+        PackedTrace::InstDep &inst = insts[i];
+        inst.seqNum = seq_num;
+        seq_num += 1 + i % 3;
+        inst.type = 1 + i % 3;
+        inst.compDelay = i % 11 * 500;
+        inst.pAddr = inst.vAddr = inst.pc = 0;
+        inst.size = inst.flags = inst.asid = inst.weight = 0;
+        inst.present = 0;
+        if (inst.type != 3) {
+            inst.present |= PackedTrace::InstDep::HasPAddr |
+                PackedTrace::InstDep::HasSize |
+                PackedTrace::InstDep::HasFlags |
+                PackedTrace::InstDep::HasVAddr |
+                PackedTrace::InstDep::HasAsid;
+            inst.pAddr = 0x10000000ULL + (i * 13 % 4096) * 8;
+            inst.vAddr = inst.pAddr + 0x7f0000000000ULL;
+            inst.size = 8;
+            inst.flags = i % 4;
+            inst.asid = 1;
+        }
+        if (i % 4) {
+            inst.present |= PackedTrace::InstDep::HasWeight;
+            inst.weight = i % 4;
+        }
+        if (i % 5) {
+            inst.present |= PackedTrace::InstDep::HasPc;
+            inst.pc = 0x400000 + (i % 2000) * 4;
+        }
+        for (int d = 1; d <= i % 4 && inst.seqNum > d * 3ULL; d++)
+            deps[i].push_back(inst.seqNum - d * 3);
+        inst.numRobDep = i % 2 ? deps[i].size() : 0;
+        inst.numRegDep = deps[i].size() - inst.numRobDep;
+    }
+    return insts;
+}
+
+static void
+toProto(const PackedTrace::Packet &pkt, ProtoMessage::Packet &msg)
+{
+    msg.Clear();
+    msg.set_tick(pkt.tick);
+    msg.set_cmd(pkt.cmd);
+    msg.set_addr(pkt.addr);
+    msg.set_size(pkt.size);
+    if (pkt.present & PackedTrace::Packet::HasFlags)
+        msg.set_flags(pkt.flags);
+    if (pkt.present & PackedTrace::Packet::HasPktId)
+        msg.set_pkt_id(pkt.pktId);
+    if (pkt.present & PackedTrace::Packet::HasPc)
+        msg.set_pc(pkt.pc);
+}
+
+static void
+toProto(const PackedTrace::InstDep &inst, const uint64_t *deps,
+        ProtoMessage::InstDepRecord &msg)
+{
+    msg.Clear();
+    msg.set_seq_num(inst.seqNum);
+    msg.set_type((ProtoMessage::InstDepRecord::RecordType)inst.type);
+    msg.set_comp_delay(inst.compDelay);
+    if (inst.present & PackedTrace::InstDep::HasPAddr)
+        msg.set_p_addr(inst.pAddr);
+    if (inst.present & PackedTrace::InstDep::HasSize)
+        msg.set_size(inst.size);
+    if (inst.present & PackedTrace::InstDep::HasFlags)
+        msg.set_flags(inst.flags);
+    if (inst.present & PackedTrace::InstDep::HasWeight)
+        msg.set_weight(inst.weight);
+    if (inst.present & PackedTrace::InstDep::HasPc)
+        msg.set_pc(inst.pc);
+    if (inst.present & PackedTrace::InstDep::HasVAddr)
+        msg.set_v_addr(inst.vAddr);
+    if (inst.present & PackedTrace::InstDep::HasAsid)
+        msg.set_asid(inst.asid);
+    for (int d = 0; d < inst.numRobDep; d++)
+        msg.add_rob_dep(deps[d]);
+    for (int d = 0; d < inst.numRegDep; d++)
+        msg.add_reg_dep(deps[inst.numRobDep + d]);
+}
+
+static bool
+samePacket(const PackedTrace::Packet &a, const PackedTrace::Packet &b)
+{
+    return a.tick == b.tick && a.addr == b.addr && a.cmd == b.cmd &&
+        a.size == b.size && a.present == b.present &&
+        a.flags == b.flags && a.pktId == b.pktId && a.pc == b.pc;
+}
+
+static bool
+sameInstDep(const PackedTrace::InstDep &a, const vector<uint64_t> &deps,
+            const PackedTrace::InstDep &b)
+{
+    if (a.seqNum != b.seqNum || a.type != b.type ||
+        a.compDelay != b.compDelay || a.present != b.present ||
+        a.pAddr != b.pAddr || a.vAddr != b.vAddr || a.pc != b.pc ||
+        a.size != b.size || a.flags != b.flags || a.asid != b.asid ||
+        a.weight != b.weight || a.numRobDep != b.numRobDep ||
+        a.numRegDep != b.numRegDep) {
+        return false;
+    }
+    for (size_t d = 0; d < deps.size(); d++) {
+        if (b.deps[d] != deps[d])
+            return false;
+    }
+    return true;
+}
+
+/** Replays a packet trace, returning the number of matching records */
+static int
+replayProto(const string &path, const vector<PackedTrace::Packet> &pkts)
+{
+    ProtoInputStream trace(path);
+    ProtoMessage::PacketHeader header;
+    ProtoMessage::Packet msg;
+    int matched = 0;
+    if (!trace.read(header))
+        return 0;
+    for (size_t i = 0; trace.read(msg); i++) {
+        if (i < pkts.size() && msg.tick() == pkts[i].tick &&
+            msg.addr() == pkts[i].addr && msg.cmd() == pkts[i].cmd &&
+            msg.size() == pkts[i].size &&
+            msg.has_pc() == bool(pkts[i].present &
+                                 PackedTrace::Packet::HasPc) &&
+            msg.pc() == pkts[i].pc) {
+            matched++;
+        }
+    }
+    return matched;
+}
+
+static int
+replayPacked(const string &path, const vector<PackedTrace::Packet> &pkts)
+{
+    PackedTraceReader trace(path);
+    PackedTrace::Packet pkt;
+    int matched = 0;
+    for (size_t i = 0; trace.read(pkt); i++) {
+        if (i < pkts.size() && samePacket(pkts[i], pkt))
+            matched++;
+    }
+    return matched;
+}
+
+static int
+replayProto(const string &path,
+            const vector<PackedTrace::InstDep> &insts,
+            const vector<vector<uint64_t>> &deps)
+{
+    ProtoInputStream trace(path);
+    ProtoMessage::InstDepRecordHeader header;
+    ProtoMessage::InstDepRecord msg;
+    int matched = 0;
+    if (!trace.read(header))
+        return 0;
+    for (size_t i = 0; trace.read(msg); i++) {
+        if (i >= insts.size() || msg.seq_num() != insts[i].seqNum ||
+            msg.comp_delay() != insts[i].compDelay ||
+            msg.p_addr() != insts[i].pAddr ||
+            msg.weight() != insts[i].weight ||
+            msg.rob_dep_size() + msg.reg_dep_size() != (int)deps[i].size()) {
+            continue;
+        }
+        bool same = true;
+        for (int d = 0; d < msg.rob_dep_size(); d++)
+            same = same && msg.rob_dep(d) == deps[i][d];
+        for (int d = 0; d < msg.reg_dep_size(); d++)
+            same = same && msg.reg_dep(d) == deps[i][msg.rob_dep_size() + d];
+        matched += same;
+    }
+    return matched;
+}
+
+static int
+replayPacked(const string &path,
+             const vector<PackedTrace::InstDep> &insts,
+             const vector<vector<uint64_t>> &deps)
+{
+    PackedTraceReader trace(path);
+    PackedTrace::InstDep inst;
+    int matched = 0;
+    for (size_t i = 0; trace.read(inst); i++) {
+        if (i < insts.size() && sameInstDep(insts[i], deps[i], inst))
+            matched++;
+    }
+    return matched;
+}
+
+int
+main(int argc, char **argv)
+{
+    int num_records = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    char dir_template[] = "/tmp/packedtraceXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    if (!dir) {
+        cprintf("Can't create a temporary directory\n");
+        return 1;
+    }
+    const string paths[] = {
+        string(dir) + "/pkt.trc.gz", string(dir) + "/pkt.ptrc",
+        string(dir) + "/pkt.zlib.ptrc", string(dir) + "/inst.trc.gz",
+        string(dir) + "/inst.ptrc", string(dir) + "/inst.zlib.ptrc",
+    };
+
+    vector<PackedTrace::Packet> pkts = makePackets(num_records);
+    vector<vector<uint64_t>> deps;
+    vector<PackedTrace::InstDep> insts = makeInstDeps(num_records, deps);
+
+    // Write every trace
+    {
+        ProtoOutputStream proto(paths[0]);
+        ProtoMessage::PacketHeader header;
+        header.set_obj_id("system.tgen");
+        header.set_ver(0);
+        header.set_tick_freq(1000000000000ULL);
+        ProtoMessage::PacketHeader::IdStringEntry *id =
+            header.add_id_strings();
+        id->set_key(0);
+        id->set_value("system.cpu.dcache");
+        proto.write(header);
+
+        PackedTrace::Header packed_header(PackedTrace::PacketTrace);
+        packed_header.objId = header.obj_id();
+        packed_header.tickFreq = header.tick_freq();
+        packed_header.idStrings.emplace_back(0, "system.cpu.dcache");
+        PackedTraceWriter packed(paths[1], packed_header);
+        PackedTraceWriter zlib(paths[2], packed_header, true);
+
+        ProtoMessage::Packet msg;
+        for (auto &pkt : pkts) {
+            toProto(pkt, msg);
+            proto.write(msg);
+            packed.write(pkt);
+            zlib.write(pkt);
+        }
+    }
+    {
+        ProtoOutputStream proto(paths[3]);
+        ProtoMessage::InstDepRecordHeader header;
+        header.set_obj_id("system.cpu");
+        header.set_ver(0);
+        header.set_tick_freq(1000000000000ULL);
+        header.set_window_size(750);
+        proto.write(header);
+
+        PackedTrace::Header packed_header(PackedTrace::InstDepTrace);
+        packed_header.objId = header.obj_id();
+        packed_header.tickFreq = header.tick_freq();
+        packed_header.windowSize = header.window_size();
+        PackedTraceWriter packed(paths[4], packed_header);
+        PackedTraceWriter zlib(paths[5], packed_header, true);
+
+        ProtoMessage::InstDepRecord msg;
+        for (size_t i = 0; i < insts.size(); i++) {
+            insts[i].deps = deps[i].data();
+            toProto(insts[i], deps[i].data(), msg);
+            proto.write(msg);
+            packed.write(insts[i]);
+            zlib.write(insts[i]);
+        }
+    }
+
+    bool ok = true;
+    double pkt_times[3];
+    for (int f = 0; f < 3; f++) {
+        auto start = chrono::steady_clock::now();
+        int matched = f ? replayPacked(paths[f], pkts) :
+            replayProto(paths[f], pkts);
+        pkt_times[f] = secondsSince(start);
+        ok = ok && matched == num_records;
+    }
+
+    double inst_times[3];
+    for (int f = 0; f < 3; f++) {
+        auto start = chrono::steady_clock::now();
+        int matched = f ? replayPacked(paths[3 + f], insts, deps) :
+            replayProto(paths[3 + f], insts, deps);
+        inst_times[f] = secondsSince(start);
+        ok = ok && matched == num_records;
+    }
+
+    if (!ok) {
+        cprintf("A trace doesn't read back the records written\n");
+        return 1;
+    }
+
+    const char *formats[] = { "protobuf", "packed", "packed zlib" };
+    cprintf("%d records\n", num_records);
+    for (int f = 0; f < 3; f++) {
+        cprintf("packets      %-11s %7.3fs size %9d KB (%.1fx faster)\n",
+                formats[f], pkt_times[f], fileSize(paths[f]) >> 10,
+                pkt_times[0] / pkt_times[f]);
+    }
+    for (int f = 0; f < 3; f++) {
+        cprintf("instructions %-11s %7.3fs size %9d KB (%.1fx faster)\n",
+                formats[f], inst_times[f], fileSize(paths[3 + f]) >> 10,
+                inst_times[0] / inst_times[f]);
+    }
+
+    for (auto &path : paths)
+        unlink(path.c_str());
+    rmdir(dir);
+
+    return 0;
+}
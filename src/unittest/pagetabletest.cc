@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/page_table.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static const Addr PageBytes = 4096;
+
+/** One entry per page, as the page table used to be */
+struct PageMap
+{
+    unordered_map<Addr, EmulationPageTable::Entry> pages;
+
+    void
+    map(Addr vaddr, Addr paddr, Addr size, uint64_t flags)
+    {
+        for (Addr offset = 0; offset < size; offset += PageBytes) {
+            pages[vaddr + offset] = EmulationPageTable::Entry(
+                paddr + offset, flags);
+        }
+    }
+
+    void
+    unmap(Addr vaddr, Addr size)
+    {
+        for (Addr offset = 0; offset < size; offset += PageBytes)
+            pages.erase(vaddr + offset);
+    }
+
+    bool
+    translate(Addr vaddr, Addr &paddr) const
+    {
+        auto it = pages.find(vaddr & ~(PageBytes - 1));
+        if (it == pages.end())
+            return false;
+        paddr = it->second.paddr + (vaddr & (PageBytes - 1));
+        return true;
+    }
+};
+
+/** Checkpoints the per page table in the old page table format */
+struct PageMapCheckpoint : public Serializable
+{
+    const PageMap &ref;
+
+    PageMapCheckpoint(const PageMap &_ref) : ref(_ref) {}
+
+    void
+    serialize(CheckpointOut &cp) const override
+    {
+        paramOut(cp, "ptable.size", ref.pages.size());
+
+        int count = 0;
+        for (auto &pte : ref.pages) {
+            ScopedCheckpointSection sec(cp, csprintf("Entry%d", count++));
+
+            paramOut(cp, "vaddr", pte.first);
+            paramOut(cp, "paddr", pte.second.paddr);
+            paramOut(cp, "flags", pte.second.flags);
+        }
+    }
+
+    void unserialize(CheckpointIn &cp) override {}
+};
+
+/** Check every page in [start, end) translates the same in both */
+static bool
+sameTranslations(EmulationPageTable &table, const PageMap &ref,
+                 Addr start, Addr end)
+{
+    for (Addr vaddr = start; vaddr < end; vaddr += PageBytes) {
+        Addr paddr = 0, ref_paddr = 0;
+        bool mapped = table.translate(vaddr + 8, paddr);
+        if (mapped != ref.translate(vaddr + 8, ref_paddr))
+            return false;
+        if (!mapped)
+            continue;
+
+        const EmulationPageTable::Entry *entry = table.lookup(vaddr + 8);
+        auto &ref_entry = ref.pages.at(vaddr);
+        if (paddr != ref_paddr || !entry ||
+            entry->paddr != ref_entry.paddr ||
+            entry->flags != ref_entry.flags) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int
+main()
+{
+    const Addr footprint = 256 << 20;
+    mt19937_64 rng(1234);
+
+    // Arrays are mapped on first touch, a page at a time, with physical
+    // pages handed out in order. A few pages of stack are touched in
+    // between, growing down.
+    UnitTest::setCase("Mapping a page at a time");
+    EmulationPageTable table("ptable", 0, PageBytes);
+    PageMap ref;
+    const Addr heap = 0x10000000, stack = 0x7fff00000000ULL;
+    Addr next_paddr = 0, stack_top = stack;
+    for (Addr offset = 0; offset < footprint; offset += PageBytes) {
+        table.map(heap + offset, next_paddr, PageBytes);
+        ref.map(heap + offset, next_paddr, PageBytes, 0);
+        next_paddr += PageBytes;
+        if (offset % (64 << 20) == 0) {
+            stack_top -= PageBytes;
+            table.map(stack_top, next_paddr, PageBytes);
+            ref.map(stack_top, next_paddr, PageBytes, 0);
+            next_paddr += PageBytes;
+        }
+    }
+    EXPECT_EQ(ref.pages.size(), footprint / PageBytes +
+              (stack - stack_top) / PageBytes);
+    // Each stack page splits the heap
+    EXPECT_TRUE(table.numMappings() <=
+                1 + 2 * (stack - stack_top) / PageBytes);
+    EXPECT_TRUE(sameTranslations(table, ref, heap, heap + footprint));
+    EXPECT_TRUE(sameTranslations(table, ref, stack_top, stack));
+
+    ostringstream cpt, ref_cpt;
+    table.serialize(cpt);
+    PageMapCheckpoint(ref).serialize(ref_cpt);
+    EXPECT_TRUE(cpt.str().size() * 100 < ref_cpt.str().size());
+
+    // Physically contiguous spans, as used for bulk functional copies
+    UnitTest::setCase("Contiguous ranges");
+    Addr vaddr = heap, spans = 0;
+    bool ok = true;
+    while (vaddr < heap + footprint && ok) {
+        Addr paddr, ref_paddr;
+        Addr len = table.translateRange(vaddr, heap + footprint - vaddr,
+                                        paddr);
+        ok = len > 0 && ref.translate(vaddr, ref_paddr) &&
+            paddr == ref_paddr &&
+            ref.translate(vaddr + len - 1, ref_paddr) &&
+            paddr + len - 1 == ref_paddr;
+        vaddr += len;
+        spans++;
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(vaddr, heap + footprint);
+    EXPECT_EQ(spans, 1 + footprint / (64 << 20));
+    Addr paddr;
+    EXPECT_EQ(table.translateRange(heap + 100, 50, paddr), 50);
+    EXPECT_EQ(table.translateRange(heap - PageBytes, PageBytes, paddr), 0);
+
+    UnitTest::setCase("Random operations");
+    EmulationPageTable small("small", 0, PageBytes);
+    PageMap small_ref;
+    const Addr base = 0x400000, pages = 512;
+    ok = true;
+    for (int op = 0; op < 5000 && ok; op++) {
+        Addr vaddr = base + rng() % pages * PageBytes;
+        Addr size = (1 + rng() % 16) * PageBytes;
+        uint64_t flags = rng() % 3 == 0 ? EmulationPageTable::ReadOnly : 0;
+
+        switch (rng() % 4) {
+          case 0:
+          case 1:
+            if (small.isUnmapped(vaddr, size)) {
+                Addr paddr = rng() % 2 ? next_paddr : rng() % 64 * PageBytes;
+                small.map(vaddr, paddr, size, flags);
+                small_ref.map(vaddr, paddr, size, flags);
+                next_paddr += size;
+            } else {
+                small.map(vaddr, next_paddr, size,
+                          flags | EmulationPageTable::Clobber);
+                small_ref.map(vaddr, next_paddr, size, flags);
+                next_paddr += size;
+            }
+            break;
+          case 2: {
+            bool mapped = true;
+            for (Addr offset = 0; offset < size; offset += PageBytes)
+                mapped = mapped && small_ref.pages.count(vaddr + offset);
+            if (mapped) {
+                small.unmap(vaddr, size);
+                small_ref.unmap(vaddr, size);
+            }
+            break;
+          }
+          case 3: {
+            bool mapped = true;
+            for (Addr offset = 0; offset < size; offset += PageBytes)
+                mapped = mapped && small_ref.pages.count(vaddr + offset);
+            Addr new_vaddr = base + (pages + rng() % pages) * PageBytes;
+            if (mapped && small.isUnmapped(new_vaddr, size)) {
+                small.remap(vaddr, size, new_vaddr);
+                for (Addr offset = 0; offset < size; offset += PageBytes) {
+                    small_ref.pages[new_vaddr + offset] =
+                        small_ref.pages.at(vaddr + offset);
+                }
+                small_ref.unmap(vaddr, size);
+            }
+            break;
+          }
+        }
+        ok = sameTranslations(small, small_ref, base,
+                              base + 2 * pages * PageBytes);
+    }
+    EXPECT_TRUE(ok);
+
+    vector<pair<Addr, Addr>> addr_maps;
+    small.getMappings(&addr_maps);
+    EXPECT_EQ(addr_maps.size(), small_ref.pages.size());
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "mem/sparse_store.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static uint8_t *
+allocStore(uint64_t size)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+}
+
+/** Touch a few percent of the pages, like a typical SE workload. */
+static void
+fillStore(uint8_t *pmem, uint64_t size)
+{
+    mt19937_64 rng(1234);
+    const uint64_t pages = size / SparseStore::pageSize;
+    for (uint64_t p = 0; p < pages; p++) {
+        uint64_t kind = rng() % 100;
+        if (kind >= 6)
+            continue;
+        uint64_t *w = reinterpret_cast<uint64_t *>(
+            pmem + p * SparseStore::pageSize);
+        for (size_t i = 0; i < SparseStore::pageSize / 8; i++) {
+            if (kind < 4)
+                w[i] = (i * 8 + p) & 0xff;  // small, compressible data
+            else if (kind < 5)
+                w[i] = rng();               // incompressible data
+            else if (i < 16)
+                w[i] = p;                   // mostly zero page
+        }
+    }
+}
+
+static uint64_t
+countPages(const uint8_t *pmem, uint64_t size)
+{
+    uint64_t pages = 0;
+    for (uint64_t off = 0; off < size; off += SparseStore::pageSize) {
+        uint64_t bytes = min<uint64_t>(SparseStore::pageSize, size - off);
+        for (uint64_t i = 0; i < bytes; i++) {
+            if (pmem[off + i]) {
+                pages++;
+                break;
+            }
+        }
+    }
+    return pages;
+}
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+/**
+ * Write a store, restore it into a fresh zero filled store and check
+ * that the two match.
+ */
+static void
+checkRestore(const string &path, const uint8_t *orig, uint64_t size,
+             bool compress, unsigned threads, bool allow_mmap)
+{
+    SparseStore::Stats wstats =
+        SparseStore::write(path, orig, size, compress, threads);
+    EXPECT_TRUE(SparseStore::isSparseStore(path));
+    EXPECT_EQ(wstats.pages, countPages(orig, size));
+    EXPECT_EQ(wstats.fileBytes, fileSize(path));
+
+    uint8_t *pmem = allocStore(size);
+    SparseStore::Stats rstats =
+        SparseStore::read(path, pmem, size, threads, allow_mmap);
+    EXPECT_EQ(rstats.pages, wstats.pages);
+    EXPECT_TRUE(allow_mmap || rstats.mappedPages == 0);
+    EXPECT_TRUE(memcmp(orig, pmem, size) == 0);
+
+    munmap(pmem, size);
+    unlink(path.c_str());
+}
+
+int
+main()
+{
+    char dir_template[] = "/tmp/pmemcptXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    EXPECT_TRUE(dir != nullptr);
+    if (!dir)
+        return UnitTest::printResults();
+    string path = string(dir) + "/store.spmem";
+
+    // Several groups, and a partial page at the end of the store
+    const uint64_t size = 9 * SparseStore::groupPages *
+        SparseStore::pageSize + SparseStore::pageSize + 1000;
+    uint8_t *orig = allocStore(size);
+    fillStore(orig, size);
+    memset(orig + size - 1000, 0x5a, 1000);
+
+    UnitTest::setCase("Compressed restore");
+    checkRestore(path, orig, size, true, 4, false);
+
+    UnitTest::setCase("Raw restore, copied");
+    checkRestore(path, orig, size, false, 4, false);
+
+    UnitTest::setCase("Raw restore, mapped");
+    checkRestore(path, orig, size, false, 4, true);
+
+    UnitTest::setCase("Single threaded restore");
+    checkRestore(path, orig, size, true, 1, false);
+
+    // Checkpointing again into the same file, as a run restored from a
+    // checkpoint directory may do, leaves the mapped pages alone
+    UnitTest::setCase("Rewriting a mapped file");
+    {
+        SparseStore::write(path, orig, size, false, 4);
+        uint8_t *pmem = allocStore(size);
+        SparseStore::Stats stats = SparseStore::read(path, pmem, size, 4,
+                                                     true);
+        EXPECT_TRUE(stats.mappedPages > 0);
+
+        uint8_t *other = allocStore(size);
+        memset(other, 0xa5, size);
+        SparseStore::write(path, other, size, false, 4);
+        EXPECT_TRUE(memcmp(orig, pmem, size) == 0);
+        EXPECT_FALSE(access((path + ".tmp").c_str(), F_OK) == 0);
+
+        munmap(other, size);
+        munmap(pmem, size);
+        unlink(path.c_str());
+    }
+
+    UnitTest::setCase("Empty store");
+    {
+        uint8_t *empty = allocStore(size);
+        SparseStore::Stats stats =
+            SparseStore::write(path, empty, size, true, 0);
+        EXPECT_EQ(stats.pages, 0);
+        uint8_t *pmem = allocStore(size);
+        SparseStore::read(path, pmem, size, 0, true);
+        EXPECT_TRUE(memcmp(empty, pmem, size) == 0);
+        munmap(pmem, size);
+        munmap(empty, size);
+        unlink(path.c_str());
+    }
+
+    UnitTest::setCase("gzip stores are not sparse");
+    {
+        string gz_path = string(dir) + "/store.pmem";
+        gzFile f = gzopen(gz_path.c_str(), "wb");
+        gzwrite(f, orig, SparseStore::pageSize);
+        gzclose(f);
+        EXPECT_FALSE(SparseStore::isSparseStore(gz_path));
+        EXPECT_FALSE(SparseStore::isSparseStore(string(dir) + "/none"));
+        unlink(gz_path.c_str());
+    }
+
+    munmap(orig, size);
+    rmdir(dir);
+
+    return UnitTest::printResults();
+}
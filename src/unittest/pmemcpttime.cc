@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Writes and restores a mostly empty backing store with the gzip
+ * stream used by PhysicalMemory and with the sparse formats, copying
+ * and mapping raw stores, and prints the host time and file size of
+ * each. The store size in MB can be given as the first argument.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "base/cprintf.hh"
+#include "mem/sparse_store.hh"
+
+using namespace std;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+static uint8_t *
+allocStore(uint64_t size)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+}
+
+/** Touch a few percent of the pages, like a typical SE workload. */
+static void
+fillStore(uint8_t *pmem, uint64_t size)
+{
+    mt19937_64 rng(1234);
+    const uint64_t pages = size / SparseStore::pageSize;
+    for (uint64_t p = 0; p < pages; p++) {
+        uint64_t kind = rng() % 100;
+        if (kind >= 6)
+            continue;
+        uint64_t *w = reinterpret_cast<uint64_t *>(
+            pmem + p * SparseStore::pageSize);
+        for (size_t i = 0; i < SparseStore::pageSize / 8; i++) {
+            if (kind < 4)
+                w[i] = (i * 8 + p) & 0xff;  // small, compressible data
+            else if (kind < 5)
+                w[i] = rng();               // incompressible data
+            else if (i < 16)
+                w[i] = p;                   // mostly zero page
+        }
+    }
+}
+
+/** The gzip stream PhysicalMemory::serializeStore() writes. */
+static void
+writeGzip(const string &path, const uint8_t *pmem, uint64_t size)
+{
+    gzFile f = gzopen(path.c_str(), "wb");
+    for (uint64_t done = 0, pass = 0; done < size; done += pass) {
+        pass = min<uint64_t>(INT_MAX, size - done);
+        gzwrite(f, pmem + done, pass);
+    }
+    gzclose(f);
+}
+
+/** The restore loop of PhysicalMemory::unserializeStore(). */
+static void
+readGzip(const string &path, uint8_t *pmem, uint64_t size)
+{
+    const uint32_t chunk_size = 16384;
+    gzFile f = gzopen(path.c_str(), "rb");
+    long *temp = new long[chunk_size];
+    uint64_t curr = 0;
+    while (curr < size) {
+        int bytes = gzread(f, temp, chunk_size);
+        if (bytes <= 0)
+            break;
+        for (uint32_t x = 0; x < bytes / sizeof(long); x++) {
+            if (temp[x] != 0)
+                *(long *)(pmem + curr + x * sizeof(long)) = temp[x];
+        }
+        curr += bytes;
+    }
+    delete[] temp;
+    gzclose(f);
+}
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint64_t size = (argc > 1 ? atoi(argv[1]) : 512) * (1ULL << 20);
+
+    char dir_template[] = "/tmp/pmemcptXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    if (!dir) {
+        cprintf("Can't create a temporary directory\n");
+        return 1;
+    }
+
+    uint8_t *orig = allocStore(size);
+    if (!orig) {
+        cprintf("Can't allocate a %d MB store\n", size >> 20);
+        return 1;
+    }
+    fillStore(orig, size);
+
+    cprintf("%d MB store\n", size >> 20);
+
+    // gzip reference
+    string gz_path = string(dir) + "/store.pmem";
+    auto start = chrono::steady_clock::now();
+    writeGzip(gz_path, orig, size);
+    double gz_write = secondsSince(start);
+
+    uint8_t *pmem = allocStore(size);
+    start = chrono::steady_clock::now();
+    readGzip(gz_path, pmem, size);
+    double gz_read = secondsSince(start);
+
+    if (memcmp(orig, pmem, size) != 0) {
+        cprintf("gzip restore differs from the store\n");
+        return 1;
+    }
+    munmap(pmem, size);
+
+    cprintf("%-12s write %7.3fs restore %7.3fs size %9d KB\n", "gzip",
+            gz_write, gz_read, fileSize(gz_path) >> 10);
+    unlink(gz_path.c_str());
+
+    const struct
+    {
+        const char *name;
+        bool compress;
+        bool mmap;
+    } formats[] = {
+        { "sparse", true, false },
+        { "sparse_raw", false, false },
+        { "raw_mapped", false, true },
+    };
+    for (const auto &format : formats) {
+        const char *name = format.name;
+        string path = string(dir) + "/store.spmem";
+
+        start = chrono::steady_clock::now();
+        SparseStore::Stats wstats =
+            SparseStore::write(path, orig, size, format.compress, 0);
+        double write_secs = secondsSince(start);
+
+        pmem = allocStore(size);
+        start = chrono::steady_clock::now();
+        SparseStore::Stats rstats =
+            SparseStore::read(path, pmem, size, 0, format.mmap);
+        double read_secs = secondsSince(start);
+
+        // Mapped pages are only read from the file when touched, so
+        // also time a full pass over the restored store
+        start = chrono::steady_clock::now();
+        bool same = memcmp(orig, pmem, size) == 0;
+        double touch_secs = secondsSince(start);
+
+        munmap(pmem, size);
+        if (!same) {
+            cprintf("%s restore differs from the store\n", name);
+            return 1;
+        }
+
+        cprintf("%-12s write %7.3fs restore %7.3fs size %9d KB "
+                "(%.1fx/%.1fx faster, %d pages, %d mapped, "
+                "first touch %.3fs)\n", name, write_secs, read_secs,
+                wstats.fileBytes >> 10, gz_write / write_secs,
+                gz_read / read_secs, wstats.pages, rstats.mappedPages,
+                touch_secs);
+        unlink(path.c_str());
+    }
+
+    munmap(orig, size);
+    rmdir(dir);
+
+    return 0;
+}
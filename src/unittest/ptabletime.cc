@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Maps the arrays of a large accelerator workload into an
+ * EmulationPageTable the way SE mode does, a page at a time, and
+ * measures translate() throughput against a table with one hash entry
+ * per page. Also prints the number of mappings and the checkpoint size
+ * of both. The footprint in MB can be given as the first argument.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/page_table.hh"
+
+using namespace std;
+
+static const Addr PageBytes = 4096;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+/** One entry per page, as the page table used to be */
+struct PageMap
+{
+    unordered_map<Addr, EmulationPageTable::Entry> pages;
+
+    void
+    map(Addr vaddr, Addr paddr, Addr size, uint64_t flags)
+    {
+        for (Addr offset = 0; offset < size; offset += PageBytes) {
+            pages[vaddr + offset] = EmulationPageTable::Entry(
+                paddr + offset, flags);
+        }
+    }
+
+    bool
+    translate(Addr vaddr, Addr &paddr) const
+    {
+        auto it = pages.find(vaddr & ~(PageBytes - 1));
+        if (it == pages.end())
+            return false;
+        paddr = it->second.paddr + (vaddr & (PageBytes - 1));
+        return true;
+    }
+};
+
+/** Checkpoints the per page table in the old page table format */
+struct PageMapCheckpoint : public Serializable
+{
+    const PageMap &ref;
+
+    PageMapCheckpoint(const PageMap &_ref) : ref(_ref) {}
+
+    void
+    serialize(CheckpointOut &cp) const override
+    {
+        paramOut(cp, "ptable.size", ref.pages.size());
+
+        int count = 0;
+        for (auto &pte : ref.pages) {
+            ScopedCheckpointSection sec(cp, csprintf("Entry%d", count++));
+
+            paramOut(cp, "vaddr", pte.first);
+            paramOut(cp, "paddr", pte.second.paddr);
+            paramOut(cp, "flags", pte.second.flags);
+        }
+    }
+
+    void unserialize(CheckpointIn &cp) override {}
+};
+
+int
+main(int argc, char **argv)
+{
+    Addr footprint = (argc > 1 ? atoi(argv[1]) : 4096) * (1ULL << 20);
+    mt19937_64 rng(1234);
+
+    // Arrays are mapped on first touch, a page at a time, with physical
+    // pages handed out in order. A few pages of stack are touched in
+    // between, growing down.
+    EmulationPageTable table("ptable", 0, PageBytes);
+    PageMap ref;
+    const Addr heap = 0x10000000, stack = 0x7fff00000000ULL;
+    Addr next_paddr = 0, stack_top = stack;
+    for (Addr offset = 0; offset < footprint; offset += PageBytes) {
+        table.map(heap + offset, next_paddr, PageBytes);
+        ref.map(heap + offset, next_paddr, PageBytes, 0);
+        next_paddr += PageBytes;
+        if (offset % (64 << 20) == 0) {
+            stack_top -= PageBytes;
+            table.map(stack_top, next_paddr, PageBytes);
+            ref.map(stack_top, next_paddr, PageBytes, 0);
+            next_paddr += PageBytes;
+        }
+    }
+
+    ostringstream cpt, ref_cpt;
+    table.serialize(cpt);
+    PageMapCheckpoint(ref).serialize(ref_cpt);
+
+    // Accesses mostly stream through an array, with some random ones
+    const int num_accesses = 20000000;
+    vector<Addr> vaddrs(4096);
+    for (size_t i = 0; i < vaddrs.size(); i++) {
+        if (i % 8 == 0)
+            vaddrs[i] = heap + rng() % footprint;
+        else
+            vaddrs[i] = heap + (i * 64) % footprint;
+    }
+
+    auto start = chrono::steady_clock::now();
+    Addr sum = 0;
+    for (int i = 0; i < num_accesses; i++) {
+        Addr paddr = 0;
+        ref.translate(vaddrs[i % vaddrs.size()] + i, paddr);
+        sum += paddr;
+    }
+    double ref_time = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    Addr table_sum = 0;
+    for (int i = 0; i < num_accesses; i++) {
+        Addr paddr = 0;
+        table.translate(vaddrs[i % vaddrs.size()] + i, paddr);
+        table_sum += paddr;
+    }
+    double table_time = secondsSince(start);
+
+    if (sum != table_sum) {
+        cprintf("The page table translates differently\n");
+        return 1;
+    }
+
+    cprintf("%d MB footprint, %d pages, %d mappings\n", footprint >> 20,
+            ref.pages.size(), table.numMappings());
+    cprintf("checkpoint %d KB, %d KB with an entry per page\n",
+            cpt.str().size() >> 10, ref_cpt.str().size() >> 10);
+    cprintf("per page   %7.3fs for %d translations\n", ref_time,
+            num_accesses);
+    cprintf("ranges     %7.3fs (%.1fx faster)\n", table_time,
+            ref_time / table_time);
+
+    return 0;
+}
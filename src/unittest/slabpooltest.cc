@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <deque>
+#include <random>
+
+#include "base/refcnt.hh"
+#include "base/slab_pool.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+/** Stands in for a dynamic instruction, about the size of an O3 one. */
+class Inst : public RefCounted, public SlabAllocated
+{
+  public:
+    static int alive;
+
+    uint64_t seqNum;
+    uint64_t regs[160];
+
+    Inst(uint64_t seq_num) : seqNum(seq_num) { regs[0] = seq_num; ++alive; }
+    ~Inst() { --alive; }
+};
+
+int Inst::alive = 0;
+
+typedef RefCountingPtr<Inst> InstPtr;
+
+/**
+ * Run the way a CPU allocates its dynamic instructions: they are
+ * fetched in groups, retired in order and squashed in bursts.
+ * Instructions come from the pool if one is given. Returns a checksum
+ * of the sequence numbers that were retired.
+ */
+static uint64_t
+run(SlabPool *pool, uint64_t insts, size_t capacity)
+{
+    mt19937_64 rng(1234);
+    deque<InstPtr> rob;
+    uint64_t seq = 0;
+    uint64_t sum = 0;
+
+    while (seq < insts) {
+        // Fetch
+        for (int i = 0; i < 8 && rob.size() < capacity; i++) {
+            ++seq;
+            rob.push_back(pool ? new (*pool) Inst(seq) : new Inst(seq));
+        }
+
+        // Commit
+        for (int i = 0; i < 8 && !rob.empty() && rng() % 4; i++) {
+            sum = sum * 31 + rob.front()->regs[0];
+            rob.pop_front();
+        }
+
+        // Squash the wrong path on a mispredict
+        if (!rob.empty() && rng() % 16 == 0) {
+            uint64_t squash = rob.front()->seqNum + rng() % rob.size();
+            while (!rob.empty() && rob.back()->seqNum > squash)
+                rob.pop_back();
+        }
+    }
+    return sum;
+}
+
+int
+main()
+{
+    const uint64_t insts = 200000;
+    const size_t capacity = 192;
+
+    UnitTest::setCase("Basic operations");
+    {
+        SlabPool *pool = new SlabPool(2);
+        InstPtr a = new (*pool) Inst(1);
+        InstPtr b = new (*pool) Inst(2);
+        InstPtr c = new (*pool) Inst(3);
+        EXPECT_EQ(pool->numSlabs(), 2);
+        EXPECT_EQ(pool->outstanding(), 3);
+
+        // A freed object is the next one handed out
+        Inst *freed = b.get();
+        b = NULL;
+        b = new (*pool) Inst(4);
+        EXPECT_TRUE(b.get() == freed);
+        EXPECT_EQ(pool->allocated(), 4);
+        EXPECT_EQ(pool->reused(), 1);
+
+        // Objects without a pool come from the heap
+        InstPtr d = new Inst(5);
+        EXPECT_EQ(pool->allocated(), 4);
+        d = NULL;
+
+        // A stats reset restarts the counts, not the free list
+        pool->resetCounts();
+        EXPECT_EQ(pool->allocated(), 0);
+        EXPECT_EQ(pool->reused(), 0);
+        EXPECT_EQ(pool->outstanding(), 3);
+        c = NULL;
+        c = new (*pool) Inst(3);
+        EXPECT_EQ(pool->allocated(), 1);
+        EXPECT_EQ(pool->reused(), 1);
+
+        // The pool lives on until its last object is gone
+        pool->detach();
+        a = NULL;
+        b = NULL;
+        EXPECT_EQ(pool->outstanding(), 1);
+        EXPECT_EQ(c->seqNum, 3);
+        c = NULL;
+        EXPECT_EQ(Inst::alive, 0);
+    }
+
+    // Once the first slab is full, every instruction comes from the
+    // free list
+    UnitTest::setCase("Matches the heap");
+    {
+        SlabPool *pool = new SlabPool(capacity + 8);
+        EXPECT_EQ(run(nullptr, insts, capacity), run(pool, insts, capacity));
+        EXPECT_EQ(pool->numSlabs(), 1);
+        EXPECT_EQ(pool->outstanding(), 0);
+        EXPECT_TRUE(pool->allocated() >= insts);
+        EXPECT_TRUE(pool->allocated() - pool->reused() <= capacity + 8);
+        EXPECT_EQ(Inst::alive, 0);
+        pool->detach();
+    }
+
+    return UnitTest::printResults();
+}
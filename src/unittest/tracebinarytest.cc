@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/trace.hh"
+#include "base/trace_binary.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static uint64_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+static string
+decode(const string &path)
+{
+    ostringstream out;
+    Trace::decodeBinaryTrace(path, out);
+    return out.str();
+}
+
+/** The kind of messages a memory system and an accelerator log */
+static void
+logMessages(Trace::Logger &logger, const vector<string> &names, int count)
+{
+    static const char data[] = "scratchpad contents, 40 bytes long...";
+    const char *states[] = { "Idle", "Busy", "Waiting" };
+    string long_line(10000, 'x');
+
+    for (int i = 0; i < count; i++) {
+        Tick when = i * 500;
+        const string &name = names[i % names.size()];
+        uint64_t addr = 0x80000000ULL + i * 64;
+
+        switch (i % 8) {
+          case 0:
+            logger.dprintf(when, name, "Read addr %#x size %d\n", addr, 64);
+            break;
+          case 1:
+            logger.dprintf(when, name, "Node %5d state %s -> %s\n", i,
+                           states[i % 3], string(states[(i + 1) % 3]));
+            break;
+          case 2:
+            logger.dprintf(when, name, "latency %.3f ratio %g ok %d\n",
+                           i / 7.0, float(i) / 3, i % 3 == 0);
+            break;
+          case 3:
+            logger.dprintf(when, name, "%c%c byte %#04x short %d %-6s|\n",
+                           char('a' + i % 26), (unsigned char)'Z',
+                           (uint8_t)i, (short)-i, "left");
+            break;
+          case 4:
+            logger.dprintf(when, name, "cycle %s width %*d\n",
+                           Cycles(i), 8, i);
+            break;
+          case 5:
+            logger.dprintf(MaxTick, string(), "raw line %d\n", i);
+            break;
+          case 6:
+            if (i % 1000 == 6)
+                logger.dprintf(when, name, "long %s\n", long_line);
+            else
+                logger.dprintf(when, name, "done\n");
+            break;
+          case 7:
+            if (i % 100 == 7)
+                logger.dump(when, name, data, sizeof(data));
+            else
+                ccprintf(logger.getOstream(), "%7d: exec %#x\n", when, addr);
+            break;
+        }
+    }
+}
+
+/** The messages as the text logger writes them */
+static string
+textTrace(const vector<string> &names, ObjectMatch &ignore, int count)
+{
+    ostringstream text;
+    Trace::OstreamLogger logger(text);
+    logger.setIgnore(ignore);
+    logMessages(logger, names, count);
+    return text.str();
+}
+
+/** Lets the test hold the lock, like a thread that crashed could */
+class LockableLogger : public Trace::BinaryLogger
+{
+  public:
+    using BinaryLogger::BinaryLogger;
+
+    /**
+     * Lock once the writer thread is idle and submit this thread's
+     * block, which the writer can't pick up until the lock is freed
+     */
+    std::unique_lock<std::mutex>
+    lockAndSubmit()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (writing || !fullBlocks.empty()) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+        ThreadState &ts = threadState();
+        if (ts.block)
+            submit(ts);
+        return lock;
+    }
+};
+
+static const int numMessages = 20000;
+
+int
+main()
+{
+    char dir_template[] = "/tmp/tracebinXXXXXX";
+    const char *dir = mkdtemp(dir_template);
+    EXPECT_TRUE(dir != nullptr);
+    if (!dir)
+        return UnitTest::printResults();
+    string bin_path = string(dir) + "/trace.bin";
+    string ring_path = string(dir) + "/ring.bin";
+    string threads_path = string(dir) + "/threads.bin";
+    string signal_path = string(dir) + "/signal.bin";
+
+    vector<string> names;
+    for (int i = 0; i < 8; i++)
+        names.push_back(csprintf("system.acc%d.spad", i));
+    names.push_back("system.ignored");
+    ObjectMatch ignore("system.ignored");
+    const string text = textTrace(names, ignore, numMessages);
+
+    UnitTest::setCase("Identical output");
+    {
+        Trace::BinaryLogger binary(bin_path);
+        binary.setIgnore(ignore);
+        logMessages(binary, names, numMessages);
+    }
+    EXPECT_FALSE(text.empty());
+    EXPECT_TRUE(text.find("system.ignored") == string::npos);
+    EXPECT_TRUE(decode(bin_path) == text);
+
+    // Small blocks, so long messages and dumps don't fit in one
+    UnitTest::setCase("Small blocks");
+    {
+        Trace::BinaryLogger binary(bin_path, 0, 4096);
+        binary.setIgnore(ignore);
+        logMessages(binary, names, numMessages);
+    }
+    EXPECT_TRUE(decode(bin_path) == text);
+
+    // The ring holds the last 64 KB of messages
+    UnitTest::setCase("Ring");
+    {
+        Trace::BinaryLogger ring(ring_path, 64 * 1024, 4096);
+        ring.setIgnore(ignore);
+        logMessages(ring, names, numMessages);
+    }
+    {
+        string ring_text = decode(ring_path);
+        EXPECT_TRUE(fileSize(ring_path) <=
+                    Trace::BinaryLogger::headerSize + 64 * 1024);
+        EXPECT_FALSE(ring_text.empty());
+        EXPECT_TRUE(ring_text.size() < text.size());
+        EXPECT_TRUE(text.compare(text.size() - ring_text.size(),
+                                 ring_text.size(), ring_text) == 0);
+    }
+
+    UnitTest::setCase("Threads");
+    const int num_threads = 4;
+    const int per_thread = numMessages / 4;
+    {
+        Trace::BinaryLogger binary(threads_path, 0, 4096);
+        vector<thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&binary, t, per_thread]() {
+                string name = csprintf("system.cpu%d", t);
+                for (int i = 0; i < per_thread; i++)
+                    binary.dprintf(i, name, "message %d\n", i);
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+    }
+    {
+        vector<string> lines, expected;
+        istringstream decoded(decode(threads_path));
+        for (string line; getline(decoded, line); )
+            lines.push_back(line);
+        for (int t = 0; t < num_threads; t++) {
+            for (int i = 0; i < per_thread; i++) {
+                expected.push_back(csprintf("%7d: system.cpu%d: message %d",
+                                            i, t, i));
+            }
+        }
+        sort(lines.begin(), lines.end());
+        sort(expected.begin(), expected.end());
+        EXPECT_EQ(lines.size(), expected.size());
+        EXPECT_TRUE(lines == expected);
+    }
+
+    // The submitted block is written without taking the lock, and
+    // the writer thread doesn't write it again
+    UnitTest::setCase("Signal flush");
+    {
+        LockableLogger binary(signal_path, 0, 4096);
+        binary.setIgnore(ignore);
+        logMessages(binary, names, numMessages);
+        string before = decode(signal_path);
+        {
+            auto lock = binary.lockAndSubmit();
+            binary.signalFlush();
+            EXPECT_TRUE(before.size() < text.size());
+            EXPECT_TRUE(decode(signal_path) == text);
+        }
+    }
+    EXPECT_TRUE(decode(signal_path) == text);
+
+    for (auto path : { bin_path, ring_path, threads_path, signal_path }) {
+        unlink(path.c_str());
+        unlink((path + ".dict").c_str());
+    }
+    rmdir(dir);
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <functional>
+#include <list>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "cpu/o3/wakeup_matrix.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+const unsigned numSlots = 128;
+const unsigned numRegs = 256;
+const unsigned width = 8;
+
+struct Inst
+{
+    InstSeqNum seqNum;
+    int srcs[2];
+    int numSrcs;
+    int waiting;
+    int dest;
+};
+
+/** Dependency lists and ready queue, as in the IQ without the matrix. */
+class ListScheduler
+{
+  private:
+    vector<list<int>> dependents;
+    vector<int> freeSlots;
+    priority_queue<pair<InstSeqNum, int>,
+                   vector<pair<InstSeqNum, int>>,
+                   greater<pair<InstSeqNum, int>>> readyQueue;
+
+  public:
+    ListScheduler() : dependents(numRegs)
+    {
+        for (int i = numSlots; i-- > 0; )
+            freeSlots.push_back(i);
+    }
+
+    unsigned numFree() const { return freeSlots.size(); }
+
+    int
+    allocate(InstSeqNum seq)
+    {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    void free(int slot) { freeSlots.push_back(slot); }
+
+    void addDependent(int reg, int slot) { dependents[reg].push_back(slot); }
+    void setReady(int slot, InstSeqNum seq) { readyQueue.emplace(seq, slot); }
+
+    template <class F>
+    void
+    wake(int reg, F f)
+    {
+        while (!dependents[reg].empty()) {
+            f(dependents[reg].front());
+            dependents[reg].pop_front();
+        }
+    }
+
+    int
+    select()
+    {
+        if (readyQueue.empty())
+            return -1;
+        int slot = readyQueue.top().second;
+        readyQueue.pop();
+        return slot;
+    }
+};
+
+/** The same interface on top of the matrix. */
+class MatrixScheduler
+{
+  private:
+    WakeupMatrix matrix;
+
+  public:
+    MatrixScheduler() : matrix(numSlots, numRegs, 1) {}
+
+    unsigned numFree() const { return matrix.numFree(); }
+
+    int allocate(InstSeqNum seq) { return matrix.allocate(seq); }
+    void free(int slot) { matrix.free(slot); }
+    void addDependent(int reg, int slot) { matrix.addDependent(reg, slot); }
+    void setReady(int slot, InstSeqNum seq) { matrix.setReady(slot, 0); }
+
+    template <class F>
+    void wake(int reg, F f) { matrix.wakeDependents(reg, f); }
+
+    int
+    select()
+    {
+        int slot = matrix.selectOldest();
+        if (slot >= 0)
+            matrix.clearReady(slot);
+        return slot;
+    }
+};
+
+/**
+ * Fill the window with instructions reading the results of recent
+ * ones, issue the oldest ready ones every cycle and wake up their
+ * dependents a cycle later. Returns a checksum of the issue order.
+ */
+template <class Scheduler>
+static uint64_t
+run(Scheduler &sched, uint64_t insts)
+{
+    mt19937_64 rng(1234);
+    vector<Inst> slots(numSlots);
+    vector<bool> regReady(numRegs, true);
+    vector<int> writeback, issued;
+    InstSeqNum seq = 0;
+    uint64_t sum = 0;
+    int reg = 0;
+
+    while (seq < insts) {
+        // Write back what issued last cycle
+        for (int slot : writeback) {
+            int dest = slots[slot].dest;
+            regReady[dest] = true;
+            sched.wake(dest, [&](int consumer) {
+                if (--slots[consumer].waiting == 0)
+                    sched.setReady(consumer, slots[consumer].seqNum);
+            });
+            sched.free(slot);
+        }
+        writeback.clear();
+
+        // Issue
+        for (unsigned i = 0; i < width; i++) {
+            int slot = sched.select();
+            if (slot < 0)
+                break;
+            sum = sum * 31 + slots[slot].seqNum;
+            writeback.push_back(slot);
+        }
+
+        // Dispatch
+        for (unsigned i = 0; i < width && sched.numFree(); i++) {
+            int slot = sched.allocate(++seq);
+            Inst &inst = slots[slot];
+            inst.seqNum = seq;
+            inst.numSrcs = rng() % 3;
+            inst.waiting = 0;
+            for (int s = 0; s < inst.numSrcs; s++) {
+                int src = (reg + numRegs - 1 - rng() % 16) % numRegs;
+                // Each source waits once, even if it is read twice
+                if (!regReady[src] && (s == 0 || src != inst.srcs[0])) {
+                    sched.addDependent(src, slot);
+                    ++inst.waiting;
+                }
+                inst.srcs[s] = src;
+            }
+            inst.dest = reg;
+            regReady[reg] = false;
+            reg = (reg + 1) % numRegs;
+            if (inst.waiting == 0)
+                sched.setReady(slot, seq);
+        }
+    }
+    return sum;
+}
+
+int
+main()
+{
+    const uint64_t insts = 200000;
+
+    UnitTest::setCase("Selecting the oldest");
+    {
+        WakeupMatrix m(70, 8, 2);
+        EXPECT_EQ(m.numFree(), 70);
+        EXPECT_EQ(m.selectOldest(), -1);
+
+        // Fill past the first word, then make room for an instruction
+        // of another thread that is older than most of the others
+        vector<int> slots;
+        for (int i = 0; i < 70; i++)
+            slots.push_back(m.allocate(100 + i));
+        m.free(slots[5]);
+        int old_slot = m.allocate(50);
+        EXPECT_EQ(old_slot, slots[5]);
+
+        m.setReady(slots[69], 0);
+        m.setReady(slots[3], 1);
+        EXPECT_TRUE(m.anyReady());
+        EXPECT_EQ(m.selectOldest(), slots[3]);
+        m.setReady(old_slot, 0);
+        EXPECT_EQ(m.selectOldest(), old_slot);
+
+        // A blocked op class is skipped until the next select
+        m.unblockAll();
+        m.block(0);
+        EXPECT_EQ(m.selectOldest(), slots[3]);
+        m.clearReady(slots[3]);
+        EXPECT_EQ(m.selectOldest(), -1);
+        m.unblockAll();
+        EXPECT_EQ(m.selectOldest(), old_slot);
+
+        m.free(old_slot);
+        EXPECT_EQ(m.selectOldest(), slots[69]);
+        m.free(slots[69]);
+        EXPECT_FALSE(m.anyReady());
+    }
+
+    UnitTest::setCase("Waking dependents");
+    {
+        WakeupMatrix m(100, 8, 1);
+        int a = m.allocate(1);
+        for (int i = 0; i < 80; i++)
+            m.allocate(2 + i);
+        int b = m.allocate(100);
+        EXPECT_TRUE(m.empty());
+        m.addDependent(3, b);
+        m.addDependent(3, a);
+        m.addDependent(4, a);
+        EXPECT_TRUE(m.hasDependents(3));
+        EXPECT_FALSE(m.hasDependents(5));
+
+        vector<int> woken;
+        EXPECT_EQ(m.wakeDependents(3, [&](int s) { woken.push_back(s); }),
+                  2);
+        EXPECT_EQ(woken.size(), 2);
+        EXPECT_EQ(woken[0], a);
+        EXPECT_EQ(woken[1], b);
+        EXPECT_FALSE(m.hasDependents(3));
+
+        // Squashed instructions stop waiting
+        m.removeDependent(4, a);
+        EXPECT_TRUE(m.empty());
+    }
+
+    UnitTest::setCase("Matches dependency lists");
+    {
+        ListScheduler lists;
+        MatrixScheduler matrix;
+        EXPECT_EQ(run(lists, insts), run(matrix, insts));
+    }
+
+    return UnitTest::printResults();
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compares the WakeupMatrix of the O3 IQ with per register dependency
+ * lists and an age ordered ready queue on a synthetic instruction
+ * window. Prints the host time of both. The number of instructions in
+ * millions can be given as the first argument.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "cpu/o3/wakeup_matrix.hh"
+
+using namespace std;
+
+static double
+secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() -
+                                    start).count();
+}
+
+const unsigned numSlots = 128;
+const unsigned numRegs = 256;
+const unsigned width = 8;
+
+struct Inst
+{
+    InstSeqNum seqNum;
+    int srcs[2];
+    int numSrcs;
+    int waiting;
+    int dest;
+};
+
+/** Dependency lists and ready queue, as in the IQ without the matrix. */
+class ListScheduler
+{
+  private:
+    vector<list<int>> dependents;
+    vector<int> freeSlots;
+    priority_queue<pair<InstSeqNum, int>,
+                   vector<pair<InstSeqNum, int>>,
+                   greater<pair<InstSeqNum, int>>> readyQueue;
+
+  public:
+    ListScheduler() : dependents(numRegs)
+    {
+        for (int i = numSlots; i-- > 0; )
+            freeSlots.push_back(i);
+    }
+
+    unsigned numFree() const { return freeSlots.size(); }
+
+    int
+    allocate(InstSeqNum seq)
+    {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    void free(int slot) { freeSlots.push_back(slot); }
+
+    void addDependent(int reg, int slot) { dependents[reg].push_back(slot); }
+    void setReady(int slot, InstSeqNum seq) { readyQueue.emplace(seq, slot); }
+
+    template <class F>
+    void
+    wake(int reg, F f)
+    {
+        while (!dependents[reg].empty()) {
+            f(dependents[reg].front());
+            dependents[reg].pop_front();
+        }
+    }
+
+    int
+    select()
+    {
+        if (readyQueue.empty())
+            return -1;
+        int slot = readyQueue.top().second;
+        readyQueue.pop();
+        return slot;
+    }
+};
+
+/** The same interface on top of the matrix. */
+class MatrixScheduler
+{
+  private:
+    WakeupMatrix matrix;
+
+  public:
+    MatrixScheduler() : matrix(numSlots, numRegs, 1) {}
+
+    unsigned numFree() const { return matrix.numFree(); }
+
+    int allocate(InstSeqNum seq) { return matrix.allocate(seq); }
+    void free(int slot) { matrix.free(slot); }
+    void addDependent(int reg, int slot) { matrix.addDependent(reg, slot); }
+    void setReady(int slot, InstSeqNum seq) { matrix.setReady(slot, 0); }
+
+    template <class F>
+    void wake(int reg, F f) { matrix.wakeDependents(reg, f); }
+
+    int
+    select()
+    {
+        int slot = matrix.selectOldest();
+        if (slot >= 0)
+            matrix.clearReady(slot);
+        return slot;
+    }
+};
+
+/**
+ * Fill the window with instructions reading the results of recent
+ * ones, issue the oldest ready ones every cycle and wake up their
+ * dependents a cycle later. Returns a checksum of the issue order.
+ */
+template <class Scheduler>
+static uint64_t
+run(Scheduler &sched, uint64_t insts)
+{
+    mt19937_64 rng(1234);
+    vector<Inst> slots(numSlots);
+    vector<bool> regReady(numRegs, true);
+    vector<int> writeback, issued;
+    InstSeqNum seq = 0;
+    uint64_t sum = 0;
+    int reg = 0;
+
+    while (seq < insts) {
+        // Write back what issued last cycle
+        for (int slot : writeback) {
+            int dest = slots[slot].dest;
+            regReady[dest] = true;
+            sched.wake(dest, [&](int consumer) {
+                if (--slots[consumer].waiting == 0)
+                    sched.setReady(consumer, slots[consumer].seqNum);
+            });
+            sched.free(slot);
+        }
+        writeback.clear();
+
+        // Issue
+        for (unsigned i = 0; i < width; i++) {
+            int slot = sched.select();
+            if (slot < 0)
+                break;
+            sum = sum * 31 + slots[slot].seqNum;
+            writeback.push_back(slot);
+        }
+
+        // Dispatch
+        for (unsigned i = 0; i < width && sched.numFree(); i++) {
+            int slot = sched.allocate(++seq);
+            Inst &inst = slots[slot];
+            inst.seqNum = seq;
+            inst.numSrcs = rng() % 3;
+            inst.waiting = 0;
+            for (int s = 0; s < inst.numSrcs; s++) {
+                int src = (reg + numRegs - 1 - rng() % 16) % numRegs;
+                // Each source waits once, even if it is read twice
+                if (!regReady[src] && (s == 0 || src != inst.srcs[0])) {
+                    sched.addDependent(src, slot);
+                    ++inst.waiting;
+                }
+                inst.srcs[s] = src;
+            }
+            inst.dest = reg;
+            regReady[reg] = false;
+            reg = (reg + 1) % numRegs;
+            if (inst.waiting == 0)
+                sched.setReady(slot, seq);
+        }
+    }
+    return sum;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t insts = (argc > 1 ? atoi(argv[1]) : 10) * 1000000ULL;
+
+    ListScheduler lists;
+    auto start = chrono::steady_clock::now();
+    uint64_t list_sum = run(lists, insts);
+    double list_secs = secondsSince(start);
+
+    MatrixScheduler matrix;
+    start = chrono::steady_clock::now();
+    uint64_t matrix_sum = run(matrix, insts);
+    double matrix_secs = secondsSince(start);
+
+    if (list_sum != matrix_sum) {
+        cprintf("WakeupMatrix issued in a different order\n");
+        return 1;
+    }
+
+    cprintf("%d M instructions, %d entry window: lists %.3fs, "
+            "WakeupMatrix %.3fs (%.2fx)\n", insts / 1000000, numSlots,
+            list_secs, matrix_secs, list_secs / matrix_secs);
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <random>
+#include <set>
+
+#include "mem/ruby/common/WakeupSet.hh"
+#include "unittest/unittest.hh"
+
+using namespace std;
+
+static const Tick period = 500;
+
+int
+main()
+{
+    UnitTest::setCase("Wakeups on clock edges");
+    {
+        WakeupSet wakeups;
+        wakeups.advance(0, period);
+        wakeups.insert(0);
+        wakeups.insert(3 * period);
+        EXPECT_TRUE(wakeups.contains(0));
+        EXPECT_TRUE(wakeups.contains(3 * period));
+        EXPECT_FALSE(wakeups.contains(2 * period));
+        EXPECT_EQ(wakeups.size(), 2);
+    }
+
+    UnitTest::setCase("Wakeups beyond the horizon or off the edge");
+    {
+        WakeupSet wakeups;
+        wakeups.advance(0, period);
+        Tick far = (WakeupSet::horizonCycles + 10) * period;
+        wakeups.insert(far);
+        wakeups.insert(period + 1);
+        EXPECT_TRUE(wakeups.contains(far));
+        EXPECT_TRUE(wakeups.contains(period + 1));
+        EXPECT_FALSE(wakeups.contains(period));
+        EXPECT_EQ(wakeups.size(), 2);
+
+        // the far wakeup moves into the window and stays recorded
+        wakeups.advance(20 * period, period);
+        EXPECT_TRUE(wakeups.contains(far));
+        EXPECT_FALSE(wakeups.contains(period + 1));
+        EXPECT_EQ(wakeups.size(), 1);
+    }
+
+    UnitTest::setCase("Advancing retires past wakeups");
+    {
+        WakeupSet wakeups;
+        wakeups.advance(0, period);
+        for (Tick c = 0; c < 8; c++)
+            wakeups.insert(c * period);
+        wakeups.advance(5 * period, period);
+        EXPECT_FALSE(wakeups.contains(4 * period));
+        EXPECT_TRUE(wakeups.contains(5 * period));
+        EXPECT_TRUE(wakeups.contains(7 * period));
+        EXPECT_EQ(wakeups.size(), 3);
+
+        // a jump past the whole window clears it
+        wakeups.advance(1000 * period, period);
+        EXPECT_EQ(wakeups.size(), 0);
+    }
+
+    UnitTest::setCase("Clock period change");
+    {
+        WakeupSet wakeups;
+        wakeups.advance(0, period);
+        wakeups.insert(4 * period);
+        wakeups.insert(6 * period);
+        wakeups.advance(5 * period, period / 2);
+        EXPECT_FALSE(wakeups.contains(4 * period));
+        EXPECT_TRUE(wakeups.contains(6 * period));
+        wakeups.insert(5 * period + period / 2);
+        EXPECT_TRUE(wakeups.contains(5 * period + period / 2));
+        EXPECT_EQ(wakeups.size(), 2);
+    }
+
+    UnitTest::setCase("WakeupSet matches std::set");
+    {
+        // the wakeup pattern of a Ruby Consumer: mostly the next few
+        // edges, some far away and a few off the clock edge
+        mt19937 rng(1234);
+        uniform_int_distribution<int> count(0, 4);
+        uniform_int_distribution<int> near(0, 8);
+        uniform_int_distribution<int> far(0, 2000);
+        uniform_int_distribution<int> kind(0, 99);
+
+        set<Tick> ref;
+        WakeupSet wakeups;
+        bool same = true;
+        for (int c = 0; c < 20000; c++) {
+            Tick edge = c * period;
+            for (int n = count(rng); n > 0; n--) {
+                int k = kind(rng);
+                Tick t = edge;
+                if (k < 90)
+                    t += near(rng) * period;
+                else if (k < 98)
+                    t += far(rng) * period;
+                else
+                    t += near(rng) * period + 1 + k;
+
+                bool hit = ref.find(t) != ref.end();
+                same &= wakeups.contains(t) == hit;
+                if (!hit) {
+                    ref.insert(t);
+                    wakeups.insert(t);
+                }
+                ref.erase(ref.begin(), ref.lower_bound(edge));
+                wakeups.advance(edge, period);
+            }
+        }
+        EXPECT_TRUE(same);
+        EXPECT_EQ(wakeups.size(), ref.size());
+    }
+
+    return UnitTest::printResults();
+}
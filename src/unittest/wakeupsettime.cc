@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018 Harvard University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Replays the wakeup pattern of a Ruby Consumer against both the
+ * WakeupSet used by Consumer and the std::set it replaced, checks that
+ * both report the same redundant wakeups and prints the host time
+ * spent in each.
+ */
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "mem/ruby/common/WakeupSet.hh"
+
+using namespace std;
+
+static const Tick period = 500;
+static const int cycles = 2000000;
+
+/** Generate the tick offsets a consumer schedules in one cycle. */
+static vector<vector<Tick>>
+makeTrace()
+{
+    mt19937 rng(1234);
+    uniform_int_distribution<int> count(0, 4);
+    uniform_int_distribution<int> near(0, 8);
+    uniform_int_distribution<int> far(0, 2000);
+    uniform_int_distribution<int> kind(0, 99);
+
+    vector<vector<Tick>> trace(cycles);
+    for (auto &events : trace) {
+        int n = count(rng);
+        for (int i = 0; i < n; i++) {
+            int k = kind(rng);
+            if (k < 90)
+                events.push_back(near(rng) * period);
+            else if (k < 98)
+                events.push_back(far(rng) * period);
+            else
+                events.push_back(near(rng) * period + 1 + k);
+        }
+    }
+    return trace;
+}
+
+int
+main()
+{
+    vector<vector<Tick>> trace = makeTrace();
+    vector<bool> ref_hits, new_hits;
+
+    auto start = chrono::steady_clock::now();
+    {
+        set<Tick> wakeups;
+        for (int c = 0; c < cycles; c++) {
+            Tick edge = c * period;
+            for (Tick offset : trace[c]) {
+                Tick t = edge + offset;
+                bool hit = wakeups.find(t) != wakeups.end();
+                if (!hit)
+                    wakeups.insert(t);
+                ref_hits.push_back(hit);
+                wakeups.erase(wakeups.begin(), wakeups.lower_bound(edge));
+            }
+        }
+    }
+    double ref_secs = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    {
+        WakeupSet wakeups;
+        for (int c = 0; c < cycles; c++) {
+            Tick edge = c * period;
+            for (Tick offset : trace[c]) {
+                Tick t = edge + offset;
+                bool hit = wakeups.contains(t);
+                if (!hit)
+                    wakeups.insert(t);
+                new_hits.push_back(hit);
+                wakeups.advance(edge, period);
+            }
+        }
+    }
+    double new_secs = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+
+    if (ref_hits != new_hits) {
+        cprintf("WakeupSet and std::set disagree\n");
+        return 1;
+    }
+
+    cprintf("std::set:  %d wakeups in %.3fs\n", ref_hits.size(), ref_secs);
+    cprintf("WakeupSet: %d wakeups in %.3fs (%.2fx)\n", new_hits.size(),
+            new_secs, ref_secs / new_secs);
+
+    return 0;
+}
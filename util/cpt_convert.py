@@ -0,0 +1,305 @@
+#!/usr/bin/env python2
+
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script converts gem5 checkpoints between the ini format of m5.cpt
+# and the binary format of m5.cpt.bin (see src/base/binary_ini.hh).
+#
+# gem5 writes the binary form next to m5.cpt when run with
+# --binary-checkpoints, and restores from it whenever it is at least
+# as recent as m5.cpt. Checkpoints written without that option can be
+# converted with:
+#
+#   cpt_convert.py [-r] <m5.cpt or checkpoint directory>
+#
+# Tools such as cpt_upgrader.py only work on the ini form. Since the
+# binary form is ignored once m5.cpt is newer, upgrading a checkpoint
+# only needs it to be converted again. A checkpoint whose m5.cpt was
+# lost can be turned back into an ini file with --to-ini.
+
+from __future__ import print_function
+
+import mmap
+import os
+import os.path as osp
+import struct
+import sys
+
+MAGIC = b'GEM5INIB'
+VERSION = 1
+BYTE_ORDER_MARK = 0x01020304
+
+TEXT, INT64, UINT64 = 0, 1, 2
+
+# magic, version, byte order, sections, index offset, hash table
+# offset, hash buckets
+FILE_HEADER = struct.Struct('=8sIIQQQQ')
+# name length, entries
+SECTION_HEADER = struct.Struct('=II')
+# name length, value type, value length in bytes or words
+ENTRY_HEADER = struct.Struct('=IB3xQ')
+
+MAX_INT64 = (1 << 63) - 1
+MAX_UINT64 = (1 << 64) - 1
+
+verbose_print = False
+
+def verboseprint(*args):
+    if verbose_print:
+        print(*args)
+
+def align(size):
+    return (size + 7) & ~7
+
+def padding(size):
+    return b'\0' * (align(size) - size)
+
+def hash_name(name):
+    """FNV-1a, as used for the section hash table"""
+    h = 0xcbf29ce484222325
+    for c in bytearray(name):
+        h = ((h ^ c) * 0x100000001b3) & MAX_UINT64
+    return h
+
+def parse_ints(value):
+    """Return (words, signed) if value is a list of canonical decimal
+    integers that gem5 stores as such, or None"""
+    if not value:
+        return None
+    words = []
+    signed = False
+    largest = 0
+    for token in value.split(b' '):
+        negative = token.startswith(b'-')
+        digits = token[1:] if negative else token
+        if not digits.isdigit() or \
+           (digits.startswith(b'0') and (len(digits) > 1 or negative)):
+            return None
+        magnitude = int(digits)
+        if negative:
+            if magnitude > MAX_INT64 + 1:
+                return None
+            signed = True
+            words.append((-magnitude) & MAX_UINT64)
+        else:
+            if magnitude > MAX_UINT64:
+                return None
+            largest = max(largest, magnitude)
+            words.append(magnitude)
+    if signed and largest > MAX_INT64:
+        return None
+    return words, signed
+
+def read_ini(path):
+    """Parse an ini file the way gem5's IniFile does"""
+    sections = {}
+    section = None
+    with open(path, 'rb') as f:
+        for line in f:
+            line = line.lstrip().rstrip(b'\n').rstrip(b' ')
+            if not line:
+                continue
+            if line.startswith(b'[') and line.endswith(b']'):
+                section = sections.setdefault(line[1:-1].strip(b' '), {})
+                continue
+            if section is None:
+                continue
+            offset = line.find(b'=')
+            if offset < 0:
+                raise ValueError("Can't parse .ini line %r" % line)
+            append = offset > 0 and line[offset - 1:offset] == b'+'
+            name = line[:offset - 1 if append else offset].strip(b' ')
+            value = line[offset + 1:].strip(b' ')
+            if append and name in section:
+                section[name] += b' ' + value
+            else:
+                section[name] = value
+    return sections
+
+def write_binary(sections, path):
+    out = open(path, 'wb')
+    names = sorted(sections)
+    out.write(FILE_HEADER.pack(MAGIC, VERSION, BYTE_ORDER_MARK, len(names),
+                               0, 0, 0))
+    pos = FILE_HEADER.size
+
+    offsets = []
+    for name in names:
+        offsets.append(pos)
+        entries = sections[name]
+        entry_names = sorted(entries)
+
+        encoded = []
+        entry_pos = pos + SECTION_HEADER.size + align(len(name)) + \
+            8 * len(entry_names)
+        entry_offsets = []
+        for entry in entry_names:
+            value = entries[entry]
+            ints = parse_ints(value)
+            if ints is None:
+                data = value
+                header = ENTRY_HEADER.pack(len(entry), TEXT, len(value))
+            else:
+                words, signed = ints
+                data = struct.pack('=%dQ' % len(words), *words)
+                header = ENTRY_HEADER.pack(len(entry),
+                                           INT64 if signed else UINT64,
+                                           len(words))
+            record = header + entry + padding(len(entry)) + \
+                data + padding(len(data))
+            entry_offsets.append(entry_pos)
+            entry_pos += len(record)
+            encoded.append(record)
+
+        out.write(SECTION_HEADER.pack(len(name), len(entry_names)))
+        out.write(name + padding(len(name)))
+        out.write(struct.pack('=%dQ' % len(entry_offsets), *entry_offsets))
+        for record in encoded:
+            out.write(record)
+        pos = entry_pos
+
+    index_offset = pos
+    out.write(struct.pack('=%dQ' % len(offsets), *offsets))
+    pos += 8 * len(offsets)
+
+    buckets = 1
+    while buckets < 2 * len(names) + 1:
+        buckets *= 2
+    table = [0] * buckets
+    for name, offset in zip(names, offsets):
+        bucket = hash_name(name) & (buckets - 1)
+        while table[bucket]:
+            bucket = (bucket + 1) & (buckets - 1)
+        table[bucket] = offset
+    out.write(struct.pack('=%dQ' % buckets, *table))
+
+    out.seek(0)
+    out.write(FILE_HEADER.pack(MAGIC, VERSION, BYTE_ORDER_MARK, len(names),
+                               index_offset, pos, buckets))
+    out.close()
+
+def read_binary(path):
+    with open(path, 'rb') as f:
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    magic, version, order, num_sections, index_offset, _, _ = \
+        FILE_HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("%s is not a binary checkpoint" % path)
+    if order != BYTE_ORDER_MARK:
+        raise ValueError("%s was written on a host of different endianness"
+                         % path)
+
+    sections = []
+    offsets = struct.unpack_from('=%dQ' % num_sections, data, index_offset)
+    for offset in offsets:
+        name_len, num_entries = SECTION_HEADER.unpack_from(data, offset)
+        pos = offset + SECTION_HEADER.size
+        name = data[pos:pos + name_len]
+        pos += align(name_len)
+        entry_offsets = struct.unpack_from('=%dQ' % num_entries, data, pos)
+
+        entries = []
+        for entry_offset in entry_offsets:
+            name_len, kind, count = ENTRY_HEADER.unpack_from(data,
+                                                             entry_offset)
+            pos = entry_offset + ENTRY_HEADER.size
+            entry = data[pos:pos + name_len]
+            pos += align(name_len)
+            if kind == TEXT:
+                value = data[pos:pos + count]
+            else:
+                fmt = '=%d%s' % (count, 'q' if kind == INT64 else 'Q')
+                words = struct.unpack_from(fmt, data, pos)
+                value = b' '.join(str(w).encode() for w in words)
+            entries.append((entry, value))
+        sections.append((name, entries))
+
+    data.close()
+    return sections
+
+def write_ini(sections, path):
+    with open(path, 'wb') as out:
+        out.write(b'## checkpoint converted from binary\n')
+        for name, entries in sections:
+            out.write(b'\n[' + name + b']\n')
+            for entry, value in entries:
+                out.write(entry + b'=' + value + b'\n')
+
+def process_dir(path, to_ini=False, **kwargs):
+    ini_path = osp.join(path, 'm5.cpt')
+    bin_path = osp.join(path, 'm5.cpt.bin')
+    if to_ini:
+        if osp.isfile(ini_path):
+            os.rename(ini_path, ini_path + '.bak')
+        write_ini(read_binary(bin_path), ini_path)
+        # gem5 only uses the binary form if it is at least as recent
+        os.utime(bin_path, None)
+        verboseprint("Wrote", ini_path)
+    else:
+        write_binary(read_ini(ini_path), bin_path)
+        verboseprint("Wrote", bin_path)
+
+if __name__ == '__main__':
+    from optparse import OptionParser
+    parser = OptionParser("usage: %prog [options] <filename or directory>")
+    parser.add_option("-r", "--recurse", action="store_true",
+                      help="Recurse through all subdirectories converting "\
+                           "each checkpoint that is found")
+    parser.add_option("--to-ini", action="store_true", default=False,
+                      help="Convert m5.cpt.bin back into m5.cpt, keeping "\
+                           "any existing m5.cpt as m5.cpt.bak")
+    parser.add_option("-v", "--verbose", action="store_true",
+                      help="Print out each file written")
+
+    (options, args) = parser.parse_args()
+    verbose_print = options.verbose
+
+    if len(args) != 1:
+        parser.error("You must specify a checkpoint file to convert or a "\
+                     "directory of checkpoints to recursively convert")
+
+    # Deal with shell variables and ~
+    path = osp.expandvars(osp.expanduser(args[0]))
+    source = 'm5.cpt.bin' if options.to_ini else 'm5.cpt'
+
+    if osp.isfile(path):
+        process_dir(osp.dirname(path) or '.', options.to_ini)
+    elif osp.isdir(path):
+        if options.recurse:
+            for root, dirs, files in os.walk(path):
+                if source in files:
+                    process_dir(root, options.to_ini)
+        elif osp.isfile(osp.join(path, source)):
+            process_dir(path, options.to_ini)
+        else:
+            print("Error: %s not found in %s and recurse not specified" %
+                  (source, path))
+            sys.exit(1)
+    else:
+        print("Error: %s is neither a file nor a directory" % path)
+        sys.exit(1)
@@ -55,6 +55,8 @@
  *          -o gem5cxx.opt -Lbuild/ARM -lgem5_opt
  */
 
+#include <sys/stat.h>
+
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
@@ -78,7 +80,8 @@ void
 usage(const std::string &prog_name)
 {
     std::cerr << "Usage: " << prog_name << (
-        " <config-file.ini> [ <option> ]\n\n"
+        " ( <config-file.ini> | <cache-dir> <config-hash> )"
+        " [ <option> ]\n\n"
         "OPTIONS:\n"
         "    -p <object> <param> <value>  -- set a parameter\n"
         "    -v <object> <param> <values> -- set a vector parameter from"
@@ -124,9 +127,21 @@ main(int argc, char **argv)
 
     const std::string config_file(argv[arg_ptr]);
 
-    CxxConfigFileBase *conf = new CxxIniFile();
-
-    if (!conf->load(config_file.c_str())) {
+    CxxIniFile *conf = new CxxIniFile();
+
+    // A directory is an elaboration cache written by --elab-cache,
+    // followed by the hash of the config to load from it
+    struct stat config_stat;
+    if (stat(config_file.c_str(), &config_stat) == 0 &&
+        S_ISDIR(config_stat.st_mode)) {
+        if (++arg_ptr >= argc)
+            usage(prog_name);
+        if (!conf->loadCached(config_file, argv[arg_ptr])) {
+            std::cerr << "Can't find config " << argv[arg_ptr] <<
+                " in cache: " << config_file << '\n';
+            return EXIT_FAILURE;
+        }
+    } else if (!conf->load(config_file.c_str())) {
         std::cerr << "Can't open config file: " << config_file << '\n';
         return EXIT_FAILURE;
     }
@@ -0,0 +1,48 @@
+#!/usr/bin/env python2
+
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Decode a binary debug trace written with --debug-binary or
+# --debug-ring into the text gem5 would have written with the same
+# debug flags. The decoder is part of gem5, so run this script with the
+# gem5 binary the trace was written by:
+#
+#   gem5.opt util/decode_debug_trace.py m5out/trace.bin [trace.txt]
+#
+# The dictionary of names and format strings is read from
+# <trace>.dict. Without an output file the text is written to stdout.
+
+import sys
+
+from m5 import trace
+
+if len(sys.argv) not in (2, 3):
+    print >>sys.stderr, \
+        "Usage: gem5.opt %s <binary trace> [text output]" % sys.argv[0]
+    sys.exit(1)
+
+trace.decodeBinary(sys.argv[1], sys.argv[2] if len(sys.argv) == 3 else "cout")
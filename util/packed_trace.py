@@ -0,0 +1,361 @@
+#!/usr/bin/env python2
+
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script converts packet traces and elastic instruction dependency
+# traces between the protobuf format written by gem5 and the packed
+# format of src/proto/packed_trace.hh, which TraceCPU and TrafficGen
+# also read. Packed traces store the records in fixed width columns, a
+# batch at a time, and can optionally compress the batches with zlib.
+#
+# Usage:
+#   packed_trace.py pack [--zlib] [--batch N] <protobuf trace> <packed trace>
+#   packed_trace.py unpack <packed trace> <protobuf trace>
+#   packed_trace.py info <packed trace>
+#
+# Protobuf traces are gzipped when their name ends in .gz.
+
+from __future__ import print_function
+
+import gzip
+import optparse
+import os
+import protolib
+import struct
+import subprocess
+import sys
+import zlib
+
+util_dir = os.path.dirname(os.path.realpath(__file__))
+# Make sure the proto definitions are up to date.
+subprocess.check_call(['make', '--quiet', '-C', util_dir, 'packet_pb2.py',
+                       'inst_dep_record_pb2.py'])
+sys.path.insert(0, util_dir)
+import inst_dep_record_pb2
+import packet_pb2
+
+MAGIC = b'gem5ptrc'
+VERSION = 1
+BYTE_ORDER_MARK = 0x01020304
+
+PACKET_TRACE = 1
+INST_DEP_TRACE = 2
+
+NO_COMPRESSION = 0
+ZLIB = 1
+
+# Layout of PackedTrace::FileHeader and PackedTrace::BatchHeader
+FILE_HEADER = struct.Struct('<8sIIIIQIIII')
+BATCH_HEADER = struct.Struct('<IIQQ')
+
+# Columns of each kind of batch as (field, struct format), in file order.
+# The dependencies of instruction records follow their columns.
+PACKET_COLUMNS = [('tick', 'Q'), ('addr', 'Q'), ('pc', 'Q'),
+                  ('pkt_id', 'Q'), ('cmd', 'I'), ('size', 'I'),
+                  ('flags', 'I'), ('present', 'B')]
+INST_DEP_COLUMNS = [('seq_num', 'Q'), ('comp_delay', 'Q'), ('p_addr', 'Q'),
+                    ('v_addr', 'Q'), ('pc', 'Q'), ('size', 'I'),
+                    ('flags', 'I'), ('asid', 'I'), ('weight', 'I'),
+                    ('type', 'B'), ('num_rob_dep', 'B'),
+                    ('num_reg_dep', 'B'), ('present', 'B')]
+
+# Optional fields of each kind, in the order of their bits in 'present'
+PACKET_OPTIONAL = ['flags', 'pkt_id', 'pc']
+INST_DEP_OPTIONAL = ['p_addr', 'size', 'flags', 'weight', 'pc', 'v_addr',
+                     'asid']
+
+def pad8(n):
+    return (n + 7) & ~7
+
+def columns(kind):
+    return PACKET_COLUMNS if kind == PACKET_TRACE else INST_DEP_COLUMNS
+
+def optional(kind):
+    return PACKET_OPTIONAL if kind == PACKET_TRACE else INST_DEP_OPTIONAL
+
+def openProtoWr(filename):
+    if filename.endswith('.gz'):
+        return gzip.open(filename, 'wb')
+    return open(filename, 'wb')
+
+def readProtoHeader(proto_in):
+    """Read a protobuf trace header and tell which kind of trace it is"""
+    if proto_in.read(4) != b'gem5':
+        raise ValueError("not a protobuf trace")
+    size, pos = protolib._DecodeVarint32(proto_in)
+    buf = proto_in.read(size)
+    # Only instruction trace headers have a window size. Field 4 holds
+    # the id strings in packet trace headers, with a different wire
+    # type, so the parser keeps those as unknown fields.
+    header = inst_dep_record_pb2.InstDepRecordHeader()
+    header.ParseFromString(buf)
+    if header.HasField('window_size'):
+        return INST_DEP_TRACE, header
+    header = packet_pb2.PacketHeader()
+    header.ParseFromString(buf)
+    return PACKET_TRACE, header
+
+class PackedWriter(object):
+    def __init__(self, filename, kind, header, compress, batch_records):
+        self.out = open(filename, 'wb')
+        self.kind = kind
+        self.compress = compress
+        self.batch_records = batch_records
+        self.records = []
+
+        extra = self._string(header.obj_id)
+        id_strings = getattr(header, 'id_strings', [])
+        extra += struct.pack('<I', len(id_strings))
+        for id_string in id_strings:
+            extra += struct.pack('<I', id_string.key)
+            extra += self._string(id_string.value)
+
+        window_size = getattr(header, 'window_size', 0)
+        self.out.write(FILE_HEADER.pack(
+            MAGIC, VERSION, BYTE_ORDER_MARK, kind,
+            ZLIB if compress else NO_COMPRESSION, header.tick_freq,
+            header.ver, window_size, len(extra), 0))
+        self.out.write(extra + b'\0' * (pad8(len(extra)) - len(extra)))
+
+    @staticmethod
+    def _string(s):
+        data = s.encode('utf-8') if not isinstance(s, bytes) else s
+        return struct.pack('<I', len(data)) + data
+
+    def write(self, msg):
+        """Add a protobuf record"""
+        rec = {}
+        present = 0
+        for bit, field in enumerate(optional(self.kind)):
+            if msg.HasField(field):
+                present |= 1 << bit
+        for field, fmt in columns(self.kind):
+            if field == 'present':
+                rec[field] = present
+            elif field == 'num_rob_dep':
+                rec[field] = len(msg.rob_dep)
+            elif field == 'num_reg_dep':
+                rec[field] = len(msg.reg_dep)
+            else:
+                rec[field] = getattr(msg, field)
+        if self.kind == INST_DEP_TRACE:
+            rec['deps'] = list(msg.rob_dep) + list(msg.reg_dep)
+        self.records.append(rec)
+        if len(self.records) == self.batch_records:
+            self.flush()
+
+    def flush(self):
+        if not self.records:
+            return
+        n = len(self.records)
+        data = b''
+        for field, fmt in columns(self.kind):
+            col = struct.pack('<%d%s' % (n, fmt),
+                              *[r[field] for r in self.records])
+            data += col + b'\0' * (pad8(len(col)) - len(col))
+        num_deps = 0
+        if self.kind == INST_DEP_TRACE:
+            deps = [d for r in self.records for d in r['deps']]
+            num_deps = len(deps)
+            data += struct.pack('<%dQ' % num_deps, *deps)
+
+        stored = zlib.compress(data) if self.compress else data
+        self.out.write(BATCH_HEADER.pack(n, num_deps, len(data),
+                                         len(stored)))
+        self.out.write(stored + b'\0' * (pad8(len(stored)) - len(stored)))
+        self.records = []
+
+    def close(self):
+        self.flush()
+        self.out.close()
+
+class PackedReader(object):
+    def __init__(self, filename):
+        with open(filename, 'rb') as f:
+            self.data = f.read()
+        (magic, version, bom, self.kind, self.compression, self.tick_freq,
+         self.ver, self.window_size, extra_bytes, _) = \
+            FILE_HEADER.unpack_from(self.data, 0)
+        if magic != MAGIC:
+            raise ValueError("%s is not a packed trace" % filename)
+        if bom != BYTE_ORDER_MARK or version != VERSION:
+            raise ValueError("%s has an unsupported layout" % filename)
+
+        pos = FILE_HEADER.size
+        self.obj_id, pos = self._string(pos)
+        count, = struct.unpack_from('<I', self.data, pos)
+        pos += 4
+        self.id_strings = []
+        for i in range(count):
+            key, = struct.unpack_from('<I', self.data, pos)
+            value, pos = self._string(pos + 4)
+            self.id_strings.append((key, value))
+        self.first_batch = FILE_HEADER.size + pad8(extra_bytes)
+
+    def _string(self, pos):
+        length, = struct.unpack_from('<I', self.data, pos)
+        pos += 4
+        return self.data[pos:pos + length].decode('utf-8'), pos + length
+
+    def batches(self):
+        """Yield the columns of each batch as a dict of lists"""
+        pos = self.first_batch
+        while pos < len(self.data):
+            n, num_deps, raw_bytes, stored_bytes = \
+                BATCH_HEADER.unpack_from(self.data, pos)
+            pos += BATCH_HEADER.size
+            data = self.data[pos:pos + stored_bytes]
+            if self.compression == ZLIB:
+                data = zlib.decompress(data)
+            if len(data) != raw_bytes:
+                raise ValueError("bad batch in packed trace")
+            pos += pad8(stored_bytes)
+
+            cols = {}
+            col_pos = 0
+            for field, fmt in columns(self.kind):
+                cols[field] = struct.unpack_from('<%d%s' % (n, fmt), data,
+                                                 col_pos)
+                col_pos += pad8(n * struct.calcsize(fmt))
+            cols['deps'] = struct.unpack_from('<%dQ' % num_deps, data,
+                                              col_pos)
+            yield n, cols
+
+    def records(self):
+        """Yield every record as a protobuf message"""
+        fields = [f for f, fmt in columns(self.kind)]
+        opt = optional(self.kind)
+        for n, cols in self.batches():
+            dep = 0
+            for i in range(n):
+                if self.kind == PACKET_TRACE:
+                    msg = packet_pb2.Packet()
+                else:
+                    msg = inst_dep_record_pb2.InstDepRecord()
+                present = cols['present'][i]
+                for field in fields:
+                    if field in ('present', 'num_rob_dep', 'num_reg_dep'):
+                        continue
+                    if field in opt and \
+                       not present & (1 << opt.index(field)):
+                        continue
+                    setattr(msg, field, cols[field][i])
+                if self.kind == INST_DEP_TRACE:
+                    num_rob = cols['num_rob_dep'][i]
+                    num_reg = cols['num_reg_dep'][i]
+                    msg.rob_dep.extend(cols['deps'][dep:dep + num_rob])
+                    dep += num_rob
+                    msg.reg_dep.extend(cols['deps'][dep:dep + num_reg])
+                    dep += num_reg
+                yield msg
+
+def pack(options, proto_file, packed_file):
+    proto_in = protolib.openFileRd(proto_file)
+    kind, header = readProtoHeader(proto_in)
+    if kind == PACKET_TRACE:
+        msg = packet_pb2.Packet()
+    else:
+        msg = inst_dep_record_pb2.InstDepRecord()
+
+    out = PackedWriter(packed_file, kind, header, options.zlib,
+                       options.batch)
+    num_records = 0
+    while protolib.decodeMessage(proto_in, msg):
+        out.write(msg)
+        num_records += 1
+    out.close()
+    proto_in.close()
+    print("Packed %d records" % num_records)
+
+def unpack(options, packed_file, proto_file):
+    trace = PackedReader(packed_file)
+    if trace.kind == PACKET_TRACE:
+        header = packet_pb2.PacketHeader()
+        for key, value in trace.id_strings:
+            id_string = header.id_strings.add()
+            id_string.key = key
+            id_string.value = value
+    else:
+        header = inst_dep_record_pb2.InstDepRecordHeader()
+        header.window_size = trace.window_size
+    header.obj_id = trace.obj_id
+    header.ver = trace.ver
+    header.tick_freq = trace.tick_freq
+
+    proto_out = openProtoWr(proto_file)
+    # Magic number in 4-byte Little Endian, as in src/proto/protoio.cc
+    proto_out.write(b'gem5')
+    protolib.encodeMessage(proto_out, header)
+    num_records = 0
+    for msg in trace.records():
+        protolib.encodeMessage(proto_out, msg)
+        num_records += 1
+    proto_out.close()
+    print("Unpacked %d records" % num_records)
+
+def info(options, packed_file):
+    trace = PackedReader(packed_file)
+    print("Kind:", "packet" if trace.kind == PACKET_TRACE else
+          "instruction dependency")
+    print("Object id:", trace.obj_id)
+    print("Tick frequency:", trace.tick_freq)
+    if trace.kind == INST_DEP_TRACE:
+        print("Window size:", trace.window_size)
+    for key, value in trace.id_strings:
+        print("Master id %d: %s" % (key, value))
+    print("Compression:", "zlib" if trace.compression == ZLIB else "none")
+    num_batches = 0
+    num_records = 0
+    for n, cols in trace.batches():
+        num_batches += 1
+        num_records += n
+    print("Records: %d in %d batches" % (num_records, num_batches))
+
+def main():
+    parser = optparse.OptionParser(
+        usage="%prog pack|unpack|info [options] <input> [<output>]")
+    parser.add_option("--zlib", action="store_true", default=False,
+                      help="Compress the batches of the packed trace")
+    parser.add_option("--batch", type="int", default=4096,
+                      help="Records per batch of the packed trace "
+                      "[default: %default]")
+    (options, args) = parser.parse_args()
+
+    commands = { 'pack' : (pack, 3), 'unpack' : (unpack, 3),
+                 'info' : (info, 2) }
+    if not args or args[0] not in commands or \
+       len(args) != commands[args[0]][1]:
+        parser.print_usage()
+        sys.exit(1)
+    if options.batch < 1:
+        parser.error("--batch must be positive")
+
+    func, nargs = commands[args[0]]
+    func(options, *args[1:])
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,359 @@
+#!/usr/bin/env python2
+
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Check that runs with --parallel-cores are repeatable, and measure how
+# they scale with the number of cores.
+#
+#   parallel_check.py determinism [-r RUNS] -- <gem5> <config> [args]
+#   parallel_check.py scaling -p PROGRAM [-n 4,8,16] -- <gem5> <config> \
+#       [args]
+#   parallel_check.py selftest
+#
+# determinism runs the command RUNS times with --parallel-cores and
+# compares every stats dump of every run against the first run,
+# ignoring the host_* stats, as well as the output of gem5 and the
+# simulated programs, ignoring the lines that name the host, the date
+# or the output directory. It lists what differs and exits with a
+# non-zero status if anything does.
+#
+# scaling runs an se.py-style config with one copy of PROGRAM per core,
+# once on a single event queue and once with --parallel-cores, for each
+# core count. It reports the host seconds spent simulating, the speedup
+# and how far the simulated time of the parallel run is from the serial
+# one, since the domain bridges between the L1 caches and the crossbar
+# change the timing of snoops. The simulated time may differ, but if
+# what the programs print differs between the two runs, it exits with a
+# non-zero status.
+#
+# selftest runs both checks against a fake gem5 that prints made-up
+# stats and output, and makes sure that identical runs pass and that
+# every kind of difference fails, so the script can be tested without a
+# gem5 build.
+#
+# Every run gets its own output directory under --outdir.
+
+from __future__ import print_function
+
+import optparse
+import os
+import subprocess
+import sys
+
+BEGIN = "---------- Begin Simulation Statistics ----------"
+END = "---------- End Simulation Statistics   ----------"
+
+# Lines of the gem5 banner that change from run to run
+HOST_LINES = ("gem5 compiled", "gem5 started", "gem5 executing on",
+              "command line:")
+
+def run(cmd, outdir, extra):
+    """Run gem5 with its output in outdir"""
+
+    if not os.path.isdir(outdir):
+        os.makedirs(outdir)
+    args = [cmd[0], "-d", outdir] + cmd[1:] + extra
+    with open(os.path.join(outdir, "run.log"), "w") as log:
+        status = subprocess.call(args, stdout=log, stderr=subprocess.STDOUT)
+    if status != 0:
+        print("%s failed with status %d, see %s" %
+              (" ".join(args), status, os.path.join(outdir, "run.log")),
+              file=sys.stderr)
+        sys.exit(1)
+
+def readDumps(outdir):
+    """Return the stats dumps as lists of (name, value), where value
+    holds the fields of the stat as text"""
+
+    dumps = []
+    dump = None
+    with open(os.path.join(outdir, "stats.txt")) as f:
+        for line in f:
+            line = line.strip()
+            if line == BEGIN:
+                dump = []
+            elif line == END:
+                dumps.append(dump)
+                dump = None
+            elif dump is not None:
+                fields = line.split("#")[0].split()
+                if len(fields) >= 2:
+                    dump.append((fields[0], tuple(fields[1:])))
+    if not dumps:
+        raise ValueError("no complete stats dump in %s" % outdir)
+    return dumps
+
+def readFirstDump(outdir):
+    return readDumps(outdir)[0]
+
+def readOutput(path, outdir):
+    """Return the lines of an output file that should be the same in
+    every run"""
+
+    lines = []
+    with open(path) as f:
+        for line in f:
+            if not line.startswith(HOST_LINES):
+                lines.append(line.replace(outdir, "<outdir>"))
+    return lines
+
+def compareOutput(name, reference, lines, max_report):
+    """Print where two outputs differ, and return True if they do"""
+
+    if reference == lines:
+        return False
+    import difflib
+    diff = list(difflib.unified_diff(reference, lines, "reference", name,
+                                     n=0))
+    for line in diff[:max_report]:
+        print(line.rstrip("\n"))
+    if len(diff) > max_report:
+        print("... and %d more lines" % (len(diff) - max_report))
+    return True
+
+def statSum(dump, suffix):
+    total = 0.0
+    for name, value in dump:
+        if name.endswith(suffix):
+            total += float(value[0])
+    return total
+
+def statValue(dump, name):
+    for stat, value in dump:
+        if stat == name:
+            return float(value[0])
+    raise ValueError("no %s stat" % name)
+
+def determinism(options, cmd):
+    runs = []
+    for i in range(options.runs):
+        outdir = os.path.join(options.outdir, "run%d" % i)
+        run(cmd, outdir, ["--parallel-cores"])
+        runs.append(outdir)
+
+    def stats(outdir):
+        return [ dict((name, value) for name, value in dump
+                      if not name.startswith("host_"))
+                 for dump in readDumps(outdir) ]
+
+    reference = stats(runs[0])
+    differ = []
+    for i, outdir in enumerate(runs[1:], 1):
+        dumps = stats(outdir)
+        if len(dumps) != len(reference):
+            differ.append((i, "number of dumps", len(dumps),
+                           len(reference)))
+        for n, (ref, dump) in enumerate(zip(reference, dumps)):
+            for name in sorted(set(ref) | set(dump)):
+                if ref.get(name) != dump.get(name):
+                    differ.append((i, "dump %d: %s" % (n, name),
+                                   " ".join(dump.get(name, ("-",))),
+                                   " ".join(ref.get(name, ("-",)))))
+
+    print("%d runs, %d snoops copied to the cores, %d responded to by "
+          "the bridges in the first run" %
+          (options.runs,
+           statSum(reference[-1].items(), ".deferredSnoops"),
+           statSum(reference[-1].items(), ".promisedSnoops")))
+
+    for i, what, value, ref in differ[:options.max_report]:
+        print("run%d: %s: %s != %s" % (i, what, value, ref))
+    if len(differ) > options.max_report:
+        print("... and %d more" % (len(differ) - options.max_report))
+
+    # everything gem5 and the simulated programs printed
+    output_differs = False
+    reference_log = os.path.join(runs[0], "run.log")
+    for i, outdir in enumerate(runs[1:], 1):
+        log = os.path.join(outdir, "run.log")
+        output_differs |= compareOutput(
+            log, readOutput(reference_log, runs[0]),
+            readOutput(log, outdir), options.max_report)
+
+    if differ or output_differs:
+        sys.exit(1)
+    print("All runs have identical stats and output")
+
+def scaling(options, cmd):
+    if not options.program:
+        print("scaling needs --program", file=sys.stderr)
+        sys.exit(1)
+
+    print("%6s %12s %12s %8s %14s" % ("cores", "serial (s)",
+                                      "parallel (s)", "speedup",
+                                      "sim_ticks (%)"))
+    diverged = []
+    for cores in [int(n) for n in options.cores.split(",")]:
+        extra = ["-n", str(cores), "-c", ";".join([options.program] * cores)]
+        if options.options:
+            extra += ["-o", ";".join([options.options] * cores)]
+
+        # every program writes its output to a file of its own
+        serial_dir = os.path.join(options.outdir, "serial%d" % cores)
+        parallel_dir = os.path.join(options.outdir, "parallel%d" % cores)
+        def outputs(outdir):
+            return [ os.path.abspath(os.path.join(outdir, "prog%d.out" % i))
+                     for i in range(cores) ]
+        run(cmd, serial_dir,
+            extra + ["--output", ";".join(outputs(serial_dir))])
+        run(cmd, parallel_dir,
+            extra + ["--parallel-cores",
+                     "--output", ";".join(outputs(parallel_dir))])
+        for serial_out, parallel_out in zip(outputs(serial_dir),
+                                            outputs(parallel_dir)):
+            if compareOutput(parallel_out,
+                             readOutput(serial_out, serial_dir),
+                             readOutput(parallel_out, parallel_dir),
+                             options.max_report):
+                diverged.append(parallel_out)
+
+        serial = readFirstDump(serial_dir)
+        parallel = readFirstDump(parallel_dir)
+        serial_time = statValue(serial, "host_seconds")
+        parallel_time = statValue(parallel, "host_seconds")
+        serial_ticks = statValue(serial, "sim_ticks")
+        parallel_ticks = statValue(parallel, "sim_ticks")
+
+        print("%6d %12.2f %12.2f %8.2f %+14.2f" %
+              (cores, serial_time, parallel_time,
+               serial_time / parallel_time if parallel_time else 0.0,
+               (parallel_ticks - serial_ticks) / serial_ticks * 100))
+
+    if diverged:
+        print("The output of %d parallel programs differs from the serial "
+              "run" % len(diverged))
+        sys.exit(1)
+
+# Stands in for gem5 in selftest. It takes the options parallel_check
+# passes, and PARALLEL_CHECK_FAKE selects what differs in the runs
+# with --parallel-cores after the first one.
+FAKE_GEM5 = """#!%(python)s
+import os, sys
+args = sys.argv[1:]
+outdir = args[args.index("-d") + 1]
+parallel = "--parallel-cores" in args
+cores = int(args[args.index("-n") + 1]) if "-n" in args else 2
+outputs = (args[args.index("--output") + 1].split(";")
+           if "--output" in args else [])
+vary = parallel and not outdir.endswith("run0") and \\
+    os.environ.get("PARALLEL_CHECK_FAKE", "")
+print("gem5 started %%s" %% os.getpid())
+print("command line: %%s" %% " ".join(sys.argv))
+print("Redirecting output to %%s" %% outdir)
+print("Exiting @ tick 1000 because %%s" %%
+      ("a different reason" if vary == "output" else "exiting"))
+for i, path in enumerate(outputs):
+    with open(path, "w") as f:
+        f.write("program %%d: %%s\\n" %%
+                (i, "wrong" if vary == "program" and i == 1 else "ok"))
+with open(os.path.join(outdir, "stats.txt"), "w") as f:
+    for dump in range(2):
+        f.write("\\n---------- Begin Simulation Statistics ----------\\n")
+        f.write("sim_ticks %%d # Number of ticks simulated\\n" %%
+                (1000 + dump + (cores if parallel else 0)))
+        f.write("host_seconds %%d # Real time elapsed on the host\\n" %%
+                (os.getpid() %% 7 + 1))
+        f.write("system.cpu.domain_bridges.promisedSnoops %%d # Snoops\\n" %%
+                (dump + (1 if vary == "stats" else 0)))
+        f.write("\\n---------- End Simulation Statistics   ----------\\n")
+"""
+
+def selftest(options):
+    outdir = os.path.abspath(options.outdir)
+    if not os.path.isdir(outdir):
+        os.makedirs(outdir)
+    fake = os.path.join(outdir, "fake_gem5.py")
+    with open(fake, "w") as f:
+        f.write(FAKE_GEM5 % { "python": sys.executable })
+    os.chmod(fake, 0o755)
+
+    # check, difference of the fake runs, expected status
+    cases = [ (["determinism", "-r", "3"], "", 0),
+              (["determinism"], "stats", 1),
+              (["determinism"], "output", 1),
+              (["scaling", "-p", "prog", "-n", "2,4"], "", 0),
+              (["scaling", "-p", "prog", "-n", "2"], "program", 1) ]
+    failed = 0
+    for n, (check, vary, expected) in enumerate(cases):
+        case_dir = os.path.join(outdir, "case%d" % n)
+        args = [sys.executable, os.path.abspath(__file__)] + check + \
+            ["-d", case_dir, "--", fake, "config.py"]
+        env = dict(os.environ, PARALLEL_CHECK_FAKE=vary)
+        with open(os.path.join(outdir, "case%d.log" % n), "w") as log:
+            status = subprocess.call(args, stdout=log,
+                                     stderr=subprocess.STDOUT, env=env)
+        ok = status == expected
+        failed += not ok
+        print("%s: %s with %s, exit status %d" %
+              ("ok" if ok else "FAILED", check[0],
+               "differing %s" % vary if vary else "identical runs", status))
+
+    if failed:
+        print("%d of %d self-tests failed, see %s" %
+              (failed, len(cases), outdir))
+        sys.exit(1)
+    print("All self-tests passed")
+
+def main():
+    parser = optparse.OptionParser(
+        usage="%prog determinism|scaling [options] -- <gem5> <config> "
+              "[args]\n       %prog selftest [-d OUTDIR]")
+    parser.add_option("-d", "--outdir", default="parallel_check",
+                      help="Directory for the output of the runs "
+                      "[default: %default]")
+    parser.add_option("-r", "--runs", type="int", default=2,
+                      help="Runs compared by determinism [default: %default]")
+    parser.add_option("--max-report", type="int", default=20,
+                      help="Differing stats to list [default: %default]")
+    parser.add_option("-n", "--cores", default="4,8,16",
+                      help="Core counts run by scaling [default: %default]")
+    parser.add_option("-p", "--program", default=None,
+                      help="Program run on every core by scaling")
+    parser.add_option("-o", "--options", default=None,
+                      help="Arguments of the program run by scaling")
+    (options, args) = parser.parse_args()
+
+    if args == ["selftest"]:
+        selftest(options)
+        return
+    if len(args) < 3 or args[0] not in ("determinism", "scaling"):
+        parser.print_usage()
+        sys.exit(1)
+    if options.runs < 2:
+        print("determinism needs at least two runs", file=sys.stderr)
+        sys.exit(1)
+
+    mode, cmd = args[0], args[1:]
+    if cmd[0] == "--":
+        cmd = cmd[1:]
+    if mode == "determinism":
+        determinism(options, cmd)
+    else:
+        scaling(options, cmd)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python2
+
+# Copyright (c) 2018 Harvard University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Combine the stats of the runs restored from SimPoint checkpoints into
+# an estimate for the whole workload.
+#
+#   simpoint_stats.py <restored outdir>... [-o stats.txt]
+#
+# Each output directory holds the stats.txt of a run started with
+# --restore-simpoint-checkpoint, and the simpoint.txt it wrote with the
+# weight of its simpoint. The last stats dump of each run covers the
+# simulated interval, after its warmup. Every stat of the estimate is
+# the average of that stat over the runs, weighted by the simpoint
+# weights, so it describes one interval of the workload. Stats missing
+# from a run count as zero.
+
+from __future__ import print_function
+
+import optparse
+import os
+import sys
+
+BEGIN = "---------- Begin Simulation Statistics ----------"
+END = "---------- End Simulation Statistics   ----------"
+
+def readWeight(outdir):
+    with open(os.path.join(outdir, "simpoint.txt")) as f:
+        fields = dict(line.split(None, 1) for line in f if line.strip())
+    return float(fields["weight"])
+
+def readLastDump(outdir):
+    """Return the stats of the last dump as a list of (name, value)"""
+
+    dump = None
+    with open(os.path.join(outdir, "stats.txt")) as f:
+        for line in f:
+            line = line.strip()
+            if line == BEGIN:
+                current = []
+            elif line == END:
+                dump = current
+            elif line:
+                fields = line.split()
+                if len(fields) < 2:
+                    continue
+                try:
+                    current.append((fields[0], float(fields[1])))
+                except ValueError:
+                    pass
+    if dump is None:
+        raise ValueError("no stats dump in %s" % outdir)
+    return dump
+
+def main():
+    parser = optparse.OptionParser(
+        usage="%prog [options] <restored outdir>...")
+    parser.add_option("-o", "--output", default=None,
+                      help="Write the estimate to this file [default: stdout]")
+    (options, outdirs) = parser.parse_args()
+    if not outdirs:
+        parser.print_usage()
+        sys.exit(1)
+
+    names = []
+    totals = {}
+    total_weight = 0.0
+    for outdir in outdirs:
+        weight = readWeight(outdir)
+        total_weight += weight
+        for name, value in readLastDump(outdir):
+            if name not in totals:
+                names.append(name)
+                totals[name] = 0.0
+            totals[name] += weight * value
+
+    if total_weight <= 0.0:
+        print("The simpoints have no weight", file=sys.stderr)
+        sys.exit(1)
+
+    out = open(options.output, "w") if options.output else sys.stdout
+    out.write("# Weighted estimate from %d simpoints covering %.1f%% of the "
+              "workload\n" % (len(outdirs), total_weight * 100))
+    for name in names:
+        out.write("%-60s %16.6f\n" % (name, totals[name] / total_weight))
+    if options.output:
+        out.close()
+
+if __name__ == "__main__":
+    main()